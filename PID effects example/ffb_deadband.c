@@ -0,0 +1,55 @@
+#include "ffb_deadband.h"
+
+#include <string.h>
+
+void ffb_deadband_init(ffb_deadband* deadband, int floor, int weber, unsigned int max_skip) {
+    memset(deadband, 0x00, sizeof(*deadband));
+
+    deadband->floor = floor > 0 ? floor : 0;
+    deadband->weber = weber > 0 ? weber : 0;
+    deadband->max_skip = max_skip ? max_skip : 1;
+}
+
+void ffb_deadband_reset(ffb_deadband* deadband) {
+    deadband->primed = 0;
+}
+
+int ffb_deadband_update(ffb_deadband* deadband, short magnitude, short* out) {
+    int error, last_abs;
+    long jnd;
+
+    deadband->ticks++;
+
+    if (deadband->primed) {
+        error = magnitude - deadband->last;
+        if (error < 0)
+            error = -error;
+        last_abs = deadband->last < 0 ? -deadband->last : deadband->last;
+
+        jnd = (long)last_abs * deadband->weber / FFB_DEADBAND_UNITY;
+        if (jnd < deadband->floor)
+            jnd = deadband->floor;
+
+        deadband->accumulated += error;
+        deadband->skipped++;
+        if (deadband->accumulated <= jnd && deadband->skipped < deadband->max_skip) {
+            if (error > deadband->max_error)
+                deadband->max_error = error;
+            return 0;
+        }
+    }
+
+    deadband->primed = 1;
+    deadband->last = magnitude;
+    deadband->accumulated = 0;
+    deadband->skipped = 0;
+    deadband->sent++;
+    *out = magnitude;
+    return 1;
+}
+
+int ffb_deadband_reduction(const ffb_deadband* deadband) {
+    if (deadband->ticks == 0)
+        return 0;
+    return (int)((deadband->ticks - deadband->sent) * 100 / deadband->ticks);
+}
@@ -0,0 +1,47 @@
+// Perceptual dead-band
+// Suppresses SET_CONSTANT_FORCE_REPORT updates the driver cannot feel.
+// The just-noticeable difference follows Weber's law:
+//      jnd = max(floor, weber * |last sent magnitude|)
+// The error |magnitude - last sent| is accumulated on every tick and an
+// update is sent once the sum exceeds the jnd, so a large step goes out
+// right away and a slow drift goes out after a few ticks. An update is
+// sent at least every max_skip ticks whatever the error.
+//
+// ffb_deadband_update() only depends on its inputs, so a recorded trace
+// can be replayed through it to check the fidelity of a setting.
+
+#ifndef FFB_DEADBAND_H__
+#define FFB_DEADBAND_H__
+
+// Unity of the Q8 Weber fraction
+#define FFB_DEADBAND_UNITY 256
+
+typedef struct ffb_deadband {
+    int floor;              // Absolute jnd, in magnitude units
+    int weber;              // Relative jnd, Q8 of the last sent magnitude
+    unsigned int max_skip;  // Ticks without an update before one is forced
+
+    int primed;             // Something has been sent
+    int last;               // Last sent magnitude
+    long accumulated;       // Error accumulated since the last update
+    unsigned int skipped;   // Ticks since the last update
+
+    // Statistics
+    long ticks;
+    long sent;
+    int max_error;          // Largest |magnitude - last sent| while suppressed
+} ffb_deadband;
+
+// e.g. floor 16, weber FFB_DEADBAND_UNITY / 20 (5%), max_skip 10
+void ffb_deadband_init(ffb_deadband* deadband, int floor, int weber, unsigned int max_skip);
+
+// Returns 1 and sets *out to the magnitude to send, 0 to skip the tick
+int ffb_deadband_update(ffb_deadband* deadband, short magnitude, short* out);
+
+// The next update is sent whatever the error (e.g. after a device reset)
+void ffb_deadband_reset(ffb_deadband* deadband);
+
+// Percentage of the ticks that did not send an update
+int ffb_deadband_reduction(const ffb_deadband* deadband);
+
+#endif // FFB_DEADBAND_H__
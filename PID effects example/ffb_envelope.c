@@ -0,0 +1,215 @@
+#include "ffb_envelope.h"
+
+#include <string.h>
+
+#include "pid_effect.h"
+#include "pid_reports.h"
+
+#define FFB_MAGNITUDE_MAX 32767
+
+static int envelope_clamp_level(int level) {
+    if (level < 0)
+        return 0;
+    if (level > FFB_MAGNITUDE_MAX)
+        return FFB_MAGNITUDE_MAX;
+    return level;
+}
+
+void ffb_envelope_init(ffb_envelope* envelope) {
+    memset(envelope, 0x00, sizeof(*envelope));
+}
+
+void ffb_envelope_set(ffb_envelope* envelope, int slot, const ffb_envelope_params* params) {
+    int magnitude;
+    int attack_level, fade_level;
+    unsigned long attack_ms, fade_ms, duration;
+
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS)
+        return;
+
+    magnitude = params->magnitude < 0 ? -params->magnitude : params->magnitude;
+    magnitude = envelope_clamp_level(magnitude);
+    attack_level = envelope_clamp_level(params->attack_level);
+    fade_level = envelope_clamp_level(params->fade_level);
+    attack_ms = params->attack_time_ms;
+    fade_ms = params->fade_time_ms;
+    duration = params->duration_ms;
+
+    // The attack and the fade share the duration, the attack first
+    if (duration != FFB_ENVELOPE_INFINITE) {
+        if (attack_ms > duration)
+            attack_ms = duration;
+        if (fade_ms > duration - attack_ms)
+            fade_ms = duration - attack_ms;
+    }
+
+    envelope->negative[slot] = params->magnitude < 0;
+    envelope->sustain[slot] = magnitude;
+    envelope->attack_level[slot] = attack_level;
+    envelope->fade_level[slot] = fade_level;
+    envelope->attack_ms[slot] = attack_ms;
+    envelope->duration_ms[slot] = duration;
+    envelope->start_delay_ms[slot] = params->start_delay_ms;
+    // An infinite effect never fades
+    envelope->fade_start_ms[slot] = duration == FFB_ENVELOPE_INFINITE ? FFB_ENVELOPE_INFINITE : duration - fade_ms;
+
+    envelope->attack_slope[slot] = attack_ms ? ((long long)(magnitude - attack_level) << 16) / (long long)attack_ms : 0;
+    envelope->fade_slope[slot] = fade_ms ? ((long long)(fade_level - magnitude) << 16) / (long long)fade_ms : 0;
+}
+
+int ffb_envelope_add(ffb_envelope* envelope, const ffb_envelope_params* params, int mode) {
+    int i;
+
+    for (i = 0; i < FFB_ENVELOPE_MAX_EFFECTS; i++) {
+        if (envelope->used[i])
+            continue;
+
+        envelope->used[i] = 1;
+        envelope->mode[i] = (unsigned char)mode;
+        envelope->playing[i] = 0;
+        envelope->output[i] = 0;
+        ffb_envelope_set(envelope, i, params);
+        if (i >= envelope->count)
+            envelope->count = i + 1;
+        return i;
+    }
+
+    return -1;
+}
+
+void ffb_envelope_remove(ffb_envelope* envelope, int slot) {
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS)
+        return;
+
+    envelope->used[slot] = 0;
+    envelope->playing[slot] = 0;
+    envelope->output[slot] = 0;
+    while (envelope->count > 0 && !envelope->used[envelope->count - 1])
+        envelope->count--;
+}
+
+void ffb_envelope_set_mode(ffb_envelope* envelope, int slot, int mode) {
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS)
+        return;
+
+    envelope->mode[slot] = (unsigned char)mode;
+    envelope->output[slot] = 0;
+}
+
+// SET_ENVELOPE_REPORT, SET_CONSTANT_FORCE_REPORT and SET_EFFECT_REPORT
+// of the slot, started
+static int envelope_upload(ffb_envelope* envelope, int slot, pid_writer* writer, pid_templates* templates) {
+    unsigned long duration = envelope->duration_ms[slot];
+    unsigned long max = PID_DURATION_INFINITE - 1;
+    pid_effect_desc desc;
+    int index;
+
+    // The duration is in ms up to the logical maximum of its field,
+    // PID_DURATION_INFINITE playing until stopped
+    if (templates->duration && (unsigned long)templates->duration->logical_max < max)
+        max = (unsigned long)templates->duration->logical_max;
+    if (duration != FFB_ENVELOPE_INFINITE && duration > max)
+        return -1;
+    if (pid_effect_desc_init(&desc, templates, PID_ET_CONSTANT_FORCE))
+        return -1;
+    desc.duration = duration == FFB_ENVELOPE_INFINITE ? PID_DURATION_INFINITE : (long)duration;
+    desc.start_delay = (long)envelope->start_delay_ms[slot];
+    desc.magnitude = envelope->negative[slot] ? -envelope->sustain[slot] : envelope->sustain[slot];
+    desc.attack_level = envelope->attack_level[slot];
+    desc.attack_time = (long)envelope->attack_ms[slot];
+    desc.fade_level = envelope->fade_level[slot];
+    desc.fade_time = duration == FFB_ENVELOPE_INFINITE ? 0 : (long)(duration - envelope->fade_start_ms[slot]);
+    desc.start = 1;
+
+    index = pid_effect_create(writer, templates, &desc);
+    if (index < 0)
+        return -1;
+    envelope->index[slot] = index;
+    return 0;
+}
+
+int ffb_envelope_start(ffb_envelope* envelope, int slot, pid_writer* writer, pid_templates* templates, unsigned long now_ms) {
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS || !envelope->used[slot])
+        return -1;
+
+    if (envelope->index[slot] > 0) {
+        pid_effect_free(writer, templates, (unsigned char)envelope->index[slot]);
+        envelope->index[slot] = 0;
+    }
+    if (envelope->mode[slot] == FFB_ENVELOPE_DEVICE && envelope_upload(envelope, slot, writer, templates))
+        return -1;
+
+    envelope->start_ms[slot] = now_ms + envelope->start_delay_ms[slot];
+    envelope->playing[slot] = 1;
+    return 0;
+}
+
+void ffb_envelope_stop(ffb_envelope* envelope, int slot, pid_writer* writer, pid_templates* templates) {
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS)
+        return;
+
+    if (envelope->index[slot] > 0) {
+        pid_effect_free(writer, templates, (unsigned char)envelope->index[slot]);
+        envelope->index[slot] = 0;
+    }
+    envelope->playing[slot] = 0;
+    envelope->output[slot] = 0;
+}
+
+int ffb_envelope_playing(const ffb_envelope* envelope, int slot) {
+    if (slot < 0 || slot >= FFB_ENVELOPE_MAX_EFFECTS)
+        return 0;
+    return envelope->playing[slot];
+}
+
+void ffb_envelope_eval(ffb_envelope* envelope, unsigned long now_ms) {
+    unsigned long elapsed;
+    long level;
+    int i;
+
+    for (i = 0; i < envelope->count; i++) {
+        if (!envelope->playing[i]) {
+            envelope->output[i] = 0;
+            continue;
+        }
+
+        // Still in the start delay (the difference wraps around)
+        elapsed = now_ms - envelope->start_ms[i];
+        if ((long)elapsed < 0) {
+            envelope->output[i] = 0;
+            continue;
+        }
+
+        // The device ends its effects by itself, their block stays
+        // until they are stopped
+        if (elapsed >= envelope->duration_ms[i] || envelope->mode[i] != FFB_ENVELOPE_HOST) {
+            if (elapsed >= envelope->duration_ms[i])
+                envelope->playing[i] = 0;
+            envelope->output[i] = 0;
+            continue;
+        }
+
+        if (elapsed < envelope->attack_ms[i])
+            level = envelope->attack_level[i] + (long)((envelope->attack_slope[i] * (long long)elapsed) >> 16);
+        else if (elapsed > envelope->fade_start_ms[i])
+            level = envelope->sustain[i] + (long)((envelope->fade_slope[i] * (long long)(elapsed - envelope->fade_start_ms[i])) >> 16);
+        else
+            level = envelope->sustain[i];
+
+        envelope->output[i] = (short)(envelope->negative[i] ? -level : level);
+    }
+}
+
+short ffb_envelope_sum(const ffb_envelope* envelope) {
+    long sum = 0;
+    int i;
+
+    for (i = 0; i < envelope->count; i++)
+        sum += envelope->output[i];
+
+    if (sum > FFB_MAGNITUDE_MAX)
+        sum = FFB_MAGNITUDE_MAX;
+    if (sum < -FFB_MAGNITUDE_MAX)
+        sum = -FFB_MAGNITUDE_MAX;
+    return (short)sum;
+}
@@ -0,0 +1,93 @@
+// Host-side envelope and duration engine
+// Evaluates attack level/time, fade level/time, start delay and duration
+// of many effects at once, so a short-lived effect can be rendered by the
+// host and streamed as a constant force instead of uploading its
+// SET_ENVELOPE_REPORT and SET_EFFECT_REPORT over USB.
+//
+// Each effect is rendered either by the device (started as a constant
+// force effect with its SET_ENVELOPE_REPORT through pid_effect_create())
+// or by the host. Parameters are stored as a structure of arrays with
+// slopes precomputed in Q16, so ffb_envelope_eval() is a linear walk with
+// one multiply per effect.
+
+#ifndef FFB_ENVELOPE_H__
+#define FFB_ENVELOPE_H__
+
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+#define FFB_ENVELOPE_MAX_EFFECTS 32
+
+// Duration of an effect that plays until it is stopped
+#define FFB_ENVELOPE_INFINITE 0xffffffffUL
+
+enum FFB_ENVELOPE_MODE {
+    FFB_ENVELOPE_DEVICE = 0, // Uploaded with pid_effect_create() when started
+    FFB_ENVELOPE_HOST,       // Evaluated by ffb_envelope_eval()
+};
+
+typedef struct ffb_envelope_params {
+    int magnitude;                // Sustain level with its sign, -32767..32767
+    int attack_level;             // 0..32767
+    int fade_level;               // 0..32767
+    unsigned long attack_time_ms;
+    unsigned long fade_time_ms;
+    unsigned long start_delay_ms;
+    unsigned long duration_ms;    // FFB_ENVELOPE_INFINITE plays until stopped
+} ffb_envelope_params;
+
+typedef struct ffb_envelope {
+    unsigned char used[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned char mode[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned char playing[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned char negative[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned long start_ms[FFB_ENVELOPE_MAX_EFFECTS];      // Start time, start delay included
+    unsigned long attack_ms[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned long fade_start_ms[FFB_ENVELOPE_MAX_EFFECTS]; // From the start
+    unsigned long duration_ms[FFB_ENVELOPE_MAX_EFFECTS];
+    unsigned long start_delay_ms[FFB_ENVELOPE_MAX_EFFECTS];
+    int sustain[FFB_ENVELOPE_MAX_EFFECTS];                 // |magnitude|
+    int attack_level[FFB_ENVELOPE_MAX_EFFECTS];
+    int fade_level[FFB_ENVELOPE_MAX_EFFECTS];
+    long long attack_slope[FFB_ENVELOPE_MAX_EFFECTS];      // Q16 level per ms
+    long long fade_slope[FFB_ENVELOPE_MAX_EFFECTS];
+    short output[FFB_ENVELOPE_MAX_EFFECTS];                // Result of the last evaluation
+    int index[FFB_ENVELOPE_MAX_EFFECTS];                   // Effect Block Index of a device effect, 0 if not uploaded
+    int count;  // Highest used slot + 1
+} ffb_envelope;
+
+void ffb_envelope_init(ffb_envelope* envelope);
+
+// Adds an effect, stopped. Returns its slot, or -1 if every slot is taken.
+int ffb_envelope_add(ffb_envelope* envelope, const ffb_envelope_params* params, int mode);
+// A device effect is stopped first, or its block is left on the device
+void ffb_envelope_remove(ffb_envelope* envelope, int slot);
+
+// Changes the parameters, a host effect keeps playing from where it is,
+// a device effect gets them at its next start. So does a change of mode
+void ffb_envelope_set(ffb_envelope* envelope, int slot, const ffb_envelope_params* params);
+void ffb_envelope_set_mode(ffb_envelope* envelope, int slot, int mode);
+
+// now_ms is any millisecond clock, e.g. pid_time_us() / 1000.
+// Device mode: creates and starts the constant force effect with
+// pid_effect_create(), replacing the one of the last start. Its reports,
+// and the Block Free of a stop, go through the writer loop, which may be
+// streaming.
+// Returns 0 on success, -1 if the slot is not used, the effect could not
+// be created or, in device mode, a finite duration does not fit the
+// Duration field of the SET_EFFECT_REPORT
+int ffb_envelope_start(ffb_envelope* envelope, int slot, pid_writer* writer, pid_templates* templates, unsigned long now_ms);
+// Frees the device effect, if any, and stops the effect
+void ffb_envelope_stop(ffb_envelope* envelope, int slot, pid_writer* writer, pid_templates* templates);
+
+// Returns 1 until the duration of the effect has elapsed or it is stopped
+int ffb_envelope_playing(const ffb_envelope* envelope, int slot);
+
+// Evaluates every host effect at now_ms into output[], and ends the
+// device effects whose duration has elapsed
+void ffb_envelope_eval(ffb_envelope* envelope, unsigned long now_ms);
+
+// Sum of the outputs of the host effects, clamped to -32767..32767
+short ffb_envelope_sum(const ffb_envelope* envelope);
+
+#endif // FFB_ENVELOPE_H__
@@ -0,0 +1,413 @@
+#include "ffb_expr.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum FFB_EXPR_OP {
+    EXPR_CONST = 0,
+    EXPR_VAR,
+    EXPR_TIME,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_POW,
+    EXPR_NEG,
+    EXPR_SIN,
+    EXPR_COS,
+    EXPR_ABS,
+    EXPR_SQRT,
+    EXPR_EXP,
+    EXPR_FLOOR,
+    EXPR_MIN,
+    EXPR_MAX,
+    EXPR_CLAMP,
+};
+
+typedef struct expr_function {
+    const char* name;
+    int op;
+    unsigned int args;
+} expr_function;
+
+static const expr_function expr_functions[] = {
+    { "sin", EXPR_SIN, 1 },
+    { "cos", EXPR_COS, 1 },
+    { "abs", EXPR_ABS, 1 },
+    { "sqrt", EXPR_SQRT, 1 },
+    { "exp", EXPR_EXP, 1 },
+    { "floor", EXPR_FLOOR, 1 },
+    { "min", EXPR_MIN, 2 },
+    { "max", EXPR_MAX, 2 },
+    { "clamp", EXPR_CLAMP, 3 },
+};
+
+typedef struct expr_parser {
+    ffb_expr* expr;
+    const char* source;
+    const char* p;
+    unsigned int sp;    // Next free register
+} expr_parser;
+
+static float expr_apply(int op, float a, float b, float c) {
+    switch (op) {
+    case EXPR_ADD: return a + b;
+    case EXPR_SUB: return a - b;
+    case EXPR_MUL: return a * b;
+    case EXPR_DIV: return b != 0.0f ? a / b : 0.0f;
+    case EXPR_POW: return powf(a, b);
+    case EXPR_NEG: return -a;
+    case EXPR_SIN: return sinf(a);
+    case EXPR_COS: return cosf(a);
+    case EXPR_ABS: return fabsf(a);
+    case EXPR_SQRT: return a > 0.0f ? sqrtf(a) : 0.0f;
+    case EXPR_EXP: return expf(a);
+    case EXPR_FLOOR: return floorf(a);
+    case EXPR_MIN: return a < b ? a : b;
+    case EXPR_MAX: return a > b ? a : b;
+    case EXPR_CLAMP: return a < b ? b : (a > c ? c : a);
+    default: return 0.0f;
+    }
+}
+
+static int expr_fail_at(expr_parser* parser, const char* at, const char* error) {
+    if (!parser->expr->error) {
+        parser->expr->error = error;
+        parser->expr->error_pos = (int)(at - parser->source);
+    }
+    return -1;
+}
+
+static int expr_fail(expr_parser* parser, const char* error) {
+    return expr_fail_at(parser, parser->p, error);
+}
+
+static void expr_skip(expr_parser* parser) {
+    while (isspace((unsigned char)*parser->p))
+        parser->p++;
+}
+
+static int expr_emit(expr_parser* parser, int op, unsigned int dst, unsigned int args, float value) {
+    ffb_expr* expr = parser->expr;
+    ffb_expr_op* code;
+    unsigned int i;
+
+    // Operands are in dst..dst + args - 1: fold them if they are constants
+    if (args > 0 && expr->length >= args) {
+        for (i = 0; i < args; i++) {
+            code = &expr->code[expr->length - args + i];
+            if (code->op != EXPR_CONST || code->dst != dst + i)
+                break;
+        }
+        if (i == args) {
+            code = &expr->code[expr->length - args];
+            code->value = expr_apply(op, code[0].value,
+                                     args > 1 ? code[1].value : 0.0f,
+                                     args > 2 ? code[2].value : 0.0f);
+            expr->length -= args - 1;
+            return 0;
+        }
+    }
+
+    if (expr->length >= FFB_EXPR_MAX_CODE)
+        return expr_fail(parser, "expression too long");
+
+    code = &expr->code[expr->length++];
+    code->op = (unsigned char)op;
+    code->dst = (unsigned char)dst;
+    code->a = (unsigned char)dst;
+    code->b = (unsigned char)(dst + 1);
+    code->c = (unsigned char)(dst + 2);
+    code->value = value;
+    return 0;
+}
+
+static int expr_push(expr_parser* parser, unsigned int* reg) {
+    if (parser->sp >= FFB_EXPR_MAX_REGS)
+        return expr_fail(parser, "expression too deep");
+    *reg = parser->sp++;
+    if (parser->sp > parser->expr->regs)
+        parser->expr->regs = parser->sp;
+    return 0;
+}
+
+static int expr_parse(expr_parser* parser);
+static int expr_unary(expr_parser* parser);
+
+static int expr_name(expr_parser* parser, char* name) {
+    unsigned int n = 0;
+
+    while (isalnum((unsigned char)*parser->p) || *parser->p == '_') {
+        if (n + 1 >= FFB_EXPR_MAX_NAME)
+            return expr_fail(parser, "name too long");
+        name[n++] = *parser->p++;
+    }
+    name[n] = '\0';
+    return 0;
+}
+
+// Errors about the call point at its name, which starts at start
+static int expr_call(expr_parser* parser, const char* name, const char* start, unsigned int reg) {
+    const expr_function* fn = NULL;
+    unsigned int i, args = 0;
+
+    for (i = 0; i < sizeof(expr_functions) / sizeof(expr_functions[0]); i++) {
+        if (strcmp(expr_functions[i].name, name) == 0)
+            fn = &expr_functions[i];
+    }
+    if (!fn)
+        return expr_fail_at(parser, start, "unknown function");
+
+    // The first argument lands in reg, the next ones right after it
+    parser->p++;
+    parser->sp = reg;
+    for (;;) {
+        if (expr_parse(parser))
+            return -1;
+        args++;
+        expr_skip(parser);
+        if (*parser->p != ',')
+            break;
+        parser->p++;
+    }
+    if (*parser->p != ')')
+        return expr_fail(parser, "expected )");
+    parser->p++;
+    if (args != fn->args)
+        return expr_fail_at(parser, start, "wrong number of arguments");
+
+    parser->sp = reg + 1;
+    return expr_emit(parser, fn->op, reg, args, 0.0f);
+}
+
+static int expr_primary(expr_parser* parser) {
+    char name[FFB_EXPR_MAX_NAME];
+    const char* start;
+    unsigned int reg, i;
+    char* end;
+    float value;
+
+    expr_skip(parser);
+
+    if (*parser->p == '(') {
+        parser->p++;
+        if (expr_parse(parser))
+            return -1;
+        expr_skip(parser);
+        if (*parser->p != ')')
+            return expr_fail(parser, "expected )");
+        parser->p++;
+        return 0;
+    }
+
+    if (isdigit((unsigned char)*parser->p) || *parser->p == '.') {
+        value = (float)strtod(parser->p, &end);
+        if (end == parser->p)
+            return expr_fail(parser, "bad number");
+        parser->p = end;
+        if (expr_push(parser, &reg))
+            return -1;
+        return expr_emit(parser, EXPR_CONST, reg, 0, value);
+    }
+
+    if (!isalpha((unsigned char)*parser->p) && *parser->p != '_')
+        return expr_fail(parser, "expected a value");
+
+    start = parser->p;
+    if (expr_name(parser, name) || expr_push(parser, &reg))
+        return -1;
+    expr_skip(parser);
+    if (*parser->p == '(')
+        return expr_call(parser, name, start, reg);
+
+    if (strcmp(name, "t") == 0)
+        return expr_emit(parser, EXPR_TIME, reg, 0, 0.0f);
+    for (i = 0; i < parser->expr->var_count; i++) {
+        if (strcmp(parser->expr->names[i], name) == 0)
+            return expr_emit(parser, EXPR_VAR, reg, 0, (float)i);
+    }
+    return expr_fail_at(parser, start, "unknown variable");
+}
+
+// power := primary ('^' unary)?, right associative
+static int expr_power(expr_parser* parser) {
+    if (expr_primary(parser))
+        return -1;
+    expr_skip(parser);
+    if (*parser->p != '^')
+        return 0;
+    parser->p++;
+    if (expr_unary(parser))
+        return -1;
+    parser->sp--;
+    return expr_emit(parser, EXPR_POW, parser->sp - 1, 2, 0.0f);
+}
+
+static int expr_unary(expr_parser* parser) {
+    expr_skip(parser);
+    if (*parser->p == '-') {
+        parser->p++;
+        if (expr_unary(parser))
+            return -1;
+        return expr_emit(parser, EXPR_NEG, parser->sp - 1, 1, 0.0f);
+    }
+    if (*parser->p == '+')
+        parser->p++;
+    return expr_power(parser);
+}
+
+static int expr_term(expr_parser* parser) {
+    int op;
+
+    if (expr_unary(parser))
+        return -1;
+    for (;;) {
+        expr_skip(parser);
+        if (*parser->p == '*')
+            op = EXPR_MUL;
+        else if (*parser->p == '/')
+            op = EXPR_DIV;
+        else
+            return 0;
+        parser->p++;
+        if (expr_unary(parser))
+            return -1;
+        parser->sp--;
+        if (expr_emit(parser, op, parser->sp - 1, 2, 0.0f))
+            return -1;
+    }
+}
+
+static int expr_parse(expr_parser* parser) {
+    int op;
+
+    if (expr_term(parser))
+        return -1;
+    for (;;) {
+        expr_skip(parser);
+        if (*parser->p == '+')
+            op = EXPR_ADD;
+        else if (*parser->p == '-')
+            op = EXPR_SUB;
+        else
+            return 0;
+        parser->p++;
+        if (expr_term(parser))
+            return -1;
+        parser->sp--;
+        if (expr_emit(parser, op, parser->sp - 1, 2, 0.0f))
+            return -1;
+    }
+}
+
+int ffb_expr_compile(ffb_expr* expr, const char* source, const char* const* names, unsigned int name_count) {
+    expr_parser parser;
+    const char* p;
+    unsigned int i;
+
+    memset(expr, 0x00, sizeof(*expr));
+    parser.expr = expr;
+    parser.source = source;
+    parser.p = source;
+    parser.sp = 0;
+
+    if (name_count > FFB_EXPR_MAX_VARS)
+        return expr_fail(&parser, "too many variables");
+    for (i = 0; i < name_count; i++) {
+        if (strlen(names[i]) >= FFB_EXPR_MAX_NAME)
+            return expr_fail(&parser, "name too long");
+        memcpy(expr->names[i], names[i], strlen(names[i]) + 1);
+    }
+    expr->var_count = name_count;
+
+    // Optional "force =", the name cannot start with a digit
+    expr_skip(&parser);
+    p = parser.p;
+    while (isalpha((unsigned char)*p) || *p == '_' || (p != parser.p && isdigit((unsigned char)*p)))
+        p++;
+    while (isspace((unsigned char)*p))
+        p++;
+    if (p != parser.p && *p == '=')
+        parser.p = p + 1;
+
+    if (expr_parse(&parser))
+        return -1;
+    expr_skip(&parser);
+    if (*parser.p != '\0')
+        return expr_fail(&parser, "unexpected character");
+    return 0;
+}
+
+void ffb_expr_eval(const ffb_expr* expr, float t, float dt, const float* const* vars, float* out, unsigned int count) {
+    float regs[FFB_EXPR_MAX_REGS][FFB_EXPR_BLOCK];
+    const ffb_expr_op* code;
+    const float* v;
+    float* d;
+    const float* a;
+    const float* b;
+    const float* c;
+    unsigned int offset, n, i, k;
+
+    for (offset = 0; offset < count; offset += n) {
+        n = count - offset < FFB_EXPR_BLOCK ? count - offset : FFB_EXPR_BLOCK;
+
+        for (k = 0; k < expr->length; k++) {
+            code = &expr->code[k];
+            d = regs[code->dst];
+            a = regs[code->a];
+            b = regs[code->b % FFB_EXPR_MAX_REGS];
+            c = regs[code->c % FFB_EXPR_MAX_REGS];
+
+            switch (code->op) {
+            case EXPR_CONST:
+                for (i = 0; i < n; i++)
+                    d[i] = code->value;
+                break;
+            case EXPR_VAR:
+                v = vars[(int)code->value] + offset;
+                for (i = 0; i < n; i++)
+                    d[i] = v[i];
+                break;
+            case EXPR_TIME:
+                for (i = 0; i < n; i++)
+                    d[i] = t + (float)(offset + i) * dt;
+                break;
+            case EXPR_ADD:
+                for (i = 0; i < n; i++)
+                    d[i] = a[i] + b[i];
+                break;
+            case EXPR_SUB:
+                for (i = 0; i < n; i++)
+                    d[i] = a[i] - b[i];
+                break;
+            case EXPR_MUL:
+                for (i = 0; i < n; i++)
+                    d[i] = a[i] * b[i];
+                break;
+            case EXPR_NEG:
+                for (i = 0; i < n; i++)
+                    d[i] = -a[i];
+                break;
+            case EXPR_MIN:
+                for (i = 0; i < n; i++)
+                    d[i] = a[i] < b[i] ? a[i] : b[i];
+                break;
+            case EXPR_MAX:
+                for (i = 0; i < n; i++)
+                    d[i] = a[i] > b[i] ? a[i] : b[i];
+                break;
+            default:
+                for (i = 0; i < n; i++)
+                    d[i] = expr_apply(code->op, a[i], b[i], c[i]);
+                break;
+            }
+        }
+
+        if (expr->length == 0)
+            memset(out + offset, 0x00, n * sizeof(*out));
+        else
+            memcpy(out + offset, regs[0], n * sizeof(*out));
+    }
+}
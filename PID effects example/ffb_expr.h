@@ -0,0 +1,59 @@
+// Expression language for custom effects
+// A designer writes the force as an expression, e.g.
+//      force = k * sin(speed * t) * roughness
+// compiled once by ffb_expr_compile() into a register bytecode, then
+// evaluated by ffb_expr_eval() over a block of samples: each instruction
+// loops over the block, so the cost of decoding is paid once per block
+// and the loops vectorize.
+//
+// Syntax: numbers, + - * / ^ (power), unary -, parentheses,
+//      t                   time in seconds,
+//      names               variables given at compile time, a block of
+//                          samples each (telemetry, wheel angle, ...),
+//      sin(x) cos(x) abs(x) sqrt(x) exp(x) floor(x)
+//      min(a, b) max(a, b) clamp(x, lo, hi)
+// A leading "name =" is ignored. Operations on constants only are folded
+// at compile time.
+//
+// In ffb_graph.h an expression node binds its inputs to the variables.
+
+#ifndef FFB_EXPR_H__
+#define FFB_EXPR_H__
+
+#define FFB_EXPR_MAX_CODE 64
+#define FFB_EXPR_MAX_REGS 16
+#define FFB_EXPR_MAX_VARS 8
+#define FFB_EXPR_MAX_NAME 16
+#define FFB_EXPR_BLOCK 32
+
+typedef struct ffb_expr_op {
+    unsigned char op;
+    unsigned char dst;
+    unsigned char a;
+    unsigned char b;
+    unsigned char c;
+    float value;        // Constant, or index of a variable
+} ffb_expr_op;
+
+typedef struct ffb_expr {
+    ffb_expr_op code[FFB_EXPR_MAX_CODE];
+    unsigned int length;
+    unsigned int regs;  // Registers used
+    unsigned int var_count;
+    char names[FFB_EXPR_MAX_VARS][FFB_EXPR_MAX_NAME];
+
+    // Set when the compilation fails
+    const char* error;
+    int error_pos;
+} ffb_expr;
+
+// names are the variables, in the order of ffb_expr_eval()'s vars.
+// Returns 0 on success, -1 with error and error_pos (offset in source of
+// the name or character at fault) set otherwise
+int ffb_expr_compile(ffb_expr* expr, const char* source, const char* const* names, unsigned int name_count);
+
+// Writes count samples to out, sample n being at time t + n * dt (seconds).
+// vars[i] holds count samples of variable i.
+void ffb_expr_eval(const ffb_expr* expr, float t, float dt, const float* const* vars, float* out, unsigned int count);
+
+#endif // FFB_EXPR_H__
@@ -0,0 +1,174 @@
+#include "ffb_filter.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFB_FILTER_SSE 1
+#endif
+
+#define FFB_FILTER_PI 3.14159265358979f
+
+// States below this are flushed at the end of a block, denormals are slow
+#define FFB_FILTER_DENORMAL 1e-20f
+
+int ffb_filter_init(ffb_filter* filter, unsigned int channels, float sample_rate_hz) {
+    unsigned int s, c;
+
+    memset(filter, 0x00, sizeof(*filter));
+
+    if (channels == 0 || channels > FFB_FILTER_MAX_CHANNELS || sample_rate_hz <= 0.0f)
+        return -1;
+
+    filter->channels = channels;
+    filter->sample_rate = sample_rate_hz;
+    for (s = 0; s < FFB_FILTER_MAX_STAGES; s++) {
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++)
+            filter->b0[s][c] = 1.0f;
+    }
+    return 0;
+}
+
+static int filter_set(ffb_filter* filter, unsigned int channel, unsigned int stage,
+                      float b0, float b1, float b2, float a0, float a1, float a2) {
+    filter->b0[stage][channel] = b0 / a0;
+    filter->b1[stage][channel] = b1 / a0;
+    filter->b2[stage][channel] = b2 / a0;
+    filter->a1[stage][channel] = a1 / a0;
+    filter->a2[stage][channel] = a2 / a0;
+    if (stage >= filter->stages)
+        filter->stages = stage + 1;
+    return 0;
+}
+
+static int filter_check(const ffb_filter* filter, unsigned int channel, unsigned int stage, float freq_hz) {
+    if (channel >= filter->channels || stage >= FFB_FILTER_MAX_STAGES)
+        return -1;
+    if (freq_hz <= 0.0f || freq_hz >= filter->sample_rate / 2.0f)
+        return -1;
+    return 0;
+}
+
+// Coefficients from the Audio EQ Cookbook (R. Bristow-Johnson)
+int ffb_filter_set_lowpass(ffb_filter* filter, unsigned int channel, unsigned int stage, float cutoff_hz, float q) {
+    float w, alpha, cw;
+
+    if (filter_check(filter, channel, stage, cutoff_hz) || q <= 0.0f)
+        return -1;
+
+    w = 2.0f * FFB_FILTER_PI * cutoff_hz / filter->sample_rate;
+    cw = cosf(w);
+    alpha = sinf(w) / (2.0f * q);
+    return filter_set(filter, channel, stage,
+                      (1.0f - cw) / 2.0f, 1.0f - cw, (1.0f - cw) / 2.0f,
+                      1.0f + alpha, -2.0f * cw, 1.0f - alpha);
+}
+
+int ffb_filter_set_notch(ffb_filter* filter, unsigned int channel, unsigned int stage, float freq_hz, float q) {
+    float w, alpha, cw;
+
+    if (filter_check(filter, channel, stage, freq_hz) || q <= 0.0f)
+        return -1;
+
+    w = 2.0f * FFB_FILTER_PI * freq_hz / filter->sample_rate;
+    cw = cosf(w);
+    alpha = sinf(w) / (2.0f * q);
+    return filter_set(filter, channel, stage,
+                      1.0f, -2.0f * cw, 1.0f,
+                      1.0f + alpha, -2.0f * cw, 1.0f - alpha);
+}
+
+// (1 + s / wz) / (1 + s / wp) through the bilinear transform,
+// each corner prewarped so it lands on the requested frequency
+int ffb_filter_set_lead(ffb_filter* filter, unsigned int channel, unsigned int stage, float zero_hz, float pole_hz) {
+    float tz, tp;
+
+    if (filter_check(filter, channel, stage, zero_hz) || filter_check(filter, channel, stage, pole_hz))
+        return -1;
+
+    tz = 1.0f / tanf(FFB_FILTER_PI * zero_hz / filter->sample_rate);
+    tp = 1.0f / tanf(FFB_FILTER_PI * pole_hz / filter->sample_rate);
+    return filter_set(filter, channel, stage,
+                      1.0f + tz, 1.0f - tz, 0.0f,
+                      1.0f + tp, 1.0f - tp, 0.0f);
+}
+
+void ffb_filter_reset(ffb_filter* filter) {
+    memset(filter->z1, 0x00, sizeof(filter->z1));
+    memset(filter->z2, 0x00, sizeof(filter->z2));
+}
+
+#ifdef FFB_FILTER_SSE
+
+// Four channels starting at c, the state stays in registers over the block
+static void filter_process4(ffb_filter* filter, float* frames, unsigned int count, unsigned int c) {
+    __m128 z1[FFB_FILTER_MAX_STAGES];
+    __m128 z2[FFB_FILTER_MAX_STAGES];
+    __m128 x, y;
+    unsigned int n, s;
+
+    for (s = 0; s < filter->stages; s++) {
+        z1[s] = _mm_loadu_ps(&filter->z1[s][c]);
+        z2[s] = _mm_loadu_ps(&filter->z2[s][c]);
+    }
+
+    for (n = 0; n < count; n++) {
+        x = _mm_loadu_ps(&frames[n * FFB_FILTER_MAX_CHANNELS + c]);
+        for (s = 0; s < filter->stages; s++) {
+            y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&filter->b0[s][c]), x), z1[s]);
+            z1[s] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&filter->b1[s][c]), x),
+                                          _mm_mul_ps(_mm_loadu_ps(&filter->a1[s][c]), y)),
+                               z2[s]);
+            z2[s] = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&filter->b2[s][c]), x),
+                               _mm_mul_ps(_mm_loadu_ps(&filter->a2[s][c]), y));
+            x = y;
+        }
+        _mm_storeu_ps(&frames[n * FFB_FILTER_MAX_CHANNELS + c], x);
+    }
+
+    for (s = 0; s < filter->stages; s++) {
+        _mm_storeu_ps(&filter->z1[s][c], z1[s]);
+        _mm_storeu_ps(&filter->z2[s][c], z2[s]);
+    }
+}
+
+#else
+
+static void filter_process4(ffb_filter* filter, float* frames, unsigned int count, unsigned int c) {
+    float x, y;
+    unsigned int n, s, k;
+
+    for (k = c; k < c + 4; k++) {
+        for (n = 0; n < count; n++) {
+            x = frames[n * FFB_FILTER_MAX_CHANNELS + k];
+            for (s = 0; s < filter->stages; s++) {
+                y = filter->b0[s][k] * x + filter->z1[s][k];
+                filter->z1[s][k] = filter->b1[s][k] * x - filter->a1[s][k] * y + filter->z2[s][k];
+                filter->z2[s][k] = filter->b2[s][k] * x - filter->a2[s][k] * y;
+                x = y;
+            }
+            frames[n * FFB_FILTER_MAX_CHANNELS + k] = x;
+        }
+    }
+}
+
+#endif
+
+void ffb_filter_process(ffb_filter* filter, float* frames, unsigned int count) {
+    unsigned int c, s;
+
+    // Channels past filter->channels pass through (b0 = 1), filtering
+    // them anyway keeps every group four wide
+    for (c = 0; c < filter->channels; c += 4)
+        filter_process4(filter, frames, count, c);
+
+    for (s = 0; s < filter->stages; s++) {
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+            if (fabsf(filter->z1[s][c]) < FFB_FILTER_DENORMAL)
+                filter->z1[s][c] = 0.0f;
+            if (fabsf(filter->z2[s][c]) < FFB_FILTER_DENORMAL)
+                filter->z2[s][c] = 0.0f;
+        }
+    }
+}
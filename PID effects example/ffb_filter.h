@@ -0,0 +1,54 @@
+// Biquad filter bank shaping the force output
+// Wheel bases resonate (rim, belt, mount) and a force streamed in steps
+// excites them. Each channel runs up to FFB_FILTER_MAX_STAGES cascaded
+// biquads (transposed direct form II), each stage being:
+//      low-pass: 2nd order, cutoff and Q,
+//      notch:    rejects a resonance at freq, Q sets the width,
+//      lead:     1st order phase lead (zero below the pole), unity gain at DC,
+//                to win back the phase the low-pass and the base filter lose.
+// Unused stages pass through.
+//
+// ffb_filter_process() filters a block of frames for every channel at
+// once. Coefficients and state are stored [stage][channel], so with SSE
+// four channels are filtered per instruction.
+// The sample rate is fixed: feed it from a constant rate source
+// (e.g. the render callback of ffb_jitter.h), not the adaptive writer tick.
+
+#ifndef FFB_FILTER_H__
+#define FFB_FILTER_H__
+
+#define FFB_FILTER_MAX_STAGES 4
+#define FFB_FILTER_MAX_CHANNELS 8   // Multiple of 4
+
+typedef struct ffb_filter {
+    unsigned int channels;
+    unsigned int stages;        // Stages in use, the others are skipped
+    float sample_rate;
+
+    float b0[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float b1[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float b2[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float a1[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float a2[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float z1[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+    float z2[FFB_FILTER_MAX_STAGES][FFB_FILTER_MAX_CHANNELS];
+} ffb_filter;
+
+// Every stage passes through. Returns 0 on success,
+// -1 if channels or sample_rate_hz is out of range
+int ffb_filter_init(ffb_filter* filter, unsigned int channels, float sample_rate_hz);
+
+// Stage designers, the state of the stage is kept.
+// Return 0 on success, -1 if the channel, the stage or a frequency
+// (which must be below the Nyquist frequency) is out of range
+int ffb_filter_set_lowpass(ffb_filter* filter, unsigned int channel, unsigned int stage, float cutoff_hz, float q);
+int ffb_filter_set_notch(ffb_filter* filter, unsigned int channel, unsigned int stage, float freq_hz, float q);
+int ffb_filter_set_lead(ffb_filter* filter, unsigned int channel, unsigned int stage, float zero_hz, float pole_hz);
+
+// Clears the state of every stage
+void ffb_filter_reset(ffb_filter* filter);
+
+// Filters count frames in place, frames[n * FFB_FILTER_MAX_CHANNELS + channel]
+void ffb_filter_process(ffb_filter* filter, float* frames, unsigned int count);
+
+#endif // FFB_FILTER_H__
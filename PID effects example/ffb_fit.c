@@ -0,0 +1,253 @@
+#include "ffb_fit.h"
+
+#include <string.h>
+
+#include "pid_reports.h"
+
+// Centi-degrees in a period, phase of the SET_PERIODIC_REPORT
+#define FFB_FIT_PHASE_FULL 36000
+
+static int fit_abs(int x) {
+    return x < 0 ? -x : x;
+}
+
+static int fit_clamp(long long x) {
+    return x > 32767 ? 32767 : x < -32767 ? -32767 : (int)x;
+}
+
+static long long fit_div_floor(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static long long fit_div_ceil(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) == (b < 0)) ? q + 1 : q;
+}
+
+// Longest run of samples fitting a constant level
+static unsigned int fit_constant(const short* s, unsigned int count, int e, int* level) {
+    int lo = s[0];
+    int hi = s[0];
+    unsigned int n;
+
+    for (n = 1; n < count; n++) {
+        int nlo = s[n] < lo ? s[n] : lo;
+        int nhi = s[n] > hi ? s[n] : hi;
+
+        if (nhi - nlo > 2 * e)
+            break;
+        lo = nlo;
+        hi = nhi;
+    }
+
+    *level = (lo + hi) / 2;
+    return n;
+}
+
+// Number of leading samples within e of level, at most max
+static unsigned int fit_level(const short* s, unsigned int count, int level, int e, unsigned int max) {
+    unsigned int n;
+
+    for (n = 0; n < count && n < max; n++) {
+        if (fit_abs(s[n] - level) > e)
+            break;
+    }
+    return n;
+}
+
+// Longest ramp starting on s[0]: the slopes that keep every sample
+// within e form an interval that shrinks as the ramp grows.
+static unsigned int fit_ramp(const short* s, unsigned int count, int e, long long* slope) {
+    long long lo = -(1ll << 40);
+    long long hi = 1ll << 40;
+    long long nlo, nhi;
+    unsigned int n;
+
+    for (n = 1; n < count; n++) {
+        // Q16 slopes such that s[0] + (slope * n >> 16) is within e of s[n]
+        nlo = fit_div_ceil(((long long)s[n] - e - s[0]) * 65536, n);
+        nhi = fit_div_floor(((long long)s[n] + e - s[0] + 1) * 65536 - 1, n);
+        if (nlo < lo)
+            nlo = lo;
+        if (nhi > hi)
+            nhi = hi;
+        if (nlo > nhi)
+            break;
+        lo = nlo;
+        hi = nhi;
+    }
+
+    *slope = n > 1 ? lo + (hi - lo) / 2 : 0;
+    return n;
+}
+
+// Square wave: a first (possibly partial) run at level a, then full half
+// periods alternating between b and a. Needs at least three runs.
+static unsigned int fit_square(const short* s, unsigned int count, int e, ffb_fit_segment* segment) {
+    unsigned int first, half, run, n;
+    int a, b;
+    int level;
+
+    first = fit_constant(s, count, e, &a);
+    if (first >= count)
+        return 0;
+    half = fit_constant(s + first, count - first, e, &b);
+    if (fit_abs(a - b) <= 2 * e || first > half)
+        return 0;
+
+    // The levels are those of the runs, every sample must be within e of them
+    if (fit_level(s, first, a, e, first) != first || fit_level(s + first, half, b, e, half) != half)
+        return 0;
+
+    n = first + half;
+    level = a;
+    while (n < count) {
+        run = fit_level(s + n, count - n, level, e, half);
+        n += run;
+        if (run < half)
+            break;
+        level = level == a ? b : a;
+    }
+
+    if (n < first + 2 * half)
+        return 0;
+
+    segment->start = a;
+    segment->end = b;
+    segment->half_period = half;
+    segment->phase = half - first;
+    return n;
+}
+
+int ffb_fit_value(const ffb_fit_segment* segment, unsigned int i) {
+    unsigned int k = i - segment->first;
+
+    switch (segment->kind) {
+    case FFB_FIT_RAMP:
+        // Same rounding as fit_ramp() validated the slope with
+        return segment->start + (int)((segment->slope * k) >> 16);
+    case FFB_FIT_SQUARE:
+        return ((segment->phase + k) % (2 * segment->half_period)) < segment->half_period ? segment->start : segment->end;
+    default:
+        return segment->start;
+    }
+}
+
+static void fit_measure(const short* samples, ffb_fit_segment* segment) {
+    unsigned int i;
+    int error = 0;
+
+    for (i = segment->first; i < segment->first + segment->length; i++) {
+        int d = fit_abs(samples[i] - ffb_fit_value(segment, i));
+        if (d > error)
+            error = d;
+    }
+    segment->error = error;
+}
+
+int ffb_fit(const short* samples, unsigned int count, int max_error, ffb_fit_segment* segments, int max_segments) {
+    ffb_fit_segment square;
+    unsigned int i = 0;
+    unsigned int n_constant, n_ramp, n_square;
+    long long slope;
+    int level;
+    int n = 0;
+
+    if (max_error < 0)
+        max_error = 0;
+
+    while (i < count && n < max_segments) {
+        ffb_fit_segment* segment = &segments[n];
+
+        memset(segment, 0x00, sizeof(*segment));
+        memset(&square, 0x00, sizeof(square));
+        n_constant = fit_constant(samples + i, count - i, max_error, &level);
+        n_ramp = fit_ramp(samples + i, count - i, max_error, &slope);
+        n_square = fit_square(samples + i, count - i, max_error, &square);
+
+        segment->first = i;
+        if (n_square > n_ramp && n_square > n_constant) {
+            *segment = square;
+            segment->kind = FFB_FIT_SQUARE;
+            segment->first = i;
+            segment->length = n_square;
+        }
+        else if (n_ramp > n_constant) {
+            segment->kind = FFB_FIT_RAMP;
+            segment->length = n_ramp;
+            segment->start = samples[i];
+            segment->slope = slope;
+            // Value one sample after the end, where the device ramp ends.
+            // A steep ramp into full scale would overshoot the Ramp End field
+            segment->end = fit_clamp(samples[i] + ((slope * n_ramp) >> 16));
+        }
+        else {
+            segment->kind = FFB_FIT_CONSTANT;
+            segment->length = n_constant;
+            segment->start = level;
+            segment->end = level;
+        }
+
+        fit_measure(samples, segment);
+
+        // Every sample must be within max_error, a constant always is
+        if (segment->error > max_error) {
+            segment->kind = FFB_FIT_CONSTANT;
+            segment->length = n_constant;
+            segment->start = level;
+            segment->end = level;
+            fit_measure(samples, segment);
+        }
+        i += segment->length;
+        n++;
+    }
+
+    return n;
+}
+
+int ffb_fit_to_effect(const ffb_fit_segment* segment, unsigned int sample_ms, const pid_templates* templates, pid_effect_desc* desc) {
+    unsigned long duration = (unsigned long)segment->length * sample_ms;
+    unsigned long period;
+    unsigned int position;
+    unsigned char type;
+
+    switch (segment->kind) {
+    case FFB_FIT_RAMP:
+        type = PID_ET_RAMP;
+        break;
+    case FFB_FIT_SQUARE:
+        type = PID_ET_SQUARE;
+        break;
+    default:
+        type = PID_ET_CONSTANT_FORCE;
+        break;
+    }
+
+    if (pid_effect_desc_init(desc, templates, type))
+        return -1;
+    if (templates->duration && duration > (unsigned long)templates->duration->logical_max)
+        return -1;
+    desc->duration = (long)duration;
+
+    switch (segment->kind) {
+    case FFB_FIT_RAMP:
+        desc->ramp_start = segment->start;
+        desc->ramp_end = segment->end;
+        break;
+    case FFB_FIT_SQUARE:
+        // The device square wave is high for the first half of the period
+        period = 2ul * segment->half_period;
+        position = segment->start > segment->end ? segment->phase : segment->half_period + segment->phase;
+        desc->magnitude = fit_abs(segment->start - segment->end) / 2;
+        desc->offset = (segment->start + segment->end) / 2;
+        desc->period = (long)(period * sample_ms);
+        desc->phase = (long)((unsigned long)position * FFB_FIT_PHASE_FULL / period);
+        break;
+    default:
+        desc->magnitude = segment->start;
+        break;
+    }
+
+    return 0;
+}
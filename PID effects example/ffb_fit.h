@@ -0,0 +1,50 @@
+// Waveform fitting
+// Turns an upcoming force track (one magnitude every sample_ms) into a
+// sequence of device-native effects, each one within max_error of the
+// samples it replaces:
+//      constant force,
+//      ramp,
+//      square wave (two levels with a constant half period).
+// Uploading a handful of effects replaces one SET_CONSTANT_FORCE_REPORT
+// per sample, e.g. the +/-1500 toggle of main() is a single square wave.
+//
+// The fit is greedy: at every position the kind covering the most
+// samples wins, the simplest kind on a tie.
+
+#ifndef FFB_FIT_H__
+#define FFB_FIT_H__
+
+#include "pid_effect.h"
+
+enum FFB_FIT_KIND {
+    FFB_FIT_CONSTANT = 0,
+    FFB_FIT_RAMP,
+    FFB_FIT_SQUARE,
+};
+
+typedef struct ffb_fit_segment {
+    int kind;               // FFB_FIT_KIND
+    unsigned int first;     // Index of the first sample
+    unsigned int length;    // Number of samples
+    int start;              // Constant level, ramp start, or first level of the square wave
+    int end;                // Ramp end (value one sample after the segment, clamped to -32767..32767), or second level of the square wave
+    long long slope;        // Ramp, Q16 per sample: start + (slope * k >> 16) at sample k
+    unsigned int half_period;  // Square wave, in samples
+    unsigned int phase;        // Square wave, samples already elapsed in the first period
+    int error;              // Largest difference with the samples
+} ffb_fit_segment;
+
+// Fits samples into at most max_segments segments.
+// Returns the number of segments. If it is max_segments, the last segment
+// may end before count: fit the rest again later.
+int ffb_fit(const short* samples, unsigned int count, int max_error, ffb_fit_segment* segments, int max_segments);
+
+// Value of the segment at sample i (from the start of the track)
+int ffb_fit_value(const ffb_fit_segment* segment, unsigned int i);
+
+// Fills desc with the effect playing segment (type, duration,
+// type specific parameters) for samples of sample_ms.
+// Returns 0 on success
+int ffb_fit_to_effect(const ffb_fit_segment* segment, unsigned int sample_ms, const pid_templates* templates, pid_effect_desc* desc);
+
+#endif // FFB_FIT_H__
@@ -0,0 +1,516 @@
+#include "ffb_graph.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "pid_reports.h"
+
+#define FFB_MAGNITUDE_MAX 32767
+#define FFB_GRAPH_PI 3.14159265358979f
+
+void ffb_graph_init(ffb_graph* graph) {
+    memset(graph, 0x00, sizeof(*graph));
+    graph->sink = -1;
+}
+
+static int graph_add(ffb_graph* graph, int kind) {
+    ffb_graph_node* node;
+
+    if (graph->node_count >= FFB_GRAPH_MAX_NODES)
+        return -1;
+
+    node = &graph->nodes[graph->node_count];
+    memset(node, 0x00, sizeof(*node));
+    node->kind = kind;
+    node->level = -1;
+    graph->compiled = 0;
+    return (int)graph->node_count++;
+}
+
+int ffb_graph_add_telemetry(ffb_graph* graph, ffb_resample* resample) {
+    int id = graph_add(graph, FFB_NODE_TELEMETRY);
+
+    if (id >= 0)
+        graph->nodes[id].resample = resample;
+    return id;
+}
+
+int ffb_graph_add_periodic(ffb_graph* graph, int effect, float magnitude, float offset, unsigned long period_ms, unsigned long phase_ms) {
+    int id = graph_add(graph, FFB_NODE_PERIODIC);
+
+    if (id >= 0) {
+        graph->nodes[id].effect = effect;
+        graph->nodes[id].magnitude = magnitude;
+        graph->nodes[id].offset = offset;
+        graph->nodes[id].period_ms = period_ms ? period_ms : 1;
+        graph->nodes[id].phase_ms = phase_ms;
+    }
+    return id;
+}
+
+int ffb_graph_add_condition(ffb_graph* graph, int effect, float coefficient, float center, float dead_band, float saturation) {
+    int id = graph_add(graph, FFB_NODE_CONDITION);
+
+    if (id >= 0) {
+        graph->nodes[id].effect = effect;
+        graph->nodes[id].magnitude = coefficient;
+        graph->nodes[id].offset = center;
+        graph->nodes[id].dead_band = dead_band;
+        graph->nodes[id].saturation = saturation;
+    }
+    return id;
+}
+
+int ffb_graph_add_expr(ffb_graph* graph, const ffb_expr* expr) {
+    int id = graph_add(graph, FFB_NODE_EXPR);
+
+    if (id >= 0)
+        graph->nodes[id].expr = expr;
+    return id;
+}
+
+int ffb_graph_add_plugin(ffb_graph* graph, ffb_plugin* plugin) {
+    int id = graph_add(graph, FFB_NODE_PLUGIN);
+
+    if (id >= 0)
+        graph->nodes[id].plugin = plugin;
+    return id;
+}
+
+int ffb_graph_add_noise(ffb_graph* graph, ffb_noise* noise) {
+    int id = graph_add(graph, FFB_NODE_NOISE);
+
+    if (id >= 0)
+        graph->nodes[id].noise = noise;
+    return id;
+}
+
+int ffb_graph_add_impulses(ffb_graph* graph, ffb_impulse_bank* bank) {
+    int id = graph_add(graph, FFB_NODE_IMPULSE);
+
+    if (id >= 0)
+        graph->nodes[id].impulses = bank;
+    return id;
+}
+
+int ffb_graph_add_filter(ffb_graph* graph, ffb_filter* filter) {
+    int id = graph_add(graph, FFB_NODE_FILTER);
+
+    if (id >= 0)
+        graph->nodes[id].filter = filter;
+    return id;
+}
+
+int ffb_graph_add_mixer(ffb_graph* graph) {
+    return graph_add(graph, FFB_NODE_MIXER);
+}
+
+int ffb_graph_add_limiter(ffb_graph* graph, ffb_limiter* limiter) {
+    int id = graph_add(graph, FFB_NODE_LIMITER);
+
+    if (id >= 0)
+        graph->nodes[id].limiter = limiter;
+    return id;
+}
+
+int ffb_graph_add_slew(ffb_graph* graph, ffb_slew* slew) {
+    int id = graph_add(graph, FFB_NODE_SLEW);
+
+    if (id >= 0)
+        graph->nodes[id].slew = slew;
+    return id;
+}
+
+int ffb_graph_add_sink(ffb_graph* graph) {
+    return graph_add(graph, FFB_NODE_SINK);
+}
+
+int ffb_graph_connect(ffb_graph* graph, int from, int to, float gain) {
+    ffb_graph_node* node;
+
+    if (from < 0 || to < 0 || from >= (int)graph->node_count || to >= (int)graph->node_count || from == to)
+        return -1;
+
+    node = &graph->nodes[to];
+    if (node->kind == FFB_NODE_TELEMETRY || node->kind == FFB_NODE_PERIODIC || node->kind == FFB_NODE_IMPULSE
+        || graph->nodes[from].kind == FFB_NODE_SINK || node->input_count >= FFB_GRAPH_MAX_INPUTS)
+        return -1;
+
+    node->inputs[node->input_count] = from;
+    node->gains[node->input_count] = gain;
+    node->input_count++;
+    graph->compiled = 0;
+    return 0;
+}
+
+int ffb_graph_compile(ffb_graph* graph, int sink) {
+    int needed[FFB_GRAPH_MAX_NODES] = { 0 };
+    int stack[FFB_GRAPH_MAX_NODES];
+    unsigned int count[FFB_GRAPH_MAX_NODES + 1] = { 0 };
+    unsigned int top = 0;
+    unsigned int remaining = 0;
+    unsigned int i, k, assigned;
+    ffb_graph_node* node;
+    int level, id;
+
+    graph->compiled = 0;
+    if (sink < 0 || sink >= (int)graph->node_count || graph->nodes[sink].kind != FFB_NODE_SINK)
+        return -1;
+
+    // Nodes the sink depends on
+    needed[sink] = 1;
+    stack[top++] = sink;
+    while (top > 0) {
+        node = &graph->nodes[stack[--top]];
+        for (k = 0; k < node->input_count; k++) {
+            id = node->inputs[k];
+            if (!needed[id]) {
+                needed[id] = 1;
+                stack[top++] = id;
+            }
+        }
+    }
+
+    for (i = 0; i < graph->node_count; i++) {
+        node = &graph->nodes[i];
+        if (needed[i] && node->kind == FFB_NODE_EXPR && node->input_count != node->expr->var_count)
+            return -1;
+    }
+
+    // Level: one more than the highest input, a pass that assigns
+    // nothing while nodes are left means a cycle
+    for (i = 0; i < graph->node_count; i++) {
+        graph->nodes[i].level = -1;
+        if (needed[i])
+            remaining++;
+    }
+    while (remaining > 0) {
+        assigned = 0;
+        for (i = 0; i < graph->node_count; i++) {
+            node = &graph->nodes[i];
+            if (!needed[i] || node->level >= 0)
+                continue;
+            level = 0;
+            for (k = 0; k < node->input_count; k++) {
+                if (graph->nodes[node->inputs[k]].level < 0)
+                    break;
+                if (graph->nodes[node->inputs[k]].level + 1 > level)
+                    level = graph->nodes[node->inputs[k]].level + 1;
+            }
+            if (k < node->input_count)
+                continue;
+            node->level = level;
+            assigned++;
+            remaining--;
+        }
+        if (assigned == 0)
+            return -1;
+    }
+
+    // Counting sort by level
+    graph->level_count = (unsigned int)graph->nodes[sink].level + 1;
+    for (i = 0; i < graph->node_count; i++) {
+        if (needed[i])
+            count[graph->nodes[i].level + 1]++;
+    }
+    graph->width = 0;
+    for (i = 1; i <= graph->level_count; i++) {
+        if (count[i] > graph->width)
+            graph->width = count[i];
+        count[i] += count[i - 1];
+        graph->level_end[i - 1] = count[i];
+    }
+    for (i = 0; i < graph->node_count; i++) {
+        if (needed[i])
+            graph->order[count[graph->nodes[i].level]++] = (int)i;
+    }
+    graph->order_count = graph->level_end[graph->level_count - 1];
+
+    for (i = 0; i < graph->node_count; i++) {
+        graph->nodes[i].time_us = 0;
+        graph->nodes[i].runs = 0;
+    }
+    graph->sink = sink;
+    graph->compiled = 1;
+    return 0;
+}
+
+static float graph_wave(int effect, unsigned long t, unsigned long period) {
+    float pos = (float)(t % period) / (float)period;
+
+    switch (effect) {
+    case PID_ET_SQUARE:
+        return pos < 0.5f ? 1.0f : -1.0f;
+    case PID_ET_TRIANGLE:
+        return 1.0f - 4.0f * fabsf(pos - 0.5f);
+    case PID_ET_SAWTOOTH_UP:
+        return 2.0f * pos - 1.0f;
+    case PID_ET_SAWTOOTH_DOWN:
+        return 1.0f - 2.0f * pos;
+    default:
+        return sinf(2.0f * FFB_GRAPH_PI * pos);
+    }
+}
+
+static float graph_condition(ffb_graph_node* node, float x, unsigned int sample_ms) {
+    float d, f;
+
+    if (node->effect == PID_ET_DAMPER) {
+        d = (x - node->last) / (float)sample_ms;
+        node->last = x;
+    }
+    else {
+        d = x - node->offset;
+    }
+
+    if (d > node->dead_band)
+        d -= node->dead_band;
+    else if (d < -node->dead_band)
+        d += node->dead_band;
+    else
+        d = 0.0f;
+
+    f = -node->magnitude * d;
+    if (node->saturation > 0.0f) {
+        if (f > node->saturation)
+            f = node->saturation;
+        if (f < -node->saturation)
+            f = -node->saturation;
+    }
+    return f;
+}
+
+static short graph_clamp(float x) {
+    if (x > FFB_MAGNITUDE_MAX)
+        return FFB_MAGNITUDE_MAX;
+    if (x < -FFB_MAGNITUDE_MAX)
+        return -FFB_MAGNITUDE_MAX;
+    return (short)(x < 0.0f ? x - 0.5f : x + 0.5f);
+}
+
+static void graph_run_node(ffb_graph* graph, int id) {
+    ffb_graph_node* node = &graph->nodes[id];
+    float* out = graph->buffers[id];
+    const float* in;
+    float frames[FFB_GRAPH_BLOCK * FFB_FILTER_MAX_CHANNELS];
+    float scaled[FFB_GRAPH_MAX_INPUTS][FFB_GRAPH_BLOCK];
+    const float* vars[FFB_GRAPH_MAX_INPUTS];
+    ffb_plugin_inputs inputs;
+    short samples[FFB_GRAPH_BLOCK];
+    short target;
+    unsigned int count = graph->count;
+    unsigned int n, k;
+    long long start = pid_time_us();
+    float g;
+
+    // Weighted sum of the inputs, plain loops the compiler vectorizes
+    if (node->kind != FFB_NODE_TELEMETRY && node->kind != FFB_NODE_PERIODIC && node->kind != FFB_NODE_IMPULSE
+        && node->kind != FFB_NODE_EXPR && node->kind != FFB_NODE_PLUGIN) {
+        for (n = 0; n < count; n++)
+            out[n] = 0.0f;
+        for (k = 0; k < node->input_count; k++) {
+            in = graph->buffers[node->inputs[k]];
+            g = node->gains[k];
+            for (n = 0; n < count; n++)
+                out[n] += g * in[n];
+        }
+    }
+
+    switch (node->kind) {
+    case FFB_NODE_TELEMETRY:
+        ffb_resample_render(node->resample, (long long)graph->t_ms * 1000, graph->sample_ms * 1000, samples, count);
+        for (n = 0; n < count; n++)
+            out[n] = samples[n];
+        break;
+    case FFB_NODE_PERIODIC:
+        for (n = 0; n < count; n++)
+            out[n] = node->offset + node->magnitude * graph_wave(node->effect, graph->t_ms + n * graph->sample_ms + node->phase_ms, node->period_ms);
+        break;
+    case FFB_NODE_CONDITION:
+        for (n = 0; n < count; n++)
+            out[n] = graph_condition(node, out[n], graph->sample_ms);
+        break;
+    case FFB_NODE_EXPR:
+    case FFB_NODE_PLUGIN:
+        for (k = 0; k < node->input_count; k++) {
+            in = graph->buffers[node->inputs[k]];
+            g = node->gains[k];
+            for (n = 0; n < count; n++)
+                scaled[k][n] = g * in[n];
+            vars[k] = scaled[k];
+        }
+        if (node->kind == FFB_NODE_EXPR) {
+            ffb_expr_eval(node->expr, (float)(graph->t_ms - graph->origin_ms) / 1000.0f,
+                          (float)graph->sample_ms / 1000.0f, vars, out, count);
+            break;
+        }
+        inputs.size = sizeof(inputs);
+        inputs.t = (double)(graph->t_ms - graph->origin_ms) / 1000.0;
+        inputs.dt = (float)graph->sample_ms / 1000.0f;
+        inputs.channel_count = node->input_count;
+        inputs.channels = vars;
+        ffb_plugin_process(node->plugin, out, count, &inputs);
+        break;
+    case FFB_NODE_IMPULSE:
+        ffb_impulse_render(node->impulses, graph->sample_ms, out, count);
+        break;
+    case FFB_NODE_NOISE:
+        ffb_noise_render(node->noise, out, out, count, (float)graph->sample_ms / 1000.0f);
+        break;
+    case FFB_NODE_FILTER:
+        memset(frames, 0x00, sizeof(frames));
+        for (n = 0; n < count; n++)
+            frames[n * FFB_FILTER_MAX_CHANNELS] = out[n];
+        ffb_filter_process(node->filter, frames, count);
+        for (n = 0; n < count; n++)
+            out[n] = frames[n * FFB_FILTER_MAX_CHANNELS];
+        break;
+    case FFB_NODE_LIMITER:
+        for (n = 0; n < count; n++)
+            out[n] = ffb_limiter_process(node->limiter, graph_clamp(out[n]));
+        break;
+    case FFB_NODE_SLEW:
+        for (n = 0; n < count; n++) {
+            target = graph_clamp(out[n]);
+            ffb_slew_process(node->slew, &target, &samples[n], (float)graph->sample_ms);
+            out[n] = samples[n];
+        }
+        break;
+    default:
+        // Mixer and sink: the sum is the output
+        break;
+    }
+
+    node->time_us += pid_time_us() - start;
+    node->runs++;
+}
+
+// next and end: generation << 8 | index in order
+#define GRAPH_INDEX_BITS 8
+#define GRAPH_INDEX_MASK ((1L << GRAPH_INDEX_BITS) - 1)
+#define GRAPH_GENERATION_MASK 0x7fffffL
+
+// Runs nodes of order[next..end) until there are none left
+static void graph_work(ffb_graph* graph) {
+    long next, end;
+
+    for (;;) {
+        next = pid_atomic_load(&graph->next);
+        end = pid_atomic_load(&graph->end);
+
+        // The level is being set up
+        if ((next >> GRAPH_INDEX_BITS) != (end >> GRAPH_INDEX_BITS)) {
+            pid_cpu_relax();
+            continue;
+        }
+        if ((next & GRAPH_INDEX_MASK) >= (end & GRAPH_INDEX_MASK))
+            return;
+
+        // Fails if another thread took the node or the level is over
+        if (!pid_atomic_cas(&graph->next, next, next + 1))
+            continue;
+        graph_run_node(graph, graph->order[next & GRAPH_INDEX_MASK]);
+        pid_atomic_add(&graph->done, 1);
+    }
+}
+
+static void graph_worker_loop(void* arg) {
+    ffb_graph_worker* worker = (ffb_graph_worker*)arg;
+
+    while (pid_atomic_load(&worker->graph->running)) {
+        pid_event_wait(&worker->wake, 100);
+        graph_work(worker->graph);
+    }
+}
+
+int ffb_graph_start_workers(ffb_graph* graph, unsigned int count) {
+    unsigned int i;
+
+    if (count > FFB_GRAPH_MAX_WORKERS)
+        count = FFB_GRAPH_MAX_WORKERS;
+
+    pid_atomic_store(&graph->running, 1);
+    for (i = 0; i < count; i++) {
+        graph->workers[i].graph = graph;
+        if (pid_event_init(&graph->workers[i].wake))
+            break;
+        if (pid_thread_start(&graph->workers[i].thread, graph_worker_loop, &graph->workers[i])) {
+            pid_event_destroy(&graph->workers[i].wake);
+            break;
+        }
+    }
+    graph->worker_count = i;
+
+    if (i < count) {
+        ffb_graph_stop_workers(graph);
+        return -1;
+    }
+    return 0;
+}
+
+void ffb_graph_stop_workers(ffb_graph* graph) {
+    unsigned int i;
+
+    pid_atomic_store(&graph->running, 0);
+    for (i = 0; i < graph->worker_count; i++) {
+        pid_event_signal(&graph->workers[i].wake);
+        pid_thread_join(graph->workers[i].thread);
+        pid_event_destroy(&graph->workers[i].wake);
+    }
+    graph->worker_count = 0;
+}
+
+static void graph_run_block(ffb_graph* graph) {
+    unsigned int level, start, end, i;
+    long tag;
+
+    start = 0;
+    for (level = 0; level < graph->level_count; level++) {
+        end = graph->level_end[level];
+        graph->generation = (graph->generation + 1) & GRAPH_GENERATION_MASK;
+        tag = graph->generation << GRAPH_INDEX_BITS;
+
+        // next first: until end has the same generation workers wait
+        pid_atomic_store(&graph->next, tag | (long)start);
+        pid_atomic_store(&graph->end, tag | (long)end);
+
+        if (graph->worker_count > 0 && end - start >= 2) {
+            for (i = 0; i < graph->worker_count && i < end - start - 1; i++)
+                pid_event_signal(&graph->workers[i].wake);
+            graph->parallel_levels++;
+        }
+        graph_work(graph);
+        while (pid_atomic_load(&graph->done) < (long)end)
+            pid_cpu_relax();
+
+        start = end;
+    }
+
+    // Every claimed node is done, a late worker fails its claim
+    pid_atomic_store(&graph->done, 0);
+    graph->blocks++;
+}
+
+void ffb_graph_render(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count) {
+    ffb_graph* graph = (ffb_graph*)ctx;
+    unsigned int offset, n;
+    const float* sink;
+
+    if (!graph->compiled) {
+        memset(out, 0x00, count * sizeof(*out));
+        return;
+    }
+
+    graph->sample_ms = sample_ms ? sample_ms : 1;
+    if (graph->blocks == 0)
+        graph->origin_ms = t_ms;
+    for (offset = 0; offset < count; offset += graph->count) {
+        graph->count = count - offset < FFB_GRAPH_BLOCK ? count - offset : FFB_GRAPH_BLOCK;
+        graph->t_ms = t_ms + offset * graph->sample_ms;
+        graph_run_block(graph);
+
+        sink = graph->buffers[graph->sink];
+        for (n = 0; n < graph->count; n++)
+            out[offset + n] = graph_clamp(sink[n]);
+    }
+}
@@ -0,0 +1,171 @@
+// Force processing graph
+// The force is described as a DAG of nodes instead of hand-wired calls:
+//      sources:  telemetry (an ffb_resample), periodic (sine, square,
+//                triangle, sawtooth), condition (spring or damper on
+//                the sum of its inputs, e.g. a wheel angle track),
+//                expression (ffb_expr.h, input i being variable i),
+//                plugin (ffb_plugin.h, input i being channel i),
+//                road noise (ffb_noise.h, the input being the speed),
+//                impulses (ffb_impulse.h),
+//      stages:   filter (ffb_filter), limiter (ffb_limiter),
+//                slew (ffb_slew), mixer,
+//      sink:     the force streamed in SET_CONSTANT_FORCE_REPORT.
+// The input of a node is the weighted sum of the nodes connected to it
+// (but for expressions and plugins).
+//
+// ffb_graph_compile() keeps the nodes the sink depends on, sorts them by
+// level (a node only depends on lower levels) and that order is run for
+// every block of FFB_GRAPH_BLOCK samples, each node writing its own
+// preallocated buffer. Nodes are plain structs dispatched with a switch:
+// no callback and no allocation per block.
+//
+// With workers started, the nodes of a level that has several of them
+// are shared between the workers and the calling thread.
+//
+// ffb_graph_render() is an ffb_render_fn: the graph is run by the render
+// thread of ffb_jitter.h, which feeds the writer loop.
+// Each node records the time spent in it, to profile the chain.
+
+#ifndef FFB_GRAPH_H__
+#define FFB_GRAPH_H__
+
+#include "pid_platform.h"
+#include "ffb_expr.h"
+#include "ffb_filter.h"
+#include "ffb_impulse.h"
+#include "ffb_limiter.h"
+#include "ffb_noise.h"
+#include "ffb_plugin.h"
+#include "ffb_resample.h"
+#include "ffb_slew.h"
+
+#define FFB_GRAPH_MAX_NODES 32
+#define FFB_GRAPH_MAX_INPUTS 8
+#define FFB_GRAPH_BLOCK 32
+#define FFB_GRAPH_MAX_WORKERS 4
+
+enum FFB_GRAPH_NODE_KIND {
+    FFB_NODE_TELEMETRY = 0,
+    FFB_NODE_PERIODIC,
+    FFB_NODE_CONDITION,
+    FFB_NODE_EXPR,
+    FFB_NODE_PLUGIN,
+    FFB_NODE_NOISE,
+    FFB_NODE_IMPULSE,
+    FFB_NODE_FILTER,
+    FFB_NODE_MIXER,
+    FFB_NODE_LIMITER,
+    FFB_NODE_SLEW,
+    FFB_NODE_SINK,
+};
+
+typedef struct ffb_graph_node {
+    int kind;
+    int inputs[FFB_GRAPH_MAX_INPUTS];
+    float gains[FFB_GRAPH_MAX_INPUTS];
+    unsigned int input_count;
+
+    // Parameters, depending on kind
+    ffb_resample* resample;     // Telemetry
+    const ffb_expr* expr;       // Expression
+    ffb_plugin* plugin;
+    ffb_noise* noise;
+    ffb_impulse_bank* impulses;
+    ffb_filter* filter;         // Filter, channel 0
+    ffb_limiter* limiter;
+    ffb_slew* slew;             // Slew, channel 0
+    int effect;                 // PID_ET_* of a periodic or condition
+    float magnitude;            // Periodic: magnitude, condition: coefficient
+    float offset;               // Periodic: offset, condition: center
+    float dead_band;            // Condition
+    float saturation;           // Condition
+    unsigned long period_ms;    // Periodic
+    unsigned long phase_ms;     // Periodic
+    float last;                 // Damper: last input sample
+
+    // Compiled
+    int level;
+    long long time_us;          // Spent in the node
+    unsigned long runs;
+} ffb_graph_node;
+
+struct ffb_graph;
+
+typedef struct ffb_graph_worker {
+    struct ffb_graph* graph;
+    pid_thread_t thread;
+    pid_event_t wake;
+} ffb_graph_worker;
+
+typedef struct ffb_graph {
+    ffb_graph_node nodes[FFB_GRAPH_MAX_NODES];
+    unsigned int node_count;
+    float buffers[FFB_GRAPH_MAX_NODES][FFB_GRAPH_BLOCK];
+
+    // Compiled execution order, level by level
+    int sink;
+    int order[FFB_GRAPH_MAX_NODES];
+    unsigned int order_count;
+    unsigned int level_end[FFB_GRAPH_MAX_NODES]; // End of each level in order
+    unsigned int level_count;
+    unsigned int width;         // Nodes in the widest level
+    int compiled;
+
+    // Block being run
+    unsigned long t_ms;
+    unsigned long origin_ms;    // Time 0 of the expressions, the first block
+    unsigned int sample_ms;
+    unsigned int count;
+
+    // Workers, nodes order[next..end) are up for grabs. next and end
+    // carry the generation of the level in their high bits, so a worker
+    // late from a previous level or block cannot claim a node
+    ffb_graph_worker workers[FFB_GRAPH_MAX_WORKERS];
+    unsigned int worker_count;
+    pid_atomic_t running;
+    pid_atomic_t next;
+    pid_atomic_t end;
+    pid_atomic_t done;
+    long generation;
+
+    // Statistics
+    unsigned long blocks;
+    unsigned long parallel_levels;
+} ffb_graph;
+
+void ffb_graph_init(ffb_graph* graph);
+
+// Node constructors, return the node id or -1 if the graph is full.
+// The modules referenced by a node must outlive the graph and must not be
+// shared between nodes, which may run on different threads.
+int ffb_graph_add_telemetry(ffb_graph* graph, ffb_resample* resample);
+int ffb_graph_add_periodic(ffb_graph* graph, int effect, float magnitude, float offset, unsigned long period_ms, unsigned long phase_ms);
+int ffb_graph_add_condition(ffb_graph* graph, int effect, float coefficient, float center, float dead_band, float saturation);
+int ffb_graph_add_expr(ffb_graph* graph, const ffb_expr* expr);
+int ffb_graph_add_plugin(ffb_graph* graph, ffb_plugin* plugin);
+int ffb_graph_add_noise(ffb_graph* graph, ffb_noise* noise);
+int ffb_graph_add_impulses(ffb_graph* graph, ffb_impulse_bank* bank);
+int ffb_graph_add_filter(ffb_graph* graph, ffb_filter* filter);
+int ffb_graph_add_mixer(ffb_graph* graph);
+int ffb_graph_add_limiter(ffb_graph* graph, ffb_limiter* limiter);
+int ffb_graph_add_slew(ffb_graph* graph, ffb_slew* slew);
+int ffb_graph_add_sink(ffb_graph* graph);
+
+// Adds gain * from to the input of to. Returns 0 on success, -1 if a node
+// does not exist, is a source (or from is the sink), or to has too many inputs
+int ffb_graph_connect(ffb_graph* graph, int from, int to, float gain);
+
+// Orders the nodes sink depends on. Returns 0 on success, -1 if sink is
+// not a sink node, the graph has a cycle or an expression node does not
+// have one input per variable
+int ffb_graph_compile(ffb_graph* graph, int sink);
+
+// Starts count worker threads (<= FFB_GRAPH_MAX_WORKERS), worth it when
+// the graph is wide and the nodes are heavy. Returns 0 on success
+int ffb_graph_start_workers(ffb_graph* graph, unsigned int count);
+void ffb_graph_stop_workers(ffb_graph* graph);
+
+// ffb_render_fn running the compiled graph (ctx is the ffb_graph)
+void ffb_graph_render(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count);
+
+#endif // FFB_GRAPH_H__
@@ -0,0 +1,188 @@
+#include "ffb_impulse.h"
+
+#include <math.h>
+#include <string.h>
+
+#define FFB_MAGNITUDE_MAX 32767
+#define FFB_IMPULSE_PI 3.14159265f
+
+void ffb_impulse_init(ffb_impulse_bank* bank, unsigned int rate_hz) {
+    unsigned int i;
+
+    memset(bank, 0x00, sizeof(*bank));
+
+    bank->rate_hz = rate_hz ? rate_hz : 1000;
+    for (i = 0; i < FFB_IMPULSE_MAX_VOICES; i++)
+        bank->voices[i].id = -1;
+}
+
+// Reserves an entry for length samples, -1 if the arena or the table is full.
+// One more sample is kept, so the interpolation never reads past the impulse
+static int impulse_reserve(ffb_impulse_bank* bank, unsigned int length) {
+    ffb_impulse_entry* entry;
+
+    if (length == 0 || bank->count >= FFB_IMPULSE_MAX || length + 1 > FFB_IMPULSE_ARENA - bank->used)
+        return -1;
+
+    entry = &bank->entries[bank->count];
+    entry->offset = bank->used;
+    entry->length = length;
+    bank->arena[entry->offset + length] = 0;
+    return (int)bank->count;
+}
+
+static int impulse_commit(ffb_impulse_bank* bank, int id) {
+    bank->used += bank->entries[id].length + 1;
+    bank->count++;
+    return id;
+}
+
+int ffb_impulse_add(ffb_impulse_bank* bank, const float* samples, unsigned int length) {
+    int id = impulse_reserve(bank, length);
+    short* out;
+    float peak = 0.0f, scale;
+    unsigned int i;
+
+    if (id < 0)
+        return -1;
+
+    for (i = 0; i < length; i++) {
+        if (fabsf(samples[i]) > peak)
+            peak = fabsf(samples[i]);
+    }
+    if (peak == 0.0f)
+        return -1;
+
+    out = bank->arena + bank->entries[id].offset;
+    scale = FFB_MAGNITUDE_MAX / peak;
+    for (i = 0; i < length; i++)
+        out[i] = (short)floorf(samples[i] * scale + 0.5f);
+    return impulse_commit(bank, id);
+}
+
+static float impulse_damped(float frequency_hz, float decay_ms, float t) {
+    return sinf(2.0f * FFB_IMPULSE_PI * frequency_hz * t) * expf(-t * 1000.0f / decay_ms);
+}
+
+int ffb_impulse_add_damped(ffb_impulse_bank* bank, float frequency_hz, float decay_ms, float length_ms) {
+    unsigned int length = (unsigned int)(length_ms * bank->rate_hz / 1000.0f);
+    int id = impulse_reserve(bank, length);
+    short* out;
+    float peak = 0.0f, scale;
+    unsigned int i;
+
+    if (id < 0 || decay_ms <= 0.0f)
+        return -1;
+
+    // Rendered twice, for the peak then to the arena, rather than buffered
+    for (i = 0; i < length; i++) {
+        float v = fabsf(impulse_damped(frequency_hz, decay_ms, (float)i / bank->rate_hz));
+
+        if (v > peak)
+            peak = v;
+    }
+    if (peak == 0.0f)
+        return -1;
+
+    out = bank->arena + bank->entries[id].offset;
+    scale = FFB_MAGNITUDE_MAX / peak;
+    for (i = 0; i < length; i++)
+        out[i] = (short)floorf(impulse_damped(frequency_hz, decay_ms, (float)i / bank->rate_hz) * scale + 0.5f);
+    return impulse_commit(bank, id);
+}
+
+int ffb_impulse_trigger(ffb_impulse_bank* bank, int id, float gain, float stretch) {
+    ffb_impulse_pending* slot;
+    long q8;
+    unsigned int i;
+
+    if (id < 0 || id >= (int)bank->count || stretch <= 0.0f)
+        return -1;
+
+    q8 = (long)(stretch * 256.0f + 0.5f);
+    if (q8 < 1)
+        q8 = 1;
+
+    for (i = 0; i < FFB_IMPULSE_MAX_PENDING; i++) {
+        slot = &bank->pending[i];
+        if (pid_atomic_cas(&slot->state, 0, 1)) {
+            pid_atomic_store(&slot->id, id);
+            pid_atomic_store(&slot->gain, (long)gain);
+            pid_atomic_store(&slot->stretch, q8);
+            pid_atomic_store(&slot->state, 2);
+            return 0;
+        }
+    }
+
+    pid_atomic_add(&bank->dropped, 1);
+    return -1;
+}
+
+// Starts a voice, taking over the one closest to its end if none is free
+static void impulse_start(ffb_impulse_bank* bank, int id, long gain, long stretch, unsigned int sample_ms) {
+    ffb_impulse_voice* voice = NULL;
+    float progress, most = -1.0f;
+    unsigned int i;
+
+    for (i = 0; i < FFB_IMPULSE_MAX_VOICES; i++) {
+        ffb_impulse_voice* v = &bank->voices[i];
+
+        if (v->id < 0) {
+            voice = v;
+            break;
+        }
+        progress = (float)v->position / ((float)bank->entries[v->id].length * 65536.0f);
+        if (progress > most) {
+            most = progress;
+            voice = v;
+        }
+    }
+    if (voice->id >= 0)
+        bank->stolen++;
+
+    voice->id = id;
+    voice->position = 0;
+    voice->step = (unsigned long)((double)sample_ms * bank->rate_hz / 1000.0 * 65536.0 * 256.0 / stretch + 0.5);
+    if (voice->step == 0)
+        voice->step = 1;
+    voice->gain = (float)gain / FFB_MAGNITUDE_MAX;
+    bank->triggers++;
+}
+
+void ffb_impulse_render(ffb_impulse_bank* bank, unsigned int sample_ms, float* out, unsigned int count) {
+    ffb_impulse_pending* slot;
+    ffb_impulse_voice* voice;
+    const short* s;
+    unsigned long end, i;
+    unsigned int k, n;
+    float f;
+
+    for (k = 0; k < FFB_IMPULSE_MAX_PENDING; k++) {
+        slot = &bank->pending[k];
+        if (pid_atomic_load(&slot->state) == 2) {
+            impulse_start(bank, (int)pid_atomic_load(&slot->id), pid_atomic_load(&slot->gain),
+                          pid_atomic_load(&slot->stretch), sample_ms);
+            pid_atomic_store(&slot->state, 0);
+        }
+    }
+
+    for (n = 0; n < count; n++)
+        out[n] = 0.0f;
+
+    for (k = 0; k < FFB_IMPULSE_MAX_VOICES; k++) {
+        voice = &bank->voices[k];
+        if (voice->id < 0)
+            continue;
+
+        s = bank->arena + bank->entries[voice->id].offset;
+        end = (unsigned long)bank->entries[voice->id].length << 16;
+        for (n = 0; n < count && voice->position < end; n++) {
+            i = voice->position >> 16;
+            f = (float)(voice->position & 0xffff) * (1.0f / 65536.0f);
+            out[n] += voice->gain * ((float)s[i] + f * (float)(s[i + 1] - s[i]));
+            voice->position += voice->step;
+        }
+        if (voice->position >= end)
+            voice->id = -1;
+    }
+}
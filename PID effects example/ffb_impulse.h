@@ -0,0 +1,83 @@
+// Pre-rendered impulse bank
+// Short effects (collisions, gear shifts, kerb strikes) are rendered once,
+// normalized to a peak of 1 and stored back to back as 16 bit samples in
+// one arena. The id returned when an impulse is added indexes the table,
+// so a trigger costs a lookup, not a render.
+//
+// A trigger plays an impulse with its own gain and time stretch on one
+// of FFB_IMPULSE_MAX_VOICES voices; when every voice is busy the one
+// closest to its end is taken over. The cost of a block is bounded by
+// the number of voices, however many impulses pile up in a crash.
+//
+// Impulses are added before rendering starts. Triggers may come from any
+// thread: they go through FFB_IMPULSE_MAX_PENDING slots, picked up by the
+// render thread at the start of the next block.
+//
+// In ffb_graph.h an impulse node is a source.
+
+#ifndef FFB_IMPULSE_H__
+#define FFB_IMPULSE_H__
+
+#include "pid_platform.h"
+
+#define FFB_IMPULSE_ARENA 16384     // Samples, for every impulse
+#define FFB_IMPULSE_MAX 64
+#define FFB_IMPULSE_MAX_VOICES 16
+#define FFB_IMPULSE_MAX_PENDING 16
+
+typedef struct ffb_impulse_entry {
+    unsigned int offset;            // In the arena
+    unsigned int length;            // Samples, not counting the trailing 0
+} ffb_impulse_entry;
+
+typedef struct ffb_impulse_voice {
+    int id;                         // -1 when free
+    unsigned long position;         // Q16 sample index
+    unsigned long step;             // Q16 samples per output sample
+    float gain;
+} ffb_impulse_voice;
+
+typedef struct ffb_impulse_pending {
+    pid_atomic_t state;             // 0 free, 1 being written, 2 ready
+    pid_atomic_t id;
+    pid_atomic_t gain;              // Magnitude units
+    pid_atomic_t stretch;           // Q8
+} ffb_impulse_pending;
+
+typedef struct ffb_impulse_bank {
+    short arena[FFB_IMPULSE_ARENA];
+    unsigned int used;
+    ffb_impulse_entry entries[FFB_IMPULSE_MAX];
+    unsigned int count;
+    unsigned int rate_hz;           // Of the stored samples
+
+    ffb_impulse_voice voices[FFB_IMPULSE_MAX_VOICES];
+    ffb_impulse_pending pending[FFB_IMPULSE_MAX_PENDING];
+
+    // Statistics
+    unsigned long triggers;
+    pid_atomic_t dropped;           // No pending slot left
+    unsigned long stolen;           // Voices taken over
+} ffb_impulse_bank;
+
+// rate_hz is the rate the impulses are given at (1000 for one sample per ms)
+void ffb_impulse_init(ffb_impulse_bank* bank, unsigned int rate_hz);
+
+// Copies length samples to the arena, normalized to a peak of 1.
+// Returns the id of the impulse, -1 if the arena or the table is full
+// or the impulse is silent
+int ffb_impulse_add(ffb_impulse_bank* bank, const float* samples, unsigned int length);
+
+// Renders a damped sine, sin(2 pi f t) exp(-t / decay), e.g. a collision
+// (12 Hz, 80 ms) or a gear shift (25 Hz, 20 ms). Returns as ffb_impulse_add()
+int ffb_impulse_add_damped(ffb_impulse_bank* bank, float frequency_hz, float decay_ms, float length_ms);
+
+// Plays an impulse at gain (magnitude units of the peak), stretch 2.0
+// lasting twice as long. Returns 0 on success, -1 if id does not exist
+// or too many triggers are pending
+int ffb_impulse_trigger(ffb_impulse_bank* bank, int id, float gain, float stretch);
+
+// Writes the sum of the voices, count samples sample_ms apart
+void ffb_impulse_render(ffb_impulse_bank* bank, unsigned int sample_ms, float* out, unsigned int count);
+
+#endif // FFB_IMPULSE_H__
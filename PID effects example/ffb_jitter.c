@@ -0,0 +1,120 @@
+#include "ffb_jitter.h"
+
+#include <string.h>
+
+#define FFB_JITTER_MASK (FFB_JITTER_RING_LEN - 1)
+
+// Samples already handed to the writer, or about to be, are never rendered again
+#define FFB_JITTER_GUARD 1
+
+int ffb_jitter_init(ffb_jitter* jitter, ffb_render_fn render, void* ctx, unsigned int sample_ms, unsigned int block, unsigned int depth) {
+    memset(jitter, 0x00, sizeof(*jitter));
+
+    if (!render || block == 0 || block > FFB_JITTER_MAX_BLOCK || depth + block > FFB_JITTER_RING_LEN)
+        return -1;
+
+    jitter->render = render;
+    jitter->ctx = ctx;
+    jitter->sample_ms = sample_ms ? sample_ms : 1;
+    jitter->block = block;
+    jitter->depth = depth;
+
+    return pid_event_init(&jitter->wake);
+}
+
+void ffb_jitter_destroy(ffb_jitter* jitter) {
+    pid_event_destroy(&jitter->wake);
+}
+
+void ffb_jitter_invalidate(ffb_jitter* jitter) {
+    pid_atomic_store(&jitter->stale, 1);
+    pid_event_signal(&jitter->wake);
+}
+
+int ffb_jitter_stream(void* ctx, short* magnitude) {
+    ffb_jitter* jitter = (ffb_jitter*)ctx;
+    long read = pid_atomic_load(&jitter->read);
+
+    // Nothing rendered yet: hold the last sample, the timeline still moves
+    if (pid_atomic_load(&jitter->write) - read <= 0)
+        pid_atomic_add(&jitter->underruns, 1);
+    else
+        jitter->last = jitter->ring[read & FFB_JITTER_MASK];
+
+    pid_atomic_store(&jitter->read, read + 1);
+    *magnitude = jitter->last;
+    return 1;
+}
+
+// Drops the tail rendered from stale input. The end is pulled back
+// first, so the writer stops taking stale samples, then moved past what
+// the writer took in the meantime: only the samples it can no longer
+// reach are counted as cancelled
+static void jitter_rewind(ffb_jitter* jitter) {
+    long write = pid_atomic_load(&jitter->write);
+    long keep = pid_atomic_load(&jitter->read) + FFB_JITTER_GUARD;
+    long played;
+
+    if (write <= keep || !pid_atomic_cas(&jitter->write, write, keep))
+        return;
+
+    played = pid_atomic_load(&jitter->read) + FFB_JITTER_GUARD;
+    if (played > write)
+        played = write;
+    if (played > keep && pid_atomic_cas(&jitter->write, keep, played))
+        keep = played;
+    pid_atomic_add(&jitter->cancelled, write - keep);
+}
+
+static void jitter_loop(void* arg) {
+    ffb_jitter* jitter = (ffb_jitter*)arg;
+    short block[FFB_JITTER_MAX_BLOCK];
+    long read, write;
+    unsigned int i;
+
+    while (pid_atomic_load(&jitter->running)) {
+        if (pid_atomic_exchange(&jitter->stale, 0))
+            jitter_rewind(jitter);
+
+        read = pid_atomic_load(&jitter->read);
+        write = pid_atomic_load(&jitter->write);
+
+        // The writer went past the rendered samples (underrun): catch up
+        if (write < read) {
+            write = read;
+            pid_atomic_store(&jitter->write, write);
+        }
+
+        if (write - read < (long)jitter->depth) {
+            jitter->render(jitter->ctx, jitter->start_ms + (unsigned long)write * jitter->sample_ms,
+                           jitter->sample_ms, block, jitter->block);
+            // Published only once written
+            for (i = 0; i < jitter->block; i++)
+                jitter->ring[(write + i) & FFB_JITTER_MASK] = block[i];
+            pid_atomic_store(&jitter->write, write + (long)jitter->block);
+            continue;
+        }
+
+        pid_event_wait(&jitter->wake, jitter->sample_ms);
+    }
+}
+
+int ffb_jitter_start(ffb_jitter* jitter) {
+    jitter->start_ms = (unsigned long)(pid_time_us() / 1000);
+    pid_atomic_store(&jitter->read, 0);
+    pid_atomic_store(&jitter->write, 0);
+
+    pid_atomic_store(&jitter->running, 1);
+    if (pid_thread_start(&jitter->thread, jitter_loop, jitter)) {
+        pid_atomic_store(&jitter->running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void ffb_jitter_stop(ffb_jitter* jitter) {
+    if (!pid_atomic_exchange(&jitter->running, 0))
+        return;
+    pid_event_signal(&jitter->wake);
+    pid_thread_join(jitter->thread);
+}
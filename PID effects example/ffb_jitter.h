@@ -0,0 +1,66 @@
+// Look-ahead force rendering with a jitter buffer
+// Games produce force targets at frame rate, with hitches. In this mode
+// the force is rendered like audio: a render thread calls render() for
+// blocks of block samples ahead of time into a ring buffer, and the writer
+// loop drains one sample per tick (ffb_jitter_stream() as stream callback,
+// with a writer period of sample_ms).
+//
+// The ring is kept depth samples ahead of the writer, so a hitch shorter
+// than depth * sample_ms does not underrun, at the price of that much
+// latency. When the game has new input, ffb_jitter_invalidate() drops the
+// samples rendered from stale input and they are rendered again.
+//
+// One render thread produces, the writer loop consumes: the ring needs no lock.
+
+#ifndef FFB_JITTER_H__
+#define FFB_JITTER_H__
+
+#include "pid_platform.h"
+
+#define FFB_JITTER_RING_LEN 256 // Power of two
+#define FFB_JITTER_MAX_BLOCK 64
+
+// Renders count samples, the first one being played at t_ms
+// (the clock of pid_time_us() / 1000), the next ones sample_ms apart.
+typedef void (*ffb_render_fn)(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count);
+
+typedef struct ffb_jitter {
+    ffb_render_fn render;
+    void* ctx;
+    unsigned int sample_ms;
+    unsigned int block;     // Samples rendered per call
+    unsigned int depth;     // Samples kept ahead of the writer
+
+    short ring[FFB_JITTER_RING_LEN];
+    pid_atomic_t read;      // Next sample to play, only advanced by the writer
+    pid_atomic_t write;     // End of the rendered samples, only moved by the render thread
+    pid_atomic_t stale;     // Set by ffb_jitter_invalidate()
+    unsigned long start_ms; // Time of sample 0
+    short last;             // Held on underrun
+
+    pid_thread_t thread;
+    pid_event_t wake;
+    pid_atomic_t running;
+
+    // Statistics
+    pid_atomic_t underruns;
+    pid_atomic_t cancelled; // Samples dropped by ffb_jitter_invalidate()
+} ffb_jitter;
+
+// block and depth are in samples, depth + block must fit in FFB_JITTER_RING_LEN.
+// Returns 0 on success
+int ffb_jitter_init(ffb_jitter* jitter, ffb_render_fn render, void* ctx, unsigned int sample_ms, unsigned int block, unsigned int depth);
+void ffb_jitter_destroy(ffb_jitter* jitter);
+
+// Starts and stops the render thread. Returns 0 on success
+int ffb_jitter_start(ffb_jitter* jitter);
+void ffb_jitter_stop(ffb_jitter* jitter);
+
+// Drops the samples that are not played yet, but the next one,
+// and renders them again from the new input
+void ffb_jitter_invalidate(ffb_jitter* jitter);
+
+// pid_stream_fn draining one sample per tick (ctx is the ffb_jitter)
+int ffb_jitter_stream(void* ctx, short* magnitude);
+
+#endif // FFB_JITTER_H__
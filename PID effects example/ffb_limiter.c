@@ -0,0 +1,190 @@
+#include "ffb_limiter.h"
+
+#include <string.h>
+
+#include "pid_reports.h"
+
+#define FFB_MAGNITUDE_MAX 32767
+#define FFB_LIMITER_QUEUE (FFB_LIMITER_MAX_LOOKAHEAD + 1)
+
+void ffb_limiter_init(ffb_limiter* limiter, int threshold, int ceiling, unsigned int lookahead, unsigned int release) {
+    memset(limiter, 0x00, sizeof(*limiter));
+
+    if (ceiling <= 0 || ceiling > FFB_MAGNITUDE_MAX)
+        ceiling = FFB_MAGNITUDE_MAX;
+    if (threshold <= 0 || threshold > ceiling)
+        threshold = ceiling;
+    if (lookahead > FFB_LIMITER_MAX_LOOKAHEAD)
+        lookahead = FFB_LIMITER_MAX_LOOKAHEAD;
+
+    limiter->threshold = threshold;
+    limiter->ceiling = ceiling;
+    limiter->lookahead = lookahead;
+    limiter->release = 1.0f / (float)(release ? release : 1);
+    limiter->target = 1.0f;
+    limiter->gain = 1.0f;
+    limiter->auto_gain = 1.0f;
+}
+
+int ffb_limiter_set_auto_gain(ffb_limiter* limiter, pid_writer* writer, const pid_codec* codec, float min_gain, unsigned int window) {
+    limiter->decay = 1.0f / (float)(window ? window : 1);
+    limiter->min_gain = min_gain > 0.0f && min_gain < 1.0f ? min_gain : 1.0f;
+    limiter->level = 0.0f;
+    limiter->auto_gain = 1.0f;
+
+    limiter->writer = writer;
+    limiter->device_gain = pid_codec_find(codec, PID_REPORT_OUTPUT, DEVICE_GAIN_REPORT_ID,
+                                          PID_USAGE(PID_PAGE_PID, PID_USAGE_DEVICE_GAIN), 0);
+    limiter->gain_length = pid_codec_report_length(codec, PID_REPORT_OUTPUT, DEVICE_GAIN_REPORT_ID);
+    if (!limiter->device_gain || limiter->gain_length > PID_WRITER_REPORT_MAX || limiter->device_gain->logical_max <= 0) {
+        limiter->device_gain = NULL;
+        return -1;
+    }
+
+    // The device gain is set to its maximum at startup
+    limiter->device_max = limiter->device_gain->logical_max;
+    limiter->device_level = limiter->device_max;
+    memset(limiter->gain_buf, 0x00, sizeof(limiter->gain_buf));
+    limiter->gain_buf[0] = DEVICE_GAIN_REPORT_ID;
+    return 0;
+}
+
+// Soft curve of ffb_mixer: d * r / (d + r) above the threshold
+static float limiter_curve(const ffb_limiter* limiter, float mag) {
+    float d = mag - limiter->threshold;
+    float r = (float)(limiter->ceiling - limiter->threshold);
+
+    if (d <= 0.0f)
+        return mag;
+    return limiter->threshold + (r > 0.0f ? d * r / (d + r) : 0.0f);
+}
+
+// Returns the share of the auto-gain left to the magnitude
+static float limiter_auto_gain(ffb_limiter* limiter, float mag) {
+    float target;
+    long level;
+
+    if (limiter->decay <= 0.0f)
+        return 1.0f;
+
+    // Peak level: instant attack, slow decay
+    if (mag > limiter->level)
+        limiter->level = mag;
+    else
+        limiter->level -= limiter->level * limiter->decay;
+
+    target = limiter->level > limiter->threshold ? limiter->threshold / limiter->level : 1.0f;
+    if (target < limiter->min_gain)
+        target = limiter->min_gain;
+    limiter->auto_gain += (target - limiter->auto_gain) * limiter->decay;
+
+    if (!limiter->device_gain)
+        return limiter->auto_gain;
+
+    // The device takes the gain rounded up, the magnitude the rest
+    limiter->since_report++;
+    level = (long)(limiter->auto_gain * limiter->device_max + 0.999f);
+    if (level > limiter->device_max)
+        level = limiter->device_max;
+    if ((level - limiter->device_level >= FFB_LIMITER_GAIN_HYSTERESIS
+         || limiter->device_level - level >= FFB_LIMITER_GAIN_HYSTERESIS
+         || (level == limiter->device_max && limiter->device_level != level))
+        && limiter->since_report >= FFB_LIMITER_GAIN_INTERVAL) {
+        pid_codec_put_raw(limiter->device_gain, limiter->gain_buf, level);
+        if (pid_writer_submit(limiter->writer, limiter->gain_buf, limiter->gain_length) == 0) {
+            limiter->device_level = level;
+            limiter->since_report = 0;
+            limiter->gain_reports++;
+        }
+    }
+
+    return limiter->auto_gain * limiter->device_max / (float)limiter->device_level;
+}
+
+// Queues the need of the sample entering the delay line, and returns the
+// lowest need of the samples still in it. A need at the back that is not
+// lower than the new one can never be the lowest again
+static float limiter_lowest(ffb_limiter* limiter, float need) {
+    unsigned int back;
+
+    // Left the delay line, the difference wraps around
+    while (limiter->queued > 0 && (long)(limiter->leaves[limiter->front] - limiter->samples) < 0) {
+        limiter->front = (limiter->front + 1) % FFB_LIMITER_QUEUE;
+        limiter->queued--;
+    }
+
+    while (limiter->queued > 0) {
+        back = (limiter->front + limiter->queued - 1) % FFB_LIMITER_QUEUE;
+        if (limiter->need[back] < need)
+            break;
+        limiter->queued--;
+    }
+    back = (limiter->front + limiter->queued) % FFB_LIMITER_QUEUE;
+    limiter->need[back] = need;
+    limiter->leaves[back] = limiter->samples + limiter->lookahead;
+    limiter->queued++;
+
+    return limiter->need[limiter->front];
+}
+
+short ffb_limiter_process(ffb_limiter* limiter, long force) {
+    float mag = (float)(force < 0 ? -force : force);
+    float scaled, need, lowest, out;
+    short delayed;
+
+    limiter->samples++;
+    if (mag > limiter->ceiling)
+        limiter->over++;
+
+    scaled = force * limiter_auto_gain(limiter, mag);
+    mag = scaled < 0.0f ? -scaled : scaled;
+    if (mag > FFB_MAGNITUDE_MAX) {
+        scaled = scaled < 0.0f ? (float)-FFB_MAGNITUDE_MAX : (float)FFB_MAGNITUDE_MAX;
+        mag = FFB_MAGNITUDE_MAX;
+    }
+
+    // Gain this sample needs when it leaves the delay line
+    need = mag > limiter->threshold ? limiter_curve(limiter, mag) / mag : 1.0f;
+    lowest = limiter_lowest(limiter, need);
+    if (need == lowest && need <= limiter->target) {
+        float step = (limiter->gain - need) / (float)(limiter->lookahead + 1);
+        // Never slower than the attack already running for an earlier peak
+        if (step > limiter->step)
+            limiter->step = step;
+    }
+    limiter->target = lowest;
+
+    if (limiter->gain > limiter->target) {
+        limiter->gain -= limiter->step;
+        if (limiter->gain <= limiter->target) {
+            limiter->gain = limiter->target;
+            limiter->step = 0.0f;
+        }
+    }
+    else {
+        limiter->step = 0.0f;
+        limiter->gain += (limiter->target - limiter->gain) * limiter->release;
+    }
+
+    if (limiter->lookahead > 0) {
+        delayed = limiter->delay[limiter->pos];
+        limiter->delay[limiter->pos] = (short)scaled;
+        limiter->pos = (limiter->pos + 1) % limiter->lookahead;
+    }
+    else {
+        delayed = (short)scaled;
+    }
+
+    out = delayed * limiter->gain;
+    if (out > limiter->ceiling || out < -limiter->ceiling) {
+        limiter->clipped++;
+        out = out < 0.0f ? (float)-limiter->ceiling : (float)limiter->ceiling;
+    }
+    return (short)(out < 0.0f ? out - 0.5f : out + 0.5f);
+}
+
+int ffb_limiter_clip_rate(const ffb_limiter* limiter) {
+    if (limiter->samples == 0)
+        return 0;
+    return (int)((unsigned long long)limiter->over * 1000 / limiter->samples);
+}
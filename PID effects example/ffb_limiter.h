@@ -0,0 +1,86 @@
+// Look-ahead soft limiter with auto-gain
+// The magnitude of SET_CONSTANT_FORCE_REPORT clips hard at +-32767.
+// The limiter delays the force by lookahead samples and, as soon as a
+// peak enters the delay line, ramps the gain down so that the peak leaves
+// it on the soft curve of the mixer (linear up to threshold, bending
+// towards ceiling). The gain follows the lowest gain needed by the samples
+// in the delay line (a monotonic queue of their needs), so it is held
+// while a peak is in the delay line, down to a smaller peak behind it,
+// then released exponentially.
+//
+// Auto-gain (optional) follows the slow peak level of the force and lowers
+// the overall gain when it keeps going past threshold. The gain is split
+// between the DEVICE_GAIN_REPORT, sent only when its value moves by more
+// than FFB_LIMITER_GAIN_HYSTERESIS, and the magnitude, which keeps its
+// full 16 bit resolution.
+//
+// ffb_limiter_process() is constant time (amortized over the queue), to
+// be called once per tick from the stream callback.
+
+#ifndef FFB_LIMITER_H__
+#define FFB_LIMITER_H__
+
+#include "pid_writer.h"
+
+#define FFB_LIMITER_MAX_LOOKAHEAD 32
+#define FFB_LIMITER_GAIN_HYSTERESIS 2     // Device gain steps
+#define FFB_LIMITER_GAIN_INTERVAL 100     // Samples between two gain reports
+
+typedef struct ffb_limiter {
+    int threshold;
+    int ceiling;
+    unsigned int lookahead;
+    float release;          // Per sample
+
+    short delay[FFB_LIMITER_MAX_LOOKAHEAD];
+    unsigned int pos;
+    float target;           // Lowest gain needed by the samples in the delay line
+
+    // Needs of the samples in the delay line, increasing from the front,
+    // each with the sample count at which it leaves the line
+    float need[FFB_LIMITER_MAX_LOOKAHEAD + 1];
+    unsigned long leaves[FFB_LIMITER_MAX_LOOKAHEAD + 1];
+    unsigned int front;
+    unsigned int queued;
+
+    float step;             // Attack step per sample
+    float gain;
+
+    // Auto-gain
+    pid_writer* writer;
+    const pid_field* device_gain;
+    unsigned char gain_buf[PID_WRITER_REPORT_MAX];
+    size_t gain_length;
+    float decay;            // Per sample, of the level
+    float min_gain;
+    float level;            // Slow peak level of the input
+    float auto_gain;        // Host times device gain
+    long device_level;      // Last device gain sent
+    long device_max;
+    unsigned long since_report;
+
+    // Statistics
+    unsigned long samples;
+    unsigned long over;     // Inputs past the ceiling, clipped without the limiter
+    unsigned long clipped;  // Outputs clipped anyway
+    unsigned long gain_reports;
+} ffb_limiter;
+
+// Output is linear up to threshold and never exceeds ceiling (<= 32767).
+// lookahead (<= FFB_LIMITER_MAX_LOOKAHEAD) is the delay, in samples,
+// release the time constant of the gain recovery, in samples.
+void ffb_limiter_init(ffb_limiter* limiter, int threshold, int ceiling, unsigned int lookahead, unsigned int release);
+
+// Enables auto-gain, down to min_gain (0..1), over a level window of
+// window samples. The device gain reports are queued on writer.
+// Returns 0 on success, -1 if the device has no DEVICE_GAIN_REPORT:
+// auto-gain then only scales the magnitude.
+int ffb_limiter_set_auto_gain(ffb_limiter* limiter, pid_writer* writer, const pid_codec* codec, float min_gain, unsigned int window);
+
+// Takes one sample, returns the one from lookahead samples ago, limited
+short ffb_limiter_process(ffb_limiter* limiter, long force);
+
+// Inputs that went past the ceiling, per thousand samples
+int ffb_limiter_clip_rate(const ffb_limiter* limiter);
+
+#endif // FFB_LIMITER_H__
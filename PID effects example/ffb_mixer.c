@@ -0,0 +1,114 @@
+#include "ffb_mixer.h"
+
+#include <string.h>
+
+#define FFB_MAGNITUDE_MAX 32767
+
+void ffb_mixer_init(ffb_mixer* mixer, int knee, int duck_gain) {
+    memset(mixer, 0x00, sizeof(*mixer));
+
+    if (knee < 0)
+        knee = 0;
+    if (knee > FFB_MAGNITUDE_MAX)
+        knee = FFB_MAGNITUDE_MAX;
+
+    mixer->knee = knee;
+    mixer->duck_gain = duck_gain;
+}
+
+int ffb_mixer_connect(ffb_mixer* mixer, int priority, int gain) {
+    int i;
+
+    if (priority < 1)
+        return -1;
+
+    for (i = 0; i < FFB_MIXER_MAX_CLIENTS; i++) {
+        ffb_mixer_client* c = &mixer->clients[i];
+
+        // Claimed first, so no other client initializes the slot, then
+        // the force and gain are set before the priority is published:
+        // the writer loop never mixes a half initialized slot.
+        if (!pid_atomic_cas(&c->priority, 0, FFB_MIXER_CLAIMED))
+            continue;
+        pid_atomic_store(&c->force, 0);
+        pid_atomic_store(&c->gain, gain);
+        pid_atomic_store(&c->priority, priority);
+        return i;
+    }
+
+    return -1;
+}
+
+void ffb_mixer_disconnect(ffb_mixer* mixer, int client) {
+    if (client < 0 || client >= FFB_MIXER_MAX_CLIENTS)
+        return;
+
+    pid_atomic_store(&mixer->clients[client].priority, 0);
+}
+
+void ffb_mixer_set_gain(ffb_mixer* mixer, int client, int gain) {
+    if (client < 0 || client >= FFB_MIXER_MAX_CLIENTS)
+        return;
+
+    pid_atomic_store(&mixer->clients[client].gain, gain);
+}
+
+void ffb_mixer_submit(ffb_mixer* mixer, int client, int force) {
+    if (client < 0 || client >= FFB_MIXER_MAX_CLIENTS)
+        return;
+
+    pid_atomic_store(&mixer->clients[client].force, force);
+}
+
+// Linear up to the knee, then bends smoothly towards full scale:
+//      y = knee + d * r / (d + r)      with d = |x| - knee, r = 32767 - knee
+// The curve has a slope of 1 at the knee and never exceeds 32767.
+static int soft_saturate(int x, int knee) {
+    int mag = x < 0 ? -x : x;
+    long long d, r;
+
+    if (mag > knee) {
+        d = mag - knee;
+        r = FFB_MAGNITUDE_MAX - knee;
+        mag = knee + (int)(r > 0 ? d * r / (d + r) : 0);
+    }
+
+    return x < 0 ? -mag : mag;
+}
+
+short ffb_mixer_tick(ffb_mixer* mixer) {
+    long priority[FFB_MIXER_MAX_CLIENTS];
+    long top = 0;
+    long long sum = 0;
+    int i;
+
+    // Snapshot the priorities first so that every slot is ducked
+    // against the same top priority during this tick.
+    for (i = 0; i < FFB_MIXER_MAX_CLIENTS; i++) {
+        priority[i] = pid_atomic_load(&mixer->clients[i].priority);
+        if (priority[i] > top)
+            top = priority[i];
+    }
+
+    for (i = 0; i < FFB_MIXER_MAX_CLIENTS; i++) {
+        long long gain = pid_atomic_load(&mixer->clients[i].gain);
+        long long force = pid_atomic_load(&mixer->clients[i].force);
+
+        if (priority[i] <= 0)
+            continue;
+        if (priority[i] < top)
+            gain = gain * mixer->duck_gain / FFB_MIXER_UNITY;
+
+        sum += force * gain;
+    }
+
+    sum /= FFB_MIXER_UNITY;
+
+    // Clamp before saturating so the int conversion cannot overflow
+    if (sum > 4 * FFB_MAGNITUDE_MAX)
+        sum = 4 * FFB_MAGNITUDE_MAX;
+    if (sum < -4 * FFB_MAGNITUDE_MAX)
+        sum = -4 * FFB_MAGNITUDE_MAX;
+
+    return (short)soft_saturate((int)sum, mixer->knee);
+}
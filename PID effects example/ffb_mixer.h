@@ -0,0 +1,58 @@
+// Force mixer
+// Sums the constant force contributions of several clients
+// (e.g. a game and a telemetry overlay adding road texture)
+// into the single magnitude sent with SET_CONSTANT_FORCE_REPORT.
+//
+// Clients run on their own threads and only publish their latest value.
+// The writer loop calls ffb_mixer_tick() once per update, and the cost of
+// a tick is always FFB_MIXER_MAX_CLIENTS slots, whatever the number of
+// connected clients.
+
+#ifndef FFB_MIXER_H__
+#define FFB_MIXER_H__
+
+#include "pid_platform.h"
+
+#define FFB_MIXER_MAX_CLIENTS 8
+
+// Unity gain for the Q8 gains used by the mixer
+#define FFB_MIXER_UNITY 256
+
+// Priority of a slot being connected, not mixed yet
+#define FFB_MIXER_CLAIMED -1
+
+typedef struct ffb_mixer_client {
+    pid_atomic_t priority; // 0 when the slot is free, FFB_MIXER_CLAIMED while
+                           // it is being connected, higher wins
+    pid_atomic_t gain;     // Q8, FFB_MIXER_UNITY = 100%
+    pid_atomic_t force;    // Latest contribution, -32768..32767
+} ffb_mixer_client;
+
+typedef struct ffb_mixer {
+    ffb_mixer_client clients[FFB_MIXER_MAX_CLIENTS];
+    int duck_gain; // Q8 gain applied to clients below the top priority
+    int knee;      // Soft saturation starts above this magnitude
+} ffb_mixer;
+
+// knee: magnitude above which the output is softly compressed (0..32767)
+// duck_gain: Q8 gain applied to every client that does not have the highest
+//            connected priority (FFB_MIXER_UNITY disables ducking)
+void ffb_mixer_init(ffb_mixer* mixer, int knee, int duck_gain);
+
+// Claims a free slot. priority must be >= 1.
+// Returns the client id, or -1 if every slot is taken.
+int ffb_mixer_connect(ffb_mixer* mixer, int priority, int gain);
+
+// Releases the slot, its contribution is dropped on the next tick.
+// Call it as well when a client process goes away.
+void ffb_mixer_disconnect(ffb_mixer* mixer, int client);
+
+void ffb_mixer_set_gain(ffb_mixer* mixer, int client, int gain);
+
+// Publishes the latest force of a client (-32768..32767)
+void ffb_mixer_submit(ffb_mixer* mixer, int client, int force);
+
+// Mixes every slot and returns the magnitude to send to the device
+short ffb_mixer_tick(ffb_mixer* mixer);
+
+#endif // FFB_MIXER_H__
@@ -0,0 +1,252 @@
+#include "ffb_noise.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFB_NOISE_SSE 1
+#endif
+
+#define FFB_NOISE_PI 3.14159265f
+
+// Starting points, tune them on the wheel. The grain is the amplitude of
+// the white noise, the low pass keeps its RMS
+static const ffb_noise_surface ffb_noise_surfaces[FFB_SURFACE_COUNT] = {
+    { "asphalt", 400.0f, 2.0f, 3, 100.0f, 40.0f, 0.0f, 0.0f },
+    { "concrete", 500.0f, 3.0f, 2, 150.0f, 60.0f, 0.0f, 0.0f },
+    { "cobbles", 1500.0f, 0.25f, 2, 500.0f, 80.0f, 0.0f, 0.0f },
+    { "gravel", 1000.0f, 1.0f, 3, 2000.0f, 120.0f, 0.0f, 0.0f },
+    { "dirt", 1500.0f, 4.0f, 3, 600.0f, 50.0f, 0.0f, 0.0f },
+    { "curb", 200.0f, 2.0f, 2, 100.0f, 40.0f, 5000.0f, 0.5f },
+};
+
+const ffb_noise_surface* ffb_noise_surface_get(int surface) {
+    if (surface < 0 || surface >= FFB_SURFACE_COUNT)
+        return NULL;
+    return &ffb_noise_surfaces[surface];
+}
+
+// Integer hash of a lattice point (lowbias32)
+static unsigned int noise_hash(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+void ffb_noise_init(ffb_noise* noise, unsigned int seed) {
+    unsigned int i;
+
+    memset(noise, 0x00, sizeof(*noise));
+
+    noise->seed = seed;
+    noise->surface = FFB_SURFACE_ASPHALT;
+    noise->previous = FFB_SURFACE_ASPHALT;
+    noise->fade = 1.0f;
+    for (i = 0; i < 4; i++)
+        noise->rng[i] = noise_hash(seed + i + 1) | 1; // xorshift is stuck at 0
+}
+
+int ffb_noise_set_surface(ffb_noise* noise, int surface) {
+    if (surface < 0 || surface >= FFB_SURFACE_COUNT)
+        return -1;
+    if (surface == noise->surface)
+        return 0;
+
+    noise->previous = noise->surface;
+    noise->surface = surface;
+    noise->fade = 0.0f;
+    return 0;
+}
+
+// Gradient noise at cell + frac of the lattice, scaled to about +-1.
+// A cell holds a random slope, the value is the smooth blend of the
+// slopes of the two cells around
+static float noise_gradient1(unsigned int cell, float f) {
+    float g0 = (float)(noise_hash(cell) >> 8) * (1.0f / 8388608.0f) - 1.0f;
+    float g1 = (float)(noise_hash(cell + 1) >> 8) * (1.0f / 8388608.0f) - 1.0f;
+    float u = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+
+    return 2.0f * (g0 * f + u * (g1 * (f - 1.0f) - g0 * f));
+}
+
+#ifdef FFB_NOISE_SSE
+
+// 32 bit multiply, SSE2 only has the 32 x 32 -> 64 one
+static __m128i noise_mullo(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static __m128 noise_slope4(__m128i x) {
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = noise_mullo(x, _mm_set1_epi32(0x7feb352d));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = noise_mullo(x, _mm_set1_epi32((int)0x846ca68bU));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+
+    return _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f / 8388608.0f)), _mm_set1_ps(1.0f));
+}
+
+// Adds amplitude * noise to out
+static void noise_gradient(const unsigned int* cells, const float* frac, float amplitude, float* out, unsigned int count) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i c;
+    __m128 f, g0, g1, u, a;
+    unsigned int n;
+
+    for (n = 0; n + 4 <= count; n += 4) {
+        c = _mm_loadu_si128((const __m128i*)(cells + n));
+        f = _mm_loadu_ps(frac + n);
+        g0 = noise_slope4(c);
+        g1 = noise_slope4(_mm_add_epi32(c, _mm_set1_epi32(1)));
+
+        u = _mm_add_ps(_mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(f, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+        u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(f, f), f), u);
+
+        a = _mm_mul_ps(g0, f);
+        a = _mm_add_ps(a, _mm_mul_ps(u, _mm_sub_ps(_mm_mul_ps(g1, _mm_sub_ps(f, one)), a)));
+        _mm_storeu_ps(out + n, _mm_add_ps(_mm_loadu_ps(out + n), _mm_mul_ps(a, _mm_set1_ps(2.0f * amplitude))));
+    }
+    for (; n < count; n++)
+        out[n] += amplitude * noise_gradient1(cells[n], frac[n]);
+}
+
+#else
+
+static void noise_gradient(const unsigned int* cells, const float* frac, float amplitude, float* out, unsigned int count) {
+    unsigned int n;
+
+    for (n = 0; n < count; n++)
+        out[n] += amplitude * noise_gradient1(cells[n], frac[n]);
+}
+
+#endif
+
+// Uniform white noise in [-1, 1). Sample i of the stream comes from lane
+// i % 4, so the stream does not depend on the block sizes
+static void noise_white(ffb_noise* noise, float* out, unsigned int count) {
+    unsigned int n;
+
+    for (n = 0; n < count; n++) {
+        if ((noise->white & 3) == 0) {
+#ifdef FFB_NOISE_SSE
+            __m128i x = _mm_loadu_si128((const __m128i*)noise->rng);
+
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+            _mm_storeu_si128((__m128i*)noise->rng, x);
+#else
+            unsigned int i;
+
+            for (i = 0; i < 4; i++) {
+                noise->rng[i] ^= noise->rng[i] << 13;
+                noise->rng[i] ^= noise->rng[i] >> 17;
+                noise->rng[i] ^= noise->rng[i] << 5;
+            }
+#endif
+        }
+        out[n] = (float)(noise->rng[noise->white & 3] >> 8) * (1.0f / 8388608.0f) - 1.0f;
+        noise->white++;
+    }
+}
+
+// Adds weight[n] * the texture of a surface to mix
+static void noise_surface(ffb_noise* noise, int id, const double* pos, const float* white, const float* weight, float* mix, unsigned int count, float dt) {
+    const ffb_noise_surface* surface = &ffb_noise_surfaces[id];
+    unsigned int cells[FFB_NOISE_BLOCK];
+    float frac[FFB_NOISE_BLOCK];
+    float value[FFB_NOISE_BLOCK];
+    float amplitude = surface->texture;
+    double scale = 1.0 / surface->wavelength;
+    double x, cell;
+    unsigned int seed, o, n;
+    float a, norm, y;
+
+    for (n = 0; n < count; n++)
+        value[n] = 0.0f;
+
+    // Each octave on its own lattice
+    for (o = 0; o < surface->octaves; o++) {
+        seed = noise_hash(noise->seed + id * FFB_NOISE_MAX_OCTAVES + o);
+        for (n = 0; n < count; n++) {
+            x = pos[n] * scale;
+            cell = floor(x);
+            cells[n] = (unsigned int)(long long)cell + seed;
+            frac[n] = (float)(x - cell);
+        }
+        noise_gradient(cells, frac, amplitude, value, count);
+        scale *= 2.0;
+        amplitude *= 0.5f;
+    }
+
+    if (surface->grain > 0.0f) {
+        a = 1.0f - expf(-2.0f * FFB_NOISE_PI * surface->grain_hz * dt);
+        norm = surface->grain * sqrtf((2.0f - a) / a);
+        y = noise->grain[id];
+        for (n = 0; n < count; n++) {
+            y += a * (white[n] - y);
+            value[n] += norm * y;
+        }
+        noise->grain[id] = y;
+    }
+
+    if (surface->rumble > 0.0f) {
+        for (n = 0; n < count; n++) {
+            x = pos[n] / surface->pitch;
+            value[n] -= surface->rumble * 0.5f * cosf(2.0f * FFB_NOISE_PI * (float)(x - floor(x)));
+        }
+    }
+
+    for (n = 0; n < count; n++)
+        mix[n] += weight[n] * value[n];
+}
+
+void ffb_noise_render(ffb_noise* noise, const float* speed, float* out, unsigned int count, float dt) {
+    double pos[FFB_NOISE_BLOCK];
+    float gain[FFB_NOISE_BLOCK];
+    float white[FFB_NOISE_BLOCK];
+    float weight[FFB_NOISE_BLOCK];
+    float faded[FFB_NOISE_BLOCK];
+    float mix[FFB_NOISE_BLOCK];
+    float step = dt * 1000.0f / FFB_NOISE_FADE_MS;
+    unsigned int done, chunk, n;
+    int fading;
+
+    for (done = 0; done < count; done += chunk) {
+        chunk = count - done < FFB_NOISE_BLOCK ? count - done : FFB_NOISE_BLOCK;
+        fading = noise->fade < 1.0f;
+
+        for (n = 0; n < chunk; n++) {
+            float v = speed[done + n];
+
+            pos[n] = noise->position;
+            noise->position += v * dt;
+            gain[n] = fabsf(v) / FFB_NOISE_FULL_SPEED;
+            if (gain[n] > 1.0f)
+                gain[n] = 1.0f;
+
+            noise->fade += step;
+            if (noise->fade > 1.0f)
+                noise->fade = 1.0f;
+            weight[n] = noise->fade;
+            faded[n] = 1.0f - noise->fade;
+            mix[n] = 0.0f;
+        }
+
+        noise_white(noise, white, chunk);
+        noise_surface(noise, noise->surface, pos, white, weight, mix, chunk, dt);
+        if (fading)
+            noise_surface(noise, noise->previous, pos, white, faded, mix, chunk, dt);
+
+        for (n = 0; n < chunk; n++)
+            out[done + n] = gain[n] * mix[n];
+    }
+}
@@ -0,0 +1,71 @@
+// Procedural road surface texture
+// Synthesizes the road feel from the vehicle speed and the surface type
+// instead of drawing random numbers per sample:
+//      texture     1D gradient (Perlin) noise over the distance traveled,
+//                  a few octaves, so the bumps stretch with the speed,
+//      grain       white noise through a one pole low pass (gravel, dirt),
+//      rumble      bumps at a fixed pitch along the road (curbs).
+// Everything scales with the speed up to FFB_NOISE_FULL_SPEED and is 0
+// at a standstill. A surface change crossfades over FFB_NOISE_FADE_MS.
+//
+// The same seed gives the same texture for the same drive. The lattice
+// hashes and the white noise are computed four samples at a time with
+// SSE2.
+//
+// In ffb_graph.h a noise node takes the speed (m/s) as its input.
+
+#ifndef FFB_NOISE_H__
+#define FFB_NOISE_H__
+
+#define FFB_NOISE_MAX_OCTAVES 4
+#define FFB_NOISE_BLOCK 32
+#define FFB_NOISE_FULL_SPEED 30.0f  // m/s
+#define FFB_NOISE_FADE_MS 100.0f
+
+enum FFB_NOISE_SURFACE {
+    FFB_SURFACE_ASPHALT = 0,
+    FFB_SURFACE_CONCRETE,
+    FFB_SURFACE_COBBLES,
+    FFB_SURFACE_GRAVEL,
+    FFB_SURFACE_DIRT,
+    FFB_SURFACE_CURB,
+    FFB_SURFACE_COUNT,
+};
+
+typedef struct ffb_noise_surface {
+    const char* name;
+    float texture;          // Amplitude of the texture, magnitude units
+    float wavelength;       // Of the first octave, in m
+    unsigned int octaves;   // Each one half the wavelength and amplitude
+    float grain;            // Amplitude of the grain
+    float grain_hz;         // Cutoff of its low pass
+    float rumble;           // Amplitude of the bumps
+    float pitch;            // Distance between bumps, in m
+} ffb_noise_surface;
+
+typedef struct ffb_noise {
+    unsigned int seed;
+    int surface;
+    int previous;           // Surface faded out
+    float fade;             // 0 (previous) to 1 (surface)
+
+    double position;        // Distance traveled, in m
+    unsigned int rng[4];    // White noise, one xorshift per SSE lane
+    unsigned int white;     // Samples of white noise drawn
+    float grain[FFB_SURFACE_COUNT]; // Low pass states
+} ffb_noise;
+
+const ffb_noise_surface* ffb_noise_surface_get(int surface);
+
+// Starts on asphalt at position 0
+void ffb_noise_init(ffb_noise* noise, unsigned int seed);
+
+// Crossfades to another surface. Returns 0 on success, -1 if surface is
+// out of range
+int ffb_noise_set_surface(ffb_noise* noise, int surface);
+
+// Writes count samples dt seconds apart, speed[n] being the speed at
+// sample n in m/s. out may be speed
+void ffb_noise_render(ffb_noise* noise, const float* speed, float* out, unsigned int count, float dt);
+
+#endif // FFB_NOISE_H__
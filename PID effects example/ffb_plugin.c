@@ -0,0 +1,256 @@
+#include "ffb_plugin.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+int ffb_plugin_init(ffb_plugin* plugin, const char* path, const char* config) {
+    memset(plugin, 0x00, sizeof(*plugin));
+
+    plugin->current = -1;
+    plugin->stamp = -1;
+    if (strlen(path) >= sizeof(plugin->path))
+        return -1;
+    memcpy(plugin->path, path, strlen(path) + 1);
+    if (config) {
+        if (strlen(config) >= sizeof(plugin->config))
+            return -1;
+        memcpy(plugin->config, config, strlen(config) + 1);
+    }
+
+    pid_mutex_init(&plugin->lock);
+    return 0;
+}
+
+static int plugin_copy(const char* from, const char* to) {
+    char buffer[4096];
+    size_t size;
+    int result = 0;
+    FILE* in = fopen(from, "rb");
+    FILE* out;
+
+    if (!in)
+        return -1;
+    out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+
+    while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, size, out) != size) {
+            result = -1;
+            break;
+        }
+    }
+    if (ferror(in))
+        result = -1;
+
+    fclose(in);
+    if (fclose(out) != 0)
+        result = -1;
+    return result;
+}
+
+// Modification time and size of the file, -1 if it does not exist.
+// The time alone is in seconds, too coarse for a build
+static long long plugin_stamp(const char* path) {
+    struct stat info;
+
+    if (stat(path, &info) != 0)
+        return -1;
+    return (long long)info.st_mtime * 1000003 + (long long)info.st_size;
+}
+
+static void plugin_release(ffb_plugin_slot* slot) {
+    if (slot->state)
+        slot->desc->teardown(slot->state);
+    if (slot->library)
+        pid_library_close(slot->library);
+    if (slot->copy[0])
+        remove(slot->copy);
+
+    slot->library = NULL;
+    slot->desc = NULL;
+    slot->state = NULL;
+    slot->copy[0] = '\0';
+}
+
+// Waits for the blocks still running in a slot that is no longer current
+static void plugin_retire(ffb_plugin_slot* slot) {
+    while (pid_atomic_load(&slot->readers) != 0)
+        pid_sleep_ms(1);
+    plugin_release(slot);
+}
+
+// A plugin built against an older ffb_plugin_abi.h has a smaller
+// description, the fields past its size are not there
+#define PLUGIN_DESC_HAS(desc, field) ((desc)->size >= offsetof(ffb_plugin_desc, field) + sizeof((desc)->field))
+
+// Takes the description from entry and starts an instance in slot
+static int plugin_start(ffb_plugin* plugin, ffb_plugin_slot* slot, ffb_plugin_entry_fn entry) {
+    slot->desc = entry();
+    if (!slot->desc || slot->desc->abi_version != FFB_PLUGIN_ABI_VERSION) {
+        slot->desc = NULL;
+        plugin->error = "ABI version mismatch";
+        return -1;
+    }
+    if (!PLUGIN_DESC_HAS(slot->desc, init) || !PLUGIN_DESC_HAS(slot->desc, process_block) || !PLUGIN_DESC_HAS(slot->desc, teardown)
+        || !slot->desc->init || !slot->desc->process_block || !slot->desc->teardown) {
+        slot->desc = NULL;
+        plugin->error = "incomplete plugin";
+        return -1;
+    }
+
+    slot->state = slot->desc->init(plugin->config[0] ? plugin->config : NULL);
+    if (!slot->state) {
+        plugin->error = "plugin init failed";
+        return -1;
+    }
+    return 0;
+}
+
+static int plugin_open(ffb_plugin* plugin, ffb_plugin_slot* slot) {
+    char copy[sizeof(slot->copy)];
+    ffb_plugin_entry_fn entry;
+    const char* prefix = "";
+    void* symbol;
+    int length;
+
+#ifndef _WIN32
+    // Without a directory dlopen() would search the library path
+    if (!strchr(plugin->path, '/'))
+        prefix = "./";
+#endif
+
+    plugin->generation++;
+    length = snprintf(copy, sizeof(copy), "%s%s.%lu", prefix, plugin->path, plugin->generation);
+    if (length < 0 || (size_t)length >= sizeof(copy)) {
+        plugin->error = "path too long";
+        return -1;
+    }
+    memcpy(slot->copy, copy, (size_t)length + 1);
+    if (plugin_copy(plugin->path, slot->copy) != 0) {
+        remove(slot->copy);
+        slot->copy[0] = '\0';
+        plugin->error = "cannot copy the library";
+        return -1;
+    }
+
+    slot->library = pid_library_open(slot->copy);
+    if (!slot->library) {
+        plugin->error = "cannot load the library";
+        return -1;
+    }
+
+    symbol = pid_library_symbol(slot->library, FFB_PLUGIN_ENTRY);
+    if (!symbol) {
+        plugin->error = "no " FFB_PLUGIN_ENTRY " export";
+        return -1;
+    }
+
+    // ISO C has no cast from an object pointer to a function pointer,
+    // the platforms with shared libraries give them the same bits
+    memcpy(&entry, &symbol, sizeof(entry));
+    return plugin_start(plugin, slot, entry);
+}
+
+// Opens the library, or the built-in plugin of entry, in the spare slot
+// and makes it current
+static int plugin_load(ffb_plugin* plugin, ffb_plugin_entry_fn entry) {
+    ffb_plugin_slot* slot;
+    long current, old;
+    int result = 0;
+
+    pid_mutex_lock(&plugin->lock);
+
+    // The spare slot was retired by the previous load
+    current = pid_atomic_load(&plugin->current);
+    slot = &plugin->slots[current == 0 ? 1 : 0];
+
+    if (entry == NULL)
+        plugin->stamp = plugin_stamp(plugin->path);
+    if ((entry ? plugin_start(plugin, slot, entry) : plugin_open(plugin, slot)) != 0) {
+        plugin_release(slot);
+        plugin->failures++;
+        result = -1;
+    }
+    else {
+        old = pid_atomic_exchange(&plugin->current, current == 0 ? 1 : 0);
+        if (old >= 0)
+            plugin_retire(&plugin->slots[old]);
+        plugin->error = NULL;
+        plugin->loads++;
+    }
+
+    pid_mutex_unlock(&plugin->lock);
+    return result;
+}
+
+int ffb_plugin_load(ffb_plugin* plugin) {
+    return plugin_load(plugin, NULL);
+}
+
+int ffb_plugin_load_entry(ffb_plugin* plugin, ffb_plugin_entry_fn entry) {
+    return plugin_load(plugin, entry);
+}
+
+int ffb_plugin_poll(ffb_plugin* plugin) {
+    long long stamp = plugin_stamp(plugin->path);
+
+    if (stamp < 0)
+        return 0;
+    if (stamp != plugin->stamp) {
+        // Wait for the file to settle, a linker writes it several times
+        plugin->stamp = stamp;
+        plugin->pending = 1;
+        return 0;
+    }
+    if (!plugin->pending)
+        return 0;
+
+    plugin->pending = 0;
+    return ffb_plugin_load(plugin) == 0 ? 1 : -1;
+}
+
+void ffb_plugin_close(ffb_plugin* plugin) {
+    long old;
+
+    pid_mutex_lock(&plugin->lock);
+    old = pid_atomic_exchange(&plugin->current, -1);
+    if (old >= 0)
+        plugin_retire(&plugin->slots[old]);
+    pid_mutex_unlock(&plugin->lock);
+
+    pid_mutex_destroy(&plugin->lock);
+}
+
+void ffb_plugin_process(ffb_plugin* plugin, float* out, unsigned int n, const ffb_plugin_inputs* inputs) {
+    ffb_plugin_slot* slot;
+    long index;
+    unsigned int i;
+
+    for (;;) {
+        index = pid_atomic_load(&plugin->current);
+        if (index < 0) {
+            for (i = 0; i < n; i++)
+                out[i] = 0.0f;
+            plugin->missed++;
+            return;
+        }
+
+        // The slot may have been swapped out between the load and the
+        // add, it is only safe to run once counted in and still current
+        slot = &plugin->slots[index];
+        pid_atomic_add(&slot->readers, 1);
+        if (pid_atomic_load(&plugin->current) == index)
+            break;
+        pid_atomic_add(&slot->readers, -1);
+    }
+
+    slot->desc->process_block(slot->state, out, n, inputs);
+    pid_atomic_add(&slot->readers, -1);
+    plugin->blocks++;
+}
@@ -0,0 +1,84 @@
+// Hot reloadable effect plugins
+// Loads an effect from a shared library (see ffb_plugin_abi.h) and swaps
+// it for a new build while the force stream keeps running, so iterating
+// on an effect does not mean restarting the program and the device reset
+// sequence.
+//
+// Two instance slots: the new build is loaded and initialized in the
+// spare slot, then made current with one atomic exchange. The render
+// thread counts itself in the slot it runs, so the old instance is torn
+// down and its library unloaded only once no block is running in it
+// (RCU style retirement): process never waits on a load.
+//
+// The library is loaded from a copy, <path>.<generation>, so the file
+// stays writable for the compiler and the new build is not mistaken for
+// the one already loaded.
+//
+// In ffb_graph.h a plugin node binds its inputs to the plugin's channels.
+
+#ifndef FFB_PLUGIN_H__
+#define FFB_PLUGIN_H__
+
+#include "pid_platform.h"
+#include "ffb_plugin_abi.h"
+
+#define FFB_PLUGIN_MAX_PATH 260
+#define FFB_PLUGIN_MAX_CONFIG 128
+
+typedef struct ffb_plugin_slot {
+    pid_library_t library;
+    const ffb_plugin_desc* desc;
+    void* state;
+    char copy[FFB_PLUGIN_MAX_PATH + 32];    // File that was loaded, "./" <path> "." <generation>
+    pid_atomic_t readers;                   // Blocks running in the slot
+} ffb_plugin_slot;
+
+typedef struct ffb_plugin {
+    char path[FFB_PLUGIN_MAX_PATH];
+    char config[FFB_PLUGIN_MAX_CONFIG];
+
+    ffb_plugin_slot slots[2];
+    pid_atomic_t current;       // Slot being run, -1 if none
+    pid_mutex_t lock;           // Serializes the loads
+    unsigned long generation;
+
+    // Last seen file, a change is loaded once it stopped changing
+    long long stamp;
+    int pending;
+
+    // Set when a load fails, the previous build keeps running
+    const char* error;
+
+    // Statistics
+    unsigned long loads;
+    unsigned long failures;
+    unsigned long blocks;
+    unsigned long missed;       // Blocks with no plugin loaded
+} ffb_plugin;
+
+// config is handed to the plugin's init(), may be NULL.
+// Returns 0 on success, -1 if path or config are too long
+int ffb_plugin_init(ffb_plugin* plugin, const char* path, const char* config);
+
+// Loads the current build of the library and makes it current, retiring
+// the previous one. Returns 0 on success, -1 with error set otherwise
+int ffb_plugin_load(ffb_plugin* plugin);
+
+// Same as ffb_plugin_load() with a plugin linked into the program: entry
+// is its FFB_PLUGIN_ENTRY function, e.g. a built-in effect, swapped in
+// and retired as a library would be
+int ffb_plugin_load_entry(ffb_plugin* plugin, ffb_plugin_entry_fn entry);
+
+// Loads the library again if the file changed since the last call and
+// then stayed the same for one call, call it every few hundred ms.
+// Returns 1 if a new build was loaded, 0 if not, -1 if the load failed
+int ffb_plugin_poll(ffb_plugin* plugin);
+
+// Retires the current instance
+void ffb_plugin_close(ffb_plugin* plugin);
+
+// Runs a block of the current instance, writes zeros if none is loaded.
+// Safe to call from the render thread while another thread loads
+void ffb_plugin_process(ffb_plugin* plugin, float* out, unsigned int n, const ffb_plugin_inputs* inputs);
+
+#endif // FFB_PLUGIN_H__
@@ -0,0 +1,63 @@
+// Effect plugin ABI
+// This is the only header a plugin includes: a plugin is a shared library
+// (.dll, .so) exporting FFB_PLUGIN_ENTRY, which returns its description.
+//
+//      static void* init(const char* config) { ... }
+//      static void process_block(void* state, float* out, unsigned int n,
+//                                const ffb_plugin_inputs* inputs) { ... }
+//      static void teardown(void* state) { ... }
+//
+//      static const ffb_plugin_desc desc = {
+//          FFB_PLUGIN_ABI_VERSION, sizeof(ffb_plugin_desc), "rumble",
+//          init, process_block, teardown,
+//      };
+//
+//      FFB_PLUGIN_EXPORT const ffb_plugin_desc* ffb_plugin_entry(void) { return &desc; }
+//
+// Plain C types only, so a plugin does not have to be built with the same
+// compiler or runtime as the host. Fields are only ever added at the end
+// of the structs and size tells how much the other side knows of; a change
+// that breaks a plugin bumps FFB_PLUGIN_ABI_VERSION.
+//
+// process_block() is called from the render thread (ffb_jitter.h), it
+// must not block nor allocate. init() and teardown() are called from the
+// thread that loads the plugin.
+
+#ifndef FFB_PLUGIN_ABI_H__
+#define FFB_PLUGIN_ABI_H__
+
+#define FFB_PLUGIN_ABI_VERSION 1
+#define FFB_PLUGIN_ENTRY "ffb_plugin_entry"
+
+#ifdef _WIN32
+#define FFB_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define FFB_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef struct ffb_plugin_inputs {
+    unsigned int size;              // sizeof(ffb_plugin_inputs) of the host
+    double t;                       // Time of the first sample, in seconds
+    float dt;                       // Time between samples, in seconds
+    unsigned int channel_count;
+    const float* const* channels;   // channel_count blocks of n samples
+} ffb_plugin_inputs;
+
+typedef struct ffb_plugin_desc {
+    unsigned int abi_version;       // FFB_PLUGIN_ABI_VERSION
+    unsigned int size;              // sizeof(ffb_plugin_desc) of the plugin
+    const char* name;
+
+    // Returns the state of a new instance, NULL on failure.
+    // config is the string given to the loader, may be NULL
+    void* (*init)(const char* config);
+
+    // Writes n samples to out, in magnitude units (+-32767)
+    void (*process_block)(void* state, float* out, unsigned int n, const ffb_plugin_inputs* inputs);
+
+    void (*teardown)(void* state);
+} ffb_plugin_desc;
+
+typedef const ffb_plugin_desc* (*ffb_plugin_entry_fn)(void);
+
+#endif // FFB_PLUGIN_ABI_H__
@@ -0,0 +1,168 @@
+#include "ffb_predict.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "pid_platform.h"
+
+#define FFB_MAGNITUDE_MAX 32767
+
+// Wheel angle noise and dynamics, in logical units of the X axis
+// (+-32767 for 900 degrees on the R9): a hand on the rim accelerates
+// by up to ~1e5 units/s^2, the encoder reads +-2 units.
+#define FFB_PREDICT_ACCEL_NOISE 1e10f
+#define FFB_PREDICT_ANGLE_NOISE 4.0f
+
+// The filter starts over after a gap in the input reports
+#define FFB_PREDICT_GAP_US 100000
+
+// Angle moves smaller than this do not update the sensitivity of the force
+#define FFB_PREDICT_MIN_ANGLE 16.0f
+
+void ffb_predict_init(ffb_predict* predict, int mode, const pid_field* angle_field, long max_lead_us) {
+    memset(predict, 0x00, sizeof(*predict));
+
+    predict->mode = mode;
+    predict->angle_field = angle_field;
+    predict->max_lead_us = max_lead_us > 0 ? max_lead_us : 0;
+    predict->q = FFB_PREDICT_ACCEL_NOISE;
+    predict->r = FFB_PREDICT_ANGLE_NOISE;
+}
+
+static void predict_angle_reset(ffb_predict* predict, long long t_us, float angle) {
+    predict->primed = 1;
+    predict->angle_us = t_us;
+    predict->angle = angle;
+    predict->rate = 0.0f;
+    predict->p[0][0] = predict->r;
+    predict->p[0][1] = 0.0f;
+    predict->p[1][0] = 0.0f;
+    predict->p[1][1] = 1e8f; // Rate unknown
+}
+
+void ffb_predict_input(void* ctx, const unsigned char* report, int length) {
+    ffb_predict* predict = (ffb_predict*)ctx;
+    const pid_field* field = predict->angle_field;
+    long long now = pid_time_us();
+    float z, dt, y, s, k0, k1, p00, p01, p10, p11;
+
+    if (!field || report[0] != field->report_id
+        || length < 1 + (int)((field->bit_offset + field->bit_size + 7) / 8))
+        return;
+
+    z = (float)pid_codec_get_raw(field, report);
+    predict->inputs++;
+
+    if (!predict->primed || now - predict->angle_us > FFB_PREDICT_GAP_US) {
+        predict_angle_reset(predict, now, z);
+        return;
+    }
+
+    // Reports read in the same poll share a timestamp: update only
+    dt = (float)(now - predict->angle_us) * 1e-6f;
+    if (dt > 0.0f) {
+        predict->angle += predict->rate * dt;
+        p00 = predict->p[0][0] + dt * (predict->p[0][1] + predict->p[1][0]) + dt * dt * predict->p[1][1];
+        p01 = predict->p[0][1] + dt * predict->p[1][1];
+        p10 = predict->p[1][0] + dt * predict->p[1][1];
+        p11 = predict->p[1][1];
+        // White acceleration noise
+        predict->p[0][0] = p00 + predict->q * dt * dt * dt / 3.0f;
+        predict->p[0][1] = p01 + predict->q * dt * dt / 2.0f;
+        predict->p[1][0] = p10 + predict->q * dt * dt / 2.0f;
+        predict->p[1][1] = p11 + predict->q * dt;
+        predict->angle_us = now;
+    }
+
+    y = z - predict->angle;
+    s = predict->p[0][0] + predict->r;
+    k0 = predict->p[0][0] / s;
+    k1 = predict->p[1][0] / s;
+    predict->angle += k0 * y;
+    predict->rate += k1 * y;
+
+    p00 = predict->p[0][0];
+    p01 = predict->p[0][1];
+    predict->p[0][0] = (1.0f - k0) * p00;
+    predict->p[0][1] = (1.0f - k0) * p01;
+    predict->p[1][0] -= k1 * p00;
+    predict->p[1][1] -= k1 * p01;
+}
+
+static float predict_angle_at(const ffb_predict* predict, long long t_us) {
+    return predict->angle + predict->rate * (float)(t_us - predict->angle_us) * 1e-6f;
+}
+
+static int predict_uses_angle(const ffb_predict* predict) {
+    return predict->mode == FFB_PREDICT_KALMAN && predict->angle_field && predict->primed;
+}
+
+// Force at t_us from the recorded changes
+static float predict_at(const ffb_predict* predict, long long t_us) {
+    float f = predict->force[2];
+    float h, h1, s21, s10;
+
+    if (predict->mode == FFB_PREDICT_NONE || predict->changes < 2)
+        return f;
+
+    if (predict_uses_angle(predict))
+        return f + predict->gain * (predict_angle_at(predict, t_us) - predict->force_angle[2]);
+
+    // At most one input interval past the last change
+    h1 = (float)(predict->t_us[2] - predict->t_us[1]);
+    h = (float)(t_us - predict->t_us[2]);
+    if (h < 0.0f)
+        h = 0.0f;
+    if (h > h1)
+        h = h1;
+
+    s21 = (predict->force[2] - predict->force[1]) / h1;
+    f += s21 * h;
+
+    // Newton form: f2 + s21 (t - t2) + c (t - t2) (t - t1)
+    if (predict->mode == FFB_PREDICT_CA && predict->changes >= 3) {
+        s10 = (predict->force[1] - predict->force[0]) / (float)(predict->t_us[1] - predict->t_us[0]);
+        f += (s21 - s10) / (float)(predict->t_us[2] - predict->t_us[0]) * h * (h + h1);
+    }
+    return f;
+}
+
+short ffb_predict_apply(ffb_predict* predict, long long now_us, short force, long lead_us) {
+    float angle = predict_uses_angle(predict) ? predict_angle_at(predict, now_us) : 0.0f;
+    float error, da, value;
+    int i;
+
+    if (predict->changes == 0 || (float)force != predict->force[2]) {
+        if (predict->changes > 0) {
+            error = (float)fabs(predict_at(predict, now_us) - force);
+            predict->error += (error - predict->error) / 16.0f;
+
+            da = angle - predict->force_angle[2];
+            if (predict_uses_angle(predict) && fabs(da) >= FFB_PREDICT_MIN_ANGLE)
+                predict->gain += ((force - predict->force[2]) / da - predict->gain) / 8.0f;
+        }
+
+        for (i = 0; i < 2; i++) {
+            predict->t_us[i] = predict->t_us[i + 1];
+            predict->force[i] = predict->force[i + 1];
+            predict->force_angle[i] = predict->force_angle[i + 1];
+        }
+        predict->t_us[2] = now_us;
+        predict->force[2] = force;
+        predict->force_angle[2] = angle;
+        if (predict->changes < 3)
+            predict->changes++;
+    }
+
+    if (lead_us < 0)
+        lead_us = 0;
+    if (lead_us > predict->max_lead_us)
+        lead_us = predict->max_lead_us;
+
+    value = predict_at(predict, now_us + lead_us);
+    if (value > FFB_MAGNITUDE_MAX)
+        value = FFB_MAGNITUDE_MAX;
+    if (value < -FFB_MAGNITUDE_MAX)
+        value = -FFB_MAGNITUDE_MAX;
+    return (short)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
@@ -0,0 +1,67 @@
+// Latency-hiding extrapolation of the force target
+// A force computed by the game is applied by the wheel after the USB
+// write, the wait for the next tick and the filtering of the base.
+// ffb_predict_apply() extrapolates the target by that lead:
+//      cv:     constant velocity, slope of the last two force changes,
+//      ca:     constant acceleration, adds the curvature of the last three,
+//      kalman: the force is followed along the wheel angle. A Kalman filter
+//              (angle, rate) runs on the X axis of the joystick input
+//              report, the force moves by its sensitivity to the angle
+//              (estimated from the last changes) times the predicted rotation.
+// The game updates the force in steps, so cv and ca extrapolate at most one
+// input interval past the last change, then hold.
+//
+// ffb_predict_input() is a pid_input_fn, and ffb_predict_apply() is meant
+// to be called from the stream callback: both run on the writer loop,
+// so the state needs no lock.
+
+#ifndef FFB_PREDICT_H__
+#define FFB_PREDICT_H__
+
+#include "pid_codec.h"
+
+enum FFB_PREDICT_MODE {
+    FFB_PREDICT_NONE = 0,
+    FFB_PREDICT_CV,
+    FFB_PREDICT_CA,
+    FFB_PREDICT_KALMAN,
+};
+
+typedef struct ffb_predict {
+    int mode;
+    long max_lead_us;
+
+    // Last three force changes, [2] being the newest
+    long long t_us[3];
+    float force[3];
+    float force_angle[3]; // Filtered angle at each change
+    unsigned int changes;
+
+    // Kalman filter on the wheel angle, in logical units and seconds
+    const pid_field* angle_field;
+    int primed;
+    long long angle_us;
+    float angle;
+    float rate;
+    float p[2][2];      // Covariance
+    float q;            // Acceleration noise density
+    float r;            // Measurement noise variance
+    float gain;         // d(force) / d(angle)
+
+    // Statistics
+    float error;        // Mean absolute error predicting each change, ~16 changes
+    unsigned long inputs;
+} ffb_predict;
+
+// angle_field is the X axis of the joystick input report, NULL without one
+// (kalman then falls back to cv). max_lead_us bounds the extrapolation.
+void ffb_predict_init(ffb_predict* predict, int mode, const pid_field* angle_field, long max_lead_us);
+
+// pid_input_fn feeding the wheel angle (ctx is the ffb_predict)
+void ffb_predict_input(void* ctx, const unsigned char* report, int length);
+
+// Records the force target at now_us and returns it extrapolated
+// to now_us + lead_us
+short ffb_predict_apply(ffb_predict* predict, long long now_us, short force, long lead_us);
+
+#endif // FFB_PREDICT_H__
@@ -0,0 +1,95 @@
+#include "ffb_ramp.h"
+
+#include <string.h>
+
+#include "pid_effect.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+
+#define FFB_MAGNITUDE_MAX 32767
+
+static int ramp_clamp(int x) {
+    if (x > FFB_MAGNITUDE_MAX)
+        return FFB_MAGNITUDE_MAX;
+    if (x < -FFB_MAGNITUDE_MAX)
+        return -FFB_MAGNITUDE_MAX;
+    return x;
+}
+
+void ffb_ramp_init(ffb_ramp* ramp, int mode, int start, int end, unsigned long duration_ms) {
+    memset(ramp, 0x00, sizeof(*ramp));
+
+    ramp->mode = mode;
+    ramp->start = ramp_clamp(start);
+    ramp->end = ramp_clamp(end);
+    ramp->duration_ms = duration_ms;
+    ramp->slope = duration_ms ? ((long long)(ramp->end - ramp->start) << 16) / (long long)duration_ms : 0;
+}
+
+int ffb_ramp_start(ffb_ramp* ramp, pid_writer* writer, pid_templates* templates, unsigned long now_ms) {
+    unsigned long max = PID_DURATION_INFINITE - 1;
+    pid_effect_desc desc;
+    int index;
+
+    if (ramp->mode == FFB_RAMP_HOST) {
+        ramp->start_ms = now_ms;
+        ramp->playing = 1;
+        return 0;
+    }
+
+    // SET_RAMP_FORCE_REPORT
+    // Data: index (8), ramp start (16), ramp end (16)
+    // The duration of the SET_EFFECT_REPORT is in ms, up to the logical
+    // maximum of its field, and PID_DURATION_INFINITE would make the ramp
+    // hold its end forever
+    if (templates->duration && (unsigned long)templates->duration->logical_max < max)
+        max = (unsigned long)templates->duration->logical_max;
+    if (ramp->duration_ms > max)
+        return -1;
+    if (pid_effect_desc_init(&desc, templates, PID_ET_RAMP))
+        return -1;
+    desc.ramp_start = ramp->start;
+    desc.ramp_end = ramp->end;
+    desc.duration = (long)ramp->duration_ms;
+    desc.start = 1;
+
+    index = pid_effect_create(writer, templates, &desc);
+    if (index < 0)
+        return -1;
+
+    ramp->index = index;
+    ramp->playing = 1;
+    return 0;
+}
+
+void ffb_ramp_stop(ffb_ramp* ramp, pid_writer* writer, pid_templates* templates) {
+    if (ramp->index > 0) {
+        pid_effect_free(writer, templates, (unsigned char)ramp->index);
+        ramp->index = 0;
+    }
+    ramp->playing = 0;
+}
+
+int ffb_ramp_eval(ffb_ramp* ramp, unsigned long now_ms, short* magnitude) {
+    unsigned long elapsed;
+
+    if (ramp->mode != FFB_RAMP_HOST || !ramp->playing)
+        return 0;
+
+    elapsed = now_ms - ramp->start_ms;
+    if (elapsed >= ramp->duration_ms) {
+        // Ends on a zero force, as the device does once the duration is over
+        ramp->playing = 0;
+        *magnitude = 0;
+    }
+    else {
+        *magnitude = (short)(ramp->start + (int)((ramp->slope * (long long)elapsed) >> 16));
+    }
+
+    ramp->updates++;
+    return 1;
+}
+
+int ffb_ramp_stream(void* ctx, short* magnitude) {
+    return ffb_ramp_eval((ffb_ramp*)ctx, (unsigned long)(pid_time_us() / 1000), magnitude);
+}
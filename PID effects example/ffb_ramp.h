@@ -0,0 +1,55 @@
+// Ramp force effect
+// A ramp goes linearly from start to end over its duration. It is either
+//      rendered by the device: one SET_RAMP_FORCE_REPORT (ID 6) uploaded
+//      with the effect, nothing to send while it plays,
+//      or rendered by the host: interpolated and streamed as
+//      SET_CONSTANT_FORCE_REPORT updates at the rate of the writer loop.
+// The device mode costs a handful of reports per ramp, the host mode one
+// report per tick, but follows changes of the ramp right away.
+
+#ifndef FFB_RAMP_H__
+#define FFB_RAMP_H__
+
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+enum FFB_RAMP_MODE {
+    FFB_RAMP_DEVICE = 0,
+    FFB_RAMP_HOST,
+};
+
+typedef struct ffb_ramp {
+    int mode;
+    int start;                  // -32767..32767
+    int end;
+    unsigned long duration_ms;
+    long long slope;            // Q16 per ms
+
+    unsigned long start_ms;
+    int playing;
+    int index;                  // Effect Block Index in device mode, 0 if not uploaded
+
+    // Statistics
+    long updates;               // Magnitudes produced in host mode
+} ffb_ramp;
+
+void ffb_ramp_init(ffb_ramp* ramp, int mode, int start, int end, unsigned long duration_ms);
+
+// Device mode: creates and starts the ramp effect with pid_effect_create(),
+// its reports and the Block Free of a stop going through the writer loop.
+// Host mode: starts the interpolation at now_ms.
+// Returns 0 on success, -1 if the effect could not be created or, in
+// device mode, the ramp lasts longer than the Duration field of the
+// SET_EFFECT_REPORT can hold (the host mode has no limit)
+int ffb_ramp_start(ffb_ramp* ramp, pid_writer* writer, pid_templates* templates, unsigned long now_ms);
+
+// Frees the device effect, if any, and stops the ramp
+void ffb_ramp_stop(ffb_ramp* ramp, pid_writer* writer, pid_templates* templates);
+
+// Host mode: returns 1 and the magnitude at now_ms while the ramp plays
+int ffb_ramp_eval(ffb_ramp* ramp, unsigned long now_ms, short* magnitude);
+
+// pid_stream_fn streaming a host ramp (ctx is the ffb_ramp)
+int ffb_ramp_stream(void* ctx, short* magnitude);
+
+#endif // FFB_RAMP_H__
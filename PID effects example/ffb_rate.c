@@ -0,0 +1,75 @@
+#include "ffb_rate.h"
+
+#include <string.h>
+
+void ffb_rate_init(ffb_rate* rate, unsigned int min_period_ms, unsigned int idle_period_ms, long fast_slope, long idle_slope) {
+    memset(rate, 0x00, sizeof(*rate));
+
+    if (min_period_ms == 0)
+        min_period_ms = 1;
+    if (idle_period_ms < min_period_ms)
+        idle_period_ms = min_period_ms;
+    if (fast_slope <= idle_slope)
+        fast_slope = idle_slope + 1;
+
+    rate->min_period_ms = min_period_ms;
+    rate->idle_period_ms = idle_period_ms;
+    rate->fast_slope = fast_slope;
+    rate->idle_slope = idle_slope;
+    rate->period_ms = idle_period_ms;
+}
+
+unsigned int ffb_rate_update(ffb_rate* rate, short magnitude, unsigned int elapsed_ms, long write_latency_us) {
+    unsigned int min_period = rate->min_period_ms;
+    unsigned int target;
+    long slope;
+
+    rate->updates++;
+
+    // The first magnitude has nothing to be compared with, it counts as static
+    if (!rate->primed) {
+        rate->primed = 1;
+        rate->last = magnitude;
+    }
+
+    slope = magnitude - rate->last;
+    if (slope < 0)
+        slope = -slope;
+    slope /= elapsed_ms ? (long)elapsed_ms : 1;
+    rate->last = magnitude;
+
+    // Fast attack, slow release: a step is followed right away,
+    // the rate only decays once the force has settled for a while.
+    if (slope > rate->slope)
+        rate->slope = slope;
+    else
+        rate->slope -= (rate->slope - slope + 7) / 8;
+
+    if (rate->slope >= rate->fast_slope)
+        target = rate->min_period_ms;
+    else if (rate->slope <= rate->idle_slope)
+        target = rate->idle_period_ms;
+    else
+        target = rate->idle_period_ms - (unsigned int)((long long)(rate->idle_period_ms - rate->min_period_ms)
+                                                       * (rate->slope - rate->idle_slope)
+                                                       / (rate->fast_slope - rate->idle_slope));
+
+    // USB feedback: no faster than the device drains the reports
+    if (write_latency_us > 0 && (unsigned int)((write_latency_us + 999) / 1000) > min_period)
+        min_period = (unsigned int)((write_latency_us + 999) / 1000);
+    if (target < min_period)
+        target = min_period;
+
+    // Speed up at once, slow down one ms per tick, but back off to the
+    // write latency at once when it grows
+    if (target < rate->period_ms)
+        rate->period_ms = target;
+    else if (target > rate->period_ms)
+        rate->period_ms++;
+    if (rate->period_ms < min_period)
+        rate->period_ms = min_period;
+
+    if (rate->period_ms == rate->min_period_ms)
+        rate->fast_updates++;
+    return rate->period_ms;
+}
@@ -0,0 +1,40 @@
+// Adaptive update rate
+// Picks the tick of the writer loop from the dynamics of the force:
+//      |dF/dt| >= fast_slope: min_period_ms (the interrupt interval of the device),
+//      |dF/dt| <= idle_slope: idle_period_ms,
+//      in between, the period is interpolated.
+// A static or zero force (menus, straights) backs off to the idle rate,
+// a curb brings the rate up on the very next tick.
+//
+// The period never goes below the average time spent in hid_write
+// (pid_writer.write_latency_us): writing faster than the device accepts
+// only makes the reports wait in the USB stack.
+
+#ifndef FFB_RATE_H__
+#define FFB_RATE_H__
+
+typedef struct ffb_rate {
+    unsigned int min_period_ms;
+    unsigned int idle_period_ms;
+    long fast_slope;           // Magnitude units per ms
+    long idle_slope;
+
+    unsigned int period_ms;    // Current period
+    int primed;
+    int last;                  // Magnitude at the previous update
+    long slope;                // Smoothed |dF/dt|, units per ms
+
+    // Statistics
+    long updates;
+    long fast_updates;         // Updates at min_period_ms
+} ffb_rate;
+
+// e.g. min 1 ms, idle 20 ms, fast 100 units/ms, idle 2 units/ms
+void ffb_rate_init(ffb_rate* rate, unsigned int min_period_ms, unsigned int idle_period_ms, long fast_slope, long idle_slope);
+
+// Called once per tick with the magnitude of the tick, elapsed_ms since
+// the previous call and the average write latency of the writer.
+// Returns the period to use until the next tick.
+unsigned int ffb_rate_update(ffb_rate* rate, short magnitude, unsigned int elapsed_ms, long write_latency_us);
+
+#endif // FFB_RATE_H__
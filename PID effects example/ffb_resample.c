@@ -0,0 +1,262 @@
+#include "ffb_resample.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFB_RESAMPLE_SSE 1
+#endif
+
+#define FFB_RESAMPLE_MASK (FFB_RESAMPLE_HISTORY - 1)
+#define FFB_RESAMPLE_PI 3.14159265358979f
+#define FFB_MAGNITUDE_MAX 32767
+#define FFB_RESAMPLE_WARP_STEPS 2       // Newton steps of the sinc time axis
+
+static float resample_sinc(float x) {
+    if (x == 0.0f)
+        return 1.0f;
+    x *= FFB_RESAMPLE_PI;
+    return sinf(x) / x;
+}
+
+void ffb_resample_init(ffb_resample* resample, int mode, long long delay_us) {
+    int i;
+    float x;
+
+    memset(resample, 0x00, sizeof(*resample));
+    resample->mode = mode;
+    resample->delay_us = delay_us;
+    pid_mutex_init(&resample->lock);
+
+    // Lanczos window, the last entry (x = a) is 0
+    for (i = 0; i <= FFB_RESAMPLE_LOBES * FFB_RESAMPLE_TABLE_STEPS; i++) {
+        x = (float)i / FFB_RESAMPLE_TABLE_STEPS;
+        resample->kernel[i] = resample_sinc(x) * resample_sinc(x / FFB_RESAMPLE_LOBES);
+    }
+}
+
+void ffb_resample_destroy(ffb_resample* resample) {
+    pid_mutex_destroy(&resample->lock);
+}
+
+void ffb_resample_push(ffb_resample* resample, long long t_us, short force) {
+    unsigned int last;
+
+    pid_mutex_lock(&resample->lock);
+
+    if (resample->count > 0) {
+        last = (resample->head - 1) & FFB_RESAMPLE_MASK;
+        if (t_us <= resample->t_us[last]) {
+            // Out of order or duplicate, the newest target wins
+            resample->value[last] = force;
+            pid_mutex_unlock(&resample->lock);
+            return;
+        }
+    }
+
+    resample->t_us[resample->head] = t_us;
+    resample->value[resample->head] = force;
+    resample->head = (resample->head + 1) & FFB_RESAMPLE_MASK;
+    if (resample->count < FFB_RESAMPLE_HISTORY)
+        resample->count++;
+
+    pid_mutex_unlock(&resample->lock);
+}
+
+// Chronological index, 0 being the oldest target
+static unsigned int resample_slot(const ffb_resample* resample, unsigned int j) {
+    return (resample->head - resample->count + j) & FFB_RESAMPLE_MASK;
+}
+
+static float resample_linear(const ffb_resample* resample, unsigned int j, long long t) {
+    unsigned int a = resample_slot(resample, j);
+    unsigned int b = resample_slot(resample, j + 1);
+    float s = (float)(t - resample->t_us[a]) / (float)(resample->t_us[b] - resample->t_us[a]);
+
+    return resample->value[a] + (resample->value[b] - resample->value[a]) * s;
+}
+
+static float resample_hermite(const ffb_resample* resample, unsigned int j, long long t) {
+    unsigned int i0 = resample_slot(resample, j > 0 ? j - 1 : j);
+    unsigned int i1 = resample_slot(resample, j);
+    unsigned int i2 = resample_slot(resample, j + 1);
+    unsigned int i3 = resample_slot(resample, j + 2 < resample->count ? j + 2 : j + 1);
+    float h = (float)(resample->t_us[i2] - resample->t_us[i1]);
+    float s = (float)(t - resample->t_us[i1]) / h;
+    float s2 = s * s;
+    float s3 = s2 * s;
+    float m1, m2;
+
+    // Catmull-Rom tangents for uneven spacing, in units per us
+    m1 = (resample->value[i2] - resample->value[i0]) / (float)(resample->t_us[i2] - resample->t_us[i0]);
+    m2 = (resample->value[i3] - resample->value[i1]) / (float)(resample->t_us[i3] - resample->t_us[i1]);
+
+    return (2.0f * s3 - 3.0f * s2 + 1.0f) * resample->value[i1]
+         + (s3 - 2.0f * s2 + s) * h * m1
+         + (-2.0f * s3 + 3.0f * s2) * resample->value[i2]
+         + (s3 - s2) * h * m2;
+}
+
+// Sums of w[i] * v[i] and of w[i] over FFB_RESAMPLE_TAPS taps
+static float resample_dot(const float* w, const float* v, float* weight) {
+#ifdef FFB_RESAMPLE_SSE
+    __m128 acc = _mm_setzero_ps();
+    __m128 wacc = _mm_setzero_ps();
+    __m128 wi;
+    float sums[4];
+    float wsums[4];
+    int i;
+
+    for (i = 0; i < FFB_RESAMPLE_TAPS; i += 4) {
+        wi = _mm_loadu_ps(w + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(wi, _mm_loadu_ps(v + i)));
+        wacc = _mm_add_ps(wacc, wi);
+    }
+    _mm_storeu_ps(sums, acc);
+    _mm_storeu_ps(wsums, wacc);
+    *weight = wsums[0] + wsums[1] + wsums[2] + wsums[3];
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float acc = 0.0f;
+    float wacc = 0.0f;
+    int i;
+
+    for (i = 0; i < FFB_RESAMPLE_TAPS; i++) {
+        acc += w[i] * v[i];
+        wacc += w[i];
+    }
+    *weight = wacc;
+    return acc;
+#endif
+}
+
+// Kernel weights of the targets within FFB_RESAMPLE_LOBES of index j + f,
+// with their values and their times from t0
+static void resample_sinc_taps(const ffb_resample* resample, unsigned int j, float f, long long t0,
+                               float* w, float* v, float* t) {
+    float x;
+    unsigned int taps = 0;
+    unsigned int i, slot, k;
+
+    for (i = 0; i < FFB_RESAMPLE_TAPS; i++) {
+        w[i] = 0.0f;
+        v[i] = 0.0f;
+        t[i] = 0.0f;
+    }
+
+    // Nearest first going both ways from j
+    for (i = 0; i < 2 * resample->count && taps < FFB_RESAMPLE_TAPS; i++) {
+        // Alternates j, j + 1, j - 1, j + 2, j - 2, ...
+        long n = (i & 1) ? (long)j + 1 + (long)(i / 2) : (long)j - (long)(i / 2);
+        if (n < 0 || n >= (long)resample->count)
+            continue;
+        // Linear between the table entries, rounding to the nearest one
+        // is a step of up to 1/128 target at every sample
+        x = fabsf((float)n - (float)j - f) * FFB_RESAMPLE_TABLE_STEPS;
+        k = (unsigned int)x;
+        if (k >= FFB_RESAMPLE_LOBES * FFB_RESAMPLE_TABLE_STEPS)
+            continue;
+        slot = resample_slot(resample, (unsigned int)n);
+        w[taps] = resample->kernel[k] + (resample->kernel[k + 1] - resample->kernel[k]) * (x - (float)k);
+        v[taps] = resample->value[slot];
+        t[taps] = (float)(resample->t_us[slot] - t0);
+        taps++;
+    }
+}
+
+static float resample_sinc_at(const ffb_resample* resample, unsigned int j, long long t) {
+    float w[FFB_RESAMPLE_TAPS];
+    float v[FFB_RESAMPLE_TAPS];
+    float tt[FFB_RESAMPLE_TAPS];
+    unsigned int a = resample_slot(resample, j);
+    unsigned int b = resample_slot(resample, j + 1);
+    float h = (float)(resample->t_us[b] - resample->t_us[a]);
+    float target = (float)(t - resample->t_us[a]);
+    float f = target / h;
+    float weight, sum, at;
+    int step;
+
+    // The kernel runs over the target index, t being at j + f. Measured in
+    // time, a late or dropped frame leaves a hole the weights do not sum
+    // across and the output rings; in index it only bends the time axis.
+    // The times of the targets are interpolated with the same weights as
+    // their values, and f is moved until they give t: a jittered frame
+    // then shifts the time axis with its value, and a force changing
+    // linearly comes out exact.
+    for (step = 0; step < FFB_RESAMPLE_WARP_STEPS; step++) {
+        resample_sinc_taps(resample, j, f, resample->t_us[a], w, v, tt);
+        at = resample_dot(w, tt, &weight);
+        if (weight <= 0.0f)
+            return resample_linear(resample, j, t);
+        f += (target - at / weight) / h;
+        if (f < 0.0f)
+            f = 0.0f;
+        if (f > 1.0f)
+            f = 1.0f;
+    }
+
+    resample_sinc_taps(resample, j, f, resample->t_us[a], w, v, tt);
+    sum = resample_dot(w, v, &weight);
+    if (weight <= 0.0f)
+        return resample_linear(resample, j, t);
+    return sum / weight;
+}
+
+static short resample_eval(const ffb_resample* resample, long long t) {
+    unsigned int oldest, newest;
+    unsigned int j;
+    float value;
+
+    if (resample->count == 0)
+        return 0;
+
+    oldest = resample_slot(resample, 0);
+    newest = resample_slot(resample, resample->count - 1);
+    if (t >= resample->t_us[newest])
+        return (short)resample->value[newest];
+    if (t <= resample->t_us[oldest])
+        return (short)resample->value[oldest];
+
+    // Segment j, j + 1 holding t, the output usually trails the newest target
+    j = resample->count - 2;
+    while (j > 0 && resample->t_us[resample_slot(resample, j)] > t)
+        j--;
+
+    switch (resample->mode) {
+    case FFB_RESAMPLE_HERMITE:
+        value = resample_hermite(resample, j, t);
+        break;
+    case FFB_RESAMPLE_SINC:
+        value = resample_sinc_at(resample, j, t);
+        break;
+    default:
+        value = resample_linear(resample, j, t);
+        break;
+    }
+
+    if (value > FFB_MAGNITUDE_MAX)
+        value = FFB_MAGNITUDE_MAX;
+    if (value < -FFB_MAGNITUDE_MAX)
+        value = -FFB_MAGNITUDE_MAX;
+    return (short)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+
+short ffb_resample_at(ffb_resample* resample, long long t_us) {
+    short force;
+
+    pid_mutex_lock(&resample->lock);
+    force = resample_eval(resample, t_us - resample->delay_us);
+    pid_mutex_unlock(&resample->lock);
+
+    return force;
+}
+
+void ffb_resample_render(ffb_resample* resample, long long t_us, unsigned int period_us, short* out, unsigned int count) {
+    unsigned int i;
+
+    pid_mutex_lock(&resample->lock);
+    for (i = 0; i < count; i++)
+        out[i] = resample_eval(resample, t_us - resample->delay_us + (long long)i * period_us);
+    pid_mutex_unlock(&resample->lock);
+}
@@ -0,0 +1,62 @@
+// Resampler from the game frame rate to the device rate
+// The game pushes timestamped force targets at an irregular rate
+// (60-144 Hz, with hitches). The writer loop reads evenly spaced samples,
+// delay_us behind the clock so there is input on both sides:
+//      linear:  straight segments between targets,
+//      hermite: cubic Hermite through the targets (Catmull-Rom tangents
+//               for uneven spacing), no corners,
+//      sinc:    band-limited, Lanczos kernel (a = 3) over the target
+//               index, normalized by the sum of the weights. The times
+//               of the targets go through the same kernel, and the index
+//               is solved for the time asked, so jittered frames do not
+//               bend the output.
+// Holding the last target (what the demo does today) makes a staircase
+// that the base renders as buzz.
+//
+// The sinc kernel is tabulated and its dot product uses SSE when the
+// compiler targets it (x64, or /arch:SSE2 on x86).
+
+#ifndef FFB_RESAMPLE_H__
+#define FFB_RESAMPLE_H__
+
+#include "pid_platform.h"
+
+#define FFB_RESAMPLE_HISTORY 16         // Targets kept, power of two
+#define FFB_RESAMPLE_LOBES 3            // Lanczos a
+#define FFB_RESAMPLE_TABLE_STEPS 64     // Kernel entries per target
+#define FFB_RESAMPLE_TAPS 8             // Targets weighted per sample, >= 2 * FFB_RESAMPLE_LOBES
+
+enum FFB_RESAMPLE_MODE {
+    FFB_RESAMPLE_LINEAR = 0,
+    FFB_RESAMPLE_HERMITE,
+    FFB_RESAMPLE_SINC,
+};
+
+typedef struct ffb_resample {
+    int mode;
+    long long delay_us;
+
+    pid_mutex_t lock;
+    long long t_us[FFB_RESAMPLE_HISTORY];
+    float value[FFB_RESAMPLE_HISTORY];
+    unsigned int head;      // Index of the next target
+    unsigned int count;
+
+    float kernel[FFB_RESAMPLE_LOBES * FFB_RESAMPLE_TABLE_STEPS + 1];
+} ffb_resample;
+
+// delay_us: about one input interval for linear and hermite,
+// FFB_RESAMPLE_LOBES intervals for sinc
+void ffb_resample_init(ffb_resample* resample, int mode, long long delay_us);
+void ffb_resample_destroy(ffb_resample* resample);
+
+// Pushes a target, t_us on the clock of pid_time_us(), in increasing order
+void ffb_resample_push(ffb_resample* resample, long long t_us, short force);
+
+// Force at t_us - delay_us, the last target is held past the newest one
+short ffb_resample_at(ffb_resample* resample, long long t_us);
+
+// Fills out with count samples period_us apart, the first one at t_us
+void ffb_resample_render(ffb_resample* resample, long long t_us, unsigned int period_us, short* out, unsigned int count);
+
+#endif // FFB_RESAMPLE_H__
@@ -0,0 +1,160 @@
+#include "ffb_slew.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FFB_SLEW_SSE 1
+#endif
+
+#define FFB_MAGNITUDE_MAX 32767
+
+// Bound of the distance to the target in units of jerk * dt^2, past it
+// the rate is at the slew limit anyway
+#define FFB_SLEW_MAX_BRAKE 1e9f
+
+// Starting points, a full +-1500 swap takes about 4 ms on the R9.
+// The default profile is gentler for bases that are not listed.
+static const ffb_slew_profile ffb_slew_profiles[] = {
+    { 0x0000, 0x0000, "default", 500.0f, 100.0f },
+    { 0x346e, 0x0002, "MOZA R9", 1000.0f, 400.0f },
+};
+
+const ffb_slew_profile* ffb_slew_profile_find(unsigned short vendor_id, unsigned short product_id) {
+    unsigned int i;
+
+    for (i = 1; i < sizeof(ffb_slew_profiles) / sizeof(ffb_slew_profiles[0]); i++) {
+        if (ffb_slew_profiles[i].vendor_id == vendor_id && ffb_slew_profiles[i].product_id == product_id)
+            return &ffb_slew_profiles[i];
+    }
+    return &ffb_slew_profiles[0];
+}
+
+int ffb_slew_init(ffb_slew* slew, unsigned int channels, const ffb_slew_profile* profile) {
+    unsigned int c;
+
+    memset(slew, 0x00, sizeof(*slew));
+
+    if (channels == 0 || channels > FFB_SLEW_MAX_CHANNELS)
+        return -1;
+    if (!profile)
+        profile = &ffb_slew_profiles[0];
+
+    slew->channels = channels;
+    for (c = 0; c < FFB_SLEW_MAX_CHANNELS; c++)
+        ffb_slew_set_limits(slew, c, profile->slew, profile->jerk);
+    return 0;
+}
+
+void ffb_slew_set_limits(ffb_slew* slew, unsigned int channel, float slew_per_ms, float jerk_per_ms2) {
+    if (channel >= FFB_SLEW_MAX_CHANNELS)
+        return;
+    slew->slew[channel] = slew_per_ms > 0.0f ? slew_per_ms : 2.0f * FFB_MAGNITUDE_MAX;
+    slew->jerk[channel] = jerk_per_ms2 > 0.0f ? jerk_per_ms2 : 2.0f * FFB_MAGNITUDE_MAX;
+}
+
+#ifdef FFB_SLEW_SSE
+
+static void slew_process4(ffb_slew* slew, const float* target, unsigned int c, float dt) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 t = _mm_loadu_ps(target + c);
+    __m128 v = _mm_loadu_ps(slew->value + c);
+    __m128 r = _mm_loadu_ps(slew->rate + c);
+    __m128 j = _mm_loadu_ps(slew->jerk + c);
+    __m128 jdt = _mm_mul_ps(j, _mm_set1_ps(dt));
+    __m128 e = _mm_sub_ps(t, v);
+    __m128 ae = _mm_andnot_ps(sign, e);
+    __m128 a, m, want, step, arrive;
+
+    // Fastest rate that can still brake to the target: braking by
+    // jerk * dt every sample, m whole samples after this one and this
+    // one taking what is left, in units of jerk * dt^2
+    a = _mm_min_ps(_mm_div_ps(ae, _mm_mul_ps(jdt, _mm_set1_ps(dt))), _mm_set1_ps(FFB_SLEW_MAX_BRAKE));
+    m = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(8.0f)), _mm_set1_ps(1.0f)));
+    m = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_set1_ps(0.5f))));
+    want = _mm_add_ps(_mm_div_ps(a, _mm_add_ps(m, _mm_set1_ps(1.0f))), _mm_mul_ps(m, _mm_set1_ps(0.5f)));
+    want = _mm_min_ps(_mm_loadu_ps(slew->slew + c), _mm_mul_ps(want, jdt));
+    want = _mm_or_ps(want, _mm_and_ps(sign, e));
+
+    r = _mm_add_ps(r, _mm_min_ps(_mm_max_ps(_mm_sub_ps(want, r), _mm_sub_ps(_mm_setzero_ps(), jdt)), jdt));
+    step = _mm_mul_ps(r, _mm_set1_ps(dt));
+
+    arrive = _mm_and_ps(_mm_cmple_ps(ae, _mm_andnot_ps(sign, step)), _mm_cmple_ps(_mm_andnot_ps(sign, r), jdt));
+    v = _mm_or_ps(_mm_and_ps(arrive, t), _mm_andnot_ps(arrive, _mm_add_ps(v, step)));
+    r = _mm_andnot_ps(arrive, r);
+
+    _mm_storeu_ps(slew->value + c, v);
+    _mm_storeu_ps(slew->rate + c, r);
+}
+
+#else
+
+static void slew_process4(ffb_slew* slew, const float* target, unsigned int c, float dt) {
+    float e, ae, want, dr, step, a, m;
+    unsigned int k;
+
+    for (k = c; k < c + 4; k++) {
+        e = target[k] - slew->value[k];
+        ae = fabsf(e);
+
+        // Fastest rate that can still brake to the target
+        a = ae / (slew->jerk[k] * dt * dt);
+        if (a > FFB_SLEW_MAX_BRAKE)
+            a = FFB_SLEW_MAX_BRAKE;
+        m = floorf((sqrtf(8.0f * a + 1.0f) - 1.0f) * 0.5f);
+        want = (a / (m + 1.0f) + m * 0.5f) * slew->jerk[k] * dt;
+        if (want > slew->slew[k])
+            want = slew->slew[k];
+        if (e < 0.0f)
+            want = -want;
+
+        dr = want - slew->rate[k];
+        if (dr > slew->jerk[k] * dt)
+            dr = slew->jerk[k] * dt;
+        if (dr < -slew->jerk[k] * dt)
+            dr = -slew->jerk[k] * dt;
+        slew->rate[k] += dr;
+        step = slew->rate[k] * dt;
+
+        if (ae <= fabsf(step) && fabsf(slew->rate[k]) <= slew->jerk[k] * dt) {
+            slew->value[k] = target[k];
+            slew->rate[k] = 0.0f;
+        }
+        else {
+            slew->value[k] += step;
+        }
+    }
+}
+
+#endif
+
+void ffb_slew_process(ffb_slew* slew, const short* target, short* out, float dt_ms) {
+    float t[FFB_SLEW_MAX_CHANNELS] = { 0 };
+    unsigned int c;
+    int limited = 0;
+
+    for (c = 0; c < slew->channels; c++)
+        t[c] = target[c];
+
+    // Unused channels of the last group stay at 0
+    for (c = 0; c < slew->channels; c += 4)
+        slew_process4(slew, t, c, dt_ms);
+
+    for (c = 0; c < slew->channels; c++) {
+        float v = slew->value[c];
+
+        // A reversal at full rate can go past the target, and past full scale
+        if (v > FFB_MAGNITUDE_MAX)
+            v = FFB_MAGNITUDE_MAX;
+        if (v < -FFB_MAGNITUDE_MAX)
+            v = -FFB_MAGNITUDE_MAX;
+        out[c] = (short)(v < 0.0f ? v - 0.5f : v + 0.5f);
+        if (slew->value[c] != t[c])
+            limited = 1;
+    }
+
+    slew->samples++;
+    if (limited)
+        slew->limited++;
+}
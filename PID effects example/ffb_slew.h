@@ -0,0 +1,50 @@
+// Slew-rate and jerk limiter
+// A step of the streamed magnitude (e.g. +1500 to -1500) hits the motor
+// as a torque step: a clunk, and current spikes that heat it up over a
+// long session. Each channel follows its target with a bounded rate of
+// change (slew, units per ms) and a bounded change of that rate
+// (jerk, units per ms^2). It brakes ahead of the target, so it lands
+// on it without overshoot.
+//
+// The limits come from a device profile. Channels are stored SoA and
+// processed four at a time with SSE.
+
+#ifndef FFB_SLEW_H__
+#define FFB_SLEW_H__
+
+#define FFB_SLEW_MAX_CHANNELS 8     // Multiple of 4
+
+typedef struct ffb_slew_profile {
+    unsigned short vendor_id;       // 0 for the default profile
+    unsigned short product_id;
+    const char* name;
+    float slew;                     // Units per ms
+    float jerk;                     // Units per ms^2
+} ffb_slew_profile;
+
+typedef struct ffb_slew {
+    unsigned int channels;
+    float slew[FFB_SLEW_MAX_CHANNELS];
+    float jerk[FFB_SLEW_MAX_CHANNELS];
+    float value[FFB_SLEW_MAX_CHANNELS];
+    float rate[FFB_SLEW_MAX_CHANNELS];  // Units per ms
+
+    // Statistics
+    unsigned long samples;
+    unsigned long limited;          // Samples where a channel did not reach its target
+} ffb_slew;
+
+// Profile of the device, the default profile if it is not listed
+const ffb_slew_profile* ffb_slew_profile_find(unsigned short vendor_id, unsigned short product_id);
+
+// Every channel starts at 0 with the limits of profile.
+// Returns 0 on success, -1 if channels is out of range
+int ffb_slew_init(ffb_slew* slew, unsigned int channels, const ffb_slew_profile* profile);
+
+// Changes the limits of one channel (e.g. a gentler one for a rumble motor)
+void ffb_slew_set_limits(ffb_slew* slew, unsigned int channel, float slew_per_ms, float jerk_per_ms2);
+
+// Moves every channel towards target over dt_ms, writes the result to out
+void ffb_slew_process(ffb_slew* slew, const short* target, short* out, float dt_ms);
+
+#endif // FFB_SLEW_H__
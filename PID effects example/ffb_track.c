@@ -0,0 +1,270 @@
+#include "ffb_track.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FFB_MAGNITUDE_MAX 32767
+#define FFB_TRACK_PAGE 4096
+
+static unsigned int track_u16(const unsigned char* p) {
+    return (unsigned int)p[0] | (unsigned int)p[1] << 8;
+}
+
+static unsigned int track_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+}
+
+static void track_put32(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+int ffb_track_open(ffb_track* track, const char* path) {
+    const unsigned char* data;
+    volatile unsigned char touch;
+    unsigned int offset;
+    size_t size, i;
+
+    memset(track, 0x00, sizeof(*track));
+
+    if (pid_file_map_open(&track->map, path) != 0)
+        return -1;
+    data = (const unsigned char*)track->map.data;
+    size = track->map.size;
+
+    if (size < FFB_TRACK_HEADER_SIZE || memcmp(data, "FFBT", 4) != 0 || track_u16(data + 4) != FFB_TRACK_VERSION)
+        goto fail;
+
+    track->channels = track_u16(data + 6);
+    track->rate_hz = track_u32(data + 8);
+    track->frames = track_u32(data + 12);
+    track->gain = (float)track_u32(data + 16) / 256.0f;
+    offset = track_u32(data + 20);
+    if (track->channels == 0 || track->rate_hz == 0 || track->frames == 0)
+        goto fail;
+    if (offset < FFB_TRACK_HEADER_SIZE || offset % 2 != 0 || offset > size
+        || (size - offset) / 2 / track->channels < track->frames)
+        goto fail;
+
+    // Samples are little endian, as every host this runs on
+    track->samples = (const short*)(data + offset);
+
+    // Faults the pages in now rather than in the render thread
+    for (i = 0; i < size; i += FFB_TRACK_PAGE)
+        touch = data[i];
+    (void)touch;
+    return 0;
+
+fail:
+    pid_file_map_close(&track->map);
+    memset(track, 0x00, sizeof(*track));
+    return -1;
+}
+
+void ffb_track_close(ffb_track* track) {
+    if (track->samples)
+        pid_file_map_close(&track->map);
+    memset(track, 0x00, sizeof(*track));
+}
+
+int ffb_track_save(const char* path, const short* samples, unsigned int channels, unsigned int rate_hz, unsigned int frames, int gain) {
+    unsigned char header[FFB_TRACK_HEADER_SIZE] = { 'F', 'F', 'B', 'T' };
+    FILE* out;
+    int result = 0;
+
+    if (channels == 0 || channels > 0xffff || rate_hz == 0 || frames == 0 || gain < 0)
+        return -1;
+
+    header[4] = FFB_TRACK_VERSION;
+    header[6] = (unsigned char)channels;
+    header[7] = (unsigned char)(channels >> 8);
+    track_put32(header + 8, rate_hz);
+    track_put32(header + 12, frames);
+    track_put32(header + 16, (unsigned int)gain);
+    track_put32(header + 20, FFB_TRACK_HEADER_SIZE);
+
+    out = fopen(path, "wb");
+    if (!out)
+        return -1;
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header)
+        || fwrite(samples, sizeof(short) * channels, frames, out) != frames)
+        result = -1;
+    if (fclose(out) != 0)
+        result = -1;
+    return result;
+}
+
+void ffb_track_player_init(ffb_track_player* player, unsigned int channel, unsigned int fade_ms) {
+    memset(player, 0x00, sizeof(*player));
+
+    player->channel = channel;
+    player->fade_ms = fade_ms;
+    player->cursor.track = -1;
+    player->fading.track = -1;
+    player->fade = 1.0f;
+}
+
+int ffb_track_player_add(ffb_track_player* player, const ffb_track* track) {
+    if (player->track_count >= FFB_TRACK_MAX)
+        return -1;
+    player->tracks[player->track_count] = track;
+    return (int)player->track_count++;
+}
+
+int ffb_track_play(ffb_track_player* player, int track, unsigned long start_ms, int loop) {
+    if (track < -1 || track >= (int)player->track_count)
+        return -1;
+
+    // Replaces a request not taken yet. The render thread only holds the
+    // command for a few loads
+    while (!pid_atomic_cas(&player->command, 0, 1) && !pid_atomic_cas(&player->command, 2, 1))
+        ;
+    pid_atomic_store(&player->command_track, track);
+    pid_atomic_store(&player->command_ms, (long)start_ms);
+    pid_atomic_store(&player->command_loop, loop);
+    pid_atomic_store(&player->command, 2);
+    return 0;
+}
+
+static float track_sample(const ffb_track_player* player, const ffb_track_cursor* cursor) {
+    const ffb_track* track = player->tracks[cursor->track];
+    unsigned int i = (unsigned int)(cursor->position >> 16);
+    float f = (float)(cursor->position & 0xffff) * (1.0f / 65536.0f);
+    const short* s;
+    float a, b;
+
+    if (i >= track->frames || player->channel >= track->channels)
+        return 0.0f;
+
+    s = track->samples + (size_t)i * track->channels + player->channel;
+    a = s[0];
+    b = i + 1 < track->frames ? s[track->channels] : a;
+    return track->gain * (a + f * (b - a));
+}
+
+// Output at the current positions. A fade still running is the cursor
+// and the fading position blended
+static float track_mix(const ffb_track_player* player) {
+    float v = player->cursor.track >= 0 ? track_sample(player, &player->cursor) : 0.0f;
+    float f = player->held;
+
+    if (player->fade >= 1.0f)
+        return v;
+    if (player->fading.track >= 0)
+        f += track_sample(player, &player->fading);
+    return player->fade * v + (1.0f - player->fade) * f;
+}
+
+// The current output fades out while the new position fades in. The
+// cursor becomes the fading position, and what the output differs from
+// it is held and faded out with it, so a fade still running carries on
+// from where it was
+static void track_fade_out(ffb_track_player* player) {
+    player->held = track_mix(player);
+    if (player->cursor.track >= 0)
+        player->held -= track_sample(player, &player->cursor);
+    player->fading = player->cursor;
+    player->fade = player->fade_ms ? 0.0f : 1.0f;
+}
+
+// The current position is faded out while the new one fades in,
+// from silence when stopped
+static void track_start(ffb_track_player* player, int track, unsigned long start_ms, int loop) {
+    const ffb_track* t;
+    long long end;
+
+    track_fade_out(player);
+    player->cursor.track = track;
+    player->loop = loop;
+
+    if (track >= 0) {
+        t = player->tracks[track];
+        end = (long long)t->frames << 16;
+        player->cursor.position = ((long long)start_ms * t->rate_hz / 1000) << 16;
+        if (player->cursor.position >= end) {
+            if (loop)
+                player->cursor.position %= end;
+            else
+                player->cursor.track = -1;
+        }
+        player->plays++;
+    }
+}
+
+static long long track_step(const ffb_track_player* player, const ffb_track_cursor* cursor, unsigned int sample_ms) {
+    if (cursor->track < 0)
+        return 0;
+    return ((long long)sample_ms * player->tracks[cursor->track]->rate_hz << 16) / 1000;
+}
+
+void ffb_track_render(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count) {
+    ffb_track_player* player = (ffb_track_player*)ctx;
+    ffb_track_cursor* cursor = &player->cursor;
+    const ffb_track* track;
+    float fade_step = player->fade_ms ? (float)sample_ms / player->fade_ms : 1.0f;
+    long long end = 0, seam = 0;
+    unsigned int n;
+    float v;
+
+    (void)t_ms;
+
+    if (pid_atomic_load(&player->command) == 2 && pid_atomic_cas(&player->command, 2, 1)) {
+        int id = (int)pid_atomic_load(&player->command_track);
+        unsigned long start_ms = (unsigned long)pid_atomic_load(&player->command_ms);
+        int loop = (int)pid_atomic_load(&player->command_loop);
+
+        pid_atomic_store(&player->command, 0);
+        track_start(player, id, start_ms, loop);
+    }
+
+    cursor->step = track_step(player, cursor, sample_ms);
+    player->fading.step = track_step(player, &player->fading, sample_ms);
+
+    // The loop seam crossfades from the last fade_ms of the track into
+    // its start, a track shorter than that wraps without it
+    if (cursor->track >= 0) {
+        track = player->tracks[cursor->track];
+        end = (long long)track->frames << 16;
+        seam = ((long long)player->fade_ms * track->rate_hz / 1000) << 16;
+        seam = seam > 0 && seam < end ? end - seam : end;
+    }
+
+    for (n = 0; n < count; n++) {
+        v = 0.0f;
+
+        if (cursor->track >= 0) {
+            if (player->loop && cursor->position >= seam) {
+                if (seam < end) {
+                    track_fade_out(player);
+                    cursor->position -= seam;
+                }
+                else {
+                    cursor->position -= end;
+                }
+                player->loops++;
+            }
+
+            v = track_sample(player, cursor);
+            cursor->position += cursor->step;
+            if (!player->loop && cursor->position >= end)
+                cursor->track = -1;
+        }
+
+        if (player->fade < 1.0f) {
+            v = player->fade * v + (1.0f - player->fade) * player->held;
+            if (player->fading.track >= 0) {
+                v += (1.0f - player->fade) * track_sample(player, &player->fading);
+                player->fading.position += player->fading.step;
+            }
+            player->fade += fade_step;
+        }
+
+        if (v > FFB_MAGNITUDE_MAX)
+            v = FFB_MAGNITUDE_MAX;
+        if (v < -FFB_MAGNITUDE_MAX)
+            v = -FFB_MAGNITUDE_MAX;
+        out[n] = (short)(v < 0.0f ? v - 0.5f : v + 0.5f);
+    }
+}
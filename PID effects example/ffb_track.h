@@ -0,0 +1,98 @@
+// Force track playback
+// Pre-authored force tracks, played from a memory mapped file straight
+// into the stream: no heap allocation, and replaying a track thousands
+// of times only reads pages the system already caches.
+//
+// File format, little endian:
+//      offset  size
+//      0       4       "FFBT"
+//      4       2       version, 1
+//      6       2       channels
+//      8       4       rate_hz
+//      12      4       frames
+//      16      4       gain, Q8 (256 = 100%)
+//      20      4       offset of the samples, 32 for version 1
+//      24      8       reserved, 0
+//      32      ...     frames * channels int16, interleaved
+//
+// The player resamples the track to the device rate. Starting a track,
+// seeking and the loop seam crossfade over fade_ms from the previous
+// output, a fade still running included, so none of them is a step in
+// the force.
+//
+// ffb_track_render() is an ffb_render_fn (ctx is the ffb_track_player):
+// the render thread of ffb_jitter.h streams the track to the writer loop,
+// while ffb_track_play() may be called from any thread.
+
+#ifndef FFB_TRACK_H__
+#define FFB_TRACK_H__
+
+#include "pid_platform.h"
+
+#define FFB_TRACK_VERSION 1
+#define FFB_TRACK_HEADER_SIZE 32
+#define FFB_TRACK_MAX 16
+
+typedef struct ffb_track {
+    pid_file_map map;
+    const short* samples;
+    unsigned int channels;
+    unsigned int rate_hz;
+    unsigned int frames;
+    float gain;
+} ffb_track;
+
+typedef struct ffb_track_cursor {
+    int track;                  // -1 when stopped
+    long long position;         // Q16 frame
+    long long step;             // Q16 frames per output sample
+} ffb_track_cursor;
+
+typedef struct ffb_track_player {
+    const ffb_track* tracks[FFB_TRACK_MAX];
+    unsigned int track_count;
+    unsigned int channel;
+    unsigned int fade_ms;
+
+    ffb_track_cursor cursor;
+    ffb_track_cursor fading;    // Previous position, faded out
+    float fade;                 // 0 (fading) to 1 (cursor)
+    float held;                 // Added to fading, what it dropped of an earlier fade
+    int loop;
+
+    // Last request of ffb_track_play(), taken at the next block
+    pid_atomic_t command;       // 0 none, 1 being written or read, 2 ready
+    pid_atomic_t command_track;
+    pid_atomic_t command_ms;
+    pid_atomic_t command_loop;
+
+    // Statistics
+    unsigned long plays;
+    unsigned long loops;
+} ffb_track_player;
+
+// Maps a track file. Returns 0 on success, -1 if it cannot be mapped or
+// is not a valid track
+int ffb_track_open(ffb_track* track, const char* path);
+void ffb_track_close(ffb_track* track);
+
+// Writes a track file, e.g. from a recorded session.
+// Returns 0 on success, -1 otherwise
+int ffb_track_save(const char* path, const short* samples, unsigned int channels, unsigned int rate_hz, unsigned int frames, int gain);
+
+// channel is the channel of the tracks that is played
+void ffb_track_player_init(ffb_track_player* player, unsigned int channel, unsigned int fade_ms);
+
+// Registers a track, which must stay open while the player runs.
+// Returns its index, -1 if the table is full
+int ffb_track_player_add(ffb_track_player* player, const ffb_track* track);
+
+// Plays track (an index, -1 to stop) from start_ms, looping it if loop.
+// Seeking is playing the same track from another time.
+// Returns 0 on success, -1 if track does not exist
+int ffb_track_play(ffb_track_player* player, int track, unsigned long start_ms, int loop);
+
+// ffb_render_fn
+void ffb_track_render(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count);
+
+#endif // FFB_TRACK_H__
@@ -0,0 +1,98 @@
+#include "ffb_watchdog.h"
+
+#include <string.h>
+
+#include "pid_reports.h"
+
+// Timestamps are kept on 31 bits so they fit in a pid_atomic_t
+#define FFB_WATCHDOG_TIME_MASK 0x7fffffff
+
+static long watchdog_now_ms(void) {
+    return (long)((pid_time_us() / 1000) & FFB_WATCHDOG_TIME_MASK);
+}
+
+static long watchdog_elapsed_ms(long since, long now) {
+    return (now - since) & FFB_WATCHDOG_TIME_MASK;
+}
+
+void ffb_watchdog_init(ffb_watchdog* watchdog, pid_writer* writer, unsigned int deadline_ms, unsigned int fade_ms) {
+    memset(watchdog, 0x00, sizeof(*watchdog));
+
+    watchdog->writer = writer;
+    watchdog->deadline_ms = deadline_ms;
+    watchdog->fade_ms = fade_ms;
+    watchdog->gain = FFB_WATCHDOG_UNITY;
+    watchdog->state = FFB_WATCHDOG_RUNNING;
+    watchdog->heartbeat_ms = watchdog_now_ms();
+}
+
+void ffb_watchdog_kick(ffb_watchdog* watchdog) {
+    pid_atomic_store(&watchdog->heartbeat_ms, watchdog_now_ms());
+}
+
+short ffb_watchdog_apply(ffb_watchdog* watchdog, short magnitude) {
+    return (short)((long)magnitude * pid_atomic_load(&watchdog->gain) / FFB_WATCHDOG_UNITY);
+}
+
+static void watchdog_loop(void* arg) {
+    ffb_watchdog* watchdog = (ffb_watchdog*)arg;
+    long now, faded;
+    int late;
+    long state;
+
+    while (pid_atomic_load(&watchdog->running)) {
+        pid_sleep_ms(1);
+
+        now = watchdog_now_ms();
+        late = watchdog_elapsed_ms(pid_atomic_load(&watchdog->heartbeat_ms), now) > (long)watchdog->deadline_ms;
+        state = pid_atomic_load(&watchdog->state);
+
+        if (!late) {
+            // Heartbeats are back. The force stays off until the device
+            // is continued, a full queue is retried on the next tick
+            if (state == FFB_WATCHDOG_PAUSED && pid_writer_device_control(watchdog->writer, PID_DC_DEVICE_CONTINUE))
+                continue;
+            if (state != FFB_WATCHDOG_RUNNING) {
+                pid_atomic_store(&watchdog->gain, FFB_WATCHDOG_UNITY);
+                pid_atomic_store(&watchdog->state, FFB_WATCHDOG_RUNNING);
+            }
+            continue;
+        }
+
+        if (state == FFB_WATCHDOG_RUNNING) {
+            pid_atomic_add(&watchdog->misses, 1);
+            watchdog->fade_start_ms = now;
+            pid_atomic_store(&watchdog->state, FFB_WATCHDOG_FADING);
+            state = FFB_WATCHDOG_FADING;
+        }
+
+        if (state == FFB_WATCHDOG_FADING) {
+            faded = watchdog_elapsed_ms(watchdog->fade_start_ms, now);
+            if (faded < (long)watchdog->fade_ms) {
+                pid_atomic_store(&watchdog->gain, FFB_WATCHDOG_UNITY - FFB_WATCHDOG_UNITY * faded / (long)watchdog->fade_ms);
+            }
+            else {
+                // Faded out, paused once the queue takes the report
+                pid_atomic_store(&watchdog->gain, 0);
+                if (pid_writer_device_control(watchdog->writer, PID_DC_DEVICE_PAUSE) == 0)
+                    pid_atomic_store(&watchdog->state, FFB_WATCHDOG_PAUSED);
+            }
+        }
+    }
+}
+
+int ffb_watchdog_start(ffb_watchdog* watchdog) {
+    ffb_watchdog_kick(watchdog);
+    pid_atomic_store(&watchdog->running, 1);
+    if (pid_thread_start(&watchdog->thread, watchdog_loop, watchdog)) {
+        pid_atomic_store(&watchdog->running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void ffb_watchdog_stop(ffb_watchdog* watchdog) {
+    if (!pid_atomic_exchange(&watchdog->running, 0))
+        return;
+    pid_thread_join(watchdog->thread);
+}
@@ -0,0 +1,54 @@
+// Deadline-miss watchdog
+// The force computation stage calls ffb_watchdog_kick() after every update.
+// If no heartbeat arrives for deadline_ms, the watchdog thread ramps the
+// streamed magnitude to zero over fade_ms and then pauses the device
+// (PID_DEVICE_CONTROL_REPORT, DC Device Pause).
+// The next heartbeat continues the device and restores the full force.
+// When the writer queue is full, the Pause or Continue is retried every
+// ms, and the state only changes once it has been queued.
+//
+// Without it, a game hitch leaves the last magnitude on the wheel forever.
+
+#ifndef FFB_WATCHDOG_H__
+#define FFB_WATCHDOG_H__
+
+#include "pid_platform.h"
+#include "pid_writer.h"
+
+// Unity gain of the fade, Q8
+#define FFB_WATCHDOG_UNITY 256
+
+enum FFB_WATCHDOG_STATE {
+    FFB_WATCHDOG_RUNNING = 0,
+    FFB_WATCHDOG_FADING,
+    FFB_WATCHDOG_PAUSED,
+};
+
+typedef struct ffb_watchdog {
+    pid_writer* writer;
+    unsigned int deadline_ms;
+    unsigned int fade_ms;
+
+    pid_thread_t thread;
+    pid_atomic_t running;
+
+    pid_atomic_t heartbeat_ms; // Time of the last kick
+    pid_atomic_t gain;         // Q8 gain applied to the streamed magnitude
+    pid_atomic_t state;        // FFB_WATCHDOG_STATE
+    pid_atomic_t misses;       // Number of deadline misses
+    long fade_start_ms;        // Only used by the watchdog thread
+} ffb_watchdog;
+
+void ffb_watchdog_init(ffb_watchdog* watchdog, pid_writer* writer, unsigned int deadline_ms, unsigned int fade_ms);
+
+// Returns 0 on success
+int ffb_watchdog_start(ffb_watchdog* watchdog);
+void ffb_watchdog_stop(ffb_watchdog* watchdog);
+
+// Heartbeat of the force computation stage
+void ffb_watchdog_kick(ffb_watchdog* watchdog);
+
+// Applies the fade to a magnitude, called by the stream on every tick
+short ffb_watchdog_apply(ffb_watchdog* watchdog, short magnitude);
+
+#endif // FFB_WATCHDOG_H__
@@ -21,6 +21,19 @@
 #include <stdlib.h>
 
 #include "hidapi.h"
+#include "pid_reports.h"
+#include "pid_codec.h"
+#include "pid_layout_gen.h"
+#include "pid_templates.h"
+#include "pid_effect.h"
+#include "pid_writer.h"
+#include "ffb_mixer.h"
+#include "ffb_watchdog.h"
+#include "ffb_deadband.h"
+#include "ffb_rate.h"
+#include "ffb_predict.h"
+#include "ffb_limiter.h"
+#include "ffb_slew.h"
 
 // Headers needed for sleeping.
 #ifdef _WIN32
@@ -126,10 +139,77 @@ void print_devices_with_descriptor(struct hid_device_info* cur_dev) {
     }
 }
 
+// Stages between the force computation and the writer loop
+typedef struct force_stream {
+    ffb_mixer mixer;
+    ffb_watchdog watchdog;
+    ffb_predict predict;
+    ffb_limiter limiter;
+    ffb_slew slew;
+    ffb_deadband deadband;
+    ffb_rate rate;
+    pid_writer* writer;
+} force_stream;
+
+// Stream callback of the writer loop, sends the mixed force
+// on every tick where it changed noticeably, and adapts the
+// tick to how fast the force changes
+static int stream_force(void* ctx, short* magnitude) {
+    force_stream* stream = (force_stream*)ctx;
+    short force = ffb_watchdog_apply(&stream->watchdog, ffb_mixer_tick(&stream->mixer));
+    unsigned int period = pid_writer_period(stream->writer);
+    long latency = pid_atomic_load(&stream->writer->write_latency_us);
+
+    // Ahead by the write and, on average, half a tick of waiting
+    force = ffb_predict_apply(&stream->predict, pid_time_us(), force, latency + (long)period * 500);
+    force = ffb_limiter_process(&stream->limiter, force);
+
+    period = ffb_rate_update(&stream->rate, force, period, latency);
+    pid_writer_set_period(stream->writer, period);
+
+    // The rate follows the target, so a step switches to fast ticks first,
+    // then the slew limiter spreads it over them (the value is held for period)
+    ffb_slew_process(&stream->slew, &force, &force, (float)period);
+
+    return ffb_deadband_update(&stream->deadband, force, magnitude);
+}
+
+// Writes pid_layout.h from a descriptor dumped as text (see pid_layout_gen.h)
+static int generate_layout(const char* descriptor_path, const char* layout_path) {
+    unsigned char descriptor[HID_API_MAX_REPORT_DESCRIPTOR_SIZE];
+    static pid_codec codec;
+    FILE* out;
+    int length;
+    int res;
+
+    length = pid_layout_load_text(descriptor_path, descriptor, sizeof(descriptor));
+    if (length < 0 || pid_codec_parse(&codec, descriptor, (size_t)length)) {
+        printf("Unable to parse %s\n", descriptor_path);
+        return 1;
+    }
+
+    out = fopen(layout_path, "w");
+    if (!out) {
+        printf("Unable to open %s\n", layout_path);
+        return 1;
+    }
+    res = pid_layout_generate(&codec, out);
+    fclose(out);
+
+    if (res) {
+        printf("Unable to write %s\n", layout_path);
+        return 1;
+    }
+    printf("Generated %s from %s (%d bytes)\n", layout_path, descriptor_path, length);
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
-    (void)argc;
-    (void)argv;
+    // Regenerates the fixed-layout encoders, e.g.
+    // --gen-layout report_descriptor.txt pid_layout.h
+    if (argc == 4 && strcmp(argv[1], "--gen-layout") == 0)
+        return generate_layout(argv[2], argv[3]);
 
     
     int res; // Result code 
@@ -138,6 +218,10 @@ int main(int argc, char* argv[])
     wchar_t wstr[MAX_STR]; // String buffer
     hid_device* handle; // Handle to the device
     int i; // Counter
+    unsigned char descriptor[HID_API_MAX_REPORT_DESCRIPTOR_SIZE]; // Report descriptor
+    static pid_codec codec; // Layout of the reports, too large for the stack
+    static pid_templates templates; // Preformatted reports of every effect block
+    pid_effect_desc effect; // Parameters of the constant force effect
 
     struct hid_device_info* devs;
 
@@ -198,20 +282,29 @@ int main(int argc, char* argv[])
 
     // From the report descriptor, we can get the different report IDs
     // and parameters needed to send the different reports to the device
-    // Here is a list of the report IDs and the corresponding reports
+    // The list of the report IDs and the corresponding reports is in pid_reports.h
     // Note that the report IDs are not the sames depending on the device
     // And also note that the parameters are not the sames depending on the device
-    enum REPORT_ID {
-        PID_POOL_REPORT_ID = 0x13,
-        PID_DEVICE_CONTROL_REPORT_ID = 0x0c,
-        DEVICE_GAIN_REPORT_ID = 0x0d,
-        CREATE_NEW_EFFECT_REPORT_ID = 0x11,
-        PID_BLOCK_LOAD_REPORT_ID = 0x12,
-        SET_CONSTANT_FORCE_REPORT_ID = 0x05,
-        SET_ENVELOPE_REPORT_ID = 0x02,
-        SET_EFFECT_REPORT_ID = 0x01,
-        EFFECT_OPERATION_REPORT_ID = 0x0a,
-    } REPORT_ID;
+    // pid_codec parses the descriptor of the device to get the length of
+    // every report and the offset, range and unit of their fields
+    res = hid_get_report_descriptor(handle, descriptor, sizeof(descriptor));
+    if (res < 0 || pid_codec_parse(&codec, descriptor, (size_t)res)) {
+        printf("Unable to parse the report descriptor: %ls\n", hid_error(handle));
+        hid_close(handle);
+        hid_exit();
+        return 1;
+    }
+
+    // The reports of the effects are built once from the descriptor,
+    // with the fields that are not simple bytes encoded from the
+    // logical/physical ranges and units of the descriptor
+    if (pid_templates_init(&templates, &codec)
+        || pid_effect_desc_init(&effect, &templates, PID_ET_CONSTANT_FORCE)) {
+        printf("The report descriptor does not describe a constant force effect\n");
+        hid_close(handle);
+        hid_exit();
+        return 1;
+    }
 
     // Here is the different reports that we need to send to the device
     // to initialize the effect and start it
@@ -235,9 +328,9 @@ int main(int argc, char* argv[])
     //      and clears all effects from memory.
     memset(buf, 0x00, sizeof(buf));
     buf[0] = PID_DEVICE_CONTROL_REPORT_ID;
-    buf[1] = 0b00001000; // Device Control
+    buf[1] = PID_DC_DEVICE_RESET; // Device Control
         
-    res = hid_write(handle, buf, 3);              
+    res = hid_write(handle, buf, pid_codec_report_length(&codec, PID_REPORT_OUTPUT, PID_DEVICE_CONTROL_REPORT_ID));
     if (res < 0) {
         printf("Unable to send PID_DEVICE_CONTROL_REPORT: %ls\n", hid_error(handle));
     }
@@ -254,7 +347,7 @@ int main(int argc, char* argv[])
     buf[0] = DEVICE_GAIN_REPORT_ID;
     buf[1] = 0xff; // Device Gain
 
-    res = hid_write(handle, buf, 3);
+    res = hid_write(handle, buf, pid_codec_report_length(&codec, PID_REPORT_OUTPUT, DEVICE_GAIN_REPORT_ID));
     if (res < 0) {
         printf("Unableto send DEVICE_GAIN_REPORT: %ls\n", hid_error(handle));
     }
@@ -262,220 +355,127 @@ int main(int argc, char* argv[])
         printf("Sent DEVICE_GAIN_REPORT\n");
     }
 
-    // 3. CREATE_NEW_EFFECT_REPORT
-    // Endpoint: SET_REPORT
-    // Data: 0x01
-    // I am telling the device that I want to create a ET Constant Force Effect
-    // The device will try and make space for the effect in memory.
-    memset(buf, 0x00, sizeof(buf));
-    buf[0] = CREATE_NEW_EFFECT_REPORT_ID;
-    buf[1] = 0x01; // Create New ET Constant Force Effect
+    // From here on, every write goes through the writer loop, which
+    // owns the device while it streams the force
+    pid_writer writer;
 
-    res = hid_send_feature_report(handle, buf, 4);
-    if (res < 0) {
-        printf("Unable to send CREATE_NEW_EFFECT_REPORT: %ls\n", hid_error(handle));
-    }
-    else {
-        printf("sent CREATE_NEW_EFFECT_REPORT\n");
+    if (pid_writer_init(&writer, handle, &codec, 20)) {
+        printf("Unable to create the writer loop\n");
+        hid_close(handle);
+        hid_exit();
+        return 1;
     }
 
-    // 4. PID_BLOCK_LOAD_REPORT
-    // Endpoint: GET_REPORT
-    // Here I am sending a GET_REPORT to the device to get the index of the effect
-    // that has been created in the device memory
-    // The device will return the index of the effect, as well as if it was successful
-    // and the remaining memory in the device
-    memset(buf, 0x00, sizeof(buf));
-    buf[0] = PID_BLOCK_LOAD_REPORT_ID;
-
-    // Note that the lenght of the buffer must be enough to receive the data
-    res = hid_get_feature_report(handle, buf, 19);
+    // 3. to 8. are sent by pid_effect_create() in one go:
+    // CREATE_NEW_EFFECT_REPORT tells the device that I want to create
+    // a ET Constant Force Effect, and the device tries to make space for it.
+    // PID_BLOCK_LOAD_REPORT returns the index of the effect, as well as
+    // if it was successful and the remaining memory in the device.
+    // Then the magnitude (0), the envelope (none) and the effect itself
+    // (infinite duration, 100% gain, direction X at 90.0 degrees) are set,
+    // and the effect is started.
+    // Only 3. and 4. are waited for, 5. to 8. are queued to the writer
+    // loop and written first thing when it starts.
+    // If anything fails, the effect is freed and the index is -1.
+    effect.start = 1;
+    res = pid_effect_create(&writer, &templates, &effect);
     if (res < 0) {
-        printf("Unable to get PID_BLOCK_LOAD_REPORT: %ls\n", hid_error(handle));
-    }
-    else {
-        // Print out the returned buffer.
-        printf("PID_BLOCK_LOAD_REPORT\n   ");
-        for (i = 0; i < res; i++)
-            printf("%02x ", (unsigned int)buf[i]);
-        printf("\n");
-    }
-
-    // The index of the effect is in the second byte of the buffer
-    // The index is 0 if the effect could not be allocated
-    index = buf[1];
-    if (index == 0) {
 		printf("Effect could not be allocated\n");
 		return 1;
 	}
+    index = (unsigned char)res;
+    printf("Created effect %u\n", (unsigned int)index);
 
-    // 5. SET_CONSTANT_FORCE_REPORT
-    // Endpoint: INTERRUPT_OUT
-    // Data: index (8), magnitude (16)
-    // Before starting the effect, we need to set the magnitude of the effect
-    // As well as the envelope of the effect
-    // Thoses parameters change depending on the effect type, make sure
-    // to set the ones that are needed for the effect you are using
-    memset(buf, 0x00, sizeof(buf));
-    buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
-    buf[1] = index;
-    buf[2] = 0x00; // Magnitude
-    buf[3] = 0x00; // Magnitude
-
-    res = hid_write(handle, buf, 5);
-    if (res < 0) {
-        printf("Unable to send SET_CONSTANT_FORCE_REPORT: %ls\n", hid_error(handle));
-    }
-    else {
-        printf("Sent SET_CONSTANT_FORCE_REPORT\n");
+    // Here I am setting the magnitude of the effect to 1500
+    // Then to -1500 to make the wheel spin
+    // The force goes through the mixer, so that other clients
+    // (e.g. a telemetry overlay) can add their own contribution.
+    // Clients below the top priority are ducked by half, and the sum
+    // is softly saturated above 24576.
+    // The writer loop streams the mixer output in a SET_CONSTANT_FORCE_REPORT every 20 ms
+    // while the force is static, down to every 1 ms when it changes fast,
+    // and stops all effects right away if the safety switch trips.
+    // If the force is not updated for 100 ms, the watchdog fades it
+    // to zero in 5 ms and pauses the device.
+    // Updates smaller than 5% of the force (at least 16) are not sent,
+    // but the force is refreshed at least every 10 ticks.
+    // Peaks are softly limited above 16384 with a 2 tick look-ahead, so
+    // the soft saturation of the mixer is not reached, and the overall
+    // gain (device gain and magnitude) goes down to 50% when the force
+    // keeps going past 16384.
+    // Steps of the force (+1500 to -1500 below) are turned into ramps
+    // bounded in slew and jerk by the profile of the base.
+    // The square wave below is not predictable, so the force is not
+    // extrapolated. A game whose force follows the wheel (springs,
+    // aligning torque) would use FFB_PREDICT_KALMAN to hide the latency.
+    force_stream stream;
+    int game; // Mixer client id of the game
+
+    ffb_mixer_init(&stream.mixer, 24576, FFB_MIXER_UNITY / 2);
+    game = ffb_mixer_connect(&stream.mixer, 2, FFB_MIXER_UNITY);
+    ffb_watchdog_init(&stream.watchdog, &writer, 100, 5);
+    ffb_predict_init(&stream.predict, FFB_PREDICT_NONE,
+                     pid_codec_find(&codec, PID_REPORT_INPUT, JOYSTICK_INPUT_REPORT_ID,
+                                    PID_USAGE(PID_PAGE_GENERIC_DESKTOP, PID_GD_USAGE_X), 0), 30000);
+    ffb_limiter_init(&stream.limiter, 16384, 24576, 2, 50);
+    if (ffb_limiter_set_auto_gain(&stream.limiter, &writer, &codec, 0.5f, 2000)) {
+        printf("No DEVICE_GAIN_REPORT, the auto-gain only scales the magnitude\n");
     }
+    ffb_slew_init(&stream.slew, 1, ffb_slew_profile_find(0x346e, 0x0002));
+    ffb_deadband_init(&stream.deadband, 16, FFB_DEADBAND_UNITY / 20, 10);
+    ffb_rate_init(&stream.rate, 1, 20, 100, 2);
+    stream.writer = &writer;
 
-    // 6. SET_ENVELOPE_REPORT
-    // Endpoint: INTERRUPT_OUT
-    // Data: index (8), attack level (16), fade level (16), attack time (32), fade time (32)
-    memset(buf, 0x00, sizeof(buf));
-    buf[0] = SET_ENVELOPE_REPORT_ID;
-    buf[1] = index;
-    buf[2] = 0x00; // Attack Level
-    buf[3] = 0x00; // Attack Level
-    buf[4] = 0x00; // Fade Level
-    buf[5] = 0x00; // Fade Level
-    buf[6] = 0x00; // Attack Time
-    buf[7] = 0x00; // Attack Time
-    buf[8] = 0x00; // Attack Time
-    buf[9] = 0x00; // Attack Time
-    buf[10] = 0x00; // Fade Time
-    buf[11] = 0x00; // Fade Time
-    buf[12] = 0x00; // Fade Time
-    buf[13] = 0x00; // Fade Time
-
-    res = hid_write(handle, buf, 15);
-    if (res < 0) {
-        printf("Unable to send SET_ENVELOPE_REPORT: %ls\n", hid_error(handle));
+    if (pid_writer_set_stream(&writer, index, stream_force, &stream)) {
+        printf("Unable to stream SET_CONSTANT_FORCE_REPORT\n");
     }
-    else {
-        printf("Sent SET_ENVELOPE_REPORT\n");
+    pid_writer_set_input(&writer, ffb_predict_input, &stream.predict);
+    if (pid_writer_start(&writer)) {
+        printf("Unable to start the writer loop\n");
     }
-
-    // 7. SET_EFFECT_REPORT
-    // Endpoint: INTERRUPT_OUT
-    // Data: 
-    //      index (8), 
-    //      effect type (8), 
-    //      duration (16), 
-    //      trigger repeat interval (16), 
-    //      sample period (16)
-    //      start delay (16)
-    //      gain (8)
-    //      trigger button (8)
-    //      axe enable X (1), 
-    //      axe enable Y (1),
-    //      direction enable (1),
-    //      padding (5),
-    //      direction X (16), (en centi-degrees)
-    //      direction Y (16),
-    //	    type specific block offset 1 (16),
-    //      type specific block offset 2 (16),
-    // 
-    // Once the magnitude and envelope of the effect are set, we can start the effect
-    memset(buf, 0x00, sizeof(buf));
-    buf[0]  = SET_EFFECT_REPORT_ID;
-    buf[1]  = index; // Index given by the device
-    buf[2]  = 0x01; // Effect Type
-    buf[3]  = 0xff; // Duration 1 
-    buf[4]  = 0xff; // Duration 2
-    buf[5]  = 0x00; // Trigger Repeat Interval 1
-    buf[6]  = 0x00; // Trigger Repeat Interval 2
-    buf[7]  = 0x00; // Sample Period 1
-    buf[8]  = 0x00; // Sample Period 2
-    buf[9]  = 0x00; // Start Delay 1
-    buf[10] = 0x00; // Start Delay 2
-    buf[11] = 0xff; // Gain
-    buf[12] = 0xff; // Trigger Button
-    buf[13] = 0b00000100; // Padding (5), Direction Enable (1), Axe Enable Y (1), Axe Enable X (1)
-    buf[14] = 0x28; // Direction X 1 => 900.0 degrees
-    buf[15] = 0x23; // Direction X 2 => 900.0 degrees 
-    buf[16] = 0x00; // Direction Y 1
-    buf[17] = 0x00; // Direction Y 2
-    buf[18] = 0x00; // Type Specific Block Offset 1 1
-    buf[19] = 0x00; // Type Specific Block Offset 1 2
-    buf[20] = 0x00; // Type Specific Block Offset 2 1
-    buf[21] = 0x00; // Type Specific Block Offset 2 2
-
-    res = hid_write(handle, buf, 23);
-    if (res < 0) {
-        printf("Unable to send SET_EFFECT_REPORT: %ls\n", hid_error(handle));
-    }
-    else {
-        printf("Sent SET_EFFECT_REPORT\n");
+    if (ffb_watchdog_start(&stream.watchdog)) {
+        printf("Unable to start the watchdog\n");
     }
 
-    // 8. EFFECT_OPERATION_REPORT
-    // Endpoint: INTERRUPT_OUT
-    // Data: 
-    //      index (8),
-    //      Op effect start (1),
-    //      Op effect start solo (1),
-    //      Op effect stop (1),
-    //      Padding (5),
-    //      Loop Count (8),
-    // Now that everything is set, we can start the effect
-    memset(buf, 0x00, sizeof(buf));
-    buf[0] = EFFECT_OPERATION_REPORT_ID;
-    buf[1] = index;
-    buf[2] = 0b00000001; // Padding (5), Op effect stop (1), Op effect start solo (1), Op effect start (1)
-
-    res = hid_write(handle, buf, 4);
-    if (res < 0) {
-        printf("Unable to send EFFECT_OPERATION_REPORT: %ls\n", hid_error(handle));
-    }
-    else {
-        printf("Sent EFFECT_OPERATION_REPORT\n");
-    }
-
-    // Here I am setting the magnitude of the effect to 1500
-    // Then to -1500 to make the wheel spin
     for (i = 0; i < 10; i++) {
-
-        // SET_CONSTANT_FORCE_REPORT
-        // Endpoint: INTERRUPT_OUT
-        // Data: index (8), magnitude (16)
-        memset(buf, 0x00, sizeof(buf));
-        buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
-        buf[1] = index;
-        buf[2] = 0xdc; // Magnitude
-        buf[3] = 0x05; // Magnitude
-
-        for (int i = 0; i < 100; i++) {
-            res = hid_write(handle, buf, 5);
+        for (int j = 0; j < 100; j++) {
+            ffb_mixer_submit(&stream.mixer, game, 1500);
+            ffb_watchdog_kick(&stream.watchdog);
             Sleep(10);
         }
-
-        // SET_CONSTANT_FORCE_REPORT
-        // Endpoint: INTERRUPT_OUT
-        // Data: index (8), magnitude (16)
-        memset(buf, 0x00, sizeof(buf));
-        buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
-        buf[1] = index;
-        buf[2] = 0x24; // Magnitude
-        buf[3] = 0xfa; // Magnitude
-
-        for (int i = 0; i < 100; i++) {
-            res = hid_write(handle, buf, 5);
+        for (int j = 0; j < 100; j++) {
+            ffb_mixer_submit(&stream.mixer, game, -1500);
+            ffb_watchdog_kick(&stream.watchdog);
             Sleep(10);
         }
-
     }
 
+    ffb_mixer_disconnect(&stream.mixer, game);
+    ffb_watchdog_stop(&stream.watchdog);
+    pid_writer_stop(&writer);
+    printf("Writer loop: %ld writes, %ld errors\n", pid_atomic_load(&writer.writes), pid_atomic_load(&writer.errors));
+    printf("Watchdog: %ld deadline misses\n", pid_atomic_load(&stream.watchdog.misses));
+    printf("Dead-band: %ld of %ld updates sent (%d%% fewer writes)\n",
+           stream.deadband.sent, stream.deadband.ticks, ffb_deadband_reduction(&stream.deadband));
+    printf("Update rate: %ld of %ld ticks at %u ms, hid_write takes %ld us\n",
+           stream.rate.fast_updates, stream.rate.updates, stream.rate.min_period_ms,
+           pid_atomic_load(&writer.write_latency_us));
+    printf("Prediction: %lu wheel reports, %.0f mean error on force changes\n",
+           stream.predict.inputs, stream.predict.error);
+    printf("Limiter: %d per thousand samples past the ceiling, %lu clipped, %lu device gain reports\n",
+           ffb_limiter_clip_rate(&stream.limiter), stream.limiter.clipped, stream.limiter.gain_reports);
+    printf("Slew limiter: %lu of %lu ticks ramping\n", stream.slew.limited, stream.slew.samples);
+    pid_writer_destroy(&writer);
+
     // PID_DEVICE_CONTROL_REPORT
     // Endpoint: INTERRUPT_OUT
     // Data: 0b00000100 
     // I am clearing all effects before closing the device
     memset(buf, 0x00, sizeof(buf));
     buf[0] = PID_DEVICE_CONTROL_REPORT_ID;
-    buf[1] = 0b00000100; // Device Control
+    buf[1] = PID_DC_STOP_ALL_EFFECTS; // Device Control
 
-    res = hid_write(handle, buf, 3);
+    res = hid_write(handle, buf, pid_codec_report_length(&codec, PID_REPORT_OUTPUT, PID_DEVICE_CONTROL_REPORT_ID));
     if (res < 0) {
         printf("Unable to send PID_DEVICE_CONTROL_REPORT: %ls\n", hid_error(handle));
     }
@@ -0,0 +1,444 @@
+#include "pid_codec.h"
+
+#include <string.h>
+
+#define PID_CODEC_MAX_USAGES 64
+#define PID_CODEC_MAX_DEPTH 8
+
+// Item types and tags of the short items
+// See 6.2.2 of the HID class definition
+enum HID_ITEM_TYPE {
+    HID_ITEM_MAIN = 0,
+    HID_ITEM_GLOBAL = 1,
+    HID_ITEM_LOCAL = 2,
+};
+
+enum HID_MAIN_TAG {
+    HID_MAIN_INPUT = 0x8,
+    HID_MAIN_OUTPUT = 0x9,
+    HID_MAIN_COLLECTION = 0xa,
+    HID_MAIN_FEATURE = 0xb,
+    HID_MAIN_END_COLLECTION = 0xc,
+};
+
+enum HID_GLOBAL_TAG {
+    HID_GLOBAL_USAGE_PAGE = 0x0,
+    HID_GLOBAL_LOGICAL_MIN = 0x1,
+    HID_GLOBAL_LOGICAL_MAX = 0x2,
+    HID_GLOBAL_PHYSICAL_MIN = 0x3,
+    HID_GLOBAL_PHYSICAL_MAX = 0x4,
+    HID_GLOBAL_UNIT_EXPONENT = 0x5,
+    HID_GLOBAL_UNIT = 0x6,
+    HID_GLOBAL_REPORT_SIZE = 0x7,
+    HID_GLOBAL_REPORT_ID = 0x8,
+    HID_GLOBAL_REPORT_COUNT = 0x9,
+    HID_GLOBAL_PUSH = 0xa,
+    HID_GLOBAL_POP = 0xb,
+};
+
+enum HID_LOCAL_TAG {
+    HID_LOCAL_USAGE = 0x0,
+    HID_LOCAL_USAGE_MIN = 0x1,
+    HID_LOCAL_USAGE_MAX = 0x2,
+};
+
+// Main item data bits
+#define HID_MAIN_CONSTANT 0x01
+#define HID_MAIN_VARIABLE 0x02
+
+typedef struct hid_globals {
+    unsigned long usage_page;
+    long logical_min;
+    long logical_max;
+    long physical_min;
+    long physical_max;
+    int unit_exponent;
+    unsigned long unit;
+    unsigned int report_size;
+    unsigned char report_id;
+    unsigned int report_count;
+    // Sizes of the min/max items, to read the maximums as unsigned
+    unsigned char logical_max_size;
+    unsigned char physical_max_size;
+} hid_globals;
+
+typedef struct hid_locals {
+    unsigned long usages[PID_CODEC_MAX_USAGES];
+    int usage_count;
+    unsigned long usage_min;
+    unsigned long usage_max;
+    int has_range;
+} hid_locals;
+
+static long item_signed(unsigned long value, int size) {
+    if (size == 1)
+        return (long)(signed char)value;
+    if (size == 2)
+        return (long)(short)value;
+    // Through int, long is 64 bits on LP64
+    return (long)(int)value;
+}
+
+static unsigned long item_extended_usage(unsigned long value, int size, const hid_globals* g) {
+    if (size == 4)
+        return value;
+    return PID_USAGE(g->usage_page, value);
+}
+
+static pid_report_layout* codec_report(pid_codec* codec, int kind, unsigned char report_id) {
+    int i;
+
+    for (i = 0; i < codec->report_count; i++) {
+        if (codec->reports[i].kind == kind && codec->reports[i].report_id == report_id)
+            return &codec->reports[i];
+    }
+    if (codec->report_count >= PID_CODEC_MAX_REPORTS)
+        return NULL;
+
+    codec->reports[codec->report_count].kind = (unsigned char)kind;
+    codec->reports[codec->report_count].report_id = report_id;
+    codec->reports[codec->report_count].bit_length = 0;
+    return &codec->reports[codec->report_count++];
+}
+
+// The maximums are read as unsigned when the minimum is not negative,
+// e.g. "0x27, 0xFF, 0xFF, 0x00, 0x00" is 65535, and "0x26, 0xFF, 0x00" is 255.
+static long range_max(long min, long max, unsigned char size) {
+    if (min >= 0 && max < 0) {
+        if (size == 1)
+            return max & 0xff;
+        if (size == 2)
+            return max & 0xffff;
+    }
+    return max;
+}
+
+static int codec_main_item(pid_codec* codec, int tag, unsigned long data,
+                           const hid_globals* g, const hid_locals* l, unsigned long parent_usage) {
+    pid_report_layout* report;
+    pid_field* field;
+    int kind;
+    unsigned int k;
+
+    if (tag == HID_MAIN_INPUT)
+        kind = PID_REPORT_INPUT;
+    else if (tag == HID_MAIN_OUTPUT)
+        kind = PID_REPORT_OUTPUT;
+    else
+        kind = PID_REPORT_FEATURE;
+
+    report = codec_report(codec, kind, g->report_id);
+    if (!report)
+        return -1;
+
+    for (k = 0; k < g->report_count; k++) {
+        if (!(data & HID_MAIN_CONSTANT)) {
+            if (codec->field_count >= PID_CODEC_MAX_FIELDS)
+                return -1;
+
+            field = &codec->fields[codec->field_count++];
+            memset(field, 0x00, sizeof(*field));
+            field->report_id = g->report_id;
+            field->kind = (unsigned char)kind;
+            field->parent_usage = parent_usage;
+            field->bit_offset = report->bit_length;
+            field->bit_size = g->report_size;
+            field->logical_min = g->logical_min;
+            field->logical_max = range_max(g->logical_min, g->logical_max, g->logical_max_size);
+            field->physical_min = g->physical_min;
+            field->physical_max = range_max(g->physical_min, g->physical_max, g->physical_max_size);
+            field->unit = g->unit;
+            field->unit_exponent = g->unit_exponent;
+
+            // Physical extents of 0 means they are the same as the logical ones
+            if (field->physical_min == 0 && field->physical_max == 0) {
+                field->physical_min = field->logical_min;
+                field->physical_max = field->logical_max;
+            }
+
+            if (!(data & HID_MAIN_VARIABLE) && l->usage_count > 1)
+                field->usage = parent_usage; // Selector array, e.g. Effect Type
+            else if (l->has_range)
+                field->usage = l->usage_min + k;
+            else if (l->usage_count > 0)
+                field->usage = l->usages[k < (unsigned int)l->usage_count ? k : (unsigned int)l->usage_count - 1];
+        }
+
+        report->bit_length += g->report_size;
+    }
+
+    return 0;
+}
+
+int pid_codec_parse(pid_codec* codec, const unsigned char* descriptor, size_t length) {
+    hid_globals g;
+    hid_globals stack[PID_CODEC_MAX_DEPTH];
+    int stack_depth = 0;
+    hid_locals l;
+    unsigned long collections[PID_CODEC_MAX_DEPTH];
+    int depth = 0;
+    size_t i = 0;
+    int size, type, tag, n;
+    unsigned long data;
+
+    memset(codec, 0x00, sizeof(*codec));
+    memset(&g, 0x00, sizeof(g));
+    memset(&l, 0x00, sizeof(l));
+
+    while (i < length) {
+        unsigned char prefix = descriptor[i++];
+
+        // Long items are not used by PID devices, skip them
+        if (prefix == 0xfe) {
+            if (i + 1 >= length)
+                return -1;
+            i += 2 + descriptor[i];
+            continue;
+        }
+
+        size = prefix & 0x03;
+        if (size == 3)
+            size = 4;
+        type = (prefix >> 2) & 0x03;
+        tag = prefix >> 4;
+
+        if (i + size > length)
+            return -1;
+        data = 0;
+        for (n = 0; n < size; n++)
+            data |= (unsigned long)descriptor[i + n] << (8 * n);
+        i += size;
+
+        if (type == HID_ITEM_MAIN) {
+            switch (tag) {
+            case HID_MAIN_INPUT:
+            case HID_MAIN_OUTPUT:
+            case HID_MAIN_FEATURE:
+                if (codec_main_item(codec, tag, data, &g, &l, depth > 0 ? collections[depth - 1] : 0))
+                    return -1;
+                break;
+            case HID_MAIN_COLLECTION:
+                if (depth >= PID_CODEC_MAX_DEPTH)
+                    return -1;
+                collections[depth++] = l.usage_count > 0 ? l.usages[0] : 0;
+                break;
+            case HID_MAIN_END_COLLECTION:
+                if (depth > 0)
+                    depth--;
+                break;
+            }
+            memset(&l, 0x00, sizeof(l));
+        }
+        else if (type == HID_ITEM_GLOBAL) {
+            switch (tag) {
+            case HID_GLOBAL_USAGE_PAGE: g.usage_page = data; break;
+            case HID_GLOBAL_LOGICAL_MIN: g.logical_min = item_signed(data, size); break;
+            case HID_GLOBAL_LOGICAL_MAX: g.logical_max = item_signed(data, size); g.logical_max_size = (unsigned char)size; break;
+            case HID_GLOBAL_PHYSICAL_MIN: g.physical_min = item_signed(data, size); break;
+            case HID_GLOBAL_PHYSICAL_MAX: g.physical_max = item_signed(data, size); g.physical_max_size = (unsigned char)size; break;
+            case HID_GLOBAL_UNIT_EXPONENT:
+                // Either a signed nibble (0x0D = -3) or a full signed value
+                if (size == 1 && data < 0x10)
+                    g.unit_exponent = data > 7 ? (int)data - 16 : (int)data;
+                else
+                    g.unit_exponent = (int)item_signed(data, size);
+                break;
+            case HID_GLOBAL_UNIT: g.unit = data; break;
+            case HID_GLOBAL_REPORT_SIZE: g.report_size = (unsigned int)data; break;
+            case HID_GLOBAL_REPORT_ID: g.report_id = (unsigned char)data; break;
+            case HID_GLOBAL_REPORT_COUNT: g.report_count = (unsigned int)data; break;
+            case HID_GLOBAL_PUSH:
+                if (stack_depth >= PID_CODEC_MAX_DEPTH)
+                    return -1;
+                stack[stack_depth++] = g;
+                break;
+            case HID_GLOBAL_POP:
+                if (stack_depth == 0)
+                    return -1;
+                g = stack[--stack_depth];
+                break;
+            }
+        }
+        else if (type == HID_ITEM_LOCAL) {
+            switch (tag) {
+            case HID_LOCAL_USAGE:
+                if (l.usage_count < PID_CODEC_MAX_USAGES)
+                    l.usages[l.usage_count++] = item_extended_usage(data, size, &g);
+                break;
+            case HID_LOCAL_USAGE_MIN:
+                l.usage_min = item_extended_usage(data, size, &g);
+                l.has_range = 1;
+                break;
+            case HID_LOCAL_USAGE_MAX:
+                l.usage_max = item_extended_usage(data, size, &g);
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+size_t pid_codec_report_length(const pid_codec* codec, int kind, unsigned char report_id) {
+    int i;
+
+    for (i = 0; i < codec->report_count; i++) {
+        if (codec->reports[i].kind == kind && codec->reports[i].report_id == report_id)
+            return 1 + (codec->reports[i].bit_length + 7) / 8;
+    }
+    return 0;
+}
+
+const pid_field* pid_codec_find(const pid_codec* codec, int kind, unsigned char report_id, unsigned long usage, unsigned long parent_usage) {
+    int i;
+
+    for (i = 0; i < codec->field_count; i++) {
+        const pid_field* field = &codec->fields[i];
+
+        if (field->kind != kind || field->report_id != report_id || field->usage != usage)
+            continue;
+        if (parent_usage != 0 && field->parent_usage != parent_usage)
+            continue;
+        return field;
+    }
+    return NULL;
+}
+
+int pid_codec_matches(const pid_codec* codec, const pid_layout_check* checks, int count) {
+    const pid_field* field;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (checks[i].usage == 0) {
+            if (pid_codec_report_length(codec, checks[i].kind, checks[i].report_id) != checks[i].bit_offset)
+                return 0;
+            continue;
+        }
+
+        field = pid_codec_find(codec, checks[i].kind, checks[i].report_id, checks[i].usage, checks[i].parent_usage);
+        if (!field || field->bit_offset != checks[i].bit_offset || field->bit_size != checks[i].bit_size)
+            return 0;
+    }
+    return 1;
+}
+
+int pid_codec_bind(pid_field_codec* fc, const pid_field* field, int unit) {
+    double lrange, prange, ratio, k;
+    int exponent;
+
+    if (!field)
+        return -1;
+
+    fc->field = field;
+
+    if (unit == PID_CODEC_RAW) {
+        fc->mul = 1 << 16;
+        fc->add = 0;
+        return 0;
+    }
+
+    lrange = (double)field->logical_max - (double)field->logical_min;
+    prange = (double)field->physical_max - (double)field->physical_min;
+    ratio = prange != 0.0 ? lrange / prange : 1.0;
+
+    // Caller units to physical units
+    k = 1.0;
+    if (unit == PID_CODEC_MS || unit == PID_CODEC_DEGREES) {
+        // Without a unit, PID times are in ms and angles in hundredths of degrees
+        if (field->unit == 0)
+            exponent = unit == PID_CODEC_MS ? -3 : -2;
+        else
+            exponent = field->unit_exponent;
+
+        // ms are 10^-3 seconds, degrees are 10^0 degrees
+        exponent = (unit == PID_CODEC_MS ? -3 : 0) - exponent;
+        for (; exponent > 0; exponent--)
+            k *= 10.0;
+        for (; exponent < 0; exponent++)
+            k /= 10.0;
+    }
+    else if (unit == PID_CODEC_NORMALIZED) {
+        k = field->physical_max;
+        if (-(double)field->physical_min > k)
+            k = -(double)field->physical_min;
+    }
+
+    fc->mul = (long long)(k * ratio * 65536.0 + 0.5);
+    fc->add = (long long)(((double)field->logical_min - (double)field->physical_min * ratio) * 65536.0);
+    return 0;
+}
+
+static void codec_pack(unsigned char* buf, unsigned int bit_offset, unsigned int bit_size, unsigned long long value) {
+    unsigned char* data = buf + 1;
+    unsigned int i = 0;
+    unsigned int bit, shift, n;
+    unsigned int mask;
+
+    while (i < bit_size) {
+        bit = bit_offset + i;
+        shift = bit & 7;
+        n = 8 - shift;
+        if (n > bit_size - i)
+            n = bit_size - i;
+        mask = ((1u << n) - 1) << shift;
+        data[bit >> 3] = (unsigned char)((data[bit >> 3] & ~mask) | (((unsigned int)(value >> i) << shift) & mask));
+        i += n;
+    }
+}
+
+static long codec_clamp(const pid_field* field, long long value) {
+    if (value < field->logical_min)
+        return field->logical_min;
+    if (value > field->logical_max)
+        return field->logical_max;
+    return (long)value;
+}
+
+void pid_codec_put_raw(const pid_field* field, unsigned char* buf, long value) {
+    codec_pack(buf, field->bit_offset, field->bit_size, (unsigned long long)(long long)value);
+}
+
+void pid_codec_put_q16(const pid_field_codec* fc, unsigned char* buf, long long value_q16) {
+    long long logical = (((value_q16 * fc->mul) >> 16) + fc->add + 32768) >> 16;
+
+    pid_codec_put_raw(fc->field, buf, codec_clamp(fc->field, logical));
+}
+
+void pid_codec_put_ms(const pid_field_codec* fc, unsigned char* buf, unsigned long ms) {
+    long long logical = ((long long)ms * fc->mul + fc->add + 32768) >> 16;
+
+    pid_codec_put_raw(fc->field, buf, codec_clamp(fc->field, logical));
+}
+
+void pid_codec_put_degrees(const pid_field_codec* fc, unsigned char* buf, float degrees) {
+    pid_codec_put_q16(fc, buf, (long long)(degrees * 65536.0f));
+}
+
+void pid_codec_put_normalized(const pid_field_codec* fc, unsigned char* buf, float value) {
+    if (value > 1.0f)
+        value = 1.0f;
+    if (value < -1.0f)
+        value = -1.0f;
+    pid_codec_put_q16(fc, buf, (long long)(value * 65536.0f));
+}
+
+long pid_codec_get_raw(const pid_field* field, const unsigned char* buf) {
+    const unsigned char* data = buf + 1;
+    unsigned long long value = 0;
+    unsigned int i;
+    unsigned int bit;
+
+    if (field->bit_size == 0)
+        return 0;
+
+    for (i = 0; i < field->bit_size && i < 64; i++) {
+        bit = field->bit_offset + i;
+        if (data[bit >> 3] & (1u << (bit & 7)))
+            value |= 1ull << i;
+    }
+
+    if (field->logical_min < 0 && field->bit_size < 64 && (value & (1ull << (field->bit_size - 1))))
+        value |= ~0ull << field->bit_size;
+
+    return (long)(long long)value;
+}
@@ -0,0 +1,156 @@
+// Report codec driven by the report descriptor
+// pid_codec_parse() walks the descriptor returned by hid_get_report_descriptor()
+// and records, for every report, the bit offset, size, logical/physical
+// ranges, unit and unit exponent of each field, as well as the report length.
+//
+// A field is then bound to the unit the caller works with (milliseconds,
+// degrees, normalized force, ...). Binding computes a Q16 fixed-point scale
+// once, so encoding a value is a multiply, a shift and a clamp.
+
+#ifndef PID_CODEC_H__
+#define PID_CODEC_H__
+
+#include <stddef.h>
+
+#define PID_CODEC_MAX_REPORTS 32
+#define PID_CODEC_MAX_FIELDS 512
+
+// Extended usage: usage page in the high 16 bits, usage in the low 16 bits
+#define PID_USAGE(page, id) ((((unsigned long)(page)) << 16) | (id))
+
+#define PID_PAGE_GENERIC_DESKTOP 0x01
+#define PID_PAGE_ORDINAL 0x0a
+#define PID_PAGE_PID 0x0f
+
+// Usage of the Generic Desktop page carrying the wheel angle
+#define PID_GD_USAGE_X 0x30
+
+// Usages of the PID page used by the effect reports
+enum PID_USAGE_ID {
+    PID_USAGE_EFFECT_BLOCK_INDEX = 0x22,
+    PID_USAGE_EFFECT_TYPE = 0x25,
+    PID_USAGE_DURATION = 0x50,
+    PID_USAGE_SAMPLE_PERIOD = 0x51,
+    PID_USAGE_GAIN = 0x52,
+    PID_USAGE_TRIGGER_BUTTON = 0x53,
+    PID_USAGE_TRIGGER_REPEAT_INTERVAL = 0x54,
+    PID_USAGE_AXES_ENABLE = 0x55,
+    PID_USAGE_DIRECTION_ENABLE = 0x56,
+    PID_USAGE_DIRECTION = 0x57,
+    PID_USAGE_TYPE_SPECIFIC_BLOCK_OFFSET = 0x58,
+    PID_USAGE_ATTACK_LEVEL = 0x5b,
+    PID_USAGE_ATTACK_TIME = 0x5c,
+    PID_USAGE_FADE_LEVEL = 0x5d,
+    PID_USAGE_FADE_TIME = 0x5e,
+    PID_USAGE_CP_OFFSET = 0x60,
+    PID_USAGE_POSITIVE_COEFFICIENT = 0x61,
+    PID_USAGE_NEGATIVE_COEFFICIENT = 0x62,
+    PID_USAGE_POSITIVE_SATURATION = 0x63,
+    PID_USAGE_NEGATIVE_SATURATION = 0x64,
+    PID_USAGE_DEAD_BAND = 0x65,
+    PID_USAGE_OFFSET = 0x6f,
+    PID_USAGE_MAGNITUDE = 0x70,
+    PID_USAGE_PHASE = 0x71,
+    PID_USAGE_PERIOD = 0x72,
+    PID_USAGE_RAMP_START = 0x75,
+    PID_USAGE_RAMP_END = 0x76,
+    PID_USAGE_EFFECT_OPERATION = 0x78,
+    PID_USAGE_LOOP_COUNT = 0x7c,
+    PID_USAGE_DEVICE_GAIN = 0x7e,
+    PID_USAGE_BLOCK_LOAD_STATUS = 0x8b,
+    PID_USAGE_START_DELAY = 0xa7,
+};
+
+enum PID_REPORT_KIND {
+    PID_REPORT_INPUT = 0,
+    PID_REPORT_OUTPUT,
+    PID_REPORT_FEATURE,
+};
+
+// Unit the caller passes to the encoders
+enum PID_CODEC_UNIT {
+    PID_CODEC_RAW = 0,     // Logical value, no conversion
+    PID_CODEC_MS,          // Milliseconds
+    PID_CODEC_DEGREES,     // Degrees
+    PID_CODEC_NORMALIZED,  // -1.0..1.0 of the physical range
+};
+
+typedef struct pid_field {
+    unsigned char report_id;
+    unsigned char kind;          // PID_REPORT_KIND
+    unsigned long usage;         // Extended usage
+    unsigned long parent_usage;  // Extended usage of the enclosing logical collection
+    unsigned int bit_offset;     // From the first byte after the report ID
+    unsigned int bit_size;
+    long logical_min;
+    long logical_max;
+    long physical_min;
+    long physical_max;
+    unsigned long unit;
+    int unit_exponent;
+} pid_field;
+
+typedef struct pid_report_layout {
+    unsigned char report_id;
+    unsigned char kind;
+    unsigned int bit_length;     // Without the report ID
+} pid_report_layout;
+
+typedef struct pid_codec {
+    pid_field fields[PID_CODEC_MAX_FIELDS];
+    int field_count;
+    pid_report_layout reports[PID_CODEC_MAX_REPORTS];
+    int report_count;
+} pid_codec;
+
+// Field bound to a caller unit, ready to encode
+typedef struct pid_field_codec {
+    const pid_field* field;
+    long long mul;  // Q16 logical units per Q16 caller unit
+    long long add;  // Q16 logical offset
+} pid_field_codec;
+
+// One entry of the layout generated in pid_layout.h.
+// An entry with a usage of 0 checks the report length (in bit_offset).
+typedef struct pid_layout_check {
+    unsigned char kind;
+    unsigned char report_id;
+    unsigned long usage;
+    unsigned long parent_usage;
+    unsigned int bit_offset;
+    unsigned int bit_size;
+} pid_layout_check;
+
+// Returns 0 on success, -1 if the descriptor is malformed or too large
+int pid_codec_parse(pid_codec* codec, const unsigned char* descriptor, size_t length);
+
+// Length to pass to hid_write / hid_send_feature_report, including the
+// report ID byte. Returns 0 if the report does not exist.
+size_t pid_codec_report_length(const pid_codec* codec, int kind, unsigned char report_id);
+
+// Finds a field by extended usage. parent_usage selects between fields that
+// share a usage (e.g. the Ordinal X of Direction and of Type Specific Block
+// Offset), pass 0 to take the first match. Returns NULL if not found.
+const pid_field* pid_codec_find(const pid_codec* codec, int kind, unsigned char report_id, unsigned long usage, unsigned long parent_usage);
+
+// Returns 1 if the descriptor has exactly the fields and lengths of checks,
+// i.e. the encoders generated in pid_layout.h can be used with this device.
+int pid_codec_matches(const pid_codec* codec, const pid_layout_check* checks, int count);
+
+// Precomputes the scale from unit to the logical range of the field.
+// Returns 0 on success, -1 if field is NULL.
+int pid_codec_bind(pid_field_codec* fc, const pid_field* field, int unit);
+
+// Encoders, the value is converted, clamped to the logical range
+// and packed into buf (buf[0] being the report ID).
+void pid_codec_put_raw(const pid_field* field, unsigned char* buf, long value);
+void pid_codec_put_q16(const pid_field_codec* fc, unsigned char* buf, long long value_q16);
+void pid_codec_put_ms(const pid_field_codec* fc, unsigned char* buf, unsigned long ms);
+void pid_codec_put_degrees(const pid_field_codec* fc, unsigned char* buf, float degrees);
+void pid_codec_put_normalized(const pid_field_codec* fc, unsigned char* buf, float value);
+
+// Decoder, sign extended when the logical minimum is negative, 0 for a
+// field without bits
+long pid_codec_get_raw(const pid_field* field, const unsigned char* buf);
+
+#endif // PID_CODEC_H__
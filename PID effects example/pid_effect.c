@@ -0,0 +1,185 @@
+#include "pid_effect.h"
+
+#include <string.h>
+
+#include "pid_reports.h"
+
+int pid_effect_desc_init(pid_effect_desc* desc, const pid_templates* templates, unsigned char type) {
+    const pid_template* t;
+
+    if (type < PID_ET_CONSTANT_FORCE || type > PID_ET_COUNT)
+        return -1;
+
+    memset(desc, 0x00, sizeof(*desc));
+    desc->type = type;
+
+    // Every block has the same defaults, read them back from the first one
+    t = &templates->effects[0][type - 1];
+    if (templates->duration)
+        desc->duration = pid_codec_get_raw(templates->duration, t->data);
+    if (templates->gain)
+        desc->gain = pid_codec_get_raw(templates->gain, t->data);
+    if (templates->direction)
+        desc->direction = pid_codec_get_raw(templates->direction, t->data);
+
+    return 0;
+}
+
+#define PID_EFFECT_REPORTS 4
+
+// Reports of an effect, queued together
+typedef struct effect_batch {
+    const unsigned char* data[PID_EFFECT_REPORTS];
+    size_t lengths[PID_EFFECT_REPORTS];
+    unsigned int count;
+} effect_batch;
+
+static int effect_add(effect_batch* batch, const pid_template* t) {
+    if (!t || t->length == 0)
+        return -1;
+    batch->data[batch->count] = t->data;
+    batch->lengths[batch->count] = t->length;
+    batch->count++;
+    return 0;
+}
+
+// Patches the images of the block at index with desc and queues them
+static int effect_upload(pid_writer* writer, pid_templates* templates, unsigned char index, const pid_effect_desc* desc) {
+    effect_batch batch;
+    unsigned char type = desc->type;
+    int envelope = 1;
+
+    batch.count = 0;
+
+    // Type specific block
+    switch (type) {
+    case PID_ET_CONSTANT_FORCE:
+        // SET_CONSTANT_FORCE_REPORT
+        // Data: index (8), magnitude (16)
+        if (effect_add(&batch, pid_template_set_constant_force(templates, index, (short)desc->magnitude)))
+            return -1;
+        break;
+    case PID_ET_RAMP:
+        // SET_RAMP_FORCE_REPORT
+        // Data: index (8), ramp start (16), ramp end (16)
+        if (effect_add(&batch, pid_template_set_ramp_force(templates, index, desc->ramp_start, desc->ramp_end)))
+            return -1;
+        break;
+    case PID_ET_SPRING:
+    case PID_ET_DAMPER:
+    case PID_ET_INERTIA:
+    case PID_ET_FRICTION:
+        // SET_CONDITION_REPORT
+        // Data: index (8), parameter block offset (4), type specific block offsets (2 x 2),
+        //      cp offset (16), positive / negative coefficient (16), positive / negative saturation (16),
+        //      dead band (16)
+        if (effect_add(&batch, pid_template_set_condition(templates, index, desc->cp_offset,
+                                                          desc->positive_coefficient, desc->negative_coefficient,
+                                                          desc->positive_saturation, desc->negative_saturation,
+                                                          desc->dead_band)))
+            return -1;
+        envelope = 0;
+        break;
+    default:
+        // SET_PERIODIC_REPORT
+        // Data: index (8), magnitude (16), offset (16), phase (16), period (32)
+        if (effect_add(&batch, pid_template_set_periodic(templates, index, desc->magnitude, desc->offset,
+                                                         desc->phase, desc->period)))
+            return -1;
+        break;
+    }
+
+    // SET_ENVELOPE_REPORT
+    // Data: index (8), attack level (16), fade level (16), attack time (32), fade time (32)
+    if (envelope && effect_add(&batch, pid_template_set_envelope(templates, index, desc->attack_level, desc->attack_time,
+                                                                 desc->fade_level, desc->fade_time)))
+        return -1;
+
+    // SET_EFFECT_REPORT
+    // Data:
+    //      index (8), effect type (8), duration (16), trigger repeat interval (16),
+    //      sample period (16), start delay (16), gain (8), trigger button (8),
+    //      axe enable X (1), axe enable Y (1), direction enable (1), padding (5),
+    //      direction X (16) (in centi-degrees), direction Y (16),
+    //      type specific block offset 1 (16), type specific block offset 2 (16)
+    pid_template_set_start_delay(templates, index, type, desc->start_delay);
+    if (effect_add(&batch, pid_template_set_effect(templates, index, type, desc->duration, desc->gain, desc->direction)))
+        return -1;
+
+    // EFFECT_OPERATION_REPORT
+    // Data: index (8), effect operation (8), loop count (8)
+    if (desc->start && effect_add(&batch, pid_template_set_operation(templates, index, PID_OP_EFFECT_START, desc->loop_count)))
+        return -1;
+
+    return pid_writer_submit_effect(writer, index, batch.data, batch.lengths, batch.count);
+}
+
+int pid_effect_create(pid_writer* writer, pid_templates* templates, const pid_effect_desc* desc) {
+    const pid_codec* codec = writer->codec;
+    unsigned char buf[PID_TEMPLATE_REPORT_MAX];
+    const pid_field* type_field;
+    const pid_field* index_field;
+    const pid_field* status_field;
+    const pid_template* t;
+    size_t length;
+    long index;
+
+    if (desc->type < PID_ET_CONSTANT_FORCE || desc->type > PID_ET_COUNT)
+        return -1;
+
+    type_field = pid_codec_find(codec, PID_REPORT_FEATURE, CREATE_NEW_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_EFFECT_TYPE), 0);
+    index_field = pid_codec_find(codec, PID_REPORT_FEATURE, PID_BLOCK_LOAD_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_EFFECT_BLOCK_INDEX), 0);
+    status_field = pid_codec_find(codec, PID_REPORT_FEATURE, PID_BLOCK_LOAD_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_BLOCK_LOAD_STATUS), 0);
+    if (!type_field || !index_field)
+        return -1;
+
+    // CREATE_NEW_EFFECT_REPORT
+    // Endpoint: SET_REPORT
+    // Data: effect type (8), byte count (10), padding (6)
+    length = pid_codec_report_length(codec, PID_REPORT_FEATURE, CREATE_NEW_EFFECT_REPORT_ID);
+    if (length > sizeof(buf))
+        return -1;
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = CREATE_NEW_EFFECT_REPORT_ID;
+    pid_codec_put_raw(type_field, buf, desc->type);
+    if (pid_writer_send_feature(writer, buf, length) < 0)
+        return -1;
+
+    // PID_BLOCK_LOAD_REPORT
+    // Endpoint: GET_REPORT
+    // Data: index (8), block load status (8), RAM pool available (16)
+    // The only round trip: the index is needed by every other report
+    length = pid_codec_report_length(codec, PID_REPORT_FEATURE, PID_BLOCK_LOAD_REPORT_ID);
+    if (length > sizeof(buf))
+        return -1;
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = PID_BLOCK_LOAD_REPORT_ID;
+    if (pid_writer_get_feature(writer, buf, length) < 0)
+        return -1;
+
+    index = pid_codec_get_raw(index_field, buf);
+    if (index < 1 || index > PID_MAX_EFFECT_BLOCKS)
+        return -1;
+    if (status_field && pid_codec_get_raw(status_field, buf) != PID_BLOCK_LOAD_SUCCESS)
+        return -1;
+
+    // A queue with no room for the upload has none for the Block Free either
+    if (effect_upload(writer, templates, (unsigned char)index, desc)) {
+        t = pid_template_get(templates, PID_TEMPLATE_BLOCK_FREE, (unsigned char)index);
+        if (t && t->length)
+            pid_writer_write(writer, t->data, t->length);
+        return -1;
+    }
+
+    return (int)index;
+}
+
+int pid_effect_free(pid_writer* writer, pid_templates* templates, unsigned char index) {
+    const pid_template* t = pid_template_get(templates, PID_TEMPLATE_BLOCK_FREE, index);
+
+    // PID_BLOCK_FREE_REPORT
+    // Data: index (8)
+    if (!t || t->length == 0)
+        return -1;
+    return pid_writer_submit_ref(writer, t->data, t->length);
+}
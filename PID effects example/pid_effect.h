@@ -0,0 +1,80 @@
+// Effect upload in one transaction
+// pid_effect_create() replaces the sequence
+//      CREATE_NEW_EFFECT_REPORT, PID_BLOCK_LOAD_REPORT,
+//      type specific reports, SET_EFFECT_REPORT, EFFECT_OPERATION_REPORT
+// with a single call. The caller only waits for the two feature reports,
+// the GET_REPORT of the PID Block Load Report giving the index every other
+// report needs. Those are then queued back-to-back to the writer loop from
+// the images of pid_templates.h, and written while the caller goes on. If
+// one of them fails, the loop frees the block with a PID_BLOCK_FREE_REPORT
+// so the device does not leak effect memory.
+//
+// Effects can be created while the writer loop streams, e.g. during
+// gameplay, or before it is started, the reports being written when it
+// starts. The images of a block must not be patched again until they
+// have been written.
+
+#ifndef PID_EFFECT_H__
+#define PID_EFFECT_H__
+
+#include "pid_codec.h"
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+// Parameters of an effect, in logical values of the reports
+typedef struct pid_effect_desc {
+    unsigned char type; // PID_ET_*
+
+    // SET_EFFECT_REPORT
+    long duration;
+    long gain;
+    long direction;
+    long start_delay;
+
+    // SET_ENVELOPE_REPORT (constant force, ramp and periodic effects)
+    long attack_level;
+    long attack_time;
+    long fade_level;
+    long fade_time;
+
+    // SET_CONSTANT_FORCE_REPORT, SET_PERIODIC_REPORT
+    long magnitude;
+
+    // SET_RAMP_FORCE_REPORT
+    long ramp_start;
+    long ramp_end;
+
+    // SET_PERIODIC_REPORT
+    long offset;
+    long phase;
+    long period;
+
+    // SET_CONDITION_REPORT
+    long cp_offset;
+    long positive_coefficient;
+    long negative_coefficient;
+    long positive_saturation;
+    long negative_saturation;
+    long dead_band;
+
+    // EFFECT_OPERATION_REPORT, sent only if start is set
+    int start;
+    unsigned char loop_count;
+} pid_effect_desc;
+
+// Fills desc with the defaults of the SET_EFFECT_REPORT images
+// (infinite duration, full gain, 90 degrees) and zeros elsewhere.
+// Returns 0 on success, -1 if type is out of range.
+int pid_effect_desc_init(pid_effect_desc* desc, const pid_templates* templates, unsigned char type);
+
+// Creates the effect and queues its upload and start, if any.
+// Returns the Effect Block Index given by the device, -1 if the device
+// has no room, a feature report could not be sent or the writer could
+// not queue the upload (the block is then freed).
+int pid_effect_create(pid_writer* writer, pid_templates* templates, const pid_effect_desc* desc);
+
+// Queues a PID_BLOCK_FREE_REPORT for the effect at index.
+// Returns 0 on success
+int pid_effect_free(pid_writer* writer, pid_templates* templates, unsigned char index);
+
+#endif // PID_EFFECT_H__
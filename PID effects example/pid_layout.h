@@ -0,0 +1,654 @@
+// Generated by pid_layout_gen.c from the report descriptor, do not edit.
+// Fixed-layout encoders and decoders of the PID reports: every offset is a constant.
+// Offsets and sizes are in bits, from the first byte after the report ID.
+// Use them only when pid_layout_matches() returns 1 for the device.
+
+#ifndef PID_LAYOUT_H__
+#define PID_LAYOUT_H__
+
+#include "pid_codec.h"
+
+// SET_EFFECT_REPORT (output, ID 0x01)
+#define PID_LAYOUT_SET_EFFECT_LENGTH 22
+#define PID_LAYOUT_SET_EFFECT_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_EFFECT_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_EFFECT_EFFECT_TYPE_BIT 8
+#define PID_LAYOUT_SET_EFFECT_EFFECT_TYPE_SIZE 8
+#define PID_LAYOUT_SET_EFFECT_DURATION_BIT 16
+#define PID_LAYOUT_SET_EFFECT_DURATION_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_TRIGGER_REPEAT_INTERVAL_BIT 32
+#define PID_LAYOUT_SET_EFFECT_TRIGGER_REPEAT_INTERVAL_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_SAMPLE_PERIOD_BIT 48
+#define PID_LAYOUT_SET_EFFECT_SAMPLE_PERIOD_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_START_DELAY_BIT 64
+#define PID_LAYOUT_SET_EFFECT_START_DELAY_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_GAIN_BIT 80
+#define PID_LAYOUT_SET_EFFECT_GAIN_SIZE 8
+#define PID_LAYOUT_SET_EFFECT_TRIGGER_BUTTON_BIT 88
+#define PID_LAYOUT_SET_EFFECT_TRIGGER_BUTTON_SIZE 8
+#define PID_LAYOUT_SET_EFFECT_AXES_ENABLE_X_BIT 96
+#define PID_LAYOUT_SET_EFFECT_AXES_ENABLE_X_SIZE 1
+#define PID_LAYOUT_SET_EFFECT_AXES_ENABLE_Y_BIT 97
+#define PID_LAYOUT_SET_EFFECT_AXES_ENABLE_Y_SIZE 1
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_ENABLE_BIT 98
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_ENABLE_SIZE 1
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_1_BIT 104
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_1_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_2_BIT 120
+#define PID_LAYOUT_SET_EFFECT_DIRECTION_2_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_TYPE_SPECIFIC_BLOCK_OFFSET_1_BIT 136
+#define PID_LAYOUT_SET_EFFECT_TYPE_SPECIFIC_BLOCK_OFFSET_1_SIZE 16
+#define PID_LAYOUT_SET_EFFECT_TYPE_SPECIFIC_BLOCK_OFFSET_2_BIT 152
+#define PID_LAYOUT_SET_EFFECT_TYPE_SPECIFIC_BLOCK_OFFSET_2_SIZE 16
+
+static inline void pid_layout_put_set_effect_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_effect_effect_type(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_effect_duration(unsigned char* buf, long value) {
+    buf[3] = (unsigned char)value;
+    buf[4] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_trigger_repeat_interval(unsigned char* buf, long value) {
+    buf[5] = (unsigned char)value;
+    buf[6] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_sample_period(unsigned char* buf, long value) {
+    buf[7] = (unsigned char)value;
+    buf[8] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_start_delay(unsigned char* buf, long value) {
+    buf[9] = (unsigned char)value;
+    buf[10] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_gain(unsigned char* buf, long value) {
+    buf[11] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_effect_trigger_button(unsigned char* buf, long value) {
+    buf[12] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_effect_axes_enable_x(unsigned char* buf, long value) {
+    buf[13] = (unsigned char)((buf[13] & 0xfe) | ((((unsigned long)value >> 0) << 0) & 0x01));
+}
+
+static inline void pid_layout_put_set_effect_axes_enable_y(unsigned char* buf, long value) {
+    buf[13] = (unsigned char)((buf[13] & 0xfd) | ((((unsigned long)value >> 0) << 1) & 0x02));
+}
+
+static inline void pid_layout_put_set_effect_direction_enable(unsigned char* buf, long value) {
+    buf[13] = (unsigned char)((buf[13] & 0xfb) | ((((unsigned long)value >> 0) << 2) & 0x04));
+}
+
+static inline void pid_layout_put_set_effect_direction_1(unsigned char* buf, long value) {
+    buf[14] = (unsigned char)value;
+    buf[15] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_direction_2(unsigned char* buf, long value) {
+    buf[16] = (unsigned char)value;
+    buf[17] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_type_specific_block_offset_1(unsigned char* buf, long value) {
+    buf[18] = (unsigned char)value;
+    buf[19] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_effect_type_specific_block_offset_2(unsigned char* buf, long value) {
+    buf[20] = (unsigned char)value;
+    buf[21] = (unsigned char)(value >> 8);
+}
+
+// SET_ENVELOPE_REPORT (output, ID 0x02)
+#define PID_LAYOUT_SET_ENVELOPE_LENGTH 14
+#define PID_LAYOUT_SET_ENVELOPE_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_ENVELOPE_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_ENVELOPE_ATTACK_LEVEL_BIT 8
+#define PID_LAYOUT_SET_ENVELOPE_ATTACK_LEVEL_SIZE 16
+#define PID_LAYOUT_SET_ENVELOPE_FADE_LEVEL_BIT 24
+#define PID_LAYOUT_SET_ENVELOPE_FADE_LEVEL_SIZE 16
+#define PID_LAYOUT_SET_ENVELOPE_ATTACK_TIME_BIT 40
+#define PID_LAYOUT_SET_ENVELOPE_ATTACK_TIME_SIZE 32
+#define PID_LAYOUT_SET_ENVELOPE_FADE_TIME_BIT 72
+#define PID_LAYOUT_SET_ENVELOPE_FADE_TIME_SIZE 32
+
+static inline void pid_layout_put_set_envelope_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_envelope_attack_level(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+    buf[3] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_envelope_fade_level(unsigned char* buf, long value) {
+    buf[4] = (unsigned char)value;
+    buf[5] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_envelope_attack_time(unsigned char* buf, long value) {
+    buf[6] = (unsigned char)value;
+    buf[7] = (unsigned char)(value >> 8);
+    buf[8] = (unsigned char)(value >> 16);
+    buf[9] = (unsigned char)(value >> 24);
+}
+
+static inline void pid_layout_put_set_envelope_fade_time(unsigned char* buf, long value) {
+    buf[10] = (unsigned char)value;
+    buf[11] = (unsigned char)(value >> 8);
+    buf[12] = (unsigned char)(value >> 16);
+    buf[13] = (unsigned char)(value >> 24);
+}
+
+// SET_CONDITION_REPORT (output, ID 0x03)
+#define PID_LAYOUT_SET_CONDITION_LENGTH 15
+#define PID_LAYOUT_SET_CONDITION_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_CONDITION_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_CONDITION_PARAMETER_BLOCK_OFFSET_BIT 8
+#define PID_LAYOUT_SET_CONDITION_PARAMETER_BLOCK_OFFSET_SIZE 4
+#define PID_LAYOUT_SET_CONDITION_TYPE_SPECIFIC_BLOCK_OFFSET_1_BIT 12
+#define PID_LAYOUT_SET_CONDITION_TYPE_SPECIFIC_BLOCK_OFFSET_1_SIZE 2
+#define PID_LAYOUT_SET_CONDITION_TYPE_SPECIFIC_BLOCK_OFFSET_2_BIT 14
+#define PID_LAYOUT_SET_CONDITION_TYPE_SPECIFIC_BLOCK_OFFSET_2_SIZE 2
+#define PID_LAYOUT_SET_CONDITION_CP_OFFSET_BIT 16
+#define PID_LAYOUT_SET_CONDITION_CP_OFFSET_SIZE 16
+#define PID_LAYOUT_SET_CONDITION_POSITIVE_COEFFICIENT_BIT 32
+#define PID_LAYOUT_SET_CONDITION_POSITIVE_COEFFICIENT_SIZE 16
+#define PID_LAYOUT_SET_CONDITION_NEGATIVE_COEFFICIENT_BIT 48
+#define PID_LAYOUT_SET_CONDITION_NEGATIVE_COEFFICIENT_SIZE 16
+#define PID_LAYOUT_SET_CONDITION_POSITIVE_SATURATION_BIT 64
+#define PID_LAYOUT_SET_CONDITION_POSITIVE_SATURATION_SIZE 16
+#define PID_LAYOUT_SET_CONDITION_NEGATIVE_SATURATION_BIT 80
+#define PID_LAYOUT_SET_CONDITION_NEGATIVE_SATURATION_SIZE 16
+#define PID_LAYOUT_SET_CONDITION_DEAD_BAND_BIT 96
+#define PID_LAYOUT_SET_CONDITION_DEAD_BAND_SIZE 16
+
+static inline void pid_layout_put_set_condition_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_condition_parameter_block_offset(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)((buf[2] & 0xf0) | ((((unsigned long)value >> 0) << 0) & 0x0f));
+}
+
+static inline void pid_layout_put_set_condition_type_specific_block_offset_1(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)((buf[2] & 0xcf) | ((((unsigned long)value >> 0) << 4) & 0x30));
+}
+
+static inline void pid_layout_put_set_condition_type_specific_block_offset_2(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)((buf[2] & 0x3f) | ((((unsigned long)value >> 0) << 6) & 0xc0));
+}
+
+static inline void pid_layout_put_set_condition_cp_offset(unsigned char* buf, long value) {
+    buf[3] = (unsigned char)value;
+    buf[4] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_condition_positive_coefficient(unsigned char* buf, long value) {
+    buf[5] = (unsigned char)value;
+    buf[6] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_condition_negative_coefficient(unsigned char* buf, long value) {
+    buf[7] = (unsigned char)value;
+    buf[8] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_condition_positive_saturation(unsigned char* buf, long value) {
+    buf[9] = (unsigned char)value;
+    buf[10] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_condition_negative_saturation(unsigned char* buf, long value) {
+    buf[11] = (unsigned char)value;
+    buf[12] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_condition_dead_band(unsigned char* buf, long value) {
+    buf[13] = (unsigned char)value;
+    buf[14] = (unsigned char)(value >> 8);
+}
+
+// SET_PERIODIC_REPORT (output, ID 0x04)
+#define PID_LAYOUT_SET_PERIODIC_LENGTH 12
+#define PID_LAYOUT_SET_PERIODIC_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_PERIODIC_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_PERIODIC_MAGNITUDE_BIT 8
+#define PID_LAYOUT_SET_PERIODIC_MAGNITUDE_SIZE 16
+#define PID_LAYOUT_SET_PERIODIC_OFFSET_BIT 24
+#define PID_LAYOUT_SET_PERIODIC_OFFSET_SIZE 16
+#define PID_LAYOUT_SET_PERIODIC_PHASE_BIT 40
+#define PID_LAYOUT_SET_PERIODIC_PHASE_SIZE 16
+#define PID_LAYOUT_SET_PERIODIC_PERIOD_BIT 56
+#define PID_LAYOUT_SET_PERIODIC_PERIOD_SIZE 32
+
+static inline void pid_layout_put_set_periodic_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_periodic_magnitude(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+    buf[3] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_periodic_offset(unsigned char* buf, long value) {
+    buf[4] = (unsigned char)value;
+    buf[5] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_periodic_phase(unsigned char* buf, long value) {
+    buf[6] = (unsigned char)value;
+    buf[7] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_periodic_period(unsigned char* buf, long value) {
+    buf[8] = (unsigned char)value;
+    buf[9] = (unsigned char)(value >> 8);
+    buf[10] = (unsigned char)(value >> 16);
+    buf[11] = (unsigned char)(value >> 24);
+}
+
+// SET_CONSTANT_FORCE_REPORT (output, ID 0x05)
+#define PID_LAYOUT_SET_CONSTANT_FORCE_LENGTH 4
+#define PID_LAYOUT_SET_CONSTANT_FORCE_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_CONSTANT_FORCE_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_CONSTANT_FORCE_MAGNITUDE_BIT 8
+#define PID_LAYOUT_SET_CONSTANT_FORCE_MAGNITUDE_SIZE 16
+
+static inline void pid_layout_put_set_constant_force_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_constant_force_magnitude(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+    buf[3] = (unsigned char)(value >> 8);
+}
+
+// SET_RAMP_FORCE_REPORT (output, ID 0x06)
+#define PID_LAYOUT_SET_RAMP_FORCE_LENGTH 6
+#define PID_LAYOUT_SET_RAMP_FORCE_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_SET_RAMP_FORCE_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_SET_RAMP_FORCE_RAMP_START_BIT 8
+#define PID_LAYOUT_SET_RAMP_FORCE_RAMP_START_SIZE 16
+#define PID_LAYOUT_SET_RAMP_FORCE_RAMP_END_BIT 24
+#define PID_LAYOUT_SET_RAMP_FORCE_RAMP_END_SIZE 16
+
+static inline void pid_layout_put_set_ramp_force_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_set_ramp_force_ramp_start(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+    buf[3] = (unsigned char)(value >> 8);
+}
+
+static inline void pid_layout_put_set_ramp_force_ramp_end(unsigned char* buf, long value) {
+    buf[4] = (unsigned char)value;
+    buf[5] = (unsigned char)(value >> 8);
+}
+
+// EFFECT_OPERATION_REPORT (output, ID 0x0a)
+#define PID_LAYOUT_EFFECT_OPERATION_LENGTH 4
+#define PID_LAYOUT_EFFECT_OPERATION_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_EFFECT_OPERATION_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_EFFECT_OPERATION_EFFECT_OPERATION_BIT 8
+#define PID_LAYOUT_EFFECT_OPERATION_EFFECT_OPERATION_SIZE 8
+#define PID_LAYOUT_EFFECT_OPERATION_LOOP_COUNT_BIT 16
+#define PID_LAYOUT_EFFECT_OPERATION_LOOP_COUNT_SIZE 8
+
+static inline void pid_layout_put_effect_operation_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_effect_operation_effect_operation(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+}
+
+static inline void pid_layout_put_effect_operation_loop_count(unsigned char* buf, long value) {
+    buf[3] = (unsigned char)value;
+}
+
+// PID_BLOCK_FREE_REPORT (output, ID 0x0b)
+#define PID_LAYOUT_PID_BLOCK_FREE_LENGTH 2
+#define PID_LAYOUT_PID_BLOCK_FREE_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_PID_BLOCK_FREE_EFFECT_BLOCK_INDEX_SIZE 8
+
+static inline void pid_layout_put_pid_block_free_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+// PID_DEVICE_CONTROL_REPORT (output, ID 0x0c)
+#define PID_LAYOUT_PID_DEVICE_CONTROL_LENGTH 2
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_ENABLE_ACTUATORS_BIT 0
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_ENABLE_ACTUATORS_SIZE 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DISABLE_ACTUATORS_BIT 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DISABLE_ACTUATORS_SIZE 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_STOP_ALL_EFFECTS_BIT 2
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_STOP_ALL_EFFECTS_SIZE 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_RESET_BIT 3
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_RESET_SIZE 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_PAUSE_BIT 4
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_PAUSE_SIZE 1
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_CONTINUE_BIT 5
+#define PID_LAYOUT_PID_DEVICE_CONTROL_DC_DEVICE_CONTINUE_SIZE 1
+
+static inline void pid_layout_put_pid_device_control_dc_enable_actuators(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xfe) | ((((unsigned long)value >> 0) << 0) & 0x01));
+}
+
+static inline void pid_layout_put_pid_device_control_dc_disable_actuators(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xfd) | ((((unsigned long)value >> 0) << 1) & 0x02));
+}
+
+static inline void pid_layout_put_pid_device_control_dc_stop_all_effects(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xfb) | ((((unsigned long)value >> 0) << 2) & 0x04));
+}
+
+static inline void pid_layout_put_pid_device_control_dc_device_reset(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xf7) | ((((unsigned long)value >> 0) << 3) & 0x08));
+}
+
+static inline void pid_layout_put_pid_device_control_dc_device_pause(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xef) | ((((unsigned long)value >> 0) << 4) & 0x10));
+}
+
+static inline void pid_layout_put_pid_device_control_dc_device_continue(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)((buf[1] & 0xdf) | ((((unsigned long)value >> 0) << 5) & 0x20));
+}
+
+// DEVICE_GAIN_REPORT (output, ID 0x0d)
+#define PID_LAYOUT_DEVICE_GAIN_LENGTH 2
+#define PID_LAYOUT_DEVICE_GAIN_DEVICE_GAIN_BIT 0
+#define PID_LAYOUT_DEVICE_GAIN_DEVICE_GAIN_SIZE 8
+
+static inline void pid_layout_put_device_gain_device_gain(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+// CREATE_NEW_EFFECT_REPORT (feature, ID 0x11)
+#define PID_LAYOUT_CREATE_NEW_EFFECT_LENGTH 4
+#define PID_LAYOUT_CREATE_NEW_EFFECT_EFFECT_TYPE_BIT 0
+#define PID_LAYOUT_CREATE_NEW_EFFECT_EFFECT_TYPE_SIZE 8
+#define PID_LAYOUT_CREATE_NEW_EFFECT_BYTE_COUNT_BIT 8
+#define PID_LAYOUT_CREATE_NEW_EFFECT_BYTE_COUNT_SIZE 10
+
+static inline void pid_layout_put_create_new_effect_effect_type(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline long pid_layout_get_create_new_effect_effect_type(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[1] >> 0) & 0xff) << 0;
+    return (long)value;
+}
+
+static inline void pid_layout_put_create_new_effect_byte_count(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+    buf[3] = (unsigned char)((buf[3] & 0xfc) | ((((unsigned long)value >> 8) << 0) & 0x03));
+}
+
+static inline long pid_layout_get_create_new_effect_byte_count(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 0) & 0xff) << 0;
+    value |= (unsigned long)((buf[3] >> 0) & 0x03) << 8;
+    return (long)value;
+}
+
+// PID_BLOCK_LOAD_REPORT (feature, ID 0x12)
+#define PID_LAYOUT_PID_BLOCK_LOAD_LENGTH 5
+#define PID_LAYOUT_PID_BLOCK_LOAD_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_PID_BLOCK_LOAD_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_PID_BLOCK_LOAD_BLOCK_LOAD_STATUS_BIT 8
+#define PID_LAYOUT_PID_BLOCK_LOAD_BLOCK_LOAD_STATUS_SIZE 8
+#define PID_LAYOUT_PID_BLOCK_LOAD_RAM_POOL_AVAILABLE_BIT 16
+#define PID_LAYOUT_PID_BLOCK_LOAD_RAM_POOL_AVAILABLE_SIZE 16
+
+static inline void pid_layout_put_pid_block_load_effect_block_index(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+}
+
+static inline long pid_layout_get_pid_block_load_effect_block_index(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[1] >> 0) & 0xff) << 0;
+    return (long)value;
+}
+
+static inline void pid_layout_put_pid_block_load_block_load_status(unsigned char* buf, long value) {
+    buf[2] = (unsigned char)value;
+}
+
+static inline long pid_layout_get_pid_block_load_block_load_status(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 0) & 0xff) << 0;
+    return (long)value;
+}
+
+static inline void pid_layout_put_pid_block_load_ram_pool_available(unsigned char* buf, long value) {
+    buf[3] = (unsigned char)value;
+    buf[4] = (unsigned char)(value >> 8);
+}
+
+static inline long pid_layout_get_pid_block_load_ram_pool_available(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[3] >> 0) & 0xff) << 0;
+    value |= (unsigned long)((buf[4] >> 0) & 0xff) << 8;
+    return (long)value;
+}
+
+// PID_POOL_REPORT (feature, ID 0x13)
+#define PID_LAYOUT_PID_POOL_LENGTH 5
+#define PID_LAYOUT_PID_POOL_RAM_POOL_SIZE_BIT 0
+#define PID_LAYOUT_PID_POOL_RAM_POOL_SIZE_SIZE 16
+#define PID_LAYOUT_PID_POOL_SIMULTANEOUS_EFFECTS_MAX_BIT 16
+#define PID_LAYOUT_PID_POOL_SIMULTANEOUS_EFFECTS_MAX_SIZE 8
+#define PID_LAYOUT_PID_POOL_DEVICE_MANAGED_POOL_BIT 24
+#define PID_LAYOUT_PID_POOL_DEVICE_MANAGED_POOL_SIZE 1
+#define PID_LAYOUT_PID_POOL_SHARED_PARAMETER_BLOCKS_BIT 25
+#define PID_LAYOUT_PID_POOL_SHARED_PARAMETER_BLOCKS_SIZE 1
+
+static inline void pid_layout_put_pid_pool_ram_pool_size(unsigned char* buf, long value) {
+    buf[1] = (unsigned char)value;
+    buf[2] = (unsigned char)(value >> 8);
+}
+
+static inline long pid_layout_get_pid_pool_ram_pool_size(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[1] >> 0) & 0xff) << 0;
+    value |= (unsigned long)((buf[2] >> 0) & 0xff) << 8;
+    return (long)value;
+}
+
+static inline void pid_layout_put_pid_pool_simultaneous_effects_max(unsigned char* buf, long value) {
+    buf[3] = (unsigned char)value;
+}
+
+static inline long pid_layout_get_pid_pool_simultaneous_effects_max(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[3] >> 0) & 0xff) << 0;
+    return (long)value;
+}
+
+static inline void pid_layout_put_pid_pool_device_managed_pool(unsigned char* buf, long value) {
+    buf[4] = (unsigned char)((buf[4] & 0xfe) | ((((unsigned long)value >> 0) << 0) & 0x01));
+}
+
+static inline long pid_layout_get_pid_pool_device_managed_pool(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[4] >> 0) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline void pid_layout_put_pid_pool_shared_parameter_blocks(unsigned char* buf, long value) {
+    buf[4] = (unsigned char)((buf[4] & 0xfd) | ((((unsigned long)value >> 0) << 1) & 0x02));
+}
+
+static inline long pid_layout_get_pid_pool_shared_parameter_blocks(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[4] >> 1) & 0x01) << 0;
+    return (long)value;
+}
+
+// PID_STATE_REPORT (input, ID 0x02)
+#define PID_LAYOUT_PID_STATE_LENGTH 3
+#define PID_LAYOUT_PID_STATE_EFFECT_BLOCK_INDEX_BIT 0
+#define PID_LAYOUT_PID_STATE_EFFECT_BLOCK_INDEX_SIZE 8
+#define PID_LAYOUT_PID_STATE_DEVICE_PAUSED_BIT 8
+#define PID_LAYOUT_PID_STATE_DEVICE_PAUSED_SIZE 1
+#define PID_LAYOUT_PID_STATE_ACTUATORS_ENABLED_BIT 9
+#define PID_LAYOUT_PID_STATE_ACTUATORS_ENABLED_SIZE 1
+#define PID_LAYOUT_PID_STATE_SAFETY_SWITCH_BIT 10
+#define PID_LAYOUT_PID_STATE_SAFETY_SWITCH_SIZE 1
+#define PID_LAYOUT_PID_STATE_ACTUATOR_POWER_BIT 11
+#define PID_LAYOUT_PID_STATE_ACTUATOR_POWER_SIZE 1
+#define PID_LAYOUT_PID_STATE_EFFECT_PLAYING_BIT 12
+#define PID_LAYOUT_PID_STATE_EFFECT_PLAYING_SIZE 1
+
+static inline long pid_layout_get_pid_state_effect_block_index(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[1] >> 0) & 0xff) << 0;
+    return (long)value;
+}
+
+static inline long pid_layout_get_pid_state_device_paused(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 0) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline long pid_layout_get_pid_state_actuators_enabled(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 1) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline long pid_layout_get_pid_state_safety_switch(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 2) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline long pid_layout_get_pid_state_actuator_power(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 3) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline long pid_layout_get_pid_state_effect_playing(const unsigned char* buf) {
+    unsigned long value = 0;
+
+    value |= (unsigned long)((buf[2] >> 4) & 0x01) << 0;
+    return (long)value;
+}
+
+static inline int pid_layout_matches(const pid_codec* codec) {
+    static const pid_layout_check checks[] = {
+        { 1, 0x01, 0, 0, 22, 0 },
+        { 1, 0x01, 0x000f0022, 0x000f0021, 0, 8 },
+        { 1, 0x01, 0x000f0025, 0x000f0025, 8, 8 },
+        { 1, 0x01, 0x000f0050, 0x000f0021, 16, 16 },
+        { 1, 0x01, 0x000f0054, 0x000f0021, 32, 16 },
+        { 1, 0x01, 0x000f0051, 0x000f0021, 48, 16 },
+        { 1, 0x01, 0x000f00a7, 0x000f0021, 64, 16 },
+        { 1, 0x01, 0x000f0052, 0x000f0021, 80, 8 },
+        { 1, 0x01, 0x000f0053, 0x000f0021, 88, 8 },
+        { 1, 0x01, 0x00010030, 0x000f0055, 96, 1 },
+        { 1, 0x01, 0x00010031, 0x000f0055, 97, 1 },
+        { 1, 0x01, 0x000f0056, 0x000f0021, 98, 1 },
+        { 1, 0x01, 0x000a0001, 0x000f0057, 104, 16 },
+        { 1, 0x01, 0x000a0002, 0x000f0057, 120, 16 },
+        { 1, 0x01, 0x000a0001, 0x000f0058, 136, 16 },
+        { 1, 0x01, 0x000a0002, 0x000f0058, 152, 16 },
+        { 1, 0x02, 0, 0, 14, 0 },
+        { 1, 0x02, 0x000f0022, 0x000f005a, 0, 8 },
+        { 1, 0x02, 0x000f005b, 0x000f005a, 8, 16 },
+        { 1, 0x02, 0x000f005d, 0x000f005a, 24, 16 },
+        { 1, 0x02, 0x000f005c, 0x000f005a, 40, 32 },
+        { 1, 0x02, 0x000f005e, 0x000f005a, 72, 32 },
+        { 1, 0x03, 0, 0, 15, 0 },
+        { 1, 0x03, 0x000f0022, 0x000f005f, 0, 8 },
+        { 1, 0x03, 0x000f0023, 0x000f005f, 8, 4 },
+        { 1, 0x03, 0x000a0001, 0x000f0058, 12, 2 },
+        { 1, 0x03, 0x000a0002, 0x000f0058, 14, 2 },
+        { 1, 0x03, 0x000f0060, 0x000f005f, 16, 16 },
+        { 1, 0x03, 0x000f0061, 0x000f005f, 32, 16 },
+        { 1, 0x03, 0x000f0062, 0x000f005f, 48, 16 },
+        { 1, 0x03, 0x000f0063, 0x000f005f, 64, 16 },
+        { 1, 0x03, 0x000f0064, 0x000f005f, 80, 16 },
+        { 1, 0x03, 0x000f0065, 0x000f005f, 96, 16 },
+        { 1, 0x04, 0, 0, 12, 0 },
+        { 1, 0x04, 0x000f0022, 0x000f006e, 0, 8 },
+        { 1, 0x04, 0x000f0070, 0x000f006e, 8, 16 },
+        { 1, 0x04, 0x000f006f, 0x000f006e, 24, 16 },
+        { 1, 0x04, 0x000f0071, 0x000f006e, 40, 16 },
+        { 1, 0x04, 0x000f0072, 0x000f006e, 56, 32 },
+        { 1, 0x05, 0, 0, 4, 0 },
+        { 1, 0x05, 0x000f0022, 0x000f0073, 0, 8 },
+        { 1, 0x05, 0x000f0070, 0x000f0073, 8, 16 },
+        { 1, 0x06, 0, 0, 6, 0 },
+        { 1, 0x06, 0x000f0022, 0x000f0074, 0, 8 },
+        { 1, 0x06, 0x000f0075, 0x000f0074, 8, 16 },
+        { 1, 0x06, 0x000f0076, 0x000f0074, 24, 16 },
+        { 1, 0x0a, 0, 0, 4, 0 },
+        { 1, 0x0a, 0x000f0022, 0x000f0077, 0, 8 },
+        { 1, 0x0a, 0x000f0078, 0x000f0078, 8, 8 },
+        { 1, 0x0a, 0x000f007c, 0x000f0077, 16, 8 },
+        { 1, 0x0b, 0, 0, 2, 0 },
+        { 1, 0x0b, 0x000f0022, 0x000f0090, 0, 8 },
+        { 1, 0x0c, 0, 0, 2, 0 },
+        { 1, 0x0c, 0x000f0097, 0x000f0096, 0, 1 },
+        { 1, 0x0c, 0x000f0098, 0x000f0096, 1, 1 },
+        { 1, 0x0c, 0x000f0099, 0x000f0096, 2, 1 },
+        { 1, 0x0c, 0x000f009a, 0x000f0096, 3, 1 },
+        { 1, 0x0c, 0x000f009b, 0x000f0096, 4, 1 },
+        { 1, 0x0c, 0x000f009c, 0x000f0096, 5, 1 },
+        { 1, 0x0d, 0, 0, 2, 0 },
+        { 1, 0x0d, 0x000f007e, 0x000f007d, 0, 8 },
+        { 2, 0x11, 0, 0, 4, 0 },
+        { 2, 0x11, 0x000f0025, 0x000f0025, 0, 8 },
+        { 2, 0x11, 0x0001003b, 0x000f00ab, 8, 10 },
+        { 2, 0x12, 0, 0, 5, 0 },
+        { 2, 0x12, 0x000f0022, 0x000f0089, 0, 8 },
+        { 2, 0x12, 0x000f008b, 0x000f008b, 8, 8 },
+        { 2, 0x12, 0x000f00ac, 0x000f0089, 16, 16 },
+        { 2, 0x13, 0, 0, 5, 0 },
+        { 2, 0x13, 0x000f0080, 0x000f007f, 0, 16 },
+        { 2, 0x13, 0x000f0083, 0x000f007f, 16, 8 },
+        { 2, 0x13, 0x000f00a9, 0x000f007f, 24, 1 },
+        { 2, 0x13, 0x000f00aa, 0x000f007f, 25, 1 },
+        { 0, 0x02, 0, 0, 3, 0 },
+        { 0, 0x02, 0x000f0022, 0x000f0092, 0, 8 },
+        { 0, 0x02, 0x000f009f, 0x000f0092, 8, 1 },
+        { 0, 0x02, 0x000f00a0, 0x000f0092, 9, 1 },
+        { 0, 0x02, 0x000f00a4, 0x000f0092, 10, 1 },
+        { 0, 0x02, 0x000f00a6, 0x000f0092, 11, 1 },
+        { 0, 0x02, 0x000f0094, 0x000f0092, 12, 1 },
+    };
+
+    return pid_codec_matches(codec, checks, (int)(sizeof(checks) / sizeof(checks[0])));
+}
+
+#endif // PID_LAYOUT_H__
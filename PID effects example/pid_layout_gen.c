@@ -0,0 +1,325 @@
+#include "pid_layout_gen.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pid_reports.h"
+
+typedef struct layout_name {
+    unsigned long id;
+    const char* name;
+} layout_name;
+
+// Reports of pid_reports.h that get encoders / decoders
+typedef struct layout_report {
+    int kind;
+    unsigned char report_id;
+    const char* name;
+} layout_report;
+
+static const layout_report layout_reports[] = {
+    { PID_REPORT_OUTPUT, SET_EFFECT_REPORT_ID, "SET_EFFECT" },
+    { PID_REPORT_OUTPUT, SET_ENVELOPE_REPORT_ID, "SET_ENVELOPE" },
+    { PID_REPORT_OUTPUT, SET_CONDITION_REPORT_ID, "SET_CONDITION" },
+    { PID_REPORT_OUTPUT, SET_PERIODIC_REPORT_ID, "SET_PERIODIC" },
+    { PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID, "SET_CONSTANT_FORCE" },
+    { PID_REPORT_OUTPUT, SET_RAMP_FORCE_REPORT_ID, "SET_RAMP_FORCE" },
+    { PID_REPORT_OUTPUT, EFFECT_OPERATION_REPORT_ID, "EFFECT_OPERATION" },
+    { PID_REPORT_OUTPUT, PID_BLOCK_FREE_REPORT_ID, "PID_BLOCK_FREE" },
+    { PID_REPORT_OUTPUT, PID_DEVICE_CONTROL_REPORT_ID, "PID_DEVICE_CONTROL" },
+    { PID_REPORT_OUTPUT, DEVICE_GAIN_REPORT_ID, "DEVICE_GAIN" },
+    { PID_REPORT_FEATURE, CREATE_NEW_EFFECT_REPORT_ID, "CREATE_NEW_EFFECT" },
+    { PID_REPORT_FEATURE, PID_BLOCK_LOAD_REPORT_ID, "PID_BLOCK_LOAD" },
+    { PID_REPORT_FEATURE, PID_POOL_REPORT_ID, "PID_POOL" },
+    { PID_REPORT_INPUT, PID_STATE_REPORT_ID, "PID_STATE" },
+};
+
+// Usages of the PID page (see the PID usage tables)
+static const layout_name pid_usage_names[] = {
+    { 0x22, "EFFECT_BLOCK_INDEX" },
+    { 0x23, "PARAMETER_BLOCK_OFFSET" },
+    { 0x25, "EFFECT_TYPE" },
+    { 0x50, "DURATION" },
+    { 0x51, "SAMPLE_PERIOD" },
+    { 0x52, "GAIN" },
+    { 0x53, "TRIGGER_BUTTON" },
+    { 0x54, "TRIGGER_REPEAT_INTERVAL" },
+    { 0x55, "AXES_ENABLE" },
+    { 0x56, "DIRECTION_ENABLE" },
+    { 0x57, "DIRECTION" },
+    { 0x58, "TYPE_SPECIFIC_BLOCK_OFFSET" },
+    { 0x5b, "ATTACK_LEVEL" },
+    { 0x5c, "ATTACK_TIME" },
+    { 0x5d, "FADE_LEVEL" },
+    { 0x5e, "FADE_TIME" },
+    { 0x60, "CP_OFFSET" },
+    { 0x61, "POSITIVE_COEFFICIENT" },
+    { 0x62, "NEGATIVE_COEFFICIENT" },
+    { 0x63, "POSITIVE_SATURATION" },
+    { 0x64, "NEGATIVE_SATURATION" },
+    { 0x65, "DEAD_BAND" },
+    { 0x6f, "OFFSET" },
+    { 0x70, "MAGNITUDE" },
+    { 0x71, "PHASE" },
+    { 0x72, "PERIOD" },
+    { 0x75, "RAMP_START" },
+    { 0x76, "RAMP_END" },
+    { 0x78, "EFFECT_OPERATION" },
+    { 0x7c, "LOOP_COUNT" },
+    { 0x7e, "DEVICE_GAIN" },
+    { 0x80, "RAM_POOL_SIZE" },
+    { 0x83, "SIMULTANEOUS_EFFECTS_MAX" },
+    { 0x8b, "BLOCK_LOAD_STATUS" },
+    { 0x94, "EFFECT_PLAYING" },
+    { 0x96, "DEVICE_CONTROL" },
+    { 0x97, "DC_ENABLE_ACTUATORS" },
+    { 0x98, "DC_DISABLE_ACTUATORS" },
+    { 0x99, "DC_STOP_ALL_EFFECTS" },
+    { 0x9a, "DC_DEVICE_RESET" },
+    { 0x9b, "DC_DEVICE_PAUSE" },
+    { 0x9c, "DC_DEVICE_CONTINUE" },
+    { 0x9f, "DEVICE_PAUSED" },
+    { 0xa0, "ACTUATORS_ENABLED" },
+    { 0xa4, "SAFETY_SWITCH" },
+    { 0xa6, "ACTUATOR_POWER" },
+    { 0xa7, "START_DELAY" },
+    { 0xa9, "DEVICE_MANAGED_POOL" },
+    { 0xaa, "SHARED_PARAMETER_BLOCKS" },
+    { 0xac, "RAM_POOL_AVAILABLE" },
+};
+
+static const char* pid_usage_name(unsigned long usage) {
+    size_t i;
+
+    if ((usage >> 16) != PID_PAGE_PID)
+        return NULL;
+    for (i = 0; i < sizeof(pid_usage_names) / sizeof(pid_usage_names[0]); i++) {
+        if (pid_usage_names[i].id == (usage & 0xffff))
+            return pid_usage_names[i].name;
+    }
+    return NULL;
+}
+
+// Name of a field, e.g. MAGNITUDE, DIRECTION_1 or AXES_ENABLE_X
+static void layout_field_name(const pid_field* field, char* name, size_t size) {
+    const char* usage = pid_usage_name(field->usage);
+    const char* parent = pid_usage_name(field->parent_usage);
+    unsigned long page = field->usage >> 16;
+    unsigned long id = field->usage & 0xffff;
+
+    if (usage)
+        snprintf(name, size, "%s", usage);
+    else if (page == PID_PAGE_ORDINAL && parent)
+        snprintf(name, size, "%s_%lu", parent, id);
+    else if (page == PID_PAGE_GENERIC_DESKTOP && id == 0x30 && parent)
+        snprintf(name, size, "%s_X", parent);
+    else if (page == PID_PAGE_GENERIC_DESKTOP && id == 0x31 && parent)
+        snprintf(name, size, "%s_Y", parent);
+    else if (page == PID_PAGE_GENERIC_DESKTOP && id == 0x3b)
+        snprintf(name, size, "BYTE_COUNT");
+    else
+        snprintf(name, size, "USAGE_%04lx_%04lx", page, id);
+}
+
+// Fields that repeat the last usage of their main item (e.g. the two
+// padding bits of PID Device Control) are only generated once
+static int layout_skip(const pid_codec* codec, int index, const layout_report* report) {
+    const pid_field* field = &codec->fields[index];
+    int i;
+
+    if (field->kind != report->kind || field->report_id != report->report_id || field->bit_size > 32)
+        return 1;
+
+    for (i = 0; i < index; i++) {
+        if (codec->fields[i].kind == field->kind && codec->fields[i].report_id == field->report_id
+            && codec->fields[i].usage == field->usage && codec->fields[i].parent_usage == field->parent_usage)
+            return 1;
+    }
+    return 0;
+}
+
+static void layout_lower(char* dst, const char* src, size_t size) {
+    size_t i;
+
+    for (i = 0; i + 1 < size && src[i]; i++)
+        dst[i] = (char)tolower((unsigned char)src[i]);
+    dst[i] = '\0';
+}
+
+// Emits one store per byte touched by the field, offsets are constants
+static void layout_put(FILE* out, const char* report, const char* field_name, const pid_field* field) {
+    char lower[128];
+    unsigned int i = 0;
+    unsigned int bit, byte, shift, n, mask;
+
+    layout_lower(lower, report, sizeof(lower));
+    fprintf(out, "static inline void pid_layout_put_%s_", lower);
+    layout_lower(lower, field_name, sizeof(lower));
+    fprintf(out, "%s(unsigned char* buf, long value) {\n", lower);
+
+    while (i < field->bit_size) {
+        bit = field->bit_offset + i;
+        byte = 1 + (bit >> 3);
+        shift = bit & 7;
+        n = 8 - shift;
+        if (n > field->bit_size - i)
+            n = field->bit_size - i;
+        mask = ((1u << n) - 1) << shift;
+
+        if (n == 8 && i == 0)
+            fprintf(out, "    buf[%u] = (unsigned char)value;\n", byte);
+        else if (n == 8)
+            fprintf(out, "    buf[%u] = (unsigned char)(value >> %u);\n", byte, i);
+        else
+            fprintf(out, "    buf[%u] = (unsigned char)((buf[%u] & 0x%02x) | ((((unsigned long)value >> %u) << %u) & 0x%02x));\n",
+                    byte, byte, ~mask & 0xff, i, shift, mask);
+        i += n;
+    }
+
+    fprintf(out, "}\n\n");
+}
+
+static void layout_get(FILE* out, const char* report, const char* field_name, const pid_field* field) {
+    char lower[128];
+    unsigned int i = 0;
+    unsigned int bit, byte, shift, n;
+
+    layout_lower(lower, report, sizeof(lower));
+    fprintf(out, "static inline long pid_layout_get_%s_", lower);
+    layout_lower(lower, field_name, sizeof(lower));
+    fprintf(out, "%s(const unsigned char* buf) {\n", lower);
+    fprintf(out, "    unsigned long value = 0;\n\n");
+
+    while (i < field->bit_size) {
+        bit = field->bit_offset + i;
+        byte = 1 + (bit >> 3);
+        shift = bit & 7;
+        n = 8 - shift;
+        if (n > field->bit_size - i)
+            n = field->bit_size - i;
+
+        fprintf(out, "    value |= (unsigned long)((buf[%u] >> %u) & 0x%02x) << %u;\n", byte, shift, (1u << n) - 1, i);
+        i += n;
+    }
+
+    if (field->logical_min < 0 && field->bit_size == 8)
+        fprintf(out, "    return (long)(signed char)value;\n");
+    else if (field->logical_min < 0 && field->bit_size == 16)
+        fprintf(out, "    return (long)(short)value;\n");
+    else if (field->logical_min < 0 && field->bit_size < 32)
+        fprintf(out, "    return (value & 0x%lxul) ? (long)(value | 0x%lxul) : (long)value;\n",
+                1ul << (field->bit_size - 1), (0xfffffffful << field->bit_size) & 0xfffffffful);
+    else
+        fprintf(out, "    return (long)value;\n");
+
+    fprintf(out, "}\n\n");
+}
+
+int pid_layout_load_text(const char* path, unsigned char* descriptor, size_t size) {
+    FILE* in = fopen(path, "r");
+    char line[512];
+    char* p;
+    char* comment;
+    size_t count = 0;
+
+    if (!in)
+        return -1;
+
+    while (fgets(line, sizeof(line), in)) {
+        comment = strstr(line, "//");
+        if (comment)
+            *comment = '\0';
+
+        for (p = line; p[0] != '\0'; p++) {
+            if (p[0] != '0' || (p[1] != 'x' && p[1] != 'X'))
+                continue;
+            if (!isxdigit((unsigned char)p[2]) || !isxdigit((unsigned char)p[3]))
+                continue;
+            if (count >= size) {
+                fclose(in);
+                return -1;
+            }
+            descriptor[count++] = (unsigned char)strtoul(p + 2, NULL, 16);
+            p += 3;
+        }
+    }
+
+    fclose(in);
+    return (int)count;
+}
+
+int pid_layout_generate(const pid_codec* codec, FILE* out) {
+    char name[128];
+    size_t r;
+    int i;
+    size_t length;
+    const layout_report* report;
+    const pid_field* field;
+
+    fprintf(out, "// Generated by pid_layout_gen.c from the report descriptor, do not edit.\n");
+    fprintf(out, "// Fixed-layout encoders and decoders of the PID reports: every offset is a constant.\n");
+    fprintf(out, "// Offsets and sizes are in bits, from the first byte after the report ID.\n");
+    fprintf(out, "// Use them only when pid_layout_matches() returns 1 for the device.\n\n");
+    fprintf(out, "#ifndef PID_LAYOUT_H__\n#define PID_LAYOUT_H__\n\n");
+    fprintf(out, "#include \"pid_codec.h\"\n\n");
+
+    for (r = 0; r < sizeof(layout_reports) / sizeof(layout_reports[0]); r++) {
+        report = &layout_reports[r];
+        length = pid_codec_report_length(codec, report->kind, report->report_id);
+        if (length == 0)
+            continue;
+
+        fprintf(out, "// %s_REPORT (%s, ID 0x%02x)\n", report->name,
+                report->kind == PID_REPORT_OUTPUT ? "output" : report->kind == PID_REPORT_FEATURE ? "feature" : "input",
+                report->report_id);
+        fprintf(out, "#define PID_LAYOUT_%s_LENGTH %u\n", report->name, (unsigned int)length);
+
+        for (i = 0; i < codec->field_count; i++) {
+            field = &codec->fields[i];
+            if (layout_skip(codec, i, report))
+                continue;
+            layout_field_name(field, name, sizeof(name));
+            fprintf(out, "#define PID_LAYOUT_%s_%s_BIT %u\n", report->name, name, field->bit_offset);
+            fprintf(out, "#define PID_LAYOUT_%s_%s_SIZE %u\n", report->name, name, field->bit_size);
+        }
+        fprintf(out, "\n");
+
+        for (i = 0; i < codec->field_count; i++) {
+            field = &codec->fields[i];
+            if (layout_skip(codec, i, report))
+                continue;
+            layout_field_name(field, name, sizeof(name));
+            if (report->kind != PID_REPORT_INPUT)
+                layout_put(out, report->name, name, field);
+            if (report->kind != PID_REPORT_OUTPUT)
+                layout_get(out, report->name, name, field);
+        }
+    }
+
+    // Checked against the descriptor of the device at runtime
+    fprintf(out, "static inline int pid_layout_matches(const pid_codec* codec) {\n");
+    fprintf(out, "    static const pid_layout_check checks[] = {\n");
+    for (r = 0; r < sizeof(layout_reports) / sizeof(layout_reports[0]); r++) {
+        report = &layout_reports[r];
+        length = pid_codec_report_length(codec, report->kind, report->report_id);
+        if (length == 0)
+            continue;
+
+        fprintf(out, "        { %d, 0x%02x, 0, 0, %u, 0 },\n", report->kind, report->report_id, (unsigned int)length);
+        for (i = 0; i < codec->field_count; i++) {
+            field = &codec->fields[i];
+            if (layout_skip(codec, i, report))
+                continue;
+            fprintf(out, "        { %d, 0x%02x, 0x%08lx, 0x%08lx, %u, %u },\n", report->kind, report->report_id,
+                    field->usage, field->parent_usage, field->bit_offset, field->bit_size);
+        }
+    }
+    fprintf(out, "    };\n\n");
+    fprintf(out, "    return pid_codec_matches(codec, checks, (int)(sizeof(checks) / sizeof(checks[0])));\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "#endif // PID_LAYOUT_H__\n");
+
+    return ferror(out) ? -1 : 0;
+}
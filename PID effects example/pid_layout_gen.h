@@ -0,0 +1,25 @@
+// Generator of pid_layout.h
+// Turns a report descriptor into fixed-layout encoders and decoders,
+// every offset being a constant, for the reports streamed at high rate.
+//
+// Run the example with
+//      --gen-layout report_descriptor.txt pid_layout.h
+// whenever the descriptor of the device changes.
+
+#ifndef PID_LAYOUT_GEN_H__
+#define PID_LAYOUT_GEN_H__
+
+#include <stdio.h>
+
+#include "pid_codec.h"
+
+// Reads the bytes of a descriptor dumped as text, one item per line
+// with a "// comment" after the bytes (as in report_descriptor.txt).
+// Returns the number of bytes read, or -1 on error.
+int pid_layout_load_text(const char* path, unsigned char* descriptor, size_t size);
+
+// Writes pid_layout.h for the PID reports of codec.
+// Returns 0 on success
+int pid_layout_generate(const pid_codec* codec, FILE* out);
+
+#endif // PID_LAYOUT_GEN_H__
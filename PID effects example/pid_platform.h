@@ -0,0 +1,363 @@
+// Small platform layer shared by the force feedback modules.
+// Everything here is header only so it inlines into the writer loop.
+
+#ifndef PID_PLATFORM_H__
+#define PID_PLATFORM_H__
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+#include <stdlib.h>
+
+// 32 bit value shared between threads.
+// Only ever touch it through the pid_atomic_* helpers below.
+typedef volatile long pid_atomic_t;
+
+#ifdef _WIN32
+
+static inline long pid_atomic_load(pid_atomic_t* a) {
+    return InterlockedCompareExchange(a, 0, 0);
+}
+
+static inline void pid_atomic_store(pid_atomic_t* a, long v) {
+    InterlockedExchange(a, v);
+}
+
+static inline long pid_atomic_exchange(pid_atomic_t* a, long v) {
+    return InterlockedExchange(a, v);
+}
+
+// Returns 1 if *a was equal to expected and has been replaced by desired.
+static inline int pid_atomic_cas(pid_atomic_t* a, long expected, long desired) {
+    return InterlockedCompareExchange(a, desired, expected) == expected;
+}
+
+static inline long pid_atomic_add(pid_atomic_t* a, long v) {
+    return InterlockedExchangeAdd(a, v) + v;
+}
+
+static inline void pid_sleep_ms(unsigned int ms) {
+    Sleep(ms);
+}
+
+// Hint in the body of a busy wait
+static inline void pid_cpu_relax(void) {
+    YieldProcessor();
+}
+
+// Monotonic clock in microseconds
+static inline long long pid_time_us(void) {
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (long long)(now.QuadPart / frequency.QuadPart) * 1000000
+        + (long long)(now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
+typedef HANDLE pid_thread_t;
+typedef CRITICAL_SECTION pid_mutex_t;
+typedef HANDLE pid_event_t; // Auto reset event
+
+typedef struct pid_thread_start_args {
+    void (*fn)(void*);
+    void* arg;
+} pid_thread_start_args;
+
+static inline DWORD WINAPI pid_thread_trampoline(LPVOID param) {
+    pid_thread_start_args args = *(pid_thread_start_args*)param;
+
+    HeapFree(GetProcessHeap(), 0, param);
+    args.fn(args.arg);
+    return 0;
+}
+
+// Returns 0 on success
+static inline int pid_thread_start(pid_thread_t* thread, void (*fn)(void*), void* arg) {
+    pid_thread_start_args* args = (pid_thread_start_args*)HeapAlloc(GetProcessHeap(), 0, sizeof(*args));
+
+    if (!args)
+        return -1;
+    args->fn = fn;
+    args->arg = arg;
+    *thread = CreateThread(NULL, 0, pid_thread_trampoline, args, 0, NULL);
+    if (!*thread) {
+        HeapFree(GetProcessHeap(), 0, args);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void pid_thread_join(pid_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+// Raises the priority of the calling thread, used by the writer loop
+static inline void pid_thread_set_realtime(void) {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+}
+
+static inline void pid_mutex_init(pid_mutex_t* m) { InitializeCriticalSection(m); }
+static inline void pid_mutex_destroy(pid_mutex_t* m) { DeleteCriticalSection(m); }
+static inline void pid_mutex_lock(pid_mutex_t* m) { EnterCriticalSection(m); }
+static inline void pid_mutex_unlock(pid_mutex_t* m) { LeaveCriticalSection(m); }
+
+static inline int pid_event_init(pid_event_t* e) {
+    *e = CreateEvent(NULL, FALSE, FALSE, NULL);
+    return *e ? 0 : -1;
+}
+
+static inline void pid_event_destroy(pid_event_t* e) { CloseHandle(*e); }
+static inline void pid_event_signal(pid_event_t* e) { SetEvent(*e); }
+
+// Waits until the event is signaled or timeout_ms elapsed
+static inline void pid_event_wait(pid_event_t* e, unsigned int timeout_ms) {
+    WaitForSingleObject(*e, timeout_ms);
+}
+
+// Shared libraries, for the effect plugins
+typedef HMODULE pid_library_t;
+
+static inline pid_library_t pid_library_open(const char* path) { return LoadLibraryA(path); }
+static inline void pid_library_close(pid_library_t lib) { FreeLibrary(lib); }
+
+static inline void* pid_library_symbol(pid_library_t lib, const char* name) {
+    return (void*)GetProcAddress(lib, name);
+}
+
+// Read only mapping of a whole file
+typedef struct pid_file_map {
+    HANDLE file;
+    HANDLE mapping;
+    const void* data;
+    size_t size;
+} pid_file_map;
+
+// Returns 0 on success, -1 if the file cannot be mapped or is empty
+static inline int pid_file_map_open(pid_file_map* map, const char* path) {
+    LARGE_INTEGER size;
+
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE)
+        return -1;
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0) {
+        CloseHandle(map->file);
+        return -1;
+    }
+
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    map->data = map->mapping ? MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!map->data) {
+        if (map->mapping)
+            CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return -1;
+    }
+    map->size = (size_t)size.QuadPart;
+    return 0;
+}
+
+static inline void pid_file_map_close(pid_file_map* map) {
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+}
+
+#else
+
+static inline long pid_atomic_load(pid_atomic_t* a) {
+    return __atomic_load_n(a, __ATOMIC_SEQ_CST);
+}
+
+static inline void pid_atomic_store(pid_atomic_t* a, long v) {
+    __atomic_store_n(a, v, __ATOMIC_SEQ_CST);
+}
+
+static inline long pid_atomic_exchange(pid_atomic_t* a, long v) {
+    return __atomic_exchange_n(a, v, __ATOMIC_SEQ_CST);
+}
+
+static inline int pid_atomic_cas(pid_atomic_t* a, long expected, long desired) {
+    return __atomic_compare_exchange_n(a, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline long pid_atomic_add(pid_atomic_t* a, long v) {
+    return __atomic_add_fetch(a, v, __ATOMIC_SEQ_CST);
+}
+
+static inline void pid_sleep_ms(unsigned int ms) {
+    usleep(ms * 1000);
+}
+
+static inline void pid_cpu_relax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#else
+    sched_yield();
+#endif
+}
+
+static inline long long pid_time_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+typedef pthread_t pid_thread_t;
+typedef pthread_mutex_t pid_mutex_t;
+
+typedef struct pid_event_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int signaled;
+} pid_event_t;
+
+typedef struct pid_thread_start_args {
+    void (*fn)(void*);
+    void* arg;
+} pid_thread_start_args;
+
+static inline void* pid_thread_trampoline(void* param) {
+    pid_thread_start_args args = *(pid_thread_start_args*)param;
+
+    free(param);
+    args.fn(args.arg);
+    return NULL;
+}
+
+static inline int pid_thread_start(pid_thread_t* thread, void (*fn)(void*), void* arg) {
+    pid_thread_start_args* args = (pid_thread_start_args*)malloc(sizeof(*args));
+
+    if (!args)
+        return -1;
+    args->fn = fn;
+    args->arg = arg;
+    if (pthread_create(thread, NULL, pid_thread_trampoline, args) != 0) {
+        free(args);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void pid_thread_join(pid_thread_t thread) {
+    pthread_join(thread, NULL);
+}
+
+static inline void pid_thread_set_realtime(void) {
+    struct sched_param param;
+
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    // Needs privileges, the loop still works at normal priority
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+static inline void pid_mutex_init(pid_mutex_t* m) { pthread_mutex_init(m, NULL); }
+static inline void pid_mutex_destroy(pid_mutex_t* m) { pthread_mutex_destroy(m); }
+static inline void pid_mutex_lock(pid_mutex_t* m) { pthread_mutex_lock(m); }
+static inline void pid_mutex_unlock(pid_mutex_t* m) { pthread_mutex_unlock(m); }
+
+static inline int pid_event_init(pid_event_t* e) {
+    pthread_condattr_t attr;
+
+    e->signaled = 0;
+    if (pthread_mutex_init(&e->lock, NULL) != 0)
+        return -1;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_cond_init(&e->cond, &attr) != 0) {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&e->lock);
+        return -1;
+    }
+    pthread_condattr_destroy(&attr);
+    return 0;
+}
+
+static inline void pid_event_destroy(pid_event_t* e) {
+    pthread_cond_destroy(&e->cond);
+    pthread_mutex_destroy(&e->lock);
+}
+
+static inline void pid_event_signal(pid_event_t* e) {
+    pthread_mutex_lock(&e->lock);
+    e->signaled = 1;
+    pthread_cond_signal(&e->cond);
+    pthread_mutex_unlock(&e->lock);
+}
+
+static inline void pid_event_wait(pid_event_t* e, unsigned int timeout_ms) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    while (!e->signaled) {
+        if (pthread_cond_timedwait(&e->cond, &e->lock, &ts) == ETIMEDOUT)
+            break;
+    }
+    e->signaled = 0;
+    pthread_mutex_unlock(&e->lock);
+}
+
+typedef void* pid_library_t;
+
+static inline pid_library_t pid_library_open(const char* path) { return dlopen(path, RTLD_NOW | RTLD_LOCAL); }
+static inline void pid_library_close(pid_library_t lib) { dlclose(lib); }
+static inline void* pid_library_symbol(pid_library_t lib, const char* name) { return dlsym(lib, name); }
+
+typedef struct pid_file_map {
+    const void* data;
+    size_t size;
+} pid_file_map;
+
+static inline int pid_file_map_open(pid_file_map* map, const char* path) {
+    struct stat info;
+    void* data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+
+    // The mapping keeps the file alive
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+
+    map->data = data;
+    map->size = (size_t)info.st_size;
+    return 0;
+}
+
+static inline void pid_file_map_close(pid_file_map* map) {
+    munmap((void*)map->data, map->size);
+}
+
+#endif
+
+#endif // PID_PLATFORM_H__
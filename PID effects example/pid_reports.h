@@ -0,0 +1,98 @@
+// Report IDs and bit fields of the PID device
+// taken from report_descriptor.txt.
+// Note that the report IDs are not the sames depending on the device
+// And also note that the parameters are not the sames depending on the device
+
+#ifndef PID_REPORTS_H__
+#define PID_REPORTS_H__
+
+enum REPORT_ID {
+    PID_POOL_REPORT_ID = 0x13,
+    PID_DEVICE_CONTROL_REPORT_ID = 0x0c,
+    DEVICE_GAIN_REPORT_ID = 0x0d,
+    CREATE_NEW_EFFECT_REPORT_ID = 0x11,
+    PID_BLOCK_LOAD_REPORT_ID = 0x12,
+    PID_BLOCK_FREE_REPORT_ID = 0x0b,
+    SET_CONSTANT_FORCE_REPORT_ID = 0x05,
+    SET_RAMP_FORCE_REPORT_ID = 0x06,
+    SET_PERIODIC_REPORT_ID = 0x04,
+    SET_CONDITION_REPORT_ID = 0x03,
+    SET_ENVELOPE_REPORT_ID = 0x02,
+    SET_EFFECT_REPORT_ID = 0x01,
+    EFFECT_OPERATION_REPORT_ID = 0x0a,
+};
+
+// Input reports
+// Note that the PID State Report shares its ID with SET_ENVELOPE_REPORT,
+// the first one is an input report, the second one an output report.
+enum INPUT_REPORT_ID {
+    JOYSTICK_INPUT_REPORT_ID = 0x01,
+    PID_STATE_REPORT_ID = 0x02,
+};
+
+// PID_DEVICE_CONTROL_REPORT
+// Data: 0b00000000
+//      DC Enable Actuators (1),
+//      DC Disable Actuators (1),
+//      DC Stop All Effects (1),
+//      DC Device Reset (1),
+//      DC Device Pause (1),
+//      DC Device Continue (1),
+//      padding (2)
+enum PID_DEVICE_CONTROL {
+    PID_DC_ENABLE_ACTUATORS = 0b00000001,
+    PID_DC_DISABLE_ACTUATORS = 0b00000010,
+    PID_DC_STOP_ALL_EFFECTS = 0b00000100,
+    PID_DC_DEVICE_RESET = 0b00001000,
+    PID_DC_DEVICE_PAUSE = 0b00010000,
+    PID_DC_DEVICE_CONTINUE = 0b00100000,
+};
+
+// PID_STATE_REPORT
+// Data: index (8), flags (8)
+// The flags are in the third byte of the buffer
+enum PID_STATE {
+    PID_STATE_DEVICE_PAUSED = 0b00000001,
+    PID_STATE_ACTUATORS_ENABLED = 0b00000010,
+    PID_STATE_SAFETY_SWITCH = 0b00000100,
+    PID_STATE_ACTUATOR_POWER = 0b00001000,
+    PID_STATE_EFFECT_PLAYING = 0b00010000,
+};
+
+// Effect Type of CREATE_NEW_EFFECT_REPORT and SET_EFFECT_REPORT
+enum PID_EFFECT_TYPE {
+    PID_ET_CONSTANT_FORCE = 1,
+    PID_ET_RAMP,
+    PID_ET_SQUARE,
+    PID_ET_SINE,
+    PID_ET_TRIANGLE,
+    PID_ET_SAWTOOTH_UP,
+    PID_ET_SAWTOOTH_DOWN,
+    PID_ET_SPRING,
+    PID_ET_DAMPER,
+    PID_ET_INERTIA,
+    PID_ET_FRICTION,
+    PID_ET_COUNT = PID_ET_FRICTION,
+};
+
+// Effect Operation of EFFECT_OPERATION_REPORT
+enum PID_EFFECT_OPERATION {
+    PID_OP_EFFECT_START = 1,
+    PID_OP_EFFECT_START_SOLO,
+    PID_OP_EFFECT_STOP,
+};
+
+// Block Load Status of PID_BLOCK_LOAD_REPORT
+enum PID_BLOCK_LOAD_STATUS {
+    PID_BLOCK_LOAD_SUCCESS = 1,
+    PID_BLOCK_LOAD_FULL,
+    PID_BLOCK_LOAD_ERROR,
+};
+
+// Effect Block Index goes from 1 to 10 (logical minimum / maximum)
+#define PID_MAX_EFFECT_BLOCKS 10
+
+// Duration of SET_EFFECT_REPORT for an effect that plays until it is stopped
+#define PID_DURATION_INFINITE 0xffff
+
+#endif // PID_REPORTS_H__
@@ -0,0 +1,273 @@
+#include "pid_templates.h"
+
+#include <string.h>
+
+#include "pid_layout.h"
+
+static const unsigned char template_report_ids[PID_TEMPLATE_SLOTS] = {
+    SET_ENVELOPE_REPORT_ID,
+    SET_CONDITION_REPORT_ID,
+    SET_PERIODIC_REPORT_ID,
+    SET_CONSTANT_FORCE_REPORT_ID,
+    SET_RAMP_FORCE_REPORT_ID,
+    EFFECT_OPERATION_REPORT_ID,
+    PID_BLOCK_FREE_REPORT_ID,
+};
+
+static const pid_field* template_find(const pid_codec* codec, unsigned char report_id, unsigned long usage, unsigned long parent_usage) {
+    return pid_codec_find(codec, PID_REPORT_OUTPUT, report_id, usage, parent_usage);
+}
+
+// Codec path, the field may be missing on this device
+static void template_put(const pid_field* field, unsigned char* buf, long value) {
+    if (field)
+        pid_codec_put_raw(field, buf, value);
+}
+
+static int template_build(pid_template* t, const pid_codec* codec, unsigned char report_id, unsigned char index) {
+    memset(t, 0x00, sizeof(*t));
+
+    t->length = pid_codec_report_length(codec, PID_REPORT_OUTPUT, report_id);
+    if (t->length > PID_TEMPLATE_REPORT_MAX)
+        return -1;
+
+    // Every effect report starts with the Effect Block Index
+    t->data[0] = report_id;
+    t->data[1] = index;
+    return 0;
+}
+
+int pid_templates_init(pid_templates* templates, const pid_codec* codec) {
+    const pid_field* type_field;
+    const pid_field* trigger_button;
+    const pid_field* direction_enable;
+    pid_field_codec direction;
+    pid_template* t;
+    int slot;
+    int type;
+    int i;
+
+    memset(templates, 0x00, sizeof(*templates));
+    templates->fixed = pid_layout_matches(codec);
+
+    templates->duration = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_DURATION), 0);
+    templates->gain = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_GAIN), 0);
+    templates->direction = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_ORDINAL, 0x01),
+                                         PID_USAGE(PID_PAGE_PID, PID_USAGE_DIRECTION));
+    templates->start_delay = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_START_DELAY), 0);
+    templates->attack_level = template_find(codec, SET_ENVELOPE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_ATTACK_LEVEL), 0);
+    templates->fade_level = template_find(codec, SET_ENVELOPE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_FADE_LEVEL), 0);
+    templates->attack_time = template_find(codec, SET_ENVELOPE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_ATTACK_TIME), 0);
+    templates->fade_time = template_find(codec, SET_ENVELOPE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_FADE_TIME), 0);
+    templates->cp_offset = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_CP_OFFSET), 0);
+    templates->positive_coefficient = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_POSITIVE_COEFFICIENT), 0);
+    templates->negative_coefficient = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_NEGATIVE_COEFFICIENT), 0);
+    templates->positive_saturation = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_POSITIVE_SATURATION), 0);
+    templates->negative_saturation = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_NEGATIVE_SATURATION), 0);
+    templates->dead_band = template_find(codec, SET_CONDITION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_DEAD_BAND), 0);
+    templates->periodic_magnitude = template_find(codec, SET_PERIODIC_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_MAGNITUDE), 0);
+    templates->periodic_offset = template_find(codec, SET_PERIODIC_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_OFFSET), 0);
+    templates->periodic_phase = template_find(codec, SET_PERIODIC_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_PHASE), 0);
+    templates->periodic_period = template_find(codec, SET_PERIODIC_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_PERIOD), 0);
+    templates->constant_magnitude = template_find(codec, SET_CONSTANT_FORCE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_MAGNITUDE), 0);
+    templates->ramp_start = template_find(codec, SET_RAMP_FORCE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_RAMP_START), 0);
+    templates->ramp_end = template_find(codec, SET_RAMP_FORCE_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_RAMP_END), 0);
+    templates->operation = template_find(codec, EFFECT_OPERATION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_EFFECT_OPERATION), 0);
+    templates->loop_count = template_find(codec, EFFECT_OPERATION_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_LOOP_COUNT), 0);
+
+    type_field = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_EFFECT_TYPE), 0);
+    trigger_button = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_TRIGGER_BUTTON), 0);
+    direction_enable = template_find(codec, SET_EFFECT_REPORT_ID, PID_USAGE(PID_PAGE_PID, PID_USAGE_DIRECTION_ENABLE), 0);
+
+    for (i = 0; i < PID_MAX_EFFECT_BLOCKS; i++) {
+        for (slot = 0; slot < PID_TEMPLATE_SLOTS; slot++) {
+            t = &templates->reports[i][slot];
+            if (template_build(t, codec, template_report_ids[slot], (unsigned char)(i + 1)))
+                return -1;
+        }
+
+        // The operation defaults to Op Effect Start, with the loop count of main() (0)
+        template_put(templates->operation, templates->reports[i][PID_TEMPLATE_EFFECT_OPERATION].data, PID_OP_EFFECT_START);
+
+        for (type = 0; type < PID_ET_COUNT; type++) {
+            t = &templates->effects[i][type];
+            if (template_build(t, codec, SET_EFFECT_REPORT_ID, (unsigned char)(i + 1)))
+                return -1;
+
+            // Same defaults as the SET_EFFECT_REPORT of main()
+            template_put(type_field, t->data, type + 1);
+            template_put(templates->duration, t->data, PID_DURATION_INFINITE);
+            if (templates->gain)
+                template_put(templates->gain, t->data, templates->gain->logical_max);
+            template_put(trigger_button, t->data, 0xff); // Out of range: no trigger button
+            template_put(direction_enable, t->data, 1);
+            if (pid_codec_bind(&direction, templates->direction, PID_CODEC_DEGREES) == 0)
+                pid_codec_put_degrees(&direction, t->data, 90.0f);
+        }
+    }
+
+    return 0;
+}
+
+pid_template* pid_template_get(pid_templates* templates, int slot, unsigned char index) {
+    if (slot < 0 || slot >= PID_TEMPLATE_SLOTS || index < 1 || index > PID_MAX_EFFECT_BLOCKS)
+        return NULL;
+    return &templates->reports[index - 1][slot];
+}
+
+pid_template* pid_template_effect(pid_templates* templates, unsigned char index, unsigned char type) {
+    if (index < 1 || index > PID_MAX_EFFECT_BLOCKS || type < PID_ET_CONSTANT_FORCE || type > PID_ET_COUNT)
+        return NULL;
+    return &templates->effects[index - 1][type - 1];
+}
+
+pid_template* pid_template_set_effect(pid_templates* templates, unsigned char index, unsigned char type,
+                                      long duration, long gain, long direction) {
+    pid_template* t = pid_template_effect(templates, index, type);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_set_effect_duration(t->data, duration);
+        pid_layout_put_set_effect_gain(t->data, gain);
+        pid_layout_put_set_effect_direction_1(t->data, direction);
+    }
+    else {
+        template_put(templates->duration, t->data, duration);
+        template_put(templates->gain, t->data, gain);
+        template_put(templates->direction, t->data, direction);
+    }
+    return t;
+}
+
+pid_template* pid_template_set_start_delay(pid_templates* templates, unsigned char index, unsigned char type, long start_delay) {
+    pid_template* t = pid_template_effect(templates, index, type);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed)
+        pid_layout_put_set_effect_start_delay(t->data, start_delay);
+    else
+        template_put(templates->start_delay, t->data, start_delay);
+    return t;
+}
+
+pid_template* pid_template_set_envelope(pid_templates* templates, unsigned char index,
+                                        long attack_level, long attack_time, long fade_level, long fade_time) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_SET_ENVELOPE, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_set_envelope_attack_level(t->data, attack_level);
+        pid_layout_put_set_envelope_fade_level(t->data, fade_level);
+        pid_layout_put_set_envelope_attack_time(t->data, attack_time);
+        pid_layout_put_set_envelope_fade_time(t->data, fade_time);
+    }
+    else {
+        template_put(templates->attack_level, t->data, attack_level);
+        template_put(templates->fade_level, t->data, fade_level);
+        template_put(templates->attack_time, t->data, attack_time);
+        template_put(templates->fade_time, t->data, fade_time);
+    }
+    return t;
+}
+
+pid_template* pid_template_set_condition(pid_templates* templates, unsigned char index, long cp_offset,
+                                         long positive_coefficient, long negative_coefficient,
+                                         long positive_saturation, long negative_saturation, long dead_band) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_SET_CONDITION, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_set_condition_cp_offset(t->data, cp_offset);
+        pid_layout_put_set_condition_positive_coefficient(t->data, positive_coefficient);
+        pid_layout_put_set_condition_negative_coefficient(t->data, negative_coefficient);
+        pid_layout_put_set_condition_positive_saturation(t->data, positive_saturation);
+        pid_layout_put_set_condition_negative_saturation(t->data, negative_saturation);
+        pid_layout_put_set_condition_dead_band(t->data, dead_band);
+    }
+    else {
+        template_put(templates->cp_offset, t->data, cp_offset);
+        template_put(templates->positive_coefficient, t->data, positive_coefficient);
+        template_put(templates->negative_coefficient, t->data, negative_coefficient);
+        template_put(templates->positive_saturation, t->data, positive_saturation);
+        template_put(templates->negative_saturation, t->data, negative_saturation);
+        template_put(templates->dead_band, t->data, dead_band);
+    }
+    return t;
+}
+
+pid_template* pid_template_set_periodic(pid_templates* templates, unsigned char index,
+                                        long magnitude, long offset, long phase, long period) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_SET_PERIODIC, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_set_periodic_magnitude(t->data, magnitude);
+        pid_layout_put_set_periodic_offset(t->data, offset);
+        pid_layout_put_set_periodic_phase(t->data, phase);
+        pid_layout_put_set_periodic_period(t->data, period);
+    }
+    else {
+        template_put(templates->periodic_magnitude, t->data, magnitude);
+        template_put(templates->periodic_offset, t->data, offset);
+        template_put(templates->periodic_phase, t->data, phase);
+        template_put(templates->periodic_period, t->data, period);
+    }
+    return t;
+}
+
+pid_template* pid_template_set_constant_force(pid_templates* templates, unsigned char index, short magnitude) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_SET_CONSTANT_FORCE, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed)
+        pid_layout_put_set_constant_force_magnitude(t->data, magnitude);
+    else
+        template_put(templates->constant_magnitude, t->data, magnitude);
+    return t;
+}
+
+pid_template* pid_template_set_ramp_force(pid_templates* templates, unsigned char index, long start, long end) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_SET_RAMP_FORCE, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_set_ramp_force_ramp_start(t->data, start);
+        pid_layout_put_set_ramp_force_ramp_end(t->data, end);
+    }
+    else {
+        template_put(templates->ramp_start, t->data, start);
+        template_put(templates->ramp_end, t->data, end);
+    }
+    return t;
+}
+
+pid_template* pid_template_set_operation(pid_templates* templates, unsigned char index, unsigned char operation, unsigned char loop_count) {
+    pid_template* t = pid_template_get(templates, PID_TEMPLATE_EFFECT_OPERATION, index);
+
+    if (!t)
+        return NULL;
+
+    if (templates->fixed) {
+        pid_layout_put_effect_operation_effect_operation(t->data, operation);
+        pid_layout_put_effect_operation_loop_count(t->data, loop_count);
+    }
+    else {
+        template_put(templates->operation, t->data, operation);
+        template_put(templates->loop_count, t->data, loop_count);
+    }
+    return t;
+}
@@ -0,0 +1,98 @@
+// Preformatted report templates
+// One byte image is built up front for every report of every effect block
+// (and, for the SET_EFFECT_REPORT, every effect type), with the report ID,
+// the index, the effect type and the defaults of main() already in place.
+//
+// An update only patches the fields that change, and the returned image
+// goes straight to pid_writer_submit_ref(): no zeroing, no copy.
+// The fields are patched with the encoders of pid_layout.h when the
+// device matches it, otherwise through the codec.
+
+#ifndef PID_TEMPLATES_H__
+#define PID_TEMPLATES_H__
+
+#include <stddef.h>
+
+#include "pid_codec.h"
+#include "pid_reports.h"
+
+#define PID_TEMPLATE_REPORT_MAX 32
+
+// Reports of an effect block other than the SET_EFFECT_REPORT
+enum PID_TEMPLATE_SLOT {
+    PID_TEMPLATE_SET_ENVELOPE = 0,
+    PID_TEMPLATE_SET_CONDITION,
+    PID_TEMPLATE_SET_PERIODIC,
+    PID_TEMPLATE_SET_CONSTANT_FORCE,
+    PID_TEMPLATE_SET_RAMP_FORCE,
+    PID_TEMPLATE_EFFECT_OPERATION,
+    PID_TEMPLATE_BLOCK_FREE,
+    PID_TEMPLATE_SLOTS,
+};
+
+typedef struct pid_template {
+    unsigned char data[PID_TEMPLATE_REPORT_MAX];
+    size_t length; // To pass to hid_write, 0 if the device has no such report
+} pid_template;
+
+typedef struct pid_templates {
+    int fixed; // The device matches pid_layout.h
+
+    pid_template effects[PID_MAX_EFFECT_BLOCKS][PID_ET_COUNT];
+    pid_template reports[PID_MAX_EFFECT_BLOCKS][PID_TEMPLATE_SLOTS];
+
+    // Fields patched when the device does not match pid_layout.h
+    const pid_field* duration;
+    const pid_field* gain;
+    const pid_field* direction;
+    const pid_field* start_delay;
+    const pid_field* attack_level;
+    const pid_field* fade_level;
+    const pid_field* attack_time;
+    const pid_field* fade_time;
+    const pid_field* cp_offset;
+    const pid_field* positive_coefficient;
+    const pid_field* negative_coefficient;
+    const pid_field* positive_saturation;
+    const pid_field* negative_saturation;
+    const pid_field* dead_band;
+    const pid_field* periodic_magnitude;
+    const pid_field* periodic_offset;
+    const pid_field* periodic_phase;
+    const pid_field* periodic_period;
+    const pid_field* constant_magnitude;
+    const pid_field* ramp_start;
+    const pid_field* ramp_end;
+    const pid_field* operation;
+    const pid_field* loop_count;
+} pid_templates;
+
+// Builds every image from the fields and lengths of codec.
+// SET_EFFECT_REPORT defaults: infinite duration, full gain, no trigger
+// button, direction enabled at 90 degrees.
+// Returns 0 on success, -1 if a report is longer than PID_TEMPLATE_REPORT_MAX.
+int pid_templates_init(pid_templates* templates, const pid_codec* codec);
+
+// Images as they are, NULL if index or type is out of range.
+// Effect Block Index goes from 1 to PID_MAX_EFFECT_BLOCKS,
+// effect type from PID_ET_CONSTANT_FORCE to PID_ET_FRICTION.
+pid_template* pid_template_get(pid_templates* templates, int slot, unsigned char index);
+pid_template* pid_template_effect(pid_templates* templates, unsigned char index, unsigned char type);
+
+// Patchers, the values are logical values of the report.
+// Return the patched image, NULL if index or type is out of range.
+pid_template* pid_template_set_effect(pid_templates* templates, unsigned char index, unsigned char type,
+                                      long duration, long gain, long direction);
+pid_template* pid_template_set_start_delay(pid_templates* templates, unsigned char index, unsigned char type, long start_delay);
+pid_template* pid_template_set_envelope(pid_templates* templates, unsigned char index,
+                                        long attack_level, long attack_time, long fade_level, long fade_time);
+pid_template* pid_template_set_condition(pid_templates* templates, unsigned char index, long cp_offset,
+                                         long positive_coefficient, long negative_coefficient,
+                                         long positive_saturation, long negative_saturation, long dead_band);
+pid_template* pid_template_set_periodic(pid_templates* templates, unsigned char index,
+                                        long magnitude, long offset, long phase, long period);
+pid_template* pid_template_set_constant_force(pid_templates* templates, unsigned char index, short magnitude);
+pid_template* pid_template_set_ramp_force(pid_templates* templates, unsigned char index, long start, long end);
+pid_template* pid_template_set_operation(pid_templates* templates, unsigned char index, unsigned char operation, unsigned char loop_count);
+
+#endif // PID_TEMPLATES_H__
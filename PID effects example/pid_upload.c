@@ -0,0 +1,127 @@
+#include "pid_upload.h"
+
+#include <string.h>
+
+// Reports carrying the parameters of an effect type
+static unsigned int upload_reports(unsigned char type) {
+    unsigned int mask = 1u << PID_UPLOAD_SET_EFFECT;
+
+    switch (type) {
+    case PID_ET_CONSTANT_FORCE:
+        mask |= (1u << PID_TEMPLATE_SET_CONSTANT_FORCE) | (1u << PID_TEMPLATE_SET_ENVELOPE);
+        break;
+    case PID_ET_RAMP:
+        mask |= (1u << PID_TEMPLATE_SET_RAMP_FORCE) | (1u << PID_TEMPLATE_SET_ENVELOPE);
+        break;
+    case PID_ET_SQUARE:
+    case PID_ET_SINE:
+    case PID_ET_TRIANGLE:
+    case PID_ET_SAWTOOTH_UP:
+    case PID_ET_SAWTOOTH_DOWN:
+        mask |= (1u << PID_TEMPLATE_SET_PERIODIC) | (1u << PID_TEMPLATE_SET_ENVELOPE);
+        break;
+    case PID_ET_SPRING:
+    case PID_ET_DAMPER:
+    case PID_ET_INERTIA:
+    case PID_ET_FRICTION:
+        mask |= 1u << PID_TEMPLATE_SET_CONDITION;
+        break;
+    }
+    return mask;
+}
+
+int pid_upload_init(pid_upload* upload, pid_templates* templates, pid_writer* writer) {
+    memset(upload, 0x00, sizeof(*upload));
+
+    upload->templates = templates;
+    upload->writer = writer;
+    upload->errors = pid_atomic_load(&writer->errors);
+    upload->dropped = pid_atomic_load(&writer->dropped);
+    return 0;
+}
+
+int pid_upload_track(pid_upload* upload, unsigned char index, unsigned char type) {
+    if (!pid_template_effect(upload->templates, index, type))
+        return -1;
+
+    upload->types[index - 1] = type;
+    upload->valid[index - 1] = 0;
+    return 0;
+}
+
+void pid_upload_forget(pid_upload* upload, unsigned char index) {
+    if (index < 1 || index > PID_MAX_EFFECT_BLOCKS)
+        return;
+    upload->types[index - 1] = 0;
+    upload->valid[index - 1] = 0;
+}
+
+void pid_upload_invalidate(pid_upload* upload, unsigned char index) {
+    if (index < 1 || index > PID_MAX_EFFECT_BLOCKS)
+        return;
+    upload->valid[index - 1] = 0;
+}
+
+// Queues the image of report if it differs from the copy sent last.
+// Returns 1 if queued, 0 if unchanged, -1 if the writer rejected it.
+static int upload_report(pid_upload* upload, unsigned char index, int report, const pid_template* t) {
+    unsigned char* sent = upload->sent[index - 1][report];
+    unsigned int bit = 1u << report;
+
+    if (t->length == 0)
+        return 0;
+
+    if ((upload->valid[index - 1] & bit) && memcmp(sent, t->data, t->length) == 0) {
+        upload->reports_skipped++;
+        return 0;
+    }
+
+    if (pid_writer_submit(upload->writer, t->data, t->length)) {
+        upload->valid[index - 1] &= ~bit;
+        return -1;
+    }
+
+    memcpy(sent, t->data, t->length);
+    upload->valid[index - 1] |= bit;
+    upload->reports_sent++;
+    return 1;
+}
+
+int pid_upload_flush(pid_upload* upload, unsigned char index) {
+    unsigned int mask;
+    long errors, dropped;
+    int queued = 0;
+    int slot;
+    int res;
+
+    if (index < 1 || index > PID_MAX_EFFECT_BLOCKS || upload->types[index - 1] == 0)
+        return -1;
+
+    // A write failed or queued reports were discarded since the last
+    // flush: the device may have missed any report, so nothing can be
+    // trusted any more.
+    errors = pid_atomic_load(&upload->writer->errors);
+    dropped = pid_atomic_load(&upload->writer->dropped);
+    if (errors != upload->errors || dropped != upload->dropped) {
+        memset(upload->valid, 0x00, sizeof(upload->valid));
+        upload->errors = errors;
+        upload->dropped = dropped;
+    }
+
+    mask = upload_reports(upload->types[index - 1]);
+    for (slot = 0; slot < PID_TEMPLATE_SLOTS; slot++) {
+        if (!(mask & (1u << slot)))
+            continue;
+        res = upload_report(upload, index, slot, pid_template_get(upload->templates, slot, index));
+        if (res < 0)
+            return -1;
+        queued += res;
+    }
+
+    res = upload_report(upload, index, PID_UPLOAD_SET_EFFECT,
+                        pid_template_effect(upload->templates, index, upload->types[index - 1]));
+    if (res < 0)
+        return -1;
+
+    return queued + res;
+}
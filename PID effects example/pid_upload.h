@@ -0,0 +1,55 @@
+// Differential upload of effect parameters
+// Keeps, for every tracked effect block, a copy of the reports last handed
+// to the writer. The parameters are changed in the images of pid_templates.h
+// and pid_upload_flush() only queues the reports whose bytes changed, so
+// tweaking the gain of an effect sends one SET_EFFECT_REPORT and nothing else.
+//
+// Output reports are not acknowledged by the device: a report counts as
+// sent once it is queued to the writer. When the writer then reports a
+// failed write, or discarded queued reports (pid_writer_emergency_stop()),
+// every copy is invalidated and the next flush sends the reports again.
+
+#ifndef PID_UPLOAD_H__
+#define PID_UPLOAD_H__
+
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+// Bit of the SET_EFFECT_REPORT in the masks, after the template slots
+#define PID_UPLOAD_SET_EFFECT PID_TEMPLATE_SLOTS
+
+typedef struct pid_upload {
+    pid_templates* templates;
+    pid_writer* writer;
+    long errors;  // Failed writes of the writer at the last flush
+    long dropped; // Reports discarded by the writer at the last flush
+
+    unsigned char types[PID_MAX_EFFECT_BLOCKS];  // Effect type, 0 if the block is not tracked
+    unsigned int valid[PID_MAX_EFFECT_BLOCKS];   // Mask of the copies matching the device
+    unsigned char sent[PID_MAX_EFFECT_BLOCKS][PID_TEMPLATE_SLOTS + 1][PID_TEMPLATE_REPORT_MAX];
+
+    // Statistics
+    long reports_sent;
+    long reports_skipped;
+} pid_upload;
+
+// Returns 0 on success
+int pid_upload_init(pid_upload* upload, pid_templates* templates, pid_writer* writer);
+
+// Starts tracking the effect at index, its first flush sends every report.
+// Returns 0 on success, -1 if index or type is out of range.
+int pid_upload_track(pid_upload* upload, unsigned char index, unsigned char type);
+
+// Stops tracking the effect at index (e.g. after a PID_BLOCK_FREE_REPORT)
+void pid_upload_forget(pid_upload* upload, unsigned char index);
+
+// Sends every report of the effect at index on the next flush
+void pid_upload_invalidate(pid_upload* upload, unsigned char index);
+
+// Queues the reports of the effect at index that changed since the last
+// flush: the type specific reports first, then the SET_EFFECT_REPORT.
+// Returns the number of reports queued, -1 if the effect is not tracked
+// or the writer rejected a report (it is sent again on the next flush).
+int pid_upload_flush(pid_upload* upload, unsigned char index);
+
+#endif // PID_UPLOAD_H__
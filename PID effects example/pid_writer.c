@@ -0,0 +1,443 @@
+#include "pid_writer.h"
+
+#include <string.h>
+
+#include "pid_layout.h"
+#include "pid_reports.h"
+
+// Input reports read per tick when polling the PID State Report
+#define PID_WRITER_MAX_READS 8
+
+// Timestamps of the stop path are kept on 31 bits so they fit in a pid_atomic_t
+#define PID_WRITER_TIME_MASK 0x7fffffff
+
+static long writer_time_stamp(void) {
+    return (long)(pid_time_us() & PID_WRITER_TIME_MASK);
+}
+
+int pid_writer_init(pid_writer* writer, hid_device* handle, const pid_codec* codec, unsigned int period_ms) {
+    memset(writer, 0x00, sizeof(*writer));
+
+    writer->handle = handle;
+    writer->codec = codec;
+    writer->control_length = pid_codec_report_length(codec, PID_REPORT_OUTPUT, PID_DEVICE_CONTROL_REPORT_ID);
+    writer->free_index = pid_codec_find(codec, PID_REPORT_OUTPUT, PID_BLOCK_FREE_REPORT_ID,
+                                        PID_USAGE(PID_PAGE_PID, PID_USAGE_EFFECT_BLOCK_INDEX), 0);
+    writer->free_length = pid_codec_report_length(codec, PID_REPORT_OUTPUT, PID_BLOCK_FREE_REPORT_ID);
+    writer->period_ms = period_ms ? period_ms : 1;
+    writer->safety_switch = -1;
+
+    if (pid_event_init(&writer->wake))
+        return -1;
+    pid_mutex_init(&writer->lock);
+    pid_mutex_init(&writer->device_lock);
+
+    return 0;
+}
+
+int pid_writer_set_stream(pid_writer* writer, unsigned char index, pid_stream_fn fn, void* ctx) {
+    writer->stream_magnitude = pid_codec_find(writer->codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID,
+                                              PID_USAGE(PID_PAGE_PID, PID_USAGE_MAGNITUDE), 0);
+    writer->stream_length = pid_codec_report_length(writer->codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID);
+    if (!writer->stream_magnitude || writer->stream_length > PID_WRITER_REPORT_MAX)
+        return -1;
+
+    // SET_CONSTANT_FORCE_REPORT
+    // Data: index (8), magnitude (16)
+    // Only the magnitude changes from one tick to the next. When the device
+    // has the layout of pid_layout.h, it is two stores at constant offsets.
+    writer->stream_fixed = pid_layout_matches(writer->codec);
+    memset(writer->stream_buf, 0x00, sizeof(writer->stream_buf));
+    writer->stream_buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
+    writer->stream_buf[1] = index;
+
+    writer->stream_index = index;
+    writer->stream = fn;
+    writer->stream_ctx = ctx;
+    return 0;
+}
+
+void pid_writer_set_input(pid_writer* writer, pid_input_fn fn, void* ctx) {
+    writer->input = fn;
+    writer->input_ctx = ctx;
+}
+
+void pid_writer_set_period(pid_writer* writer, unsigned int period_ms) {
+    pid_atomic_store(&writer->period_ms, period_ms ? (long)period_ms : 1);
+}
+
+unsigned int pid_writer_period(pid_writer* writer) {
+    return (unsigned int)pid_atomic_load(&writer->period_ms);
+}
+
+void pid_writer_destroy(pid_writer* writer) {
+    pid_mutex_destroy(&writer->device_lock);
+    pid_mutex_destroy(&writer->lock);
+    pid_event_destroy(&writer->wake);
+}
+
+static void writer_fill(pid_writer_entry* entry, const unsigned char* data, size_t length, int copy) {
+    if (copy) {
+        memcpy(entry->data, data, length);
+        entry->ref = NULL;
+    }
+    else {
+        entry->ref = data;
+    }
+    entry->length = length;
+    entry->block = 0;
+    entry->rest = 0;
+}
+
+static int writer_enqueue(pid_writer* writer, const unsigned char* data, size_t length, int copy) {
+    int res = -1;
+
+    if (length == 0 || length > PID_WRITER_REPORT_MAX)
+        return -1;
+
+    pid_mutex_lock(&writer->lock);
+    if (!pid_atomic_load(&writer->stopped) && writer->count < PID_WRITER_QUEUE_LEN) {
+        writer_fill(&writer->queue[(writer->head + writer->count) % PID_WRITER_QUEUE_LEN], data, length, copy);
+        writer->count++;
+        writer->submitted++;
+        res = 0;
+    }
+    pid_mutex_unlock(&writer->lock);
+
+    if (res == 0)
+        pid_event_signal(&writer->wake);
+
+    return res;
+}
+
+int pid_writer_submit(pid_writer* writer, const unsigned char* data, size_t length) {
+    return writer_enqueue(writer, data, length, 1);
+}
+
+int pid_writer_submit_ref(pid_writer* writer, const unsigned char* data, size_t length) {
+    return writer_enqueue(writer, data, length, 0);
+}
+
+int pid_writer_submit_effect(pid_writer* writer, unsigned char block, const unsigned char* const* data,
+                             const size_t* lengths, unsigned int count) {
+    pid_writer_entry* entry;
+    unsigned int i;
+    int res = -1;
+
+    if (count == 0 || count > PID_WRITER_QUEUE_LEN)
+        return -1;
+    for (i = 0; i < count; i++) {
+        if (lengths[i] == 0 || lengths[i] > PID_WRITER_REPORT_MAX)
+            return -1;
+    }
+
+    pid_mutex_lock(&writer->lock);
+    if (!pid_atomic_load(&writer->stopped) && writer->count + count <= PID_WRITER_QUEUE_LEN) {
+        for (i = 0; i < count; i++) {
+            entry = &writer->queue[(writer->head + writer->count) % PID_WRITER_QUEUE_LEN];
+            writer_fill(entry, data[i], lengths[i], 0);
+            entry->block = block;
+            entry->rest = (unsigned char)(count - 1 - i);
+            writer->count++;
+        }
+        writer->submitted += count;
+        res = 0;
+    }
+    pid_mutex_unlock(&writer->lock);
+
+    if (res == 0)
+        pid_event_signal(&writer->wake);
+
+    return res;
+}
+
+int pid_writer_send_feature(pid_writer* writer, const unsigned char* data, size_t length) {
+    int res;
+
+    pid_mutex_lock(&writer->device_lock);
+    res = hid_send_feature_report(writer->handle, data, length);
+    pid_mutex_unlock(&writer->device_lock);
+    return res;
+}
+
+int pid_writer_get_feature(pid_writer* writer, unsigned char* data, size_t length) {
+    int res;
+
+    pid_mutex_lock(&writer->device_lock);
+    res = hid_get_feature_report(writer->handle, data, length);
+    pid_mutex_unlock(&writer->device_lock);
+    return res;
+}
+
+int pid_writer_write(pid_writer* writer, const unsigned char* data, size_t length) {
+    int res;
+
+    pid_mutex_lock(&writer->device_lock);
+    res = hid_write(writer->handle, data, length);
+    pid_mutex_unlock(&writer->device_lock);
+    return res;
+}
+
+int pid_writer_flush(pid_writer* writer, unsigned int timeout_ms) {
+    long long end = pid_time_us() + (long long)timeout_ms * 1000;
+    long target;
+
+    pid_mutex_lock(&writer->lock);
+    target = writer->submitted;
+    pid_mutex_unlock(&writer->lock);
+
+    while (pid_atomic_load(&writer->done) - target < 0) {
+        if (pid_time_us() > end)
+            return -1;
+        pid_sleep_ms(1);
+    }
+    return 0;
+}
+
+static void writer_build_device_control(unsigned char* buf, unsigned char control) {
+    // PID_DEVICE_CONTROL_REPORT
+    // Data: 0b00000000 (see PID_DEVICE_CONTROL)
+    memset(buf, 0x00, PID_WRITER_REPORT_MAX);
+    buf[0] = PID_DEVICE_CONTROL_REPORT_ID;
+    buf[1] = control;
+}
+
+int pid_writer_device_control(pid_writer* writer, unsigned char control) {
+    unsigned char buf[PID_WRITER_REPORT_MAX];
+
+    writer_build_device_control(buf, control);
+    return pid_writer_submit(writer, buf, writer->control_length);
+}
+
+void pid_writer_emergency_stop(pid_writer* writer, unsigned char control) {
+    long old;
+
+    // Lock the output first, then drop what is queued:
+    // an entry popped by the loop in between is dropped by the loop itself.
+    pid_atomic_store(&writer->stopped, 1);
+
+    pid_mutex_lock(&writer->lock);
+    pid_atomic_add(&writer->dropped, (long)writer->count);
+    pid_atomic_add(&writer->done, (long)writer->count);
+    writer->head = 0;
+    writer->count = 0;
+    pid_mutex_unlock(&writer->lock);
+
+    do {
+        old = pid_atomic_load(&writer->stop_control);
+        if (old == 0)
+            pid_atomic_store(&writer->stop_requested_us, writer_time_stamp());
+    } while (!pid_atomic_cas(&writer->stop_control, old, old | control));
+
+    pid_event_signal(&writer->wake);
+}
+
+void pid_writer_resume(pid_writer* writer) {
+    pid_atomic_store(&writer->stopped, 0);
+}
+
+int pid_writer_is_stopped(pid_writer* writer) {
+    return pid_atomic_load(&writer->stopped) != 0;
+}
+
+// Returns 0 on success, -1 if the write failed
+static int writer_write(pid_writer* writer, const unsigned char* data, size_t length) {
+    long long start;
+    long latency;
+    long average;
+    int res;
+
+    pid_mutex_lock(&writer->device_lock);
+    start = pid_time_us();
+    res = hid_write(writer->handle, data, length) < 0 ? -1 : 0;
+    latency = (long)(pid_time_us() - start);
+    pid_mutex_unlock(&writer->device_lock);
+
+    if (res)
+        pid_atomic_add(&writer->errors, 1);
+    else
+        pid_atomic_add(&writer->writes, 1);
+
+    // Exponential average with a weight of 1/8, only written by the loop
+    average = pid_atomic_load(&writer->write_latency_us);
+    pid_atomic_store(&writer->write_latency_us, average + (latency - average) / 8);
+    return res;
+}
+
+// Frees the block of an effect whose upload failed, the rest of its
+// reports are dropped as they come out of the queue
+static void writer_rollback(pid_writer* writer, const pid_writer_entry* entry) {
+    unsigned char buf[PID_WRITER_REPORT_MAX];
+
+    writer->skip = entry->rest;
+    if (!writer->free_index || writer->free_length > sizeof(buf))
+        return;
+
+    // PID_BLOCK_FREE_REPORT
+    // Data: index (8)
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = PID_BLOCK_FREE_REPORT_ID;
+    pid_codec_put_raw(writer->free_index, buf, entry->block);
+    writer_write(writer, buf, writer->free_length);
+    pid_atomic_add(&writer->rollbacks, 1);
+}
+
+// Sends the pending stop, if any. Returns 1 if a stop has been sent.
+static int writer_service_stop(pid_writer* writer) {
+    unsigned char buf[PID_WRITER_REPORT_MAX];
+    long control = pid_atomic_exchange(&writer->stop_control, 0);
+    long latency;
+
+    if (control == 0)
+        return 0;
+
+    // The queue has been discarded, with what was left of a failed effect
+    writer->skip = 0;
+
+    // Stop All Effects and/or Disable Actuators
+    writer_build_device_control(buf, (unsigned char)control);
+    writer_write(writer, buf, writer->control_length);
+
+    latency = (writer_time_stamp() - pid_atomic_load(&writer->stop_requested_us)) & PID_WRITER_TIME_MASK;
+    pid_atomic_store(&writer->stop_latency_us, latency);
+    if (latency > pid_atomic_load(&writer->stop_latency_max_us))
+        pid_atomic_store(&writer->stop_latency_max_us, latency);
+
+    return 1;
+}
+
+// Reads the pending input reports and trips the emergency stop
+// when the safety switch bit of the PID State Report goes from 1 to 0.
+// The other input reports go to the input callback.
+static void writer_poll_state(pid_writer* writer) {
+    unsigned char buf[PID_WRITER_REPORT_MAX];
+    int safety_switch;
+    int res;
+    int i;
+
+    for (i = 0; i < PID_WRITER_MAX_READS; i++) {
+        pid_mutex_lock(&writer->device_lock);
+        res = hid_read_timeout(writer->handle, buf, sizeof(buf), 0);
+        pid_mutex_unlock(&writer->device_lock);
+        if (res <= 0)
+            break;
+        if (buf[0] != PID_STATE_REPORT_ID) {
+            if (writer->input)
+                writer->input(writer->input_ctx, buf, res);
+            continue;
+        }
+        if (res < 3)
+            continue;
+
+        safety_switch = (buf[2] & PID_STATE_SAFETY_SWITCH) ? 1 : 0;
+        if (writer->safety_switch == 1 && safety_switch == 0)
+            pid_writer_emergency_stop(writer, PID_DC_STOP_ALL_EFFECTS | PID_DC_DISABLE_ACTUATORS);
+        writer->safety_switch = safety_switch;
+    }
+}
+
+static int writer_pop(pid_writer* writer, pid_writer_entry* entry) {
+    int res = 0;
+
+    pid_mutex_lock(&writer->lock);
+    if (writer->count > 0) {
+        // Only the pointer of a referenced report is copied
+        entry->ref = writer->queue[writer->head].ref;
+        entry->length = writer->queue[writer->head].length;
+        entry->block = writer->queue[writer->head].block;
+        entry->rest = writer->queue[writer->head].rest;
+        if (!entry->ref)
+            memcpy(entry->data, writer->queue[writer->head].data, entry->length);
+        writer->head = (writer->head + 1) % PID_WRITER_QUEUE_LEN;
+        writer->count--;
+        res = 1;
+    }
+    pid_mutex_unlock(&writer->lock);
+
+    return res;
+}
+
+static void writer_stream(pid_writer* writer) {
+    short magnitude;
+
+    if (!writer->stream || !writer->stream(writer->stream_ctx, &magnitude))
+        return;
+
+    if (writer->stream_fixed)
+        pid_layout_put_set_constant_force_magnitude(writer->stream_buf, magnitude);
+    else
+        pid_codec_put_raw(writer->stream_magnitude, writer->stream_buf, magnitude);
+    writer_write(writer, writer->stream_buf, writer->stream_length);
+}
+
+static void writer_loop(void* arg) {
+    pid_writer* writer = (pid_writer*)arg;
+    pid_writer_entry entry;
+    long long period_us;
+    long long next_tick = pid_time_us();
+    long long now;
+
+    pid_thread_set_realtime();
+
+    while (pid_atomic_load(&writer->running)) {
+        writer_poll_state(writer);
+        if (writer_service_stop(writer))
+            continue;
+
+        while (writer_pop(writer, &entry)) {
+            // Popped just before a stop, drop it
+            if (pid_atomic_load(&writer->stopped)) {
+                pid_atomic_add(&writer->dropped, 1);
+                pid_atomic_add(&writer->done, 1);
+                break;
+            }
+            // What is left of an effect whose upload failed
+            if (writer->skip > 0) {
+                writer->skip--;
+                pid_atomic_add(&writer->dropped, 1);
+                pid_atomic_add(&writer->done, 1);
+                continue;
+            }
+            if (writer_write(writer, entry.ref ? entry.ref : entry.data, entry.length) && entry.block)
+                writer_rollback(writer, &entry);
+            pid_atomic_add(&writer->done, 1);
+            // A tripped safety switch must not wait for the rest of the queue
+            writer_poll_state(writer);
+            if (pid_atomic_load(&writer->stop_control))
+                break;
+        }
+        if (writer_service_stop(writer))
+            continue;
+
+        now = pid_time_us();
+        if (now >= next_tick) {
+            if (!pid_atomic_load(&writer->stopped))
+                writer_stream(writer);
+            // Read after the stream, which may change the period
+            period_us = (long long)pid_atomic_load(&writer->period_ms) * 1000;
+            next_tick += period_us;
+            if (next_tick < now)
+                next_tick = now + period_us;
+            now = pid_time_us();
+        }
+
+        if (next_tick > now)
+            pid_event_wait(&writer->wake, (unsigned int)((next_tick - now + 999) / 1000));
+    }
+}
+
+int pid_writer_start(pid_writer* writer) {
+    pid_atomic_store(&writer->running, 1);
+    if (pid_thread_start(&writer->thread, writer_loop, writer)) {
+        pid_atomic_store(&writer->running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void pid_writer_stop(pid_writer* writer) {
+    if (!pid_atomic_exchange(&writer->running, 0))
+        return;
+    pid_event_signal(&writer->wake);
+    pid_thread_join(writer->thread);
+}
@@ -0,0 +1,174 @@
+// Writer loop
+// A single thread owns the output to the device.
+// Other threads queue reports, and the constant force is streamed
+// from a callback once per tick. Feature reports, which need an answer
+// from the device, are sent from the calling thread while the loop is
+// held off the handle, as hidapi handles are not thread safe.
+//
+// Emergency stop:
+// pid_writer_emergency_stop() discards every queued write and makes the
+// loop send a PID_DEVICE_CONTROL_REPORT (Stop All Effects or Disable
+// Actuators) before anything else. The loop is woken up right away, so
+// the stop only waits for the hid_write or feature report that may
+// already be in flight.
+// The same path is taken when the safety switch bit of the
+// PID State Report trips.
+
+#ifndef PID_WRITER_H__
+#define PID_WRITER_H__
+
+#include <stddef.h>
+
+#include "hidapi.h"
+#include "pid_codec.h"
+#include "pid_platform.h"
+
+#define PID_WRITER_QUEUE_LEN 64
+#define PID_WRITER_REPORT_MAX 64
+
+// Returns 1 and sets *magnitude to stream a SET_CONSTANT_FORCE_REPORT
+// on this tick, 0 to skip the tick.
+typedef int (*pid_stream_fn)(void* ctx, short* magnitude);
+
+// Called from the loop with every input report other than the
+// PID State Report (e.g. the joystick report with the wheel angle),
+// report[0] being the report ID.
+typedef void (*pid_input_fn)(void* ctx, const unsigned char* report, int length);
+
+typedef struct pid_writer_entry {
+    unsigned char data[PID_WRITER_REPORT_MAX];
+    const unsigned char* ref; // Report written in place of data, see pid_writer_submit_ref()
+    size_t length;
+    unsigned char block;      // Effect block freed if the write fails, 0 for none
+    unsigned char rest;       // Entries of the same effect queued after this one
+} pid_writer_entry;
+
+typedef struct pid_writer {
+    hid_device* handle;
+    const pid_codec* codec;
+    pid_atomic_t period_ms; // Tick of the loop, see pid_writer_set_period()
+
+    pid_thread_t thread;
+    pid_event_t wake;
+    pid_atomic_t running;
+
+    // Held around every call on handle, by the loop and by the feature
+    // reports of other threads
+    pid_mutex_t device_lock;
+
+    // Queue of reports, protected by lock
+    pid_mutex_t lock;
+    pid_writer_entry queue[PID_WRITER_QUEUE_LEN];
+    unsigned int head; // Next entry to write
+    unsigned int count;
+    long submitted;    // Entries ever queued
+    pid_atomic_t done; // Entries ever written or dropped
+
+    // Streamed constant force, only touched by the loop once started
+    pid_stream_fn stream;
+    void* stream_ctx;
+    unsigned char stream_index;
+    const pid_field* stream_magnitude;
+    int stream_fixed;          // The device matches pid_layout.h
+    unsigned char stream_buf[PID_WRITER_REPORT_MAX]; // Preformatted SET_CONSTANT_FORCE_REPORT
+    size_t stream_length;
+    size_t control_length;
+
+    // Block Free of an effect whose upload failed, see pid_writer_submit_effect()
+    const pid_field* free_index;
+    size_t free_length;
+    unsigned int skip;          // Entries left of the effect that failed, only touched by the loop
+
+    // Input reports, only touched by the loop once started
+    pid_input_fn input;
+    void* input_ctx;
+
+    // Emergency stop
+    pid_atomic_t stop_control;  // PID_DC_* bits to send, 0 if no stop is pending
+    pid_atomic_t stopped;       // Output is locked until pid_writer_resume()
+    pid_atomic_t stop_requested_us;
+    int safety_switch;          // Last seen safety switch bit, -1 if unknown
+
+    // Statistics
+    pid_atomic_t writes;
+    pid_atomic_t errors;
+    pid_atomic_t dropped;       // Queued reports discarded by a stop or a failed upload
+    pid_atomic_t rollbacks;     // Effects freed by the loop after a failed write
+    pid_atomic_t stop_latency_us;     // Latency of the last stop
+    pid_atomic_t stop_latency_max_us; // Worst case stop latency
+    pid_atomic_t write_latency_us;    // Time spent in hid_write, averaged over ~8 writes
+} pid_writer;
+
+// The report lengths and fields are taken from codec.
+// Returns 0 on success
+int pid_writer_init(pid_writer* writer, hid_device* handle, const pid_codec* codec, unsigned int period_ms);
+
+// Streams the value returned by fn to the effect at index on every tick.
+// Must be called before pid_writer_start().
+// Returns 0 on success, -1 if the device has no SET_CONSTANT_FORCE_REPORT.
+int pid_writer_set_stream(pid_writer* writer, unsigned char index, pid_stream_fn fn, void* ctx);
+
+// Hands the input reports read by the loop to fn.
+// Must be called before pid_writer_start().
+void pid_writer_set_input(pid_writer* writer, pid_input_fn fn, void* ctx);
+
+// Changes the tick of the loop, from the next tick on.
+// Safe to call from any thread, including the stream callback.
+void pid_writer_set_period(pid_writer* writer, unsigned int period_ms);
+unsigned int pid_writer_period(pid_writer* writer);
+
+// Starts and stops the loop thread. Returns 0 on success
+int pid_writer_start(pid_writer* writer);
+void pid_writer_stop(pid_writer* writer);
+
+void pid_writer_destroy(pid_writer* writer);
+
+// Queues a report. Returns 0 on success, -1 if the queue is full,
+// the report is too long or the writer is stopped.
+int pid_writer_submit(pid_writer* writer, const unsigned char* data, size_t length);
+
+// Queues a report without copying it (e.g. an image of pid_templates.h).
+// data is read when the report is written, so it must stay valid and must
+// not be patched until then. Returns 0 on success, -1 as pid_writer_submit().
+int pid_writer_submit_ref(pid_writer* writer, const unsigned char* data, size_t length);
+
+// Queues the count reports of the effect at block, back-to-back and
+// without copying them, all of them or none. If one of them fails to be
+// written, the loop drops the others and frees the block with a
+// PID_BLOCK_FREE_REPORT, so the device does not leak effect memory.
+// Returns 0 on success, -1 if the queue has no room for all of them,
+// one is too long or the writer is stopped.
+int pid_writer_submit_effect(pid_writer* writer, unsigned char block, const unsigned char* const* data,
+                             const size_t* lengths, unsigned int count);
+
+// Sends and reads a feature report from the calling thread, after the
+// write in flight, if any. Safe to call whether the loop runs or not.
+// Return what hid_send_feature_report() / hid_get_feature_report() return.
+int pid_writer_send_feature(pid_writer* writer, const unsigned char* data, size_t length);
+int pid_writer_get_feature(pid_writer* writer, unsigned char* data, size_t length);
+
+// Writes a report from the calling thread, after the write in flight,
+// ahead of the queue. Returns what hid_write() returns.
+int pid_writer_write(pid_writer* writer, const unsigned char* data, size_t length);
+
+// Waits up to timeout_ms for every report queued so far to be written
+// or dropped. Returns 0 on success, -1 on timeout
+int pid_writer_flush(pid_writer* writer, unsigned int timeout_ms);
+
+// Queues a PID_DEVICE_CONTROL_REPORT with the PID_DC_* bits of control.
+// Returns 0 on success
+int pid_writer_device_control(pid_writer* writer, unsigned char control);
+
+// Discards the queue and sends a PID_DEVICE_CONTROL_REPORT with control
+// (PID_DC_STOP_ALL_EFFECTS and/or PID_DC_DISABLE_ACTUATORS) ahead of
+// anything else. Every output is then rejected until pid_writer_resume().
+// Safe to call from any thread.
+void pid_writer_emergency_stop(pid_writer* writer, unsigned char control);
+
+// Accepts output again after an emergency stop.
+// The caller is responsible for enabling the actuators again.
+void pid_writer_resume(pid_writer* writer);
+
+int pid_writer_is_stopped(pid_writer* writer);
+
+#endif // PID_WRITER_H__
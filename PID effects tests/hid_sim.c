@@ -0,0 +1,148 @@
+#include "hid_sim.h"
+
+#include <string.h>
+
+#include "pid_reports.h"
+
+hid_sim hid_sim_device;
+
+static const unsigned char hid_sim_report_descriptor[] = {
+#include "report_descriptor.txt"
+};
+
+void hid_sim_reset(unsigned int write_latency_us) {
+    memset(&hid_sim_device, 0x00, sizeof(hid_sim_device));
+    hid_sim_device.write_latency_us = (long)write_latency_us;
+}
+
+hid_device* hid_sim_handle(void) {
+    return (hid_device*)&hid_sim_device;
+}
+
+const unsigned char* hid_sim_descriptor(size_t* length) {
+    *length = sizeof(hid_sim_report_descriptor);
+    return hid_sim_report_descriptor;
+}
+
+int hid_sim_input(const unsigned char* report, size_t length) {
+    long tail = pid_atomic_load(&hid_sim_device.input_tail);
+
+    if (length == 0 || length > HID_SIM_REPORT_MAX
+        || tail - pid_atomic_load(&hid_sim_device.input_head) >= HID_SIM_INPUT_LEN)
+        return -1;
+
+    memcpy(hid_sim_device.input[tail % HID_SIM_INPUT_LEN], report, length);
+    hid_sim_device.input_length[tail % HID_SIM_INPUT_LEN] = length;
+    pid_atomic_store(&hid_sim_device.input_tail, tail + 1);
+    return 0;
+}
+
+static void hid_sim_record(const unsigned char* data, size_t length) {
+    size_t n = length < HID_SIM_REPORT_MAX ? length : HID_SIM_REPORT_MAX;
+
+    memcpy(hid_sim_device.last[data[0]], data, n);
+    pid_atomic_add(&hid_sim_device.count[data[0]], 1);
+    pid_atomic_add(&hid_sim_device.bytes, (long)length);
+}
+
+// Blocks as the real transfer does, leaving the CPU to the other threads.
+// Sleep() is too coarse on Windows, it spins there instead
+static void hid_sim_wait(long long end) {
+    while (pid_time_us() < end) {
+#ifdef _WIN32
+        YieldProcessor();
+#else
+        long long left = end - pid_time_us();
+        struct timespec ts;
+
+        if (left <= 0)
+            break;
+        ts.tv_sec = (time_t)(left / 1000000);
+        ts.tv_nsec = (long)(left % 1000000) * 1000;
+        nanosleep(&ts, NULL);
+#endif
+    }
+}
+
+// Called from one thread at a time
+int HID_API_CALL hid_write(hid_device* dev, const unsigned char* data, size_t length) {
+    long long start = pid_time_us();
+    hid_sim_write* entry;
+    long n;
+
+    (void)dev;
+    if (length == 0)
+        return -1;
+
+    hid_sim_wait(start + pid_atomic_load(&hid_sim_device.write_latency_us));
+
+    n = pid_atomic_load(&hid_sim_device.writes);
+    entry = &hid_sim_device.log[n % HID_SIM_LOG_LEN];
+    entry->report_id = data[0];
+    entry->start_us = start;
+    entry->end_us = pid_time_us();
+    pid_atomic_add(&hid_sim_device.writes, 1);
+
+    // The write went out, but the device did not take it
+    if (n + 1 == pid_atomic_load(&hid_sim_device.fail_write))
+        return -1;
+
+    hid_sim_record(data, length);
+    return (int)length;
+}
+
+int HID_API_CALL hid_send_feature_report(hid_device* dev, const unsigned char* data, size_t length) {
+    (void)dev;
+    if (length == 0)
+        return -1;
+
+    hid_sim_wait(pid_time_us() + pid_atomic_load(&hid_sim_device.feature_latency_us));
+
+    hid_sim_record(data, length);
+    pid_atomic_add(&hid_sim_device.features, 1);
+    return (int)length;
+}
+
+int HID_API_CALL hid_get_feature_report(hid_device* dev, unsigned char* data, size_t length) {
+    (void)dev;
+    if (length < 3)
+        return -1;
+
+    hid_sim_wait(pid_time_us() + pid_atomic_load(&hid_sim_device.feature_latency_us));
+    pid_atomic_add(&hid_sim_device.features, 1);
+
+    // PID_BLOCK_LOAD_REPORT
+    // Data: index (8), block load status (8), RAM pool available (16)
+    if (data[0] == PID_BLOCK_LOAD_REPORT_ID) {
+        hid_sim_device.block = hid_sim_device.block % PID_MAX_EFFECT_BLOCKS + 1;
+        data[1] = (unsigned char)hid_sim_device.block;
+        data[2] = PID_BLOCK_LOAD_SUCCESS;
+    }
+    return (int)length;
+}
+
+// Never waits, the writer loop only polls
+int HID_API_CALL hid_read_timeout(hid_device* dev, unsigned char* data, size_t length, int milliseconds) {
+    long head = pid_atomic_load(&hid_sim_device.input_head);
+    size_t n;
+
+    (void)dev;
+    (void)milliseconds;
+    if (head == pid_atomic_load(&hid_sim_device.input_tail))
+        return 0;
+
+    n = hid_sim_device.input_length[head % HID_SIM_INPUT_LEN];
+    if (n > length)
+        n = length;
+    memcpy(data, hid_sim_device.input[head % HID_SIM_INPUT_LEN], n);
+    pid_atomic_store(&hid_sim_device.input_head, head + 1);
+    return (int)n;
+}
+
+int HID_API_CALL hid_get_report_descriptor(hid_device* dev, unsigned char* buf, size_t buf_size) {
+    (void)dev;
+    if (buf_size < sizeof(hid_sim_report_descriptor))
+        return -1;
+    memcpy(buf, hid_sim_report_descriptor, sizeof(hid_sim_report_descriptor));
+    return (int)sizeof(hid_sim_report_descriptor);
+}
@@ -0,0 +1,66 @@
+// Simulated device
+// Implements the hidapi functions the modules call, as a device with the
+// report descriptor of report_descriptor.txt would answer them:
+// - every hid_write takes write_latency_us, as a write waiting for the
+//   next USB frame does on the wheel, and every feature report (a control
+//   transfer) feature_latency_us
+// - hid_write number fail_write (from 1, 0 for none) fails
+// - the last HID_SIM_LOG_LEN writes are logged with their timing
+// - output and feature reports are counted per report ID, and the last
+//   one of each ID is kept
+// - PID_BLOCK_LOAD_REPORT hands out the effect blocks 1 to
+//   PID_MAX_EFFECT_BLOCKS in turn
+// - input reports are read back in the order hid_sim_input() queued them
+
+#ifndef HID_SIM_H__
+#define HID_SIM_H__
+
+#include "hidapi.h"
+#include "pid_platform.h"
+
+#define HID_SIM_REPORT_MAX 64
+#define HID_SIM_INPUT_LEN 16
+#define HID_SIM_LOG_LEN 256
+
+// A write as seen by the device
+typedef struct hid_sim_write {
+    unsigned char report_id;
+    long long start_us;
+    long long end_us;
+} hid_sim_write;
+
+typedef struct hid_sim {
+    pid_atomic_t write_latency_us;
+    pid_atomic_t feature_latency_us;
+    pid_atomic_t fail_write;
+    pid_atomic_t writes;            // hid_write
+    hid_sim_write log[HID_SIM_LOG_LEN]; // Write n in log[n % HID_SIM_LOG_LEN]
+    pid_atomic_t features;          // Feature reports sent and read
+    pid_atomic_t bytes;             // Written by both
+    pid_atomic_t count[256];        // Per report ID
+    unsigned char last[256][HID_SIM_REPORT_MAX];
+    int block;                      // Last effect block handed out
+
+    // Input reports, one producer and one reader
+    unsigned char input[HID_SIM_INPUT_LEN][HID_SIM_REPORT_MAX];
+    size_t input_length[HID_SIM_INPUT_LEN];
+    pid_atomic_t input_head;
+    pid_atomic_t input_tail;
+} hid_sim;
+
+extern hid_sim hid_sim_device;
+
+// Clears the counters and sets the time taken by every write
+void hid_sim_reset(unsigned int write_latency_us);
+
+// Handle passed to the modules, never dereferenced
+hid_device* hid_sim_handle(void);
+
+// Queues an input report, report[0] being the report ID.
+// Returns 0 on success, -1 if the queue is full
+int hid_sim_input(const unsigned char* report, size_t length);
+
+// Report descriptor of the simulated device
+const unsigned char* hid_sim_descriptor(size_t* length);
+
+#endif // HID_SIM_H__
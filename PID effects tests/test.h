@@ -0,0 +1,51 @@
+// Tests and benchmarks of the force feedback modules
+// A console program built next to the demo. The modules are compiled
+// from ../PID effects example and talk to the simulated device of
+// hid_sim.h instead of hidapi, so it runs without a wheel.
+//
+// Every test_* function checks its results with TEST_CHECK. Benchmarks
+// print their timings and only check that both paths agree.
+
+#ifndef TEST_H__
+#define TEST_H__
+
+#include <stdio.h>
+
+#define TEST_CHECK(cond) test_check((cond) != 0, #cond, __FILE__, __LINE__)
+
+#define TEST_BENCH_ITERATIONS 1000000
+
+// Counts and reports a failed check. Returns ok
+int test_check(int ok, const char* expr, const char* file, int line);
+
+// Prints the time per iteration of a benchmark
+void test_bench_report(const char* name, long long elapsed_us, long iterations);
+
+// Benchmarks fold their results in, so the compiler keeps the work
+extern volatile unsigned long test_sink;
+
+void test_writer(void);
+void test_watchdog(void);
+void test_codec(void);
+void test_templates(void);
+void test_upload(void);
+void test_effect(void);
+void test_ramp(void);
+void test_fit(void);
+void test_deadband(void);
+void test_resample(void);
+void test_predict(void);
+void test_filter(void);
+void test_slew(void);
+void test_envelope(void);
+void test_jitter(void);
+void test_limiter(void);
+void test_rate(void);
+void test_noise(void);
+void test_track(void);
+void test_expr(void);
+void test_graph(void);
+void test_plugin(void);
+void test_impulse(void);
+
+#endif // TEST_H__
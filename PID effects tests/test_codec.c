@@ -0,0 +1,222 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_layout.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+
+static pid_codec codec; // Too large for the stack
+
+// The generated encoders write the same bytes as the codec
+static void test_codec_layout(const pid_field* magnitude, size_t length) {
+    unsigned char generated[PID_LAYOUT_SET_CONSTANT_FORCE_LENGTH];
+    unsigned char runtime[PID_LAYOUT_SET_CONSTANT_FORCE_LENGTH];
+    int mismatches = 0, decoded = 0;
+    long value;
+
+    TEST_CHECK(pid_layout_matches(&codec) == 1);
+    TEST_CHECK(length == sizeof(generated));
+
+    for (value = -32768; value <= 32767; value++) {
+        memset(generated, 0x00, sizeof(generated));
+        memset(runtime, 0x00, sizeof(runtime));
+        generated[0] = runtime[0] = SET_CONSTANT_FORCE_REPORT_ID;
+        pid_layout_put_set_constant_force_effect_block_index(generated, 1);
+        pid_layout_put_set_constant_force_magnitude(generated, value);
+        runtime[1] = 1;
+        pid_codec_put_raw(magnitude, runtime, value);
+
+        if (memcmp(generated, runtime, sizeof(generated)) != 0)
+            mismatches++;
+        if (pid_codec_get_raw(magnitude, generated) == value)
+            decoded++;
+    }
+    TEST_CHECK(mismatches == 0);
+    TEST_CHECK(decoded == 65536);
+}
+
+// SET_CONSTANT_FORCE_REPORT encoded through the descriptor (field looked
+// up on every report, as the demo did), through a field looked up once,
+// and with the generated layout
+static void test_codec_bench(const pid_field* magnitude, size_t length) {
+    unsigned char buf[PID_LAYOUT_SET_CONSTANT_FORCE_LENGTH] = { SET_CONSTANT_FORCE_REPORT_ID, 1 };
+    const pid_field* field;
+    long long start;
+    long i;
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        field = pid_codec_find(&codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID,
+                               PID_USAGE(PID_PAGE_PID, PID_USAGE_MAGNITUDE), 0);
+        memset(buf + 2, 0x00, length - 2);
+        pid_codec_put_raw(field, buf, (short)i);
+        test_sink += buf[2];
+    }
+    test_bench_report("SET_CONSTANT_FORCE, lookup + codec", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        memset(buf + 2, 0x00, length - 2);
+        pid_codec_put_raw(magnitude, buf, (short)i);
+        test_sink += buf[2];
+    }
+    test_bench_report("SET_CONSTANT_FORCE, codec", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        pid_layout_put_set_constant_force_magnitude(buf, (short)i);
+        test_sink += buf[2];
+    }
+    test_bench_report("SET_CONSTANT_FORCE, generated layout", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+}
+
+// Logical ranges given on 4 bytes are signed, whatever the size of long
+static void test_codec_signed(void) {
+    static pid_codec small;
+    static const unsigned char descriptor[] = {
+        0x05, 0x01,                     // Usage Page (Generic Desktop)
+        0x09, 0x04,                     // Usage (Joystick)
+        0xA1, 0x01,                     // Collection (Application)
+        0x85, 0x01,                     //   Report ID (1)
+        0x09, 0x30,                     //   Usage (X)
+        0x17, 0x60, 0x79, 0xFE, 0xFF,   //   Logical Minimum (-100000)
+        0x27, 0xA0, 0x86, 0x01, 0x00,   //   Logical Maximum (100000)
+        0x75, 0x20,                     //   Report Size (32)
+        0x95, 0x01,                     //   Report Count (1)
+        0x81, 0x02,                     //   Input (Data, Var, Abs)
+        0xC0,                           // End Collection
+    };
+    unsigned char report[5] = { 0x01 };
+    const pid_field* x;
+
+    if (!TEST_CHECK(pid_codec_parse(&small, descriptor, sizeof(descriptor)) == 0))
+        return;
+    x = pid_codec_find(&small, PID_REPORT_INPUT, 0x01, PID_USAGE(PID_PAGE_GENERIC_DESKTOP, PID_GD_USAGE_X), 0);
+    if (!TEST_CHECK(x != NULL))
+        return;
+    TEST_CHECK(x->logical_min == -100000);
+    TEST_CHECK(x->logical_max == 100000);
+
+    pid_codec_put_raw(x, report, -100000);
+    TEST_CHECK(pid_codec_get_raw(x, report) == -100000);
+}
+
+// Field of a single report at bit 0, with its ranges and unit
+static pid_field test_codec_field(unsigned int bit_size, long logical_min, long logical_max,
+                                  long physical_min, long physical_max, unsigned long unit, int unit_exponent) {
+    pid_field field;
+
+    memset(&field, 0x00, sizeof(field));
+    field.report_id = 0x01;
+    field.kind = PID_REPORT_OUTPUT;
+    field.bit_size = bit_size;
+    field.logical_min = logical_min;
+    field.logical_max = logical_max;
+    field.physical_min = physical_min;
+    field.physical_max = physical_max;
+    field.unit = unit;
+    field.unit_exponent = unit_exponent;
+    return field;
+}
+
+// Times in ms against fields of known ranges and units, rounded to the
+// nearest logical value and clamped to the logical range
+static void test_codec_ms(void) {
+    static const struct {
+        long logical_max, physical_max;
+        unsigned long unit;     // 0x1003: seconds, SI linear
+        int unit_exponent;
+        unsigned long ms;
+        long expected;
+    } cases[] = {
+        { 32767, 32767, 0, 0, 1000, 1000 },             // No unit, ms
+        { 32767, 32767, 0x1003, -3, 1000, 1000 },       // ms
+        { 32767, 32767, 0x1003, -4, 1000, 10000 },      // 100 us
+        { 32767, 32767, 0x1003, -2, 1005, 101 },        // 10 ms, rounded
+        { 32767, 32767, 0x1003, -3, 40000, 32767 },     // Clamped
+        { 255, 10000, 0x1003, -3, 10000, 255 },         // Scaled
+        { 255, 10000, 0x1003, -3, 2000, 51 },
+        { 255, 10000, 0x1003, -3, 0, 0 },
+    };
+    unsigned char report[4] = { 0x01 };
+    pid_field_codec fc;
+    pid_field field;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        field = test_codec_field(16, 0, cases[i].logical_max, 0, cases[i].physical_max, cases[i].unit, cases[i].unit_exponent);
+        if (!TEST_CHECK(pid_codec_bind(&fc, &field, PID_CODEC_MS) == 0))
+            continue;
+        pid_codec_put_ms(&fc, report, cases[i].ms);
+        if (!TEST_CHECK(pid_codec_get_raw(&field, report) == cases[i].expected))
+            printf("  case %u: %ld\n", i, pid_codec_get_raw(&field, report));
+    }
+}
+
+// -1.0..1.0 of the physical range, for a signed magnitude and an
+// unsigned gain
+static void test_codec_normalized(void) {
+    static const struct {
+        long logical_min, logical_max, physical_min, physical_max;
+        float value;
+        long expected;
+    } cases[] = {
+        { -10000, 10000, -10000, 10000, 0.5f, 5000 },
+        { -10000, 10000, -10000, 10000, -0.25f, -2500 },
+        { -10000, 10000, -10000, 10000, 1.5f, 10000 },  // Clamped to 1.0
+        { -10000, 10000, -10000, 10000, -2.0f, -10000 },
+        { -32767, 32767, -10000, 10000, 1.0f, 32767 },  // Scaled
+        { -32767, 32767, -10000, 10000, -0.25f, -8192 },
+        { 0, 255, 0, 10000, 1.0f, 255 },
+        { 0, 255, 0, 10000, 0.2f, 51 },
+        { 0, 255, 0, 10000, -1.0f, 0 },                 // Clamped to the logical range
+    };
+    unsigned char report[4] = { 0x01 };
+    pid_field_codec fc;
+    pid_field field;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        field = test_codec_field(16, cases[i].logical_min, cases[i].logical_max,
+                                 cases[i].physical_min, cases[i].physical_max, 0, 0);
+        if (!TEST_CHECK(pid_codec_bind(&fc, &field, PID_CODEC_NORMALIZED) == 0))
+            continue;
+        pid_codec_put_normalized(&fc, report, cases[i].value);
+        if (!TEST_CHECK(pid_codec_get_raw(&field, report) == cases[i].expected))
+            printf("  case %u: %ld\n", i, pid_codec_get_raw(&field, report));
+    }
+}
+
+// A field without bits reads as 0
+static void test_codec_empty(void) {
+    unsigned char report[2] = { 0x01, 0xff };
+    pid_field field = test_codec_field(0, -1, 1, -1, 1, 0, 0);
+
+    TEST_CHECK(pid_codec_get_raw(&field, report) == 0);
+}
+
+void test_codec(void) {
+    const pid_field* magnitude;
+    const unsigned char* descriptor;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+
+    magnitude = pid_codec_find(&codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID,
+                               PID_USAGE(PID_PAGE_PID, PID_USAGE_MAGNITUDE), 0);
+    length = pid_codec_report_length(&codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID);
+    if (!TEST_CHECK(magnitude != NULL))
+        return;
+
+    test_codec_layout(magnitude, length);
+    test_codec_signed();
+    test_codec_ms();
+    test_codec_normalized();
+    test_codec_empty();
+    test_codec_bench(magnitude, length);
+}
@@ -0,0 +1,77 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ffb_deadband.h"
+
+#define TEST_TRACE_TICKS 10000
+#define TEST_PI 3.14159265
+
+enum TEST_TRACE {
+    TEST_TRACE_TOGGLE = 0,  // main(): +/-1500 every 100 ticks
+    TEST_TRACE_SINE,        // 1.5 Hz aligning torque with road noise
+    TEST_TRACE_DRIFT,       // Slow drift, a few LSB per tick
+    TEST_TRACE_COUNT,
+};
+
+static const char* test_trace_names[TEST_TRACE_COUNT] = { "toggle", "sine + noise", "drift" };
+
+static short test_trace(int trace, int t) {
+    switch (trace) {
+    case TEST_TRACE_TOGGLE:
+        return (t / 100) % 2 ? -1500 : 1500;
+    case TEST_TRACE_SINE:
+        return (short)(8000.0 * sin(2.0 * TEST_PI * 1.5 * t / 1000.0) + 40.0 * sin(t * 1.7) + 25.0 * sin(t * 0.37));
+    default:
+        return (short)(2000 + t * 3 / 4);
+    }
+}
+
+// Replays a trace through the dead-band, the device holding the last
+// update: each tick the held force is within the jnd of the trace,
+// and no more than max_skip ticks go by without an update
+static void test_deadband_replay(int trace, int floor, int weber, unsigned int max_skip) {
+    ffb_deadband deadband;
+    double error, sum = 0.0;
+    int held = 0, jnd, worst = 0, beyond = 0;
+    unsigned int gap = 0, longest = 0;
+    short magnitude, out;
+    int t;
+
+    ffb_deadband_init(&deadband, floor, weber, max_skip);
+    for (t = 0; t < TEST_TRACE_TICKS; t++) {
+        magnitude = test_trace(trace, t);
+        if (ffb_deadband_update(&deadband, magnitude, &out)) {
+            held = out;
+            gap = 0;
+        }
+        else if (++gap > longest) {
+            longest = gap;
+        }
+
+        jnd = abs(held) * weber / FFB_DEADBAND_UNITY;
+        if (jnd < floor)
+            jnd = floor;
+        if (abs(magnitude - held) > jnd)
+            beyond++;
+        if (abs(magnitude - held) > worst)
+            worst = abs(magnitude - held);
+        error = magnitude - held;
+        sum += error * error;
+    }
+
+    printf("  %-14s %3d%% of the writes saved, error max %4d rms %5.1f\n", test_trace_names[trace],
+           ffb_deadband_reduction(&deadband), worst, sqrt(sum / TEST_TRACE_TICKS));
+    TEST_CHECK(beyond == 0);
+    TEST_CHECK(longest < max_skip);
+    TEST_CHECK(worst == deadband.max_error);
+    TEST_CHECK(deadband.ticks == TEST_TRACE_TICKS);
+}
+
+void test_deadband(void) {
+    int trace;
+
+    for (trace = 0; trace < TEST_TRACE_COUNT; trace++)
+        test_deadband_replay(trace, 16, FFB_DEADBAND_UNITY / 20, 10);
+}
@@ -0,0 +1,189 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_effect.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+// Interrupt OUT writes wait for the next frame, a control transfer
+// (feature report) takes about one as well at full speed
+#define TEST_USB_FRAME_US 1000
+#define TEST_EFFECTS 20
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+
+// Steps 3 to 8 of main() as they were, one call and one check per report.
+// Returns the effect block index, -1 on failure
+static int test_create_sequential(hid_device* handle) {
+    unsigned char buf[256];
+    unsigned char index;
+
+    // CREATE_NEW_EFFECT_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = CREATE_NEW_EFFECT_REPORT_ID;
+    buf[1] = PID_ET_CONSTANT_FORCE;
+    if (hid_send_feature_report(handle, buf, 4) < 0)
+        return -1;
+
+    // PID_BLOCK_LOAD_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = PID_BLOCK_LOAD_REPORT_ID;
+    if (hid_get_feature_report(handle, buf, 19) < 0)
+        return -1;
+    index = buf[1];
+    if (index == 0)
+        return -1;
+
+    // SET_CONSTANT_FORCE_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
+    buf[1] = index;
+    if (hid_write(handle, buf, 5) < 0)
+        return -1;
+
+    // SET_ENVELOPE_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = SET_ENVELOPE_REPORT_ID;
+    buf[1] = index;
+    if (hid_write(handle, buf, 15) < 0)
+        return -1;
+
+    // SET_EFFECT_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = SET_EFFECT_REPORT_ID;
+    buf[1] = index;
+    buf[2] = PID_ET_CONSTANT_FORCE;
+    buf[3] = 0xff; // Duration
+    buf[4] = 0xff;
+    buf[11] = 0xff; // Gain
+    buf[12] = 0xff; // Trigger Button
+    buf[13] = 0b00000100; // Direction Enable
+    buf[14] = 0x28; // Direction X
+    buf[15] = 0x23;
+    if (hid_write(handle, buf, 23) < 0)
+        return -1;
+
+    // EFFECT_OPERATION_REPORT
+    memset(buf, 0x00, sizeof(buf));
+    buf[0] = EFFECT_OPERATION_REPORT_ID;
+    buf[1] = index;
+    buf[2] = PID_OP_EFFECT_START;
+    if (hid_write(handle, buf, 4) < 0)
+        return -1;
+
+    return index;
+}
+
+// A write failing in the middle of the upload frees the block it got,
+// and the reports of the effect after it are not written
+static void test_effect_rollback(const pid_effect_desc* desc) {
+    pid_writer writer;
+    long fail;
+
+    for (fail = 1; fail <= 4; fail++) {
+        hid_sim_reset(0);
+        hid_sim_device.fail_write = fail;
+        TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+        TEST_CHECK(pid_writer_start(&writer) == 0);
+
+        TEST_CHECK(pid_effect_create(&writer, &templates, desc) == 1);
+        TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+        pid_writer_stop(&writer);
+
+        TEST_CHECK(hid_sim_device.count[PID_BLOCK_FREE_REPORT_ID] == 1);
+        TEST_CHECK(hid_sim_device.last[PID_BLOCK_FREE_REPORT_ID][1] == hid_sim_device.block);
+        TEST_CHECK(hid_sim_device.count[EFFECT_OPERATION_REPORT_ID] == 0);
+        TEST_CHECK(pid_atomic_load(&writer.rollbacks) == 1);
+        TEST_CHECK(pid_atomic_load(&writer.dropped) == 4 - fail);
+        pid_writer_destroy(&writer);
+    }
+
+    // A queue without room for the whole effect queues none of it, the
+    // block is freed right away
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    for (fail = 0; fail < PID_WRITER_QUEUE_LEN - 3; fail++)
+        TEST_CHECK(pid_writer_device_control(&writer, PID_DC_DEVICE_CONTINUE) == 0);
+    TEST_CHECK(pid_effect_create(&writer, &templates, desc) == -1);
+    TEST_CHECK(hid_sim_device.count[PID_BLOCK_FREE_REPORT_ID] == 1);
+    TEST_CHECK(writer.count == PID_WRITER_QUEUE_LEN - 3);
+    pid_writer_destroy(&writer);
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    TEST_CHECK(pid_effect_create(&writer, &templates, desc) == 1);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    pid_writer_stop(&writer);
+    TEST_CHECK(hid_sim_device.count[PID_BLOCK_FREE_REPORT_ID] == 0);
+    TEST_CHECK(hid_sim_device.count[EFFECT_OPERATION_REPORT_ID] == 1);
+    TEST_CHECK(pid_atomic_load(&writer.rollbacks) == 0);
+    pid_writer_destroy(&writer);
+}
+
+// Time the caller waits for an effect, with the transfers taking no time
+// (the host side only) then one frame each. The old steps wait for all
+// six transfers, pid_effect_create() for the two feature reports, the
+// writer loop sending the four others while the caller goes on. Only the
+// calls are timed, the queue is flushed between them
+static void test_effect_bench(const pid_effect_desc* desc) {
+    static const unsigned int latencies[] = { 0, TEST_USB_FRAME_US };
+    static const int counts[] = { 200, TEST_EFFECTS };
+    pid_writer writer;
+    char name[64];
+    long long start, elapsed;
+    int failures = 0;
+    int i, k;
+
+    for (k = 0; k < 2; k++) {
+        hid_sim_reset(latencies[k]);
+        hid_sim_device.feature_latency_us = latencies[k];
+        start = pid_time_us();
+        for (i = 0; i < counts[k]; i++)
+            failures += test_create_sequential(hid_sim_handle()) < 0;
+        snprintf(name, sizeof(name), "setup, main() steps, %u us transfers", latencies[k]);
+        test_bench_report(name, pid_time_us() - start, counts[k]);
+        TEST_CHECK(hid_sim_device.writes + hid_sim_device.features == 6 * counts[k]);
+
+        hid_sim_reset(latencies[k]);
+        hid_sim_device.feature_latency_us = latencies[k];
+        TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+        TEST_CHECK(pid_writer_start(&writer) == 0);
+        elapsed = 0;
+        for (i = 0; i < counts[k]; i++) {
+            start = pid_time_us();
+            failures += pid_effect_create(&writer, &templates, desc) < 0;
+            elapsed += pid_time_us() - start;
+            failures += pid_writer_flush(&writer, 1000) < 0;
+        }
+        pid_writer_stop(&writer);
+        pid_writer_destroy(&writer);
+        snprintf(name, sizeof(name), "setup, pid_effect_create, %u us transfers", latencies[k]);
+        test_bench_report(name, elapsed, counts[k]);
+        TEST_CHECK(hid_sim_device.writes + hid_sim_device.features == 6 * counts[k]);
+    }
+    TEST_CHECK(failures == 0);
+}
+
+void test_effect(void) {
+    const unsigned char* descriptor;
+    pid_effect_desc desc;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+    TEST_CHECK(pid_effect_desc_init(&desc, &templates, PID_ET_CONSTANT_FORCE) == 0);
+    desc.start = 1;
+
+    test_effect_rollback(&desc);
+    test_effect_bench(&desc);
+}
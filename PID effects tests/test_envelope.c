@@ -0,0 +1,145 @@
+#include "test.h"
+
+#include "ffb_envelope.h"
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+
+static const ffb_envelope_params test_envelope_params = {
+    -12000,     // magnitude
+    2000,       // attack level
+    4000,       // fade level
+    100,        // attack time
+    200,        // fade time
+    50,         // start delay
+    1000,       // duration
+};
+
+// A device effect is uploaded with its envelope through the running
+// writer loop when started, freed when stopped, and never adds to the
+// host output
+static void test_envelope_device(void) {
+    ffb_envelope envelope;
+    ffb_envelope_params params = test_envelope_params;
+    const unsigned char* report;
+    pid_writer writer;
+    int slot;
+
+    hid_sim_reset(0);
+    ffb_envelope_init(&envelope);
+    slot = ffb_envelope_add(&envelope, &params, FFB_ENVELOPE_DEVICE);
+    if (!TEST_CHECK(slot >= 0))
+        return;
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 0) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(envelope.index[slot] == hid_sim_device.block);
+    TEST_CHECK(hid_sim_device.count[SET_ENVELOPE_REPORT_ID] == 1);
+    TEST_CHECK(hid_sim_device.count[EFFECT_OPERATION_REPORT_ID] == 1);
+
+    report = hid_sim_device.last[SET_ENVELOPE_REPORT_ID];
+    TEST_CHECK(pid_codec_get_raw(templates.attack_level, report) == params.attack_level);
+    TEST_CHECK(pid_codec_get_raw(templates.fade_level, report) == params.fade_level);
+    TEST_CHECK(pid_codec_get_raw(templates.attack_time, report) == (long)params.attack_time_ms);
+    TEST_CHECK(pid_codec_get_raw(templates.fade_time, report) == (long)params.fade_time_ms);
+    TEST_CHECK(pid_codec_get_raw(templates.constant_magnitude, hid_sim_device.last[SET_CONSTANT_FORCE_REPORT_ID]) == params.magnitude);
+    TEST_CHECK(pid_codec_get_raw(templates.duration, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == (long)params.duration_ms);
+    TEST_CHECK(pid_codec_get_raw(templates.start_delay, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == (long)params.start_delay_ms);
+
+    ffb_envelope_eval(&envelope, 500);
+    TEST_CHECK(ffb_envelope_playing(&envelope, slot) == 1);
+    TEST_CHECK(ffb_envelope_sum(&envelope) == 0);
+    ffb_envelope_eval(&envelope, 1050);
+    TEST_CHECK(ffb_envelope_playing(&envelope, slot) == 0);
+
+    ffb_envelope_stop(&envelope, slot, &writer, &templates);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(envelope.index[slot] == 0);
+    TEST_CHECK(hid_sim_device.count[PID_BLOCK_FREE_REPORT_ID] == 1);
+
+    // Infinite effects play until stopped, finite ones up to the logical
+    // maximum of the Duration field
+    params.duration_ms = FFB_ENVELOPE_INFINITE;
+    ffb_envelope_set(&envelope, slot, &params);
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 0) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_codec_get_raw(templates.duration, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == PID_DURATION_INFINITE);
+    TEST_CHECK(pid_codec_get_raw(templates.fade_time, hid_sim_device.last[SET_ENVELOPE_REPORT_ID]) == 0);
+    ffb_envelope_stop(&envelope, slot, &writer, &templates);
+
+    params.duration_ms = (unsigned long)templates.duration->logical_max;
+    ffb_envelope_set(&envelope, slot, &params);
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 0) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_codec_get_raw(templates.duration, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == templates.duration->logical_max);
+    ffb_envelope_stop(&envelope, slot, &writer, &templates);
+
+    params.duration_ms = (unsigned long)templates.duration->logical_max + 1;
+    ffb_envelope_set(&envelope, slot, &params);
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 0) == -1);
+    TEST_CHECK(ffb_envelope_playing(&envelope, slot) == 0);
+    params.duration_ms = PID_DURATION_INFINITE;
+    ffb_envelope_set(&envelope, slot, &params);
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 0) == -1);
+
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+    hid_sim_reset(0);
+}
+
+// A host effect sends nothing and follows its envelope
+static void test_envelope_host(void) {
+    ffb_envelope envelope;
+    pid_writer writer;
+    int slot;
+
+    hid_sim_reset(0);
+    ffb_envelope_init(&envelope);
+    slot = ffb_envelope_add(&envelope, &test_envelope_params, FFB_ENVELOPE_HOST);
+    if (!TEST_CHECK(slot >= 0))
+        return;
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+
+    TEST_CHECK(ffb_envelope_start(&envelope, slot, &writer, &templates, 1000) == 0);
+    TEST_CHECK(hid_sim_device.writes == 0 && hid_sim_device.features == 0);
+
+    ffb_envelope_eval(&envelope, 1040);      // Start delay
+    TEST_CHECK(ffb_envelope_sum(&envelope) == 0);
+    ffb_envelope_eval(&envelope, 1050);      // Attack level
+    TEST_CHECK(ffb_envelope_sum(&envelope) == -2000);
+    ffb_envelope_eval(&envelope, 1100);      // Half the attack
+    TEST_CHECK(ffb_envelope_sum(&envelope) == -7000);
+    ffb_envelope_eval(&envelope, 1500);
+    TEST_CHECK(ffb_envelope_sum(&envelope) == -12000);
+    ffb_envelope_eval(&envelope, 1950);      // Half the fade
+    TEST_CHECK(ffb_envelope_sum(&envelope) == -8000);
+    ffb_envelope_eval(&envelope, 2050);
+    TEST_CHECK(ffb_envelope_sum(&envelope) == 0);
+    TEST_CHECK(ffb_envelope_playing(&envelope, slot) == 0);
+
+    ffb_envelope_stop(&envelope, slot, &writer, &templates);
+    TEST_CHECK(writer.count == 0);
+    TEST_CHECK(hid_sim_device.writes == 0 && hid_sim_device.features == 0);
+    pid_writer_destroy(&writer);
+}
+
+void test_envelope(void) {
+    const unsigned char* descriptor;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+
+    test_envelope_device();
+    test_envelope_host();
+}
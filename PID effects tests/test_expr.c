@@ -0,0 +1,140 @@
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ffb_expr.h"
+
+#define TEST_EXPR_SAMPLES 100       // More than FFB_EXPR_BLOCK
+#define TEST_EXPR_T 0.25f
+#define TEST_EXPR_DT 0.001f
+
+typedef struct test_expr_value {
+    const char* source;
+    float x;
+    float expected;
+    unsigned int length;    // Instructions left after folding
+} test_expr_value;
+
+// Precedence, associativity, folding and the "name =" prefix
+static const test_expr_value test_expr_values[] = {
+    { "-x^2",                  3.0f,   -9.0f, 4 },
+    { "-2^2",                  0.0f,   -4.0f, 1 },
+    { "2^3^2",                 0.0f,  512.0f, 1 },
+    { "x^2^-1",               16.0f,    4.0f, 3 },
+    { "2 + 3 * 4",             0.0f,   14.0f, 1 },
+    { "(2 + 3) * 4",           0.0f,   20.0f, 1 },
+    { "10 - 4 - 3",            0.0f,    3.0f, 1 },
+    { "64 / 4 / 2",            0.0f,    8.0f, 1 },
+    { "x * -x",                3.0f,   -9.0f, 4 },
+    { "2 * 3 + x",             1.0f,    7.0f, 3 },
+    { "x + 2 * 3",             1.0f,    7.0f, 3 },
+    { "sqrt(16) * x",          2.0f,    8.0f, 3 },
+    { "max(1, 2) + min(3, 4)", 0.0f,    5.0f, 1 },
+    { "clamp(x, -1, 1)",       5.0f,    1.0f, 4 },
+    { "force = x * 2",         3.0f,    6.0f, 3 },
+    { "  f_1=x",               3.0f,    3.0f, 1 },
+    { "x = x + 1",             3.0f,    4.0f, 3 },
+};
+
+typedef struct test_expr_error {
+    const char* source;
+    const char* error;
+    int error_pos;
+} test_expr_error;
+
+static const test_expr_error test_expr_errors[] = {
+    { "min(x)",       "wrong number of arguments", 0 },
+    { "1 + sin(x, 1)", "wrong number of arguments", 4 },
+    { "clamp(x, 1)",  "wrong number of arguments", 0 },
+    { "1 + foo(x)",   "unknown function", 4 },
+    { "x + y",        "unknown variable", 4 },
+    { "x +",          "expected a value", 3 },
+    { "(x + 1",       "expected )", 6 },
+    { "min(x, 1",     "expected )", 8 },
+    { "x 1",          "unexpected character", 2 },
+    { "2 = x",        "unexpected character", 2 },
+    { "force = ",     "expected a value", 8 },
+};
+
+static void test_expr_table(void) {
+    static const char* const names[] = { "x" };
+    const float* vars[1];
+    float x[TEST_EXPR_SAMPLES];
+    float out[TEST_EXPR_SAMPLES];
+    ffb_expr expr;
+    unsigned int i, n;
+    int bad;
+
+    for (i = 0; i < sizeof(test_expr_values) / sizeof(test_expr_values[0]); i++) {
+        const test_expr_value* v = &test_expr_values[i];
+
+        if (!TEST_CHECK(ffb_expr_compile(&expr, v->source, names, 1) == 0)) {
+            printf("  \"%s\": %s at %d\n", v->source, expr.error, expr.error_pos);
+            continue;
+        }
+        for (n = 0; n < TEST_EXPR_SAMPLES; n++)
+            x[n] = v->x;
+        vars[0] = x;
+        ffb_expr_eval(&expr, TEST_EXPR_T, TEST_EXPR_DT, vars, out, TEST_EXPR_SAMPLES);
+        bad = 0;
+        for (n = 0; n < TEST_EXPR_SAMPLES; n++)
+            bad += fabsf(out[n] - v->expected) > 1e-4f;
+        if (!TEST_CHECK(bad == 0))
+            printf("  \"%s\" gives %g, expected %g\n", v->source, out[0], v->expected);
+        if (!TEST_CHECK(expr.length == v->length))
+            printf("  \"%s\" is %u instructions, expected %u\n", v->source, expr.length, v->length);
+    }
+
+    for (i = 0; i < sizeof(test_expr_errors) / sizeof(test_expr_errors[0]); i++) {
+        const test_expr_error* e = &test_expr_errors[i];
+
+        if (!TEST_CHECK(ffb_expr_compile(&expr, e->source, names, 1) == -1))
+            continue;
+        if (!TEST_CHECK(expr.error && strcmp(expr.error, e->error) == 0 && expr.error_pos == e->error_pos))
+            printf("  \"%s\": %s at %d, expected %s at %d\n", e->source, expr.error ? expr.error : "no error",
+                   expr.error_pos, e->error, e->error_pos);
+    }
+}
+
+// A block of the expression of the designer against the same expression
+// computed sample by sample
+static void test_expr_block(void) {
+    static const char* const names[] = { "k", "speed", "rough", "x" };
+    static const char* source = "force = k * sin(speed * t) * rough + clamp(x, -0.5, 0.5) - abs(x)^2 / 2";
+    float values[4][TEST_EXPR_SAMPLES];
+    const float* vars[4];
+    float out[TEST_EXPR_SAMPLES];
+    float t, reference, error, worst = 0.0f;
+    ffb_expr expr;
+    int i, n;
+
+    if (!TEST_CHECK(ffb_expr_compile(&expr, source, names, 4) == 0))
+        return;
+    for (n = 0; n < TEST_EXPR_SAMPLES; n++) {
+        values[0][n] = 2000.0f;
+        values[1][n] = 20.0f + 0.1f * n;
+        values[2][n] = 0.5f + 0.25f * sinf(0.3f * n);
+        values[3][n] = -1.0f + 0.02f * n;
+    }
+    for (i = 0; i < 4; i++)
+        vars[i] = values[i];
+    ffb_expr_eval(&expr, TEST_EXPR_T, TEST_EXPR_DT, vars, out, TEST_EXPR_SAMPLES);
+
+    for (n = 0; n < TEST_EXPR_SAMPLES; n++) {
+        float x = values[3][n];
+
+        t = TEST_EXPR_T + (float)n * TEST_EXPR_DT;
+        reference = values[0][n] * sinf(values[1][n] * t) * values[2][n]
+                  + (x < -0.5f ? -0.5f : x > 0.5f ? 0.5f : x) - powf(fabsf(x), 2.0f) / 2.0f;
+        error = fabsf(out[n] - reference);
+        if (error > worst)
+            worst = error;
+    }
+    TEST_CHECK(worst < 1e-2f);
+}
+
+void test_expr(void) {
+    test_expr_table();
+    test_expr_block();
+}
@@ -0,0 +1,186 @@
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ffb_filter.h"
+#include "pid_platform.h"
+
+#define TEST_PI 3.14159265358979
+#define TEST_RATE_HZ 1000.0f
+#define TEST_BLOCK 32
+#define TEST_FRAMES 4096            // Per tone, the first half settles
+
+static float test_frames[TEST_FRAMES * FFB_FILTER_MAX_CHANNELS];
+
+// Peak of the second half of the response of every channel to a sine
+static void test_filter_tone(ffb_filter* filter, double freq_hz, double* peak) {
+    unsigned int n, c;
+
+    for (n = 0; n < TEST_FRAMES; n++) {
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++)
+            test_frames[n * FFB_FILTER_MAX_CHANNELS + c] = (float)sin(2.0 * TEST_PI * freq_hz * n / TEST_RATE_HZ);
+    }
+
+    ffb_filter_reset(filter);
+    for (n = 0; n < TEST_FRAMES; n += TEST_BLOCK)
+        ffb_filter_process(filter, test_frames + n * FFB_FILTER_MAX_CHANNELS, TEST_BLOCK);
+
+    for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+        peak[c] = 0.0;
+        for (n = TEST_FRAMES / 2; n < TEST_FRAMES; n++) {
+            if (fabs(test_frames[n * FFB_FILTER_MAX_CHANNELS + c]) > peak[c])
+                peak[c] = fabs(test_frames[n * FFB_FILTER_MAX_CHANNELS + c]);
+        }
+    }
+}
+
+// Stage designs land where asked: channel 0 low-pass 40 Hz, 1 notch
+// 25 Hz, 2 lead 5 -> 20 Hz, 3 passes through
+static void test_filter_response(void) {
+    ffb_filter filter;
+    double dc[FFB_FILTER_MAX_CHANNELS], notch[FFB_FILTER_MAX_CHANNELS], high[FFB_FILTER_MAX_CHANNELS];
+
+    TEST_CHECK(ffb_filter_init(&filter, 0, TEST_RATE_HZ) == -1);
+    TEST_CHECK(ffb_filter_init(&filter, FFB_FILTER_MAX_CHANNELS + 1, TEST_RATE_HZ) == -1);
+    TEST_CHECK(ffb_filter_init(&filter, 4, TEST_RATE_HZ) == 0);
+    TEST_CHECK(ffb_filter_set_lowpass(&filter, 4, 0, 40.0f, 0.707f) == -1);
+    TEST_CHECK(ffb_filter_set_lowpass(&filter, 0, FFB_FILTER_MAX_STAGES, 40.0f, 0.707f) == -1);
+    TEST_CHECK(ffb_filter_set_notch(&filter, 0, 0, TEST_RATE_HZ / 2.0f, 2.0f) == -1);
+
+    TEST_CHECK(ffb_filter_set_lowpass(&filter, 0, 0, 40.0f, 0.707f) == 0);
+    TEST_CHECK(ffb_filter_set_notch(&filter, 1, 0, 25.0f, 2.0f) == 0);
+    TEST_CHECK(ffb_filter_set_lead(&filter, 2, 0, 5.0f, 20.0f) == 0);
+
+    test_filter_tone(&filter, 0.5, dc);
+    test_filter_tone(&filter, 25.0, notch);
+    test_filter_tone(&filter, 250.0, high);
+    printf("  low-pass   0.5 Hz %5.3f, 250 Hz %5.3f\n", dc[0], high[0]);
+    printf("  notch      0.5 Hz %5.3f,  25 Hz %5.3f\n", dc[1], notch[1]);
+    printf("  lead       0.5 Hz %5.3f, 250 Hz %5.3f\n", dc[2], high[2]);
+
+    TEST_CHECK(fabs(dc[0] - 1.0) < 0.01);
+    TEST_CHECK(high[0] < 0.05);             // 12 dB per octave from 40 Hz
+    TEST_CHECK(fabs(dc[1] - 1.0) < 0.01);
+    TEST_CHECK(notch[1] < 0.01);
+    TEST_CHECK(fabs(dc[2] - 1.0) < 0.02);
+    TEST_CHECK(fabs(high[2] - 4.0) < 0.2);  // pole / zero
+    TEST_CHECK(fabs(dc[3] - 1.0) < 1e-6 && fabs(high[3] - 1.0) < 1e-3);
+}
+
+// Direct form I in double, one channel at a time
+static void test_filter_reference(const ffb_filter* filter, unsigned int c, const float* in, double* out, unsigned int count) {
+    double x1[FFB_FILTER_MAX_STAGES] = { 0 }, x2[FFB_FILTER_MAX_STAGES] = { 0 };
+    double y1[FFB_FILTER_MAX_STAGES] = { 0 }, y2[FFB_FILTER_MAX_STAGES] = { 0 };
+    double x, y;
+    unsigned int n, s;
+
+    for (n = 0; n < count; n++) {
+        x = in[n * FFB_FILTER_MAX_CHANNELS + c];
+        for (s = 0; s < filter->stages; s++) {
+            y = filter->b0[s][c] * x + filter->b1[s][c] * x1[s] + filter->b2[s][c] * x2[s]
+              - filter->a1[s][c] * y1[s] - filter->a2[s][c] * y2[s];
+            x2[s] = x1[s];
+            x1[s] = x;
+            y2[s] = y1[s];
+            y1[s] = y;
+            x = y;
+        }
+        out[n] = x;
+    }
+}
+
+// Every channel of a full bank, cascading all four stages, filtered in
+// blocks of 1, 4, 16 and 64 frames, matches its own reference
+static void test_filter_channels(void) {
+    static double expected[TEST_FRAMES];
+    static float input[TEST_FRAMES * FFB_FILTER_MAX_CHANNELS];
+    ffb_filter filter;
+    unsigned int seed = 5, n, c, block;
+    double error, worst = 0.0;
+
+    TEST_CHECK(ffb_filter_init(&filter, FFB_FILTER_MAX_CHANNELS, TEST_RATE_HZ) == 0);
+    for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+        TEST_CHECK(ffb_filter_set_lowpass(&filter, c, 0, 60.0f + 10.0f * c, 0.707f) == 0);
+        TEST_CHECK(ffb_filter_set_notch(&filter, c, 1, 18.0f + 2.0f * c, 3.0f) == 0);
+        TEST_CHECK(ffb_filter_set_lead(&filter, c, 2, 4.0f + c, 16.0f + c) == 0);
+        TEST_CHECK(ffb_filter_set_lowpass(&filter, c, 3, 120.0f, 0.5f + 0.1f * c) == 0);
+    }
+
+    // Steps at game frames plus noise, what the filter is there for
+    for (n = 0; n < TEST_FRAMES; n++) {
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+            seed = seed * 1103515245u + 12345u;
+            input[n * FFB_FILTER_MAX_CHANNELS + c] = (float)(((n / 16 + c) * 2654435761u) % 20001) - 10000.0f
+                                                   + (float)((seed >> 8) % 201) - 100.0f;
+        }
+    }
+
+    for (block = 1; block <= 64; block *= 4) {
+        memcpy(test_frames, input, sizeof(input));
+        ffb_filter_reset(&filter);
+        for (n = 0; n < TEST_FRAMES; n += block)
+            ffb_filter_process(&filter, test_frames + n * FFB_FILTER_MAX_CHANNELS, block);
+
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+            test_filter_reference(&filter, c, input, expected, TEST_FRAMES);
+            for (n = 0; n < TEST_FRAMES; n++) {
+                error = fabs(test_frames[n * FFB_FILTER_MAX_CHANNELS + c] - expected[n]);
+                if (error > worst)
+                    worst = error;
+            }
+        }
+    }
+    printf("  8 channels, 4 stages: worst error %.3f against the reference\n", worst);
+    TEST_CHECK(worst < 1.0);
+}
+
+// Cost of a frame of the full bank, against filtering each channel alone
+static void test_filter_bench(void) {
+    ffb_filter filter;
+    long long start;
+    long frames = TEST_BENCH_ITERATIONS / 4;
+    long i;
+    unsigned int c, s, n;
+    float x, y;
+
+    ffb_filter_init(&filter, FFB_FILTER_MAX_CHANNELS, TEST_RATE_HZ);
+    for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+        for (s = 0; s < FFB_FILTER_MAX_STAGES; s++)
+            ffb_filter_set_lowpass(&filter, c, s, 50.0f + c + s, 0.707f);
+    }
+    for (n = 0; n < TEST_BLOCK * FFB_FILTER_MAX_CHANNELS; n++)
+        test_frames[n] = (float)(n % 37) * 100.0f;
+
+    start = pid_time_us();
+    for (i = 0; i < frames; i += TEST_BLOCK) {
+        ffb_filter_process(&filter, test_frames, TEST_BLOCK);
+        test_sink += (unsigned long)test_frames[i % TEST_BLOCK];
+    }
+    test_bench_report("filter, 8 channels x 4 stages, per frame", pid_time_us() - start, frames);
+
+    ffb_filter_reset(&filter);
+    start = pid_time_us();
+    for (i = 0; i < frames; i += TEST_BLOCK) {
+        for (c = 0; c < FFB_FILTER_MAX_CHANNELS; c++) {
+            for (n = 0; n < TEST_BLOCK; n++) {
+                x = test_frames[n * FFB_FILTER_MAX_CHANNELS + c];
+                for (s = 0; s < FFB_FILTER_MAX_STAGES; s++) {
+                    y = filter.b0[s][c] * x + filter.z1[s][c];
+                    filter.z1[s][c] = filter.b1[s][c] * x - filter.a1[s][c] * y + filter.z2[s][c];
+                    filter.z2[s][c] = filter.b2[s][c] * x - filter.a2[s][c] * y;
+                    x = y;
+                }
+                test_frames[n * FFB_FILTER_MAX_CHANNELS + c] = x;
+            }
+        }
+        test_sink += (unsigned long)test_frames[i % TEST_BLOCK];
+    }
+    test_bench_report("filter, channel by channel, per frame", pid_time_us() - start, frames);
+}
+
+void test_filter(void) {
+    test_filter_response();
+    test_filter_channels();
+    test_filter_bench();
+}
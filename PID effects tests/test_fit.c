@@ -0,0 +1,160 @@
+#include "test.h"
+
+#include <stdlib.h>
+
+#include "ffb_fit.h"
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+
+#define TEST_FIT_SAMPLES 256
+#define TEST_FIT_TRACKS 2000
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+static unsigned int test_fit_seed = 1;
+
+static int test_fit_random(int range) {
+    test_fit_seed = test_fit_seed * 1103515245u + 12345u;
+    return (int)((test_fit_seed >> 8) % (unsigned int)range);
+}
+
+// Checks that the segments cover the track in order, each sample within
+// max_error. Returns the number of segments, -1 if the track did not fit
+static int test_fit_check(const short* samples, unsigned int count, int max_error) {
+    ffb_fit_segment segments[TEST_FIT_SAMPLES];
+    unsigned int next = 0, i;
+    int bad = 0;
+    int n, k;
+
+    n = ffb_fit(samples, count, max_error, segments, TEST_FIT_SAMPLES);
+    for (k = 0; k < n; k++) {
+        if (segments[k].first != next || segments[k].length == 0 || segments[k].error > max_error)
+            bad++;
+        for (i = segments[k].first; i < segments[k].first + segments[k].length; i++) {
+            if (abs(samples[i] - ffb_fit_value(&segments[k], i)) > max_error)
+                bad++;
+        }
+        next = segments[k].first + segments[k].length;
+    }
+    TEST_CHECK(next == count);
+    return TEST_CHECK(bad == 0) ? n : -1;
+}
+
+// Noisy ramps of random slopes, each sample of each segment within max_error
+static void test_fit_ramps(void) {
+    short samples[TEST_FIT_SAMPLES];
+    long segments = 0;
+    int failed = 0;
+    int t, i, n, max_error, noise, base;
+    float slope;
+
+    for (t = 0; t < TEST_FIT_TRACKS; t++) {
+        max_error = test_fit_random(20);
+        noise = max_error / 2;
+        slope = (float)(test_fit_random(2000) - 1000) / 37.0f;
+        base = test_fit_random(20000) - 10000;
+        for (i = 0; i < TEST_FIT_SAMPLES; i++)
+            samples[i] = (short)(base + slope * (float)(i % 64) + test_fit_random(2 * noise + 1) - noise);
+
+        n = test_fit_check(samples, TEST_FIT_SAMPLES, max_error);
+        if (n < 0)
+            failed++;
+        else
+            segments += n;
+    }
+    TEST_CHECK(failed == 0);
+    printf("  noisy ramps: %ld segments for %d samples\n", segments, TEST_FIT_TRACKS * TEST_FIT_SAMPLES);
+}
+
+// The +/-1500 toggle of main() (100 samples each way) is one square wave
+static void test_fit_toggle(void) {
+    short samples[1000];
+    ffb_fit_segment segment;
+    int i;
+
+    for (i = 0; i < 1000; i++)
+        samples[i] = (i / 100) % 2 ? -1500 : 1500;
+
+    TEST_CHECK(test_fit_check(samples, 1000, 0) == 1);
+    TEST_CHECK(ffb_fit(samples, 1000, 0, &segment, 1) == 1);
+    TEST_CHECK(segment.kind == FFB_FIT_SQUARE);
+    TEST_CHECK(segment.half_period == 100);
+}
+
+// A ramp running into full scale ends on the largest magnitude the Ramp
+// End field holds, not one step past it
+static void test_fit_ramp_end(void) {
+    short samples[32];
+    ffb_fit_segment segment;
+    pid_effect_desc desc;
+    int i;
+
+    for (i = 0; i < 32; i++)
+        samples[i] = (short)(32767 - (31 - i) * 1000);
+    TEST_CHECK(ffb_fit(samples, 32, 0, &segment, 1) == 1);
+    TEST_CHECK(segment.kind == FFB_FIT_RAMP);
+    TEST_CHECK(segment.length == 32);
+    TEST_CHECK(segment.end == 32767);
+    TEST_CHECK(ffb_fit_to_effect(&segment, 1, &templates, &desc) == 0);
+    TEST_CHECK(desc.ramp_start == samples[0]);
+    TEST_CHECK(desc.ramp_end == 32767);
+
+    for (i = 0; i < 32; i++)
+        samples[i] = (short)(-32767 + (31 - i) * 1000);
+    TEST_CHECK(ffb_fit(samples, 32, 0, &segment, 1) == 1);
+    TEST_CHECK(segment.end == -32767);
+}
+
+// A square wave entering 30 samples into its first half period, between
+// levels of 2500 and -500, for each level coming first
+static void test_fit_square_effect(void) {
+    static const int levels[2][2] = { { 2500, -500 }, { -500, 2500 } };
+    static const long phases[2] = { 70 * 36000 / 200, 170 * 36000 / 200 };
+    short samples[430];
+    ffb_fit_segment segment;
+    pid_effect_desc desc;
+    unsigned long max_ms;
+    int i, k;
+
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < 430; i++)
+            samples[i] = (short)levels[k][i < 30 ? 0 : ((i - 30) / 100 + 1) % 2];
+        TEST_CHECK(ffb_fit(samples, 430, 0, &segment, 1) == 1);
+        TEST_CHECK(segment.kind == FFB_FIT_SQUARE);
+        TEST_CHECK(segment.length == 430);
+        TEST_CHECK(segment.half_period == 100);
+        TEST_CHECK(segment.phase == 70);
+
+        TEST_CHECK(ffb_fit_to_effect(&segment, 2, &templates, &desc) == 0);
+        TEST_CHECK(desc.type == PID_ET_SQUARE);
+        TEST_CHECK(desc.duration == 860);
+        TEST_CHECK(desc.period == 400);
+        TEST_CHECK(desc.phase == phases[k]);
+        TEST_CHECK(desc.magnitude == 1500);
+        TEST_CHECK(desc.offset == 1000);
+    }
+
+    // The duration must fit the Duration field
+    max_ms = (unsigned long)templates.duration->logical_max / 430;
+    TEST_CHECK(ffb_fit_to_effect(&segment, (unsigned int)max_ms, &templates, &desc) == 0);
+    TEST_CHECK(desc.duration == (long)(430 * max_ms));
+    TEST_CHECK(ffb_fit_to_effect(&segment, (unsigned int)max_ms + 1, &templates, &desc) == -1);
+}
+
+void test_fit(void) {
+    const unsigned char* descriptor;
+    size_t length;
+
+    test_fit_ramps();
+    test_fit_toggle();
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+    test_fit_ramp_end();
+    test_fit_square_effect();
+}
@@ -0,0 +1,180 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "ffb_graph.h"
+#include "pid_reports.h"
+
+#define TEST_GRAPH_BLOCKS 50
+#define TEST_GRAPH_SAMPLES 100     // Per render, more than FFB_GRAPH_BLOCK
+#define TEST_GRAPH_WORKERS 2
+
+static ffb_graph test_graphs[2];   // Too large for the stack
+
+// Every node of the order comes after its inputs, on a higher level, and
+// the levels are in order
+static int test_graph_order_ok(const ffb_graph* graph) {
+    int position[FFB_GRAPH_MAX_NODES];
+    const ffb_graph_node* node;
+    unsigned int i, k, level = 0;
+    int bad = 0;
+
+    for (i = 0; i < FFB_GRAPH_MAX_NODES; i++)
+        position[i] = -1;
+    for (i = 0; i < graph->order_count; i++)
+        position[graph->order[i]] = (int)i;
+
+    for (i = 0; i < graph->order_count; i++) {
+        node = &graph->nodes[graph->order[i]];
+        while (level < graph->level_count && i >= graph->level_end[level])
+            level++;
+        bad += node->level != (int)level;
+        for (k = 0; k < node->input_count; k++) {
+            bad += position[node->inputs[k]] < 0 || position[node->inputs[k]] >= (int)i;
+            bad += graph->nodes[node->inputs[k]].level >= node->level;
+        }
+    }
+    return bad == 0;
+}
+
+static void test_graph_compile(void) {
+    ffb_graph* graph = &test_graphs[0];
+    int sine, square, mixer, spring, unused, a, b, sink;
+
+    ffb_graph_init(graph);
+    sine = ffb_graph_add_periodic(graph, PID_ET_SINE, 8000.0f, 0.0f, 100, 0);
+    square = ffb_graph_add_periodic(graph, PID_ET_SQUARE, 2000.0f, 0.0f, 40, 0);
+    mixer = ffb_graph_add_mixer(graph);
+    spring = ffb_graph_add_condition(graph, PID_ET_SPRING, 0.5f, 0.0f, 0.0f, 0.0f);
+    unused = ffb_graph_add_periodic(graph, PID_ET_TRIANGLE, 1000.0f, 0.0f, 10, 0);
+    a = ffb_graph_add_mixer(graph);
+    b = ffb_graph_add_mixer(graph);
+    sink = ffb_graph_add_sink(graph);
+
+    TEST_CHECK(ffb_graph_connect(graph, sine, mixer, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, square, mixer, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, sine, spring, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, mixer, sink, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, spring, sink, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, mixer, sine, 1.0f) == -1);  // A source has no input
+    TEST_CHECK(ffb_graph_connect(graph, sink, mixer, 1.0f) == -1);
+    TEST_CHECK(ffb_graph_connect(graph, mixer, mixer, 1.0f) == -1);
+
+    // A cycle that does not feed the sink, and a node feeding nothing,
+    // are pruned
+    TEST_CHECK(ffb_graph_connect(graph, unused, a, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, a, b, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, b, a, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_compile(graph, mixer) == -1);   // Not a sink
+    TEST_CHECK(ffb_graph_compile(graph, sink) == 0);
+    TEST_CHECK(graph->order_count == 5);
+    TEST_CHECK(graph->nodes[unused].level < 0 && graph->nodes[a].level < 0 && graph->nodes[b].level < 0);
+    TEST_CHECK(graph->level_count == 3);
+    TEST_CHECK(graph->width == 2);
+    TEST_CHECK(graph->nodes[sine].level == 0 && graph->nodes[square].level == 0);
+    TEST_CHECK(graph->nodes[mixer].level == 1 && graph->nodes[spring].level == 1);
+    TEST_CHECK(graph->nodes[sink].level == 2);
+    TEST_CHECK(test_graph_order_ok(graph));
+
+    // The cycle feeding the sink is rejected
+    TEST_CHECK(ffb_graph_connect(graph, b, sink, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_compile(graph, sink) == -1);
+    TEST_CHECK(graph->compiled == 0);
+}
+
+// Four sources on the first level, two conditions and a mixer, a filter
+// free chain whose output only depends on time (but for the damper, which
+// depends on the blocks before)
+static int test_graph_build(ffb_graph* graph) {
+    static const int waves[] = { PID_ET_SINE, PID_ET_SQUARE, PID_ET_TRIANGLE, PID_ET_SAWTOOTH_UP };
+    int sources[4], spring, damper, mixer, sink;
+    int i, failures = 0;
+
+    ffb_graph_init(graph);
+    for (i = 0; i < 4; i++)
+        sources[i] = ffb_graph_add_periodic(graph, waves[i], 3000.0f + 1000.0f * i, 100.0f * i, 30 + 17 * i, 5 * i);
+    spring = ffb_graph_add_condition(graph, PID_ET_SPRING, 0.8f, 500.0f, 200.0f, 6000.0f);
+    damper = ffb_graph_add_condition(graph, PID_ET_DAMPER, 2.0f, 0.0f, 0.0f, 0.0f);
+    mixer = ffb_graph_add_mixer(graph);
+    sink = ffb_graph_add_sink(graph);
+
+    for (i = 0; i < 4; i++)
+        failures += ffb_graph_connect(graph, sources[i], mixer, 0.5f) != 0;
+    failures += ffb_graph_connect(graph, sources[0], spring, 1.0f) != 0;
+    failures += ffb_graph_connect(graph, sources[1], spring, 0.5f) != 0;
+    failures += ffb_graph_connect(graph, sources[2], damper, 1.0f) != 0;
+    failures += ffb_graph_connect(graph, mixer, sink, 1.0f) != 0;
+    failures += ffb_graph_connect(graph, spring, sink, 1.0f) != 0;
+    failures += ffb_graph_connect(graph, damper, sink, 0.25f) != 0;
+    failures += ffb_graph_compile(graph, sink) != 0;
+    return failures == 0 ? sink : -1;
+}
+
+// The same graph rendered on the calling thread alone and shared with
+// workers gives the same samples
+static void test_graph_workers(void) {
+    static short out[2][TEST_GRAPH_BLOCKS * TEST_GRAPH_SAMPLES];
+    int g, b, nonzero = 0;
+    unsigned int n;
+
+    for (g = 0; g < 2; g++) {
+        if (!TEST_CHECK(test_graph_build(&test_graphs[g]) >= 0))
+            return;
+    }
+    TEST_CHECK(test_graphs[0].width == 4);
+    if (!TEST_CHECK(ffb_graph_start_workers(&test_graphs[1], TEST_GRAPH_WORKERS) == 0))
+        return;
+
+    for (b = 0; b < TEST_GRAPH_BLOCKS; b++) {
+        for (g = 0; g < 2; g++)
+            ffb_graph_render(&test_graphs[g], 1000 + (unsigned long)b * TEST_GRAPH_SAMPLES, 1,
+                             &out[g][b * TEST_GRAPH_SAMPLES], TEST_GRAPH_SAMPLES);
+    }
+    ffb_graph_stop_workers(&test_graphs[1]);
+
+    for (n = 0; n < TEST_GRAPH_BLOCKS * TEST_GRAPH_SAMPLES; n++)
+        nonzero += out[0][n] != 0;
+    TEST_CHECK(nonzero > TEST_GRAPH_BLOCKS * TEST_GRAPH_SAMPLES / 2);
+    TEST_CHECK(memcmp(out[0], out[1], sizeof(out[0])) == 0);
+    TEST_CHECK(test_graphs[0].parallel_levels == 0);
+    TEST_CHECK(test_graphs[1].parallel_levels > 0);
+    TEST_CHECK(test_graphs[0].blocks == test_graphs[1].blocks);
+    for (n = 0; n < test_graphs[0].node_count; n++)
+        TEST_CHECK(test_graphs[0].nodes[n].runs == test_graphs[1].nodes[n].runs);
+}
+
+// The sink clamps to -32767..32767, an uncompiled graph renders zeros
+static void test_graph_clamp(void) {
+    ffb_graph* graph = &test_graphs[0];
+    short out[FFB_GRAPH_BLOCK];
+    int square, sink;
+    int low = 0, high = 0;
+    unsigned int n;
+
+    ffb_graph_init(graph);
+    square = ffb_graph_add_periodic(graph, PID_ET_SQUARE, 30000.0f, 0.0f, FFB_GRAPH_BLOCK / 2, 0);
+    sink = ffb_graph_add_sink(graph);
+    TEST_CHECK(ffb_graph_connect(graph, square, sink, 1.0f) == 0);
+    TEST_CHECK(ffb_graph_connect(graph, square, sink, 1.0f) == 0);
+
+    memset(out, 0x55, sizeof(out));
+    ffb_graph_render(graph, 0, 1, out, FFB_GRAPH_BLOCK);
+    for (n = 0; n < FFB_GRAPH_BLOCK; n++)
+        low += out[n] != 0;
+    TEST_CHECK(low == 0);
+
+    TEST_CHECK(ffb_graph_compile(graph, sink) == 0);
+    ffb_graph_render(graph, 0, 1, out, FFB_GRAPH_BLOCK);
+    for (n = 0; n < FFB_GRAPH_BLOCK; n++) {
+        low += out[n] == -32767;
+        high += out[n] == 32767;
+    }
+    TEST_CHECK(low == FFB_GRAPH_BLOCK / 2);
+    TEST_CHECK(high == FFB_GRAPH_BLOCK / 2);
+}
+
+void test_graph(void) {
+    test_graph_compile();
+    test_graph_workers();
+    test_graph_clamp();
+}
@@ -0,0 +1,163 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ffb_impulse.h"
+
+#define TEST_IMPULSE_RATE 1000
+
+static ffb_impulse_bank test_impulse_bank;     // Too large for the stack
+
+// Samples rendered until the only voice ends, one render per sample
+static int test_impulse_played(ffb_impulse_bank* bank, float* out, int max) {
+    int n = 0;
+
+    do {
+        ffb_impulse_render(bank, 1, &out[n], 1);
+        n++;
+    } while (bank->voices[0].id >= 0 && n < max);
+    return n;
+}
+
+// Impulses are stored with a peak of 32767, whatever their scale
+static void test_impulse_normalize(void) {
+    static const float samples[] = { 0.0f, 0.5f, -2.0f, 1.0f };
+    static const float silent[] = { 0.0f, 0.0f };
+    ffb_impulse_bank* bank = &test_impulse_bank;
+    const short* s;
+    float out[4];
+    int id, damped, peak = 0;
+    unsigned int i;
+
+    ffb_impulse_init(bank, TEST_IMPULSE_RATE);
+    id = ffb_impulse_add(bank, samples, 4);
+    TEST_CHECK(id == 0);
+    s = bank->arena + bank->entries[id].offset;
+    TEST_CHECK(s[0] == 0 && s[1] == 8192 && s[2] == -32767 && s[3] == 16384);
+    TEST_CHECK(s[4] == 0);
+
+    TEST_CHECK(ffb_impulse_add(bank, silent, 2) == -1);
+    TEST_CHECK(ffb_impulse_add(bank, samples, 0) == -1);
+    TEST_CHECK(bank->count == 1);
+
+    damped = ffb_impulse_add_damped(bank, 12.0f, 80.0f, 200.0f);
+    TEST_CHECK(damped == 1);
+    TEST_CHECK(bank->entries[damped].length == 200);
+    s = bank->arena + bank->entries[damped].offset;
+    for (i = 0; i < bank->entries[damped].length; i++) {
+        if (abs(s[i]) > peak)
+            peak = abs(s[i]);
+    }
+    TEST_CHECK(peak == 32767);
+
+    // Played at a gain, the peak comes out at the gain
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 10000.0f, 1.0f) == 0);
+    ffb_impulse_render(bank, 1, out, 4);
+    TEST_CHECK(out[0] == 0.0f);
+    TEST_CHECK(fabsf(out[2] + 10000.0f) < 0.5f);
+    TEST_CHECK(fabsf(out[3] - 5000.0f) < 0.5f);
+
+    TEST_CHECK(ffb_impulse_trigger(bank, 2, 10000.0f, 1.0f) == -1);
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 10000.0f, 0.0f) == -1);
+    TEST_CHECK(pid_atomic_load(&bank->dropped) == 0);
+}
+
+// Stretch 2.0 plays every stored sample twice as long, every other output
+// sample being the stored one
+static void test_impulse_stretch(void) {
+    static float normal[256], stretched[512];
+    ffb_impulse_bank* bank = &test_impulse_bank;
+    int id, length, n, mismatches = 0;
+
+    ffb_impulse_init(bank, TEST_IMPULSE_RATE);
+    id = ffb_impulse_add_damped(bank, 25.0f, 20.0f, 100.0f);
+    if (!TEST_CHECK(id >= 0))
+        return;
+    length = (int)bank->entries[id].length;
+
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 20000.0f, 1.0f) == 0);
+    TEST_CHECK(test_impulse_played(bank, normal, 256) == length);
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 20000.0f, 2.0f) == 0);
+    TEST_CHECK(test_impulse_played(bank, stretched, 512) == 2 * length);
+
+    for (n = 0; n < length; n++)
+        mismatches += fabsf(stretched[2 * n] - normal[n]) > 0.01f;
+    TEST_CHECK(mismatches == 0);
+
+    // Samples of 2 ms cover two stored samples each
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 20000.0f, 1.0f) == 0);
+    n = 0;
+    do {
+        ffb_impulse_render(bank, 2, &normal[n], 1);
+        n++;
+    } while (bank->voices[0].id >= 0 && n < 256);
+    TEST_CHECK(n == length / 2);
+}
+
+// With every voice busy a trigger takes over the voice closest to its end
+static void test_impulse_steal(void) {
+    ffb_impulse_bank* bank = &test_impulse_bank;
+    float out[10];
+    int first, last, v;
+    int started = 0;
+
+    ffb_impulse_init(bank, TEST_IMPULSE_RATE);
+    first = ffb_impulse_add_damped(bank, 12.0f, 80.0f, 400.0f);
+    last = ffb_impulse_add_damped(bank, 25.0f, 20.0f, 50.0f);
+    if (!TEST_CHECK(first >= 0 && last >= 0))
+        return;
+
+    // Voice v started 10 * (FFB_IMPULSE_MAX_VOICES - v) samples ago
+    for (v = 0; v < FFB_IMPULSE_MAX_VOICES; v++) {
+        TEST_CHECK(ffb_impulse_trigger(bank, first, 1000.0f, 1.0f) == 0);
+        ffb_impulse_render(bank, 1, out, 10);
+    }
+    for (v = 0; v < FFB_IMPULSE_MAX_VOICES; v++)
+        started += bank->voices[v].id == first;
+    TEST_CHECK(started == FFB_IMPULSE_MAX_VOICES);
+    TEST_CHECK(bank->stolen == 0);
+
+    TEST_CHECK(ffb_impulse_trigger(bank, last, 1000.0f, 1.0f) == 0);
+    ffb_impulse_render(bank, 1, out, 1);
+    TEST_CHECK(bank->stolen == 1);
+    TEST_CHECK(bank->triggers == FFB_IMPULSE_MAX_VOICES + 1);
+    TEST_CHECK(bank->voices[0].id == last);
+    TEST_CHECK(bank->voices[0].position == 1ul << 16);
+    for (v = 1; v < FFB_IMPULSE_MAX_VOICES; v++)
+        TEST_CHECK(bank->voices[v].id == first);
+}
+
+// Triggers past the pending slots are dropped and counted, the others
+// start on the next render
+static void test_impulse_pending(void) {
+    ffb_impulse_bank* bank = &test_impulse_bank;
+    float out[1];
+    int id, i;
+    int failures = 0;
+
+    ffb_impulse_init(bank, TEST_IMPULSE_RATE);
+    id = ffb_impulse_add_damped(bank, 12.0f, 80.0f, 100.0f);
+    if (!TEST_CHECK(id >= 0))
+        return;
+
+    for (i = 0; i < FFB_IMPULSE_MAX_PENDING; i++)
+        failures += ffb_impulse_trigger(bank, id, 1000.0f, 1.0f) != 0;
+    TEST_CHECK(failures == 0);
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 1000.0f, 1.0f) == -1);
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 1000.0f, 1.0f) == -1);
+    TEST_CHECK(pid_atomic_load(&bank->dropped) == 2);
+    TEST_CHECK(bank->triggers == 0);
+
+    ffb_impulse_render(bank, 1, out, 1);
+    TEST_CHECK(bank->triggers == FFB_IMPULSE_MAX_PENDING);
+    TEST_CHECK(ffb_impulse_trigger(bank, id, 1000.0f, 1.0f) == 0);
+    TEST_CHECK(pid_atomic_load(&bank->dropped) == 2);
+}
+
+void test_impulse(void) {
+    test_impulse_normalize();
+    test_impulse_stretch();
+    test_impulse_steal();
+    test_impulse_pending();
+}
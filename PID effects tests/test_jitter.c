@@ -0,0 +1,87 @@
+#include "test.h"
+
+#include "ffb_jitter.h"
+#include "pid_platform.h"
+
+#define TEST_JITTER_RUN_MS 300
+#define TEST_JITTER_BLOCK 8
+#define TEST_JITTER_DEPTH 64
+
+typedef struct test_jitter_state {
+    ffb_jitter jitter;
+    pid_atomic_t rendered;
+    pid_atomic_t played;            // Taken from the ring, not held on underrun
+    pid_atomic_t running;
+} test_jitter_state;
+
+static void test_jitter_render(void* ctx, unsigned long t_ms, unsigned int sample_ms, short* out, unsigned int count) {
+    test_jitter_state* state = (test_jitter_state*)ctx;
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        out[i] = (short)((t_ms + i * sample_ms) & 0x7fff);
+    pid_atomic_add(&state->rendered, (long)count);
+}
+
+// The writer loop, a sample per ms
+static void test_jitter_writer(void* arg) {
+    test_jitter_state* state = (test_jitter_state*)arg;
+    long underruns;
+    short magnitude;
+
+    while (pid_atomic_load(&state->running)) {
+        underruns = pid_atomic_load(&state->jitter.underruns);
+        ffb_jitter_stream(&state->jitter, &magnitude);
+        if (pid_atomic_load(&state->jitter.underruns) == underruns)
+            pid_atomic_add(&state->played, 1);
+        pid_sleep_ms(1);
+    }
+}
+
+// Every rendered sample is played, cancelled or still waiting, never
+// both played and cancelled. Samples exposed again by a rewind may be
+// skipped by a writer that already went past them, each costing an
+// underrun
+static void test_jitter_rewind(void) {
+    static test_jitter_state state;
+    pid_thread_t writer;
+    long long start;
+    long pending, accounted;
+
+    TEST_CHECK(ffb_jitter_init(&state.jitter, test_jitter_render, &state, 1, TEST_JITTER_BLOCK, TEST_JITTER_DEPTH) == 0);
+    if (!TEST_CHECK(ffb_jitter_start(&state.jitter) == 0))
+        return;
+
+    pid_atomic_store(&state.running, 1);
+    if (!TEST_CHECK(pid_thread_start(&writer, test_jitter_writer, &state) == 0)) {
+        ffb_jitter_stop(&state.jitter);
+        return;
+    }
+
+    start = pid_time_us();
+    while (pid_time_us() - start < (long long)TEST_JITTER_RUN_MS * 1000) {
+        ffb_jitter_invalidate(&state.jitter);
+        pid_cpu_relax();
+    }
+
+    pid_atomic_store(&state.running, 0);
+    pid_thread_join(writer);
+    ffb_jitter_stop(&state.jitter);
+
+    pending = pid_atomic_load(&state.jitter.write) - pid_atomic_load(&state.jitter.read);
+    if (pending < 0)
+        pending = 0;
+    accounted = pid_atomic_load(&state.played) + pid_atomic_load(&state.jitter.cancelled) + pending;
+    printf("  %ld rendered, %ld played, %ld cancelled, %ld underruns\n", pid_atomic_load(&state.rendered),
+           pid_atomic_load(&state.played), pid_atomic_load(&state.jitter.cancelled), pid_atomic_load(&state.jitter.underruns));
+
+    TEST_CHECK(pid_atomic_load(&state.jitter.cancelled) > 0);
+    TEST_CHECK(accounted <= pid_atomic_load(&state.rendered));
+    TEST_CHECK(pid_atomic_load(&state.rendered) - accounted <= pid_atomic_load(&state.jitter.underruns));
+
+    ffb_jitter_destroy(&state.jitter);
+}
+
+void test_jitter(void) {
+    test_jitter_rewind();
+}
@@ -0,0 +1,84 @@
+#include "test.h"
+
+#include <stdlib.h>
+
+#include "ffb_limiter.h"
+
+#define TEST_THRESHOLD 16384
+#define TEST_CEILING 24576
+
+// Soft curve the limiter bends the peaks to, as in ffb_mixer
+static double test_limiter_curve(double mag) {
+    double d = mag - TEST_THRESHOLD;
+    double r = TEST_CEILING - TEST_THRESHOLD;
+
+    return d <= 0.0 ? mag : TEST_THRESHOLD + d * r / (d + r);
+}
+
+// Plays input through the limiter and checks that every sample leaves
+// at most on the soft curve
+static int test_limiter_run(ffb_limiter* limiter, const long* input, unsigned int count) {
+    unsigned int n, lookahead = limiter->lookahead;
+    long x;
+    short out;
+    int over = 0;
+
+    for (n = 0; n < count + lookahead; n++) {
+        out = ffb_limiter_process(limiter, n < count ? input[n] : 0);
+        if (n < lookahead)
+            continue;
+        x = input[n - lookahead];
+        if (abs(out) > test_limiter_curve(labs(x)) + 1.0 || (long)out * x < 0)
+            over++;
+    }
+    return over;
+}
+
+// A smaller peak behind a larger one, still in the delay line when the
+// larger one leaves, gets its own reduction
+static void test_limiter_second_peak(void) {
+    static long input[200];
+    ffb_limiter limiter;
+
+    input[100] = 32767;
+    input[104] = 26000;
+    ffb_limiter_init(&limiter, TEST_THRESHOLD, TEST_CEILING, 8, 1);
+    TEST_CHECK(test_limiter_run(&limiter, input, 200) == 0);
+    TEST_CHECK(limiter.clipped == 0);
+
+    input[104] = -26000;
+    ffb_limiter_init(&limiter, TEST_THRESHOLD, TEST_CEILING, 8, 1);
+    TEST_CHECK(test_limiter_run(&limiter, input, 200) == 0);
+    TEST_CHECK(limiter.clipped == 0);
+}
+
+// Bursts of peaks of every size, for every look-ahead and a fast and a
+// slow release
+static void test_limiter_bursts(void) {
+    static long input[20000];
+    static const unsigned int releases[] = { 1, 50 };
+    ffb_limiter limiter;
+    unsigned int seed = 3, n, lookahead, r;
+    int over = 0;
+    unsigned long clipped = 0;
+
+    for (n = 0; n < 20000; n++) {
+        seed = seed * 1103515245u + 12345u;
+        input[n] = (n / 50) % 3 == 0 ? (long)((seed >> 8) % 80001) - 40000 : (long)((seed >> 8) % 8001) - 4000;
+    }
+
+    for (lookahead = 1; lookahead <= FFB_LIMITER_MAX_LOOKAHEAD; lookahead *= 2) {
+        for (r = 0; r < sizeof(releases) / sizeof(releases[0]); r++) {
+            ffb_limiter_init(&limiter, TEST_THRESHOLD, TEST_CEILING, lookahead, releases[r]);
+            over += test_limiter_run(&limiter, input, 20000);
+            clipped += limiter.clipped;
+        }
+    }
+    TEST_CHECK(over == 0);
+    TEST_CHECK(clipped == 0);
+}
+
+void test_limiter(void) {
+    test_limiter_second_peak();
+    test_limiter_bursts();
+}
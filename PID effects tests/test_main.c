@@ -0,0 +1,70 @@
+#include "test.h"
+
+static int checks;
+static int failures;
+
+volatile unsigned long test_sink;
+
+int test_check(int ok, const char* expr, const char* file, int line) {
+    checks++;
+    if (!ok) {
+        failures++;
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+    }
+    return ok;
+}
+
+void test_bench_report(const char* name, long long elapsed_us, long iterations) {
+    double ns = (double)elapsed_us * 1000.0 / (double)iterations;
+
+    if (ns < 100000.0)
+        printf("  %-48s %8.1f ns\n", name, ns);
+    else
+        printf("  %-48s %8.1f us\n", name, ns / 1000.0);
+}
+
+typedef struct test_entry {
+    const char* name;
+    void (*fn)(void);
+} test_entry;
+
+static const test_entry tests[] = {
+    { "writer", test_writer },
+    { "watchdog", test_watchdog },
+    { "codec", test_codec },
+    { "templates", test_templates },
+    { "upload", test_upload },
+    { "effect", test_effect },
+    { "ramp", test_ramp },
+    { "fit", test_fit },
+    { "deadband", test_deadband },
+    { "resample", test_resample },
+    { "predict", test_predict },
+    { "filter", test_filter },
+    { "slew", test_slew },
+    { "envelope", test_envelope },
+    { "jitter", test_jitter },
+    { "limiter", test_limiter },
+    { "rate", test_rate },
+    { "noise", test_noise },
+    { "track", test_track },
+    { "expr", test_expr },
+    { "graph", test_graph },
+    { "plugin", test_plugin },
+    { "impulse", test_impulse },
+};
+
+int main(void) {
+    unsigned int i;
+    int before;
+
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        before = failures;
+        printf("[%s]\n", tests[i].name);
+        tests[i].fn();
+        printf("[%s] %s\n", tests[i].name, failures == before ? "ok" : "FAILED");
+    }
+
+    printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
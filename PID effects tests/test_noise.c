@@ -0,0 +1,44 @@
+#include "test.h"
+
+#include <math.h>
+
+#include "ffb_noise.h"
+
+#define TEST_NOISE_SECONDS 20
+#define TEST_NOISE_RATE 1000
+
+// Every surface adds texture around the force, not a pull to one side:
+// over a long drive its mean is small against its RMS
+static void test_noise_mean(void) {
+    static float block[TEST_NOISE_RATE];
+    ffb_noise noise;
+    double sum, squares, mean, rms;
+    int surface, s, n;
+
+    for (surface = 0; surface < FFB_SURFACE_COUNT; surface++) {
+        ffb_noise_init(&noise, 17);
+        ffb_noise_set_surface(&noise, surface);
+        sum = 0.0;
+        squares = 0.0;
+
+        for (s = 0; s < TEST_NOISE_SECONDS; s++) {
+            for (n = 0; n < TEST_NOISE_RATE; n++)
+                block[n] = FFB_NOISE_FULL_SPEED;
+            ffb_noise_render(&noise, block, block, TEST_NOISE_RATE, 1.0f / TEST_NOISE_RATE);
+            for (n = 0; n < TEST_NOISE_RATE; n++) {
+                sum += block[n];
+                squares += (double)block[n] * block[n];
+            }
+        }
+
+        mean = sum / (TEST_NOISE_SECONDS * TEST_NOISE_RATE);
+        rms = sqrt(squares / (TEST_NOISE_SECONDS * TEST_NOISE_RATE));
+        printf("  %-9s mean %7.1f, rms %7.1f\n", ffb_noise_surface_get(surface)->name, mean, rms);
+        TEST_CHECK(rms > 0.0);
+        TEST_CHECK(fabs(mean) < 0.1 * rms);
+    }
+}
+
+void test_noise(void) {
+    test_noise_mean();
+}
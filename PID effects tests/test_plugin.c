@@ -0,0 +1,267 @@
+#include "test.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ffb_plugin.h"
+#include "pid_platform.h"
+
+#define TEST_PLUGIN_BLOCK 16
+
+static const char* test_plugin_missing = "test_plugin_missing.bin";
+static const char* test_plugin_garbage = "test_plugin_garbage.bin";
+
+// Built-in plugins writing their level, counting their instances
+typedef struct test_plugin_state {
+    float level;
+    const char* config;
+} test_plugin_state;
+
+static test_plugin_state test_plugin_states[4];
+static unsigned int test_plugin_inits;
+static pid_atomic_t test_plugin_teardowns;   // From the loading thread
+static int test_plugin_fail_init;
+
+// Set by the blocking plugin once in process_block(), which then waits
+// for test_plugin_release
+static pid_atomic_t test_plugin_inside;
+static pid_atomic_t test_plugin_release;
+
+static void* test_plugin_init(const char* config) {
+    test_plugin_state* state;
+
+    if (test_plugin_fail_init || test_plugin_inits >= 4)
+        return NULL;
+    state = &test_plugin_states[test_plugin_inits];
+    state->level = (float)++test_plugin_inits;
+    state->config = config;
+    return state;
+}
+
+static void test_plugin_process(void* state, float* out, unsigned int n, const ffb_plugin_inputs* inputs) {
+    unsigned int i;
+
+    (void)inputs;
+    for (i = 0; i < n; i++)
+        out[i] = ((test_plugin_state*)state)->level;
+}
+
+static void test_plugin_process_blocking(void* state, float* out, unsigned int n, const ffb_plugin_inputs* inputs) {
+    pid_atomic_store(&test_plugin_inside, 1);
+    while (!pid_atomic_load(&test_plugin_release))
+        pid_sleep_ms(1);
+    test_plugin_process(state, out, n, inputs);
+}
+
+static void test_plugin_teardown(void* state) {
+    (void)state;
+    pid_atomic_add(&test_plugin_teardowns, 1);
+}
+
+static const ffb_plugin_desc test_plugin_desc = {
+    FFB_PLUGIN_ABI_VERSION, sizeof(ffb_plugin_desc), "level",
+    test_plugin_init, test_plugin_process, test_plugin_teardown,
+};
+
+static const ffb_plugin_desc test_plugin_blocking_desc = {
+    FFB_PLUGIN_ABI_VERSION, sizeof(ffb_plugin_desc), "blocking",
+    test_plugin_init, test_plugin_process_blocking, test_plugin_teardown,
+};
+
+// Built against an older ffb_plugin_abi.h that ended before teardown: the
+// pointer past its size must not be used, even though it is there
+static const ffb_plugin_desc test_plugin_old_desc = {
+    FFB_PLUGIN_ABI_VERSION, offsetof(ffb_plugin_desc, teardown), "old",
+    test_plugin_init, test_plugin_process, test_plugin_teardown,
+};
+
+static const ffb_plugin_desc test_plugin_future_desc = {
+    FFB_PLUGIN_ABI_VERSION + 1, sizeof(ffb_plugin_desc), "future",
+    test_plugin_init, test_plugin_process, test_plugin_teardown,
+};
+
+static const ffb_plugin_desc test_plugin_no_teardown_desc = {
+    FFB_PLUGIN_ABI_VERSION, sizeof(ffb_plugin_desc), "no teardown",
+    test_plugin_init, test_plugin_process, NULL,
+};
+
+static const ffb_plugin_desc* test_plugin_entry(void) { return &test_plugin_desc; }
+static const ffb_plugin_desc* test_plugin_blocking_entry(void) { return &test_plugin_blocking_desc; }
+static const ffb_plugin_desc* test_plugin_old_entry(void) { return &test_plugin_old_desc; }
+static const ffb_plugin_desc* test_plugin_future_entry(void) { return &test_plugin_future_desc; }
+static const ffb_plugin_desc* test_plugin_no_teardown_entry(void) { return &test_plugin_no_teardown_desc; }
+static const ffb_plugin_desc* test_plugin_null_entry(void) { return NULL; }
+
+// Level of a block, -1 if the samples differ
+static float test_plugin_block(ffb_plugin* plugin) {
+    float out[TEST_PLUGIN_BLOCK];
+    ffb_plugin_inputs inputs;
+    unsigned int i;
+
+    memset(&inputs, 0x00, sizeof(inputs));
+    inputs.size = sizeof(inputs);
+    ffb_plugin_process(plugin, out, TEST_PLUGIN_BLOCK, &inputs);
+    for (i = 1; i < TEST_PLUGIN_BLOCK; i++) {
+        if (out[i] != out[0])
+            return -1.0f;
+    }
+    return out[0];
+}
+
+static int test_plugin_exists(const char* path) {
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+        return 0;
+    fclose(file);
+    return 1;
+}
+
+// Libraries that cannot be loaded leave no copy behind and no plugin
+static void test_plugin_open_failures(void) {
+    char copy[FFB_PLUGIN_MAX_PATH + 32];
+    char path[FFB_PLUGIN_MAX_PATH + 1];
+    ffb_plugin plugin;
+    FILE* file;
+
+    memset(path, 'a', sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    TEST_CHECK(ffb_plugin_init(&plugin, path, NULL) == -1);
+
+    TEST_CHECK(ffb_plugin_init(&plugin, test_plugin_missing, NULL) == 0);
+    TEST_CHECK(ffb_plugin_load(&plugin) == -1);
+    TEST_CHECK(plugin.error && strcmp(plugin.error, "cannot copy the library") == 0);
+    TEST_CHECK(ffb_plugin_poll(&plugin) == 0);
+    snprintf(copy, sizeof(copy), "%s.%lu", test_plugin_missing, plugin.generation);
+    TEST_CHECK(!test_plugin_exists(copy));
+    ffb_plugin_close(&plugin);
+
+    file = fopen(test_plugin_garbage, "wb");
+    if (!TEST_CHECK(file != NULL))
+        return;
+    fputs("not a shared library", file);
+    fclose(file);
+
+    TEST_CHECK(ffb_plugin_init(&plugin, test_plugin_garbage, NULL) == 0);
+    TEST_CHECK(ffb_plugin_load(&plugin) == -1);
+    TEST_CHECK(plugin.error && strcmp(plugin.error, "cannot load the library") == 0);
+    TEST_CHECK(plugin.failures == 1);
+    TEST_CHECK(pid_atomic_load(&plugin.current) == -1);
+    snprintf(copy, sizeof(copy), "%s.%lu", test_plugin_garbage, plugin.generation);
+    TEST_CHECK(!test_plugin_exists(copy));
+    TEST_CHECK(test_plugin_block(&plugin) == 0.0f);
+    TEST_CHECK(plugin.missed == 1);
+    ffb_plugin_close(&plugin);
+    remove(test_plugin_garbage);
+}
+
+// Descriptions that must be refused, the running instance is kept
+static void test_plugin_rejects(void) {
+    static const struct {
+        ffb_plugin_entry_fn entry;
+        const char* error;
+    } cases[] = {
+        { test_plugin_null_entry, "ABI version mismatch" },
+        { test_plugin_future_entry, "ABI version mismatch" },
+        { test_plugin_old_entry, "incomplete plugin" },
+        { test_plugin_no_teardown_entry, "incomplete plugin" },
+    };
+    ffb_plugin plugin;
+    unsigned int i;
+
+    test_plugin_inits = 0;
+    pid_atomic_store(&test_plugin_teardowns, 0);
+    TEST_CHECK(ffb_plugin_init(&plugin, "builtin", "gain=2") == 0);
+    TEST_CHECK(ffb_plugin_load_entry(&plugin, test_plugin_entry) == 0);
+    TEST_CHECK(strcmp(test_plugin_states[0].config, "gain=2") == 0);
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (!TEST_CHECK(ffb_plugin_load_entry(&plugin, cases[i].entry) == -1))
+            continue;
+        TEST_CHECK(plugin.error && strcmp(plugin.error, cases[i].error) == 0);
+    }
+
+    test_plugin_fail_init = 1;
+    TEST_CHECK(ffb_plugin_load_entry(&plugin, test_plugin_entry) == -1);
+    TEST_CHECK(plugin.error && strcmp(plugin.error, "plugin init failed") == 0);
+    test_plugin_fail_init = 0;
+
+    TEST_CHECK(plugin.failures == 5);
+    TEST_CHECK(test_plugin_inits == 1);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 0);
+    TEST_CHECK(test_plugin_block(&plugin) == 1.0f);
+
+    ffb_plugin_close(&plugin);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 1);
+}
+
+static void test_plugin_reader(void* arg) {
+    test_plugin_block((ffb_plugin*)arg);
+}
+
+static void test_plugin_loader(void* arg) {
+    ffb_plugin_load_entry((ffb_plugin*)arg, test_plugin_entry);
+}
+
+// A load swaps the slots at once, the old instance is torn down once the
+// block running in it is over
+static void test_plugin_swap(void) {
+    pid_thread_t reader, loader;
+    ffb_plugin plugin;
+    int i;
+
+    test_plugin_inits = 0;
+    pid_atomic_store(&test_plugin_teardowns, 0);
+    pid_atomic_store(&test_plugin_inside, 0);
+    pid_atomic_store(&test_plugin_release, 0);
+
+    TEST_CHECK(ffb_plugin_init(&plugin, "builtin", NULL) == 0);
+    TEST_CHECK(ffb_plugin_load_entry(&plugin, test_plugin_entry) == 0);
+    TEST_CHECK(test_plugin_states[0].config == NULL);
+    TEST_CHECK(pid_atomic_load(&plugin.current) == 0);
+    TEST_CHECK(test_plugin_block(&plugin) == 1.0f);
+
+    TEST_CHECK(ffb_plugin_load_entry(&plugin, test_plugin_blocking_entry) == 0);
+    TEST_CHECK(pid_atomic_load(&plugin.current) == 1);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 1);
+
+    // A block stays in the blocking instance while the next one is loaded
+    if (!TEST_CHECK(pid_thread_start(&reader, test_plugin_reader, &plugin) == 0))
+        return;
+    for (i = 0; i < 1000 && !pid_atomic_load(&test_plugin_inside); i++)
+        pid_sleep_ms(1);
+    TEST_CHECK(pid_atomic_load(&plugin.slots[1].readers) == 1);
+
+    if (!TEST_CHECK(pid_thread_start(&loader, test_plugin_loader, &plugin) == 0)) {
+        pid_atomic_store(&test_plugin_release, 1);
+        pid_thread_join(reader);
+        return;
+    }
+    for (i = 0; i < 1000 && pid_atomic_load(&plugin.current) != 0; i++)
+        pid_sleep_ms(1);
+    pid_sleep_ms(20);
+
+    // The new instance is current, the old one is still there
+    TEST_CHECK(pid_atomic_load(&plugin.current) == 0);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 1);
+    TEST_CHECK(plugin.slots[1].desc == &test_plugin_blocking_desc);
+
+    pid_atomic_store(&test_plugin_release, 1);
+    pid_thread_join(reader);
+    pid_thread_join(loader);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 2);
+    TEST_CHECK(pid_atomic_load(&plugin.slots[1].readers) == 0);
+    TEST_CHECK(plugin.slots[1].desc == NULL);
+    TEST_CHECK(plugin.loads == 3);
+    TEST_CHECK(test_plugin_block(&plugin) == 3.0f);
+
+    ffb_plugin_close(&plugin);
+    TEST_CHECK(pid_atomic_load(&test_plugin_teardowns) == 3);
+}
+
+void test_plugin(void) {
+    test_plugin_open_failures();
+    test_plugin_rejects();
+    test_plugin_swap();
+}
@@ -0,0 +1,144 @@
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ffb_predict.h"
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+
+#define TEST_PI 3.14159265
+#define TEST_FRAME_US 16667         // 60 Hz game
+#define TEST_LEAD_US 20000          // Write, tick and base filtering
+#define TEST_RUN_MS 1500            // In real time, the filter reads the clock
+#define TEST_WARMUP_MS 300
+#define TEST_ANGLE_NOISE 2
+
+static pid_codec codec;             // Too large for the stack
+
+static const char* test_predict_names[] = { "none", "cv", "ca", "kalman" };
+
+// The driver sawing at the wheel, in logical units of the X axis
+static double test_predict_angle(long long t_us) {
+    double t = (double)t_us / 1000000.0;
+
+    return 6000.0 * sin(2.0 * TEST_PI * 0.7 * t) + 1500.0 * sin(2.0 * TEST_PI * 1.9 * t);
+}
+
+// Force computed by the game: self aligning, stiffening with the angle
+static double test_predict_force(long long t_us) {
+    double angle = test_predict_angle(t_us);
+
+    return -1.5 * angle - 0.00005 * angle * fabs(angle);
+}
+
+static unsigned int test_predict_seed;
+
+static long test_predict_noise(void) {
+    test_predict_seed = test_predict_seed * 1103515245u + 12345u;
+    return (long)((test_predict_seed >> 8) % (2 * TEST_ANGLE_NOISE + 1)) - TEST_ANGLE_NOISE;
+}
+
+// Runs every mode side by side on the writer loop: a joystick input
+// report and a stream tick every ms, a game frame every TEST_FRAME_US.
+// The error is against the force the game computes for the angle
+// TEST_LEAD_US later, when the wheel applies it
+static void test_predict_error(const pid_field* angle_field) {
+    ffb_predict predict[4];
+    unsigned char report[64];
+    double sum[4] = { 0 }, rms[4];
+    long long start, now, t_us, next_frame = 0;
+    short force = 0, out;
+    long n = 0;
+    int mode;
+
+    test_predict_seed = 11;
+    for (mode = FFB_PREDICT_NONE; mode <= FFB_PREDICT_KALMAN; mode++)
+        ffb_predict_init(&predict[mode], mode, angle_field, 30000);
+
+    start = pid_time_us();
+    for (;;) {
+        now = pid_time_us();
+        t_us = now - start;
+        if (t_us >= (long long)TEST_RUN_MS * 1000)
+            break;
+
+        memset(report, 0x00, sizeof(report));
+        report[0] = JOYSTICK_INPUT_REPORT_ID;
+        pid_codec_put_raw(angle_field, report, (long)test_predict_angle(t_us) + test_predict_noise());
+        for (mode = FFB_PREDICT_NONE; mode <= FFB_PREDICT_KALMAN; mode++)
+            ffb_predict_input(&predict[mode], report, (int)sizeof(report));
+
+        if (t_us >= next_frame) {
+            force = (short)test_predict_force(t_us);
+            next_frame += TEST_FRAME_US;
+        }
+
+        for (mode = FFB_PREDICT_NONE; mode <= FFB_PREDICT_KALMAN; mode++) {
+            out = ffb_predict_apply(&predict[mode], now, force, TEST_LEAD_US);
+            if (t_us >= (long long)TEST_WARMUP_MS * 1000)
+                sum[mode] += (out - test_predict_force(t_us + TEST_LEAD_US)) * (out - test_predict_force(t_us + TEST_LEAD_US));
+        }
+        if (t_us >= (long long)TEST_WARMUP_MS * 1000)
+            n++;
+
+        pid_sleep_ms(1);
+    }
+
+    if (!TEST_CHECK(n > 0))
+        return;
+    for (mode = FFB_PREDICT_NONE; mode <= FFB_PREDICT_KALMAN; mode++) {
+        rms[mode] = sqrt(sum[mode] / n);
+        printf("  %-7s error rms %7.1f, %ld ms ahead\n", test_predict_names[mode], rms[mode], (long)TEST_LEAD_US / 1000);
+    }
+
+    // Every predictor beats applying the force late, following the
+    // wheel beats extrapolating the steps of the game
+    TEST_CHECK(rms[FFB_PREDICT_CV] < rms[FFB_PREDICT_NONE]);
+    TEST_CHECK(rms[FFB_PREDICT_CA] < rms[FFB_PREDICT_NONE]);
+    TEST_CHECK(rms[FFB_PREDICT_KALMAN] < rms[FFB_PREDICT_CV]);
+}
+
+// Cost of a tick: an input report and a stream callback
+static void test_predict_bench(const pid_field* angle_field) {
+    ffb_predict predict;
+    unsigned char report[64];
+    char name[64];
+    long long start;
+    long i;
+    int mode;
+
+    memset(report, 0x00, sizeof(report));
+    report[0] = JOYSTICK_INPUT_REPORT_ID;
+
+    for (mode = FFB_PREDICT_NONE; mode <= FFB_PREDICT_KALMAN; mode++) {
+        ffb_predict_init(&predict, mode, angle_field, 30000);
+        start = pid_time_us();
+        for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+            pid_codec_put_raw(angle_field, report, (long)(i % 4096) - 2048);
+            ffb_predict_input(&predict, report, (int)sizeof(report));
+            test_sink += (unsigned short)ffb_predict_apply(&predict, start + i * 1000, (short)((i / 16) * 8 % 16384), TEST_LEAD_US);
+        }
+        snprintf(name, sizeof(name), "predict, %s, per tick", test_predict_names[mode]);
+        test_bench_report(name, pid_time_us() - start, TEST_BENCH_ITERATIONS);
+    }
+}
+
+void test_predict(void) {
+    const unsigned char* descriptor;
+    const pid_field* angle_field;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    angle_field = pid_codec_find(&codec, PID_REPORT_INPUT, JOYSTICK_INPUT_REPORT_ID,
+                                 PID_USAGE(PID_PAGE_GENERIC_DESKTOP, PID_GD_USAGE_X), 0);
+    if (!TEST_CHECK(angle_field != NULL))
+        return;
+
+    test_predict_error(angle_field);
+    test_predict_bench(angle_field);
+}
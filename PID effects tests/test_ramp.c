@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ffb_ramp.h"
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+#include "pid_writer.h"
+
+#define TEST_RAMP_START -8000
+#define TEST_RAMP_END 12000
+#define TEST_RAMP_MS 2000
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+
+// Device mode: the reports carry the ramp as it is, and the duration
+// goes up to the logical maximum of its field
+static void test_ramp_device(long* bytes, long* reports) {
+    pid_writer writer;
+    ffb_ramp ramp;
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, TEST_RAMP_MS);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(ramp.index > 0);
+    TEST_CHECK(hid_sim_device.count[SET_RAMP_FORCE_REPORT_ID] == 1);
+    TEST_CHECK(pid_codec_get_raw(templates.ramp_start, hid_sim_device.last[SET_RAMP_FORCE_REPORT_ID]) == TEST_RAMP_START);
+    TEST_CHECK(pid_codec_get_raw(templates.ramp_end, hid_sim_device.last[SET_RAMP_FORCE_REPORT_ID]) == TEST_RAMP_END);
+    TEST_CHECK(pid_codec_get_raw(templates.duration, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == TEST_RAMP_MS);
+    *bytes = hid_sim_device.bytes;
+    *reports = hid_sim_device.writes + hid_sim_device.features;
+    ffb_ramp_stop(&ramp, &writer, &templates);
+
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, (unsigned long)templates.duration->logical_max);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_codec_get_raw(templates.duration, hid_sim_device.last[SET_EFFECT_REPORT_ID]) == templates.duration->logical_max);
+    ffb_ramp_stop(&ramp, &writer, &templates);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, (unsigned long)templates.duration->logical_max + 1);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == -1);
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, PID_DURATION_INFINITE - 1);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == -1);
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, PID_DURATION_INFINITE);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == -1);
+    ffb_ramp_init(&ramp, FFB_RAMP_DEVICE, TEST_RAMP_START, TEST_RAMP_END, 100000);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == -1);
+    TEST_CHECK(hid_sim_device.writes + hid_sim_device.features == 0);
+    TEST_CHECK(writer.count == 0);
+
+    // The host mode has no limit
+    ffb_ramp_init(&ramp, FFB_RAMP_HOST, TEST_RAMP_START, TEST_RAMP_END, 100000);
+    TEST_CHECK(ffb_ramp_start(&ramp, &writer, &templates, 0) == 0);
+    pid_writer_destroy(&writer);
+}
+
+// Host mode streamed every period_ms, the device holding each magnitude
+// until the next one, against the exact ramp sampled every ms
+static void test_ramp_host(unsigned int period_ms, long device_bytes, long device_reports) {
+    size_t length = pid_codec_report_length(&codec, PID_REPORT_OUTPUT, SET_CONSTANT_FORCE_REPORT_ID);
+    double error, worst = 0.0, sum = 0.0;
+    long updates = 0;
+    unsigned long t;
+    short held = 0;
+    ffb_ramp ramp;
+
+    ffb_ramp_init(&ramp, FFB_RAMP_HOST, TEST_RAMP_START, TEST_RAMP_END, TEST_RAMP_MS);
+    TEST_CHECK(ffb_ramp_start(&ramp, NULL, &templates, 0) == 0);
+
+    for (t = 0; t < TEST_RAMP_MS; t++) {
+        if (t % period_ms == 0 && ffb_ramp_eval(&ramp, t, &held))
+            updates++;
+        error = fabs(held - (TEST_RAMP_START + (double)(TEST_RAMP_END - TEST_RAMP_START) * t / TEST_RAMP_MS));
+        if (error > worst)
+            worst = error;
+        sum += error * error;
+    }
+
+    printf("  host, every %2u ms: %4ld reports, %5ld bytes (device: %ld, %ld), error max %6.1f rms %6.1f\n",
+           period_ms, updates, updates * (long)length, device_reports, device_bytes, worst, sqrt(sum / TEST_RAMP_MS));
+    // One step of the ramp per period at most, and the error of the
+    // Q16 slope alone when every ms is sent
+    TEST_CHECK(worst <= (double)(TEST_RAMP_END - TEST_RAMP_START) * period_ms / TEST_RAMP_MS + 1.0);
+    TEST_CHECK(updates * (long)length > device_bytes);
+}
+
+void test_ramp(void) {
+    static const unsigned int periods[] = { 1, 2, 5, 10 };
+    const unsigned char* descriptor;
+    long bytes = 0, reports = 0;
+    size_t length;
+    unsigned int i;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+
+    test_ramp_device(&bytes, &reports);
+    for (i = 0; i < sizeof(periods) / sizeof(periods[0]); i++)
+        test_ramp_host(periods[i], bytes, reports);
+}
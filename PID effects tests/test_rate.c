@@ -0,0 +1,101 @@
+#include "test.h"
+
+#include "ffb_rate.h"
+
+#define TEST_RATE_WARMUP 10
+
+// Settings of main()
+#define TEST_RATE_MIN_MS 1
+#define TEST_RATE_IDLE_MS 20
+#define TEST_RATE_FAST 100
+#define TEST_RATE_IDLE 2
+
+// TEST_RATE_WARMUP ticks of a force moving at warmup units per ms from
+// -16000, or holding level if warmup is 0, then ticks ticks of a force
+// moving at slope units per ms from level. Every tick lasts the period
+// returned by the previous one, as in the writer loop
+typedef struct test_rate_case {
+    const char* name;
+    long warmup;
+    int level;
+    long slope;
+    int ticks;
+    long latency_us;
+    unsigned int first;  // Period after the first tick of the case
+    unsigned int last;   // Period after the last one
+} test_rate_case;
+
+static const test_rate_case test_rate_cases[] = {
+    { "steep",                0, -16000, 200,  50,     0,  1,  1 },
+    { "steep, slow writes",   0, -16000, 200,  50,  3500,  4,  4 },
+    { "steep, latency 1 ms",  0, -16000, 200,  50,  1000,  1,  1 },
+    { "medium",               0, -32000,  51,  50,     0, 11, 11 },
+    { "static",               0,   8000,   0,  50,     0, 20, 20 },
+    { "static after steep", 200,   8000,   0, 100,     0,  1, 20 },
+    { "zero after steep",   200,      0,   0, 100,     0,  1, 20 },
+    { "zero, slow writes",  200,      0,   0, 100, 25000, 25, 25 },
+};
+
+static short test_rate_clamp(long long x) {
+    return (short)(x > 32767 ? 32767 : x < -32767 ? -32767 : x);
+}
+
+static void test_rate_run(const test_rate_case* c) {
+    unsigned int floor_ms = (unsigned int)((c->latency_us + 999) / 1000);
+    unsigned int period = TEST_RATE_IDLE_MS;
+    unsigned int last = 0;
+    long long t = 0;
+    ffb_rate rate;
+    int below = 0, jumps = 0;
+    int n;
+
+    if (floor_ms < TEST_RATE_MIN_MS)
+        floor_ms = TEST_RATE_MIN_MS;
+
+    ffb_rate_init(&rate, TEST_RATE_MIN_MS, TEST_RATE_IDLE_MS, TEST_RATE_FAST, TEST_RATE_IDLE);
+    for (n = 0; n < TEST_RATE_WARMUP; n++) {
+        period = ffb_rate_update(&rate, test_rate_clamp(c->warmup ? -16000 + c->warmup * t : c->level),
+                                 period, c->latency_us);
+        t += period;
+        below += period < floor_ms;
+    }
+
+    t = 0;
+    for (n = 0; n < c->ticks; n++) {
+        t += period;
+        last = period;
+        period = ffb_rate_update(&rate, test_rate_clamp(c->level + c->slope * t), period, c->latency_us);
+        below += period < floor_ms;
+        // Slowing down goes one ms per tick
+        jumps += n > 0 && period > last + 1;
+        if (n == 0 && !TEST_CHECK(period == c->first))
+            printf("  %s: first period %u, expected %u\n", c->name, period, c->first);
+    }
+
+    if (!TEST_CHECK(period == c->last))
+        printf("  %s: last period %u, expected %u\n", c->name, period, c->last);
+    TEST_CHECK(below == 0);
+    TEST_CHECK(jumps == 0);
+}
+
+// The write latency growing during a static force: the period follows it
+// at once rather than one ms per tick
+static void test_rate_latency(void) {
+    ffb_rate rate;
+    int n;
+
+    ffb_rate_init(&rate, TEST_RATE_MIN_MS, TEST_RATE_IDLE_MS, TEST_RATE_FAST, TEST_RATE_IDLE);
+    for (n = 0; n < 5; n++)
+        ffb_rate_update(&rate, (short)(n * 1000), 1, 0);
+    TEST_CHECK(rate.period_ms == TEST_RATE_MIN_MS);
+    TEST_CHECK(ffb_rate_update(&rate, 5000, 1, 8000) == 8);
+    TEST_CHECK(ffb_rate_update(&rate, 6000, 8, 2000) == 2);
+}
+
+void test_rate(void) {
+    unsigned int i;
+
+    for (i = 0; i < sizeof(test_rate_cases) / sizeof(test_rate_cases[0]); i++)
+        test_rate_run(&test_rate_cases[i]);
+    test_rate_latency();
+}
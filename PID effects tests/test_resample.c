@@ -0,0 +1,125 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ffb_resample.h"
+#include "pid_platform.h"
+
+#define TEST_PI 3.14159265
+#define TEST_FRAME_US 16667         // 60 Hz game
+#define TEST_JITTER_US 3000
+#define TEST_HITCH_FRAMES 97        // A frame is dropped every so often
+#define TEST_RUN_MS 5000
+#define TEST_BLOCK 64
+
+static const char* test_resample_names[] = { "linear", "hermite", "sinc" };
+
+// Force computed by the game, a wheel weighting up and down through a corner
+static double test_resample_truth(long long t_us) {
+    double t = (double)t_us / 1000000.0;
+
+    return 9000.0 * sin(2.0 * TEST_PI * 0.8 * t) + 3000.0 * sin(2.0 * TEST_PI * 2.3 * t + 1.0);
+}
+
+static unsigned int test_resample_seed;
+
+static long long test_resample_jitter(void) {
+    test_resample_seed = test_resample_seed * 1103515245u + 12345u;
+    return (long long)((test_resample_seed >> 8) % (2 * TEST_JITTER_US + 1)) - TEST_JITTER_US;
+}
+
+// Plays TEST_RUN_MS of game frames into the resampler, read every ms as
+// the writer loop does. mode -1 holds the last target, as the demo did.
+// The error is against the truth delay_us ago, the buzz is the mean
+// second difference of the output (a staircase has large ones at every
+// frame)
+static void test_resample_run(int mode, long long delay_us, double* rms, double* buzz) {
+    ffb_resample resample;
+    long long frame_us = 0, t_us;
+    short out, previous[2] = { 0, 0 };
+    double error, sum = 0.0, curvature = 0.0;
+    int frame = 0, held = 0, ms, n = 0;
+
+    test_resample_seed = 7;
+    ffb_resample_init(&resample, mode < 0 ? FFB_RESAMPLE_LINEAR : mode, delay_us);
+
+    for (ms = 0; ms < TEST_RUN_MS; ms++) {
+        t_us = (long long)ms * 1000;
+        while (frame_us <= t_us) {
+            if (frame % TEST_HITCH_FRAMES != TEST_HITCH_FRAMES - 1) {
+                held = (int)test_resample_truth(frame_us);
+                ffb_resample_push(&resample, frame_us, (short)held);
+            }
+            frame++;
+            frame_us = (long long)frame * TEST_FRAME_US + test_resample_jitter();
+        }
+
+        out = mode < 0 ? (short)held : ffb_resample_at(&resample, t_us);
+        if (ms < 200)
+            continue; // Filling the history
+        error = out - test_resample_truth(t_us - delay_us);
+        sum += error * error;
+        curvature += fabs((double)out - 2.0 * previous[1] + previous[0]);
+        previous[0] = previous[1];
+        previous[1] = out;
+        n++;
+    }
+
+    *rms = sqrt(sum / n);
+    *buzz = curvature / n;
+    ffb_resample_destroy(&resample);
+}
+
+// Every mode follows the game better than holding, without the staircase,
+// and the higher order ones better than linear
+static void test_resample_fidelity(void) {
+    static const long long delays[] = { 2 * TEST_FRAME_US, 3 * TEST_FRAME_US, 3 * TEST_FRAME_US };
+    double hold_rms, hold_buzz, rms[FFB_RESAMPLE_SINC + 1], buzz;
+    int mode;
+
+    test_resample_run(-1, TEST_FRAME_US / 2, &hold_rms, &hold_buzz);
+    printf("  %-8s error rms %6.1f, buzz %6.1f\n", "hold", hold_rms, hold_buzz);
+
+    for (mode = FFB_RESAMPLE_LINEAR; mode <= FFB_RESAMPLE_SINC; mode++) {
+        test_resample_run(mode, delays[mode], &rms[mode], &buzz);
+        printf("  %-8s error rms %6.1f, buzz %6.1f, %lld ms behind\n", test_resample_names[mode],
+               rms[mode], buzz, delays[mode] / 1000);
+        TEST_CHECK(rms[mode] < hold_rms);
+        TEST_CHECK(buzz < hold_buzz / 4.0);
+    }
+    TEST_CHECK(rms[FFB_RESAMPLE_HERMITE] < rms[FFB_RESAMPLE_LINEAR]);
+    TEST_CHECK(rms[FFB_RESAMPLE_SINC] < rms[FFB_RESAMPLE_LINEAR]);
+}
+
+// Cost of a sample of the writer loop
+static void test_resample_bench(void) {
+    ffb_resample resample;
+    short out[TEST_BLOCK];
+    char name[64];
+    long long start, t_us;
+    long blocks = TEST_BENCH_ITERATIONS / TEST_BLOCK;
+    long i;
+    int mode, k;
+
+    for (mode = FFB_RESAMPLE_LINEAR; mode <= FFB_RESAMPLE_SINC; mode++) {
+        ffb_resample_init(&resample, mode, 3 * TEST_FRAME_US);
+        for (k = 0; k < FFB_RESAMPLE_HISTORY; k++)
+            ffb_resample_push(&resample, (long long)k * TEST_FRAME_US, (short)(k * 1000 - 8000));
+
+        t_us = (long long)(FFB_RESAMPLE_HISTORY - 1) * TEST_FRAME_US;
+        start = pid_time_us();
+        for (i = 0; i < blocks; i++) {
+            ffb_resample_render(&resample, t_us - (i % 256) * 100, 1000, out, TEST_BLOCK);
+            test_sink += (unsigned short)out[i % TEST_BLOCK];
+        }
+        snprintf(name, sizeof(name), "resample, %s, per sample", test_resample_names[mode]);
+        test_bench_report(name, pid_time_us() - start, blocks * TEST_BLOCK);
+        ffb_resample_destroy(&resample);
+    }
+}
+
+void test_resample(void) {
+    test_resample_fidelity();
+    test_resample_bench();
+}
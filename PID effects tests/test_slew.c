@@ -0,0 +1,145 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ffb_slew.h"
+#include "pid_platform.h"
+
+#define TEST_SLEW_STEPS 400         // Samples per target, enough to land
+
+// Samples of the output of a channel after a target step, from rest
+static void test_slew_step(ffb_slew* slew, short from, short to, float dt,
+                           float* max_rate, float* max_jerk, float* overshoot, int* landed) {
+    short target[FFB_SLEW_MAX_CHANNELS] = { 0 };
+    short out[FFB_SLEW_MAX_CHANNELS];
+    float previous[2], rate, last_rate = 0.0f, over;
+    int n;
+
+    // Settles on from
+    target[0] = from;
+    for (n = 0; n < TEST_SLEW_STEPS; n++)
+        ffb_slew_process(slew, target, out, dt);
+    previous[1] = out[0];
+
+    *max_rate = 0.0f;
+    *max_jerk = 0.0f;
+    *overshoot = 0.0f;
+    target[0] = to;
+    for (n = 0; n < TEST_SLEW_STEPS; n++) {
+        ffb_slew_process(slew, target, out, dt);
+        previous[0] = previous[1];
+        previous[1] = out[0];
+
+        rate = (previous[1] - previous[0]) / dt;
+        if (fabsf(rate) > *max_rate)
+            *max_rate = fabsf(rate);
+        if (fabsf(rate - last_rate) / dt > *max_jerk)
+            *max_jerk = fabsf(rate - last_rate) / dt;
+        last_rate = rate;
+
+        over = to > from ? previous[1] - to : to - previous[1];
+        if (over > *overshoot)
+            *overshoot = over;
+    }
+    *landed = out[0] == to;
+}
+
+// Steps from rest stay within the limits of the profile all the way to
+// the target, land on it and do not go past it. The output is rounded,
+// which adds up to 1 unit of error per sample, 2 / dt to the rate and
+// 4 / dt^2 to its change
+static void test_slew_limits(void) {
+    static const float dts[] = { 0.5f, 1.0f, 2.0f };
+    static const short steps[][2] = {
+        { 1500, -1500 }, { -1500, 1500 }, { 0, 32767 }, { 0, 3 }, { 200, 180 }, { -32767, 32767 },
+    };
+    const ffb_slew_profile* profile = ffb_slew_profile_find(0x346e, 0x0002);
+    ffb_slew slew;
+    float max_rate, max_jerk, overshoot, worst_jerk = 0.0f;
+    unsigned int d, s;
+    int landed;
+
+    for (d = 0; d < sizeof(dts) / sizeof(dts[0]); d++) {
+        for (s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+            TEST_CHECK(ffb_slew_init(&slew, 1, profile) == 0);
+            test_slew_step(&slew, steps[s][0], steps[s][1], dts[d], &max_rate, &max_jerk, &overshoot, &landed);
+            TEST_CHECK(landed);
+            TEST_CHECK(overshoot <= 1.0f);
+            TEST_CHECK(max_rate <= profile->slew + 2.0f / dts[d]);
+            TEST_CHECK(max_jerk <= profile->jerk + 4.0f / (dts[d] * dts[d]));
+            if (max_jerk / profile->jerk > worst_jerk)
+                worst_jerk = max_jerk / profile->jerk;
+        }
+    }
+    printf("  worst jerk %.2f of the limit\n", worst_jerk);
+}
+
+// Four and eight channels go through the same steps as one
+static void test_slew_channels(void) {
+    const ffb_slew_profile* profile = ffb_slew_profile_find(0, 0);
+    ffb_slew one, many;
+    short target[FFB_SLEW_MAX_CHANNELS], out[FFB_SLEW_MAX_CHANNELS], expected[FFB_SLEW_MAX_CHANNELS];
+    unsigned int c, n, mismatches = 0;
+
+    ffb_slew_init(&many, FFB_SLEW_MAX_CHANNELS, profile);
+    for (n = 0; n < 2000; n++) {
+        for (c = 0; c < FFB_SLEW_MAX_CHANNELS; c++)
+            target[c] = (short)((n / 150 + c) % 3 == 0 ? 1500 * (int)(c + 1) : -1500 * (int)(c + 1));
+        ffb_slew_process(&many, target, out, 1.0f);
+
+        // Each channel alone, replayed from the start
+        if (n % 97 == 0) {
+            for (c = 0; c < FFB_SLEW_MAX_CHANNELS; c++) {
+                short t[FFB_SLEW_MAX_CHANNELS] = { 0 };
+                unsigned int m;
+
+                ffb_slew_init(&one, 1, profile);
+                for (m = 0; m <= n; m++) {
+                    t[0] = (short)((m / 150 + c) % 3 == 0 ? 1500 * (int)(c + 1) : -1500 * (int)(c + 1));
+                    ffb_slew_process(&one, t, expected, 1.0f);
+                }
+                if (abs(expected[0] - out[c]) > 1)
+                    mismatches++;
+            }
+        }
+    }
+    TEST_CHECK(mismatches == 0);
+}
+
+// Overhead on the writer loop tick, against copying the target through
+static void test_slew_bench(void) {
+    short target[FFB_SLEW_MAX_CHANNELS], out[FFB_SLEW_MAX_CHANNELS];
+    char name[64];
+    ffb_slew slew;
+    long long start;
+    unsigned int channels, c;
+    long i;
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        target[0] = (short)((i / 64) % 2 ? 1500 : -1500);
+        out[0] = target[0];
+        test_sink += (unsigned short)out[0];
+    }
+    test_bench_report("slew, none, per tick", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    for (channels = 1; channels <= FFB_SLEW_MAX_CHANNELS; channels *= FFB_SLEW_MAX_CHANNELS) {
+        ffb_slew_init(&slew, channels, ffb_slew_profile_find(0x346e, 0x0002));
+        start = pid_time_us();
+        for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+            for (c = 0; c < channels; c++)
+                target[c] = (short)(((i / 64) + c) % 2 ? 1500 : -1500);
+            ffb_slew_process(&slew, target, out, 1.0f);
+            test_sink += (unsigned short)out[0];
+        }
+        snprintf(name, sizeof(name), "slew, %u channel%s, per tick", channels, channels > 1 ? "s" : "");
+        test_bench_report(name, pid_time_us() - start, TEST_BENCH_ITERATIONS);
+    }
+}
+
+void test_slew(void) {
+    test_slew_limits();
+    test_slew_channels();
+    test_slew_bench();
+}
@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+
+// SET_EFFECT_REPORT as main() built it before the templates
+static void test_build_set_effect(unsigned char* buf, size_t size, unsigned char index, long duration) {
+    memset(buf, 0x00, size);
+    buf[0] = SET_EFFECT_REPORT_ID;
+    buf[1] = index;      // Index given by the device
+    buf[2] = 0x01;       // Effect Type
+    buf[3] = (unsigned char)duration; // Duration
+    buf[4] = (unsigned char)(duration >> 8);
+    buf[11] = 0xff;      // Gain
+    buf[12] = 0xff;      // Trigger Button
+    buf[13] = 0b00000100; // Padding (5), Direction Enable (1), Axe Enable Y (1), Axe Enable X (1)
+    buf[14] = 0x28;      // Direction X
+    buf[15] = 0x23;
+}
+
+static void test_build_constant_force(unsigned char* buf, size_t size, unsigned char index, short magnitude) {
+    memset(buf, 0x00, size);
+    buf[0] = SET_CONSTANT_FORCE_REPORT_ID;
+    buf[1] = index;
+    buf[2] = (unsigned char)magnitude; // Magnitude
+    buf[3] = (unsigned char)(magnitude >> 8);
+}
+
+// A patched image has the bytes main() used to build from scratch
+static void test_templates_images(void) {
+    unsigned char buf[256];
+    pid_template* t;
+    unsigned char index;
+    long value;
+    int mismatches = 0;
+
+    for (index = 1; index <= PID_MAX_EFFECT_BLOCKS; index++) {
+        for (value = 0; value <= 0xffff; value += 97) {
+            t = pid_template_set_effect(&templates, index, PID_ET_CONSTANT_FORCE, value, 0xff, 0x2328);
+            test_build_set_effect(buf, sizeof(buf), index, value);
+            if (!t || memcmp(t->data, buf, t->length) != 0)
+                mismatches++;
+
+            t = pid_template_set_constant_force(&templates, index, (short)(value - 32768));
+            test_build_constant_force(buf, sizeof(buf), index, (short)(value - 32768));
+            if (!t || memcmp(t->data, buf, t->length) != 0)
+                mismatches++;
+        }
+    }
+    TEST_CHECK(mismatches == 0);
+
+    TEST_CHECK(pid_template_set_constant_force(&templates, 0, 0) == NULL);
+    TEST_CHECK(pid_template_set_constant_force(&templates, PID_MAX_EFFECT_BLOCKS + 1, 0) == NULL);
+    TEST_CHECK(pid_template_effect(&templates, 1, PID_ET_COUNT + 1) == NULL);
+}
+
+// One update: zeroing the 256 byte buffer of main() and building the
+// report, against patching the template
+static void test_templates_bench(void) {
+    unsigned char buf[256];
+    pid_template* t;
+    long long start;
+    long i;
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        test_build_constant_force(buf, sizeof(buf), 1, (short)i);
+        test_sink += buf[2];
+    }
+    test_bench_report("SET_CONSTANT_FORCE, memset + build", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        t = pid_template_set_constant_force(&templates, 1, (short)i);
+        test_sink += t->data[2];
+    }
+    test_bench_report("SET_CONSTANT_FORCE, template patch", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        test_build_set_effect(buf, sizeof(buf), 1, i & 0xffff);
+        test_sink += buf[3];
+    }
+    test_bench_report("SET_EFFECT, memset + build", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+
+    start = pid_time_us();
+    for (i = 0; i < TEST_BENCH_ITERATIONS; i++) {
+        t = pid_template_set_effect(&templates, 1, PID_ET_CONSTANT_FORCE, i & 0xffff, 0xff, 0x2328);
+        test_sink += t->data[3];
+    }
+    test_bench_report("SET_EFFECT, template patch", pid_time_us() - start, TEST_BENCH_ITERATIONS);
+}
+
+void test_templates(void) {
+    const unsigned char* descriptor;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+    TEST_CHECK(templates.fixed == 1);
+
+    test_templates_images();
+    test_templates_bench();
+}
@@ -0,0 +1,99 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "ffb_track.h"
+
+#define TEST_TRACK_RATE 1000
+#define TEST_TRACK_FRAMES 2000
+#define TEST_TRACK_FADE_MS 50
+#define TEST_TRACK_BLOCK 8
+#define TEST_TRACK_PI 3.14159265f
+
+// Largest change between two samples a fade can make between the
+// tracks, plus what they move on their own
+#define TEST_TRACK_MAX_STEP (2 * 12000 / TEST_TRACK_FADE_MS + 200)
+
+static const char* test_track_paths[] = { "test_track_wave.ffbt", "test_track_hold.ffbt" };
+
+typedef struct test_track_output {
+    short last;
+    int started;
+    int max_step;
+} test_track_output;
+
+static void test_track_play(ffb_track_player* player, test_track_output* output, unsigned int blocks) {
+    short block[TEST_TRACK_BLOCK];
+    unsigned int b, n;
+    int step;
+
+    for (b = 0; b < blocks; b++) {
+        ffb_track_render(player, 0, 1, block, TEST_TRACK_BLOCK);
+        for (n = 0; n < TEST_TRACK_BLOCK; n++) {
+            step = abs(block[n] - output->last);
+            if (output->started && step > output->max_step)
+                output->max_step = step;
+            output->last = block[n];
+            output->started = 1;
+        }
+    }
+}
+
+// Restarts and loop seams while a fade is still running carry on from
+// the output, without a step
+static void test_track_fades(ffb_track* tracks) {
+    ffb_track_player player;
+    test_track_output output = { 0 };
+    int wave, hold;
+
+    ffb_track_player_init(&player, 0, TEST_TRACK_FADE_MS);
+    wave = ffb_track_player_add(&player, &tracks[0]);
+    hold = ffb_track_player_add(&player, &tracks[1]);
+
+    ffb_track_play(&player, wave, 0, 0);
+    test_track_play(&player, &output, 20);
+
+    // A fade into the other track, another back before it ends, and a
+    // stop during that one
+    ffb_track_play(&player, hold, 0, 0);
+    test_track_play(&player, &output, 3);
+    ffb_track_play(&player, wave, 600, 0);
+    test_track_play(&player, &output, 2);
+    ffb_track_play(&player, -1, 0, 0);
+    test_track_play(&player, &output, 2);
+    ffb_track_play(&player, hold, 0, 1);
+    test_track_play(&player, &output, 20);
+
+    // The loop seam while the fade from a seek is still running
+    ffb_track_play(&player, wave, TEST_TRACK_FRAMES - TEST_TRACK_FADE_MS - 20, 1);
+    test_track_play(&player, &output, 40);
+    TEST_CHECK(player.loops == 1);
+
+    printf("  largest step %d\n", output.max_step);
+    TEST_CHECK(output.max_step <= TEST_TRACK_MAX_STEP);
+}
+
+void test_track(void) {
+    static short samples[2][TEST_TRACK_FRAMES];
+    ffb_track tracks[2];
+    int n, t;
+
+    for (n = 0; n < TEST_TRACK_FRAMES; n++) {
+        samples[0][n] = (short)(12000.0f * sinf(2.0f * TEST_TRACK_PI * 2.0f * n / TEST_TRACK_RATE));
+        samples[1][n] = -12000;
+    }
+    for (t = 0; t < 2; t++) {
+        if (!TEST_CHECK(ffb_track_save(test_track_paths[t], samples[t], 1, TEST_TRACK_RATE, TEST_TRACK_FRAMES, 256) == 0))
+            return;
+        if (!TEST_CHECK(ffb_track_open(&tracks[t], test_track_paths[t]) == 0))
+            return;
+    }
+
+    test_track_fades(tracks);
+
+    for (t = 0; t < 2; t++) {
+        ffb_track_close(&tracks[t]);
+        remove(test_track_paths[t]);
+    }
+}
@@ -0,0 +1,88 @@
+#include "test.h"
+
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_platform.h"
+#include "pid_reports.h"
+#include "pid_templates.h"
+#include "pid_upload.h"
+#include "pid_writer.h"
+
+#define TEST_UPLOAD_INDEX 1
+
+static pid_codec codec;         // Too large for the stack
+static pid_templates templates;
+
+// Reports of the constant force effect the device got
+static void test_upload_counts(long constant_force, long envelope, long set_effect) {
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[SET_CONSTANT_FORCE_REPORT_ID]) == constant_force);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[SET_ENVELOPE_REPORT_ID]) == envelope);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[SET_EFFECT_REPORT_ID]) == set_effect);
+}
+
+void test_upload(void) {
+    const unsigned char* descriptor;
+    pid_writer writer;
+    pid_upload upload;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+    if (!TEST_CHECK(pid_templates_init(&templates, &codec) == 0))
+        return;
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_upload_init(&upload, &templates, &writer) == 0);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == -1);
+    TEST_CHECK(pid_upload_track(&upload, TEST_UPLOAD_INDEX, PID_ET_CONSTANT_FORCE) == 0);
+    pid_template_set_constant_force(&templates, TEST_UPLOAD_INDEX, 5000);
+    pid_template_set_effect(&templates, TEST_UPLOAD_INDEX, PID_ET_CONSTANT_FORCE, 1000, 0xff, 0x2328);
+
+    // The first flush sends every report of the effect
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 3);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 0);
+
+    // The queue is discarded before the loop ever runs: the copies no
+    // longer match the device and every report is queued again
+    pid_writer_emergency_stop(&writer, PID_DC_STOP_ALL_EFFECTS);
+    pid_writer_resume(&writer);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 3);
+
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    test_upload_counts(1, 1, 1);
+
+    // A change of gain only sends the SET_EFFECT_REPORT
+    pid_template_set_effect(&templates, TEST_UPLOAD_INDEX, PID_ET_CONSTANT_FORCE, 1000, 0x80, 0x2328);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 1);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    test_upload_counts(1, 1, 2);
+    TEST_CHECK(hid_sim_device.last[SET_EFFECT_REPORT_ID][1] == TEST_UPLOAD_INDEX);
+
+    // A change of magnitude only sends the SET_CONSTANT_FORCE_REPORT
+    pid_template_set_constant_force(&templates, TEST_UPLOAD_INDEX, -5000);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 1);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 0);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    test_upload_counts(2, 1, 2);
+    TEST_CHECK(upload.reports_skipped > 0);
+
+    // The write of the next change fails: everything is sent again
+    pid_atomic_store(&hid_sim_device.fail_write, pid_atomic_load(&hid_sim_device.writes) + 1);
+    pid_template_set_constant_force(&templates, TEST_UPLOAD_INDEX, 7000);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 1);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    test_upload_counts(2, 1, 2);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == 3);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    test_upload_counts(3, 2, 3);
+
+    // A forgotten block is not flushed
+    pid_upload_forget(&upload, TEST_UPLOAD_INDEX);
+    TEST_CHECK(pid_upload_flush(&upload, TEST_UPLOAD_INDEX) == -1);
+
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+}
@@ -0,0 +1,149 @@
+#include "test.h"
+
+#include "ffb_watchdog.h"
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_reports.h"
+#include "pid_writer.h"
+
+#define TEST_WATCHDOG_DEADLINE_MS 20
+#define TEST_WATCHDOG_FADE_MS 40
+
+static pid_codec codec; // Too large for the stack
+
+// Waits up to 1 s for the watchdog to reach state, kicking it every ms
+// if kick. Returns 1 once it is reached
+static int test_watchdog_wait(ffb_watchdog* watchdog, long state, int kick) {
+    long long end = pid_time_us() + 1000000;
+
+    while (pid_atomic_load(&watchdog->state) != state) {
+        if (pid_time_us() > end)
+            return 0;
+        if (kick)
+            ffb_watchdog_kick(watchdog);
+        pid_sleep_ms(1);
+    }
+    return 1;
+}
+
+// Runs for ms, kicking every ms if kick
+static void test_watchdog_run(ffb_watchdog* watchdog, unsigned int ms, int kick) {
+    long long end = pid_time_us() + (long long)ms * 1000;
+
+    while (pid_time_us() < end) {
+        if (kick)
+            ffb_watchdog_kick(watchdog);
+        pid_sleep_ms(1);
+    }
+}
+
+// Fills the queue of a writer whose loop is not running
+static void test_watchdog_fill(pid_writer* writer) {
+    unsigned char gain[PID_WRITER_REPORT_MAX] = { DEVICE_GAIN_REPORT_ID, 0xff };
+    size_t length = pid_codec_report_length(&codec, PID_REPORT_OUTPUT, DEVICE_GAIN_REPORT_ID);
+
+    while (pid_writer_submit(writer, gain, length) == 0)
+        ;
+}
+
+// Missed heartbeats fade the force to zero and pause the device, the next
+// one continues it at full force
+static void test_watchdog_fade(void) {
+    ffb_watchdog watchdog;
+    pid_writer writer;
+    long gain, last = FFB_WATCHDOG_UNITY;
+    long long end;
+    int partial = 0, rising = 0;
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    ffb_watchdog_init(&watchdog, &writer, TEST_WATCHDOG_DEADLINE_MS, TEST_WATCHDOG_FADE_MS);
+    TEST_CHECK(ffb_watchdog_start(&watchdog) == 0);
+
+    test_watchdog_run(&watchdog, 3 * TEST_WATCHDOG_DEADLINE_MS, 1);
+    TEST_CHECK(pid_atomic_load(&watchdog.state) == FFB_WATCHDOG_RUNNING);
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 1000);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[PID_DEVICE_CONTROL_REPORT_ID]) == 0);
+
+    // The gain only goes down, through values between full and none
+    end = pid_time_us() + 1000000;
+    while (pid_atomic_load(&watchdog.state) != FFB_WATCHDOG_PAUSED && pid_time_us() < end) {
+        gain = pid_atomic_load(&watchdog.gain);
+        partial |= gain > 0 && gain < FFB_WATCHDOG_UNITY;
+        rising |= gain > last;
+        last = gain;
+        pid_sleep_ms(1);
+    }
+    TEST_CHECK(pid_atomic_load(&watchdog.state) == FFB_WATCHDOG_PAUSED);
+    TEST_CHECK(partial);
+    TEST_CHECK(!rising);
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 0);
+    TEST_CHECK(pid_atomic_load(&watchdog.misses) == 1);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[PID_DEVICE_CONTROL_REPORT_ID]) == 1);
+    TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == PID_DC_DEVICE_PAUSE);
+
+    ffb_watchdog_kick(&watchdog);
+    TEST_CHECK(test_watchdog_wait(&watchdog, FFB_WATCHDOG_RUNNING, 1));
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 1000);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[PID_DEVICE_CONTROL_REPORT_ID]) == 2);
+    TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == PID_DC_DEVICE_CONTINUE);
+
+    ffb_watchdog_stop(&watchdog);
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+}
+
+// A Pause or Continue the writer queue cannot take does not change the
+// state, it is sent once the queue has room again
+static void test_watchdog_full_queue(void) {
+    ffb_watchdog watchdog;
+    pid_writer writer;
+
+    hid_sim_reset(0);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    test_watchdog_fill(&writer);
+    ffb_watchdog_init(&watchdog, &writer, TEST_WATCHDOG_DEADLINE_MS, TEST_WATCHDOG_FADE_MS);
+    TEST_CHECK(ffb_watchdog_start(&watchdog) == 0);
+
+    test_watchdog_run(&watchdog, 2 * (TEST_WATCHDOG_DEADLINE_MS + TEST_WATCHDOG_FADE_MS), 0);
+    TEST_CHECK(pid_atomic_load(&watchdog.state) == FFB_WATCHDOG_FADING);
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 0);
+
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    TEST_CHECK(test_watchdog_wait(&watchdog, FFB_WATCHDOG_PAUSED, 0));
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[PID_DEVICE_CONTROL_REPORT_ID]) == 1);
+    TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == PID_DC_DEVICE_PAUSE);
+
+    pid_writer_stop(&writer);
+    test_watchdog_fill(&writer);
+    test_watchdog_run(&watchdog, TEST_WATCHDOG_DEADLINE_MS, 1);
+    TEST_CHECK(pid_atomic_load(&watchdog.state) == FFB_WATCHDOG_PAUSED);
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 0);
+
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+    TEST_CHECK(test_watchdog_wait(&watchdog, FFB_WATCHDOG_RUNNING, 1));
+    TEST_CHECK(ffb_watchdog_apply(&watchdog, 1000) == 1000);
+    TEST_CHECK(pid_writer_flush(&writer, 1000) == 0);
+    TEST_CHECK(pid_atomic_load(&hid_sim_device.count[PID_DEVICE_CONTROL_REPORT_ID]) == 2);
+    TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == PID_DC_DEVICE_CONTINUE);
+
+    ffb_watchdog_stop(&watchdog);
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+}
+
+void test_watchdog(void) {
+    const unsigned char* descriptor;
+    size_t length;
+
+    descriptor = hid_sim_descriptor(&length);
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+
+    test_watchdog_fade();
+    test_watchdog_full_queue();
+}
@@ -0,0 +1,146 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "hid_sim.h"
+#include "pid_codec.h"
+#include "pid_reports.h"
+#include "pid_writer.h"
+
+// A report waits for the next frame of the interrupt OUT endpoint,
+// 1 ms at full speed
+#define TEST_USB_FRAME_US 1000
+// Time left to the loop thread between two writes. The host does not
+// keep the frames exactly, so the bound is on the start of the stop
+// write rather than on the stop latency as a whole
+#define TEST_STOP_SLACK_US 500
+#define TEST_STOPS 50
+
+static pid_codec codec; // Too large for the stack
+
+static int test_stream(void* ctx, short* magnitude) {
+    (void)ctx;
+    *magnitude = 1000;
+    return 1;
+}
+
+// Waits up to 1 s for count of report_id to reach target
+static int test_wait_report(unsigned char report_id, long target) {
+    long long end = pid_time_us() + 1000000;
+
+    while (pid_atomic_load(&hid_sim_device.count[report_id]) < target) {
+        if (pid_time_us() > end)
+            return 0;
+        pid_sleep_ms(1);
+    }
+    return 1;
+}
+
+// Stops a writer with a full queue: the stop only waits for the write in
+// flight, its own write starts right after, on the next frame, and nothing
+// queued before it is written after it.
+static void test_writer_stop_latency(void) {
+    unsigned char report[PID_WRITER_REPORT_MAX] = { EFFECT_OPERATION_REPORT_ID, 1, 1, 1 };
+    size_t length = pid_codec_report_length(&codec, PID_REPORT_OUTPUT, EFFECT_OPERATION_REPORT_ID);
+    const hid_sim_write* stop;
+    const hid_sim_write* flight;
+    long long requested, returned, free_us, wait_us, worst_wait_us = 0;
+    long stops = 0, queued, operations, n;
+    pid_writer writer;
+    int k;
+
+    hid_sim_reset(TEST_USB_FRAME_US);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_set_stream(&writer, 1, test_stream, NULL) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+
+    for (k = 0; k < TEST_STOPS; k++) {
+        queued = 0;
+        while (pid_writer_submit(&writer, report, length) == 0)
+            queued++;
+        TEST_CHECK(queued > 0);
+
+        // Lands at a different point of the write in flight every time
+        pid_sleep_ms(1 + k % 4);
+        requested = pid_time_us();
+        pid_writer_emergency_stop(&writer, PID_DC_STOP_ALL_EFFECTS);
+        returned = pid_time_us();
+        TEST_CHECK(pid_writer_submit(&writer, report, length) == -1);
+
+        if (!TEST_CHECK(test_wait_report(PID_DEVICE_CONTROL_REPORT_ID, ++stops)))
+            break;
+        TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == PID_DC_STOP_ALL_EFFECTS);
+
+        // The loop writes nothing more while stopped
+        n = pid_atomic_load(&hid_sim_device.writes);
+        stop = &hid_sim_device.log[(n - 1) % HID_SIM_LOG_LEN];
+        flight = &hid_sim_device.log[(n - 2) % HID_SIM_LOG_LEN];
+        TEST_CHECK(stop->report_id == PID_DEVICE_CONTROL_REPORT_ID);
+        TEST_CHECK(flight->start_us <= returned);
+
+        free_us = flight->end_us > requested ? flight->end_us : requested;
+        wait_us = stop->start_us - free_us;
+        if (wait_us > worst_wait_us)
+            worst_wait_us = wait_us;
+
+        // Nothing queued before the stop comes out after it
+        operations = pid_atomic_load(&hid_sim_device.count[EFFECT_OPERATION_REPORT_ID]);
+        pid_sleep_ms(10);
+        TEST_CHECK(pid_atomic_load(&hid_sim_device.count[EFFECT_OPERATION_REPORT_ID]) == operations);
+        TEST_CHECK(pid_atomic_load(&hid_sim_device.writes) == n);
+        pid_writer_resume(&writer);
+    }
+
+    printf("stop latency: last %ld us, worst %ld us, stop write at worst %lld us after the write in flight, %ld dropped\n",
+           pid_atomic_load(&writer.stop_latency_us), pid_atomic_load(&writer.stop_latency_max_us),
+           worst_wait_us, pid_atomic_load(&writer.dropped));
+    TEST_CHECK(worst_wait_us <= TEST_STOP_SLACK_US);
+    TEST_CHECK(pid_atomic_load(&writer.dropped) > 0);
+
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+}
+
+// The safety switch going from 1 to 0 in the PID State Report stops the
+// effects and disables the actuators, ahead of the queue
+static void test_writer_safety_switch(void) {
+    unsigned char report[PID_WRITER_REPORT_MAX] = { EFFECT_OPERATION_REPORT_ID, 1, 1, 1 };
+    unsigned char state[2][3] = {
+        { PID_STATE_REPORT_ID, 1, PID_STATE_SAFETY_SWITCH },
+        { PID_STATE_REPORT_ID, 1, 0 },
+    };
+    size_t length = pid_codec_report_length(&codec, PID_REPORT_OUTPUT, EFFECT_OPERATION_REPORT_ID);
+    pid_writer writer;
+
+    hid_sim_reset(TEST_USB_FRAME_US);
+    TEST_CHECK(pid_writer_init(&writer, hid_sim_handle(), &codec, 1) == 0);
+    TEST_CHECK(pid_writer_start(&writer) == 0);
+
+    TEST_CHECK(hid_sim_input(state[0], sizeof(state[0])) == 0);
+    pid_sleep_ms(5);
+    while (pid_writer_submit(&writer, report, length) == 0)
+        ;
+    TEST_CHECK(hid_sim_input(state[1], sizeof(state[1])) == 0);
+
+    TEST_CHECK(test_wait_report(PID_DEVICE_CONTROL_REPORT_ID, 1));
+    TEST_CHECK(pid_writer_is_stopped(&writer));
+    TEST_CHECK(hid_sim_device.last[PID_DEVICE_CONTROL_REPORT_ID][1] == (PID_DC_STOP_ALL_EFFECTS | PID_DC_DISABLE_ACTUATORS));
+    TEST_CHECK(hid_sim_device.log[(pid_atomic_load(&hid_sim_device.writes) - 1) % HID_SIM_LOG_LEN].report_id == PID_DEVICE_CONTROL_REPORT_ID);
+    printf("safety switch: stop after %ld of %d queued reports\n",
+           pid_atomic_load(&hid_sim_device.count[EFFECT_OPERATION_REPORT_ID]), PID_WRITER_QUEUE_LEN);
+    TEST_CHECK(pid_atomic_load(&writer.dropped) > 0);
+
+    pid_writer_stop(&writer);
+    pid_writer_destroy(&writer);
+}
+
+void test_writer(void) {
+    size_t length;
+    const unsigned char* descriptor = hid_sim_descriptor(&length);
+
+    if (!TEST_CHECK(pid_codec_parse(&codec, descriptor, length) == 0))
+        return;
+
+    test_writer_stop_latency();
+    test_writer_safety_switch();
+}